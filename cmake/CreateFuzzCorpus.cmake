@@ -0,0 +1,40 @@
+# Creates a seed corpus for the fuzz targets based on the string literals found
+# in the unit tests. All literals of a single line are joined with a line break,
+# since that is how the fuzz targets separate their arguments. Every line is
+# written twice, once for each path style. The list of created files is stored
+# in the variable with the submitted name.
+function(create_fuzz_corpus test_directory corpus_directory files)
+  file(REMOVE_RECURSE ${corpus_directory})
+  file(MAKE_DIRECTORY ${corpus_directory})
+  file(GLOB TEST_SOURCES "${test_directory}/*_test.c")
+
+  set(CORPUS_FILES "")
+  foreach(TEST_SOURCE ${TEST_SOURCES})
+    get_filename_component(UNIT_NAME ${TEST_SOURCE} NAME_WE)
+    file(STRINGS ${TEST_SOURCE} LINES REGEX "\"")
+
+    set(INDEX 0)
+    foreach(LINE ${LINES})
+      string(REGEX MATCHALL "\"([^\"\\\\]|\\\\.)*\"" LITERALS "${LINE}")
+      set(ARGUMENTS "")
+      set(SEPARATOR "")
+      foreach(LITERAL ${LITERALS})
+        string(REGEX REPLACE "^\"(.*)\"$" "\\1" LITERAL "${LITERAL}")
+        string(REPLACE "\\\\" "\\" LITERAL "${LITERAL}")
+        string(REPLACE "\\\"" "\"" LITERAL "${LITERAL}")
+        set(ARGUMENTS "${ARGUMENTS}${SEPARATOR}${LITERAL}")
+        set(SEPARATOR "\n")
+      endforeach()
+
+      # The first character selects the style, "0" is windows and "1" is unix.
+      file(WRITE "${corpus_directory}/${UNIT_NAME}_${INDEX}_windows" "0${ARGUMENTS}")
+      file(WRITE "${corpus_directory}/${UNIT_NAME}_${INDEX}_unix" "1${ARGUMENTS}")
+      list(APPEND CORPUS_FILES
+        "${corpus_directory}/${UNIT_NAME}_${INDEX}_windows"
+        "${corpus_directory}/${UNIT_NAME}_${INDEX}_unix")
+      math(EXPR INDEX "${INDEX} + 1")
+    endforeach()
+  endforeach()
+
+  set(${files} ${CORPUS_FILES} PARENT_SCOPE)
+endfunction()
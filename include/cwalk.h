@@ -27,6 +27,34 @@
 #define CWK_PUBLIC
 #endif
 
+/**
+ * Threads are only used on POSIX systems, and they can be disabled by defining
+ * CWK_NO_THREADS, which leaves a library without a threading dependency.
+ */
+#if !defined(CWK_NO_THREADS) && (defined(__unix__) || defined(__APPLE__))
+#define CWK_THREADS
+#endif
+
+/**
+ * The filesystem functions are only available on POSIX systems, since they use
+ * functions like lstat and readlink. They can be disabled by defining
+ * CWK_NO_FILESYSTEM, which leaves a library which never touches the disk. Some
+ * of them use threads, so they are disabled without threads as well.
+ */
+#if !defined(CWK_NO_FILESYSTEM) && defined(CWK_THREADS)
+#define CWK_FILESYSTEM
+#include <stdint.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+
+/**
+ * The live index is built on inotify, which is only available on linux.
+ */
+#if defined(__linux__)
+#define CWK_INOTIFY
+#endif
+#endif
+
 #ifdef __cplusplus
 extern "C"
 {
@@ -46,6 +74,52 @@ struct cwk_segment
   size_t size;
 };
 
+/**
+ * A cursor points to an entry of a front-coded path list. The entry is decoded
+ * into a buffer which is provided by the caller, and the path member points to
+ * that buffer. The decoded path is null-terminated and normalized, so it can
+ * be used with all other functions, like cwk_path_get_first_segment. The
+ * length of the root is stored as well, since a normalized windows path might
+ * look like it has a different root.
+ */
+struct cwk_plist_cursor
+{
+  const void *list;
+  size_t index;
+  size_t position;
+  char *path;
+  size_t path_size;
+  size_t length;
+  size_t root_length;
+};
+
+/**
+ * The class of a path, which is determined by cwk_path_classify. The lowest
+ * three bits contain the kind of the root, which can be extracted using
+ * CWK_CLASS_ROOT. The other bits are flags.
+ *
+ * CWK_CLASS_RELATIVE - no root at all, like "a/b"
+ * CWK_CLASS_SEPARATOR - a single separator, like "/a" or "\\a"
+ * CWK_CLASS_DRIVE - a drive, like "C:\\a" or "C:a"
+ * CWK_CLASS_UNC - a network path, like "\\\\server\\share\\a"
+ * CWK_CLASS_DEVICE - a device path, like "\\\\.\\COM1" or "\\\\?\\C:\\a"
+ * CWK_CLASS_ABSOLUTE - the path is absolute
+ * CWK_CLASS_WINDOWS - the path most likely uses the windows style
+ * CWK_CLASS_ASCII - the path only contains ASCII characters
+ */
+enum cwk_path_class
+{
+  CWK_CLASS_RELATIVE = 0x00,
+  CWK_CLASS_SEPARATOR = 0x01,
+  CWK_CLASS_DRIVE = 0x02,
+  CWK_CLASS_UNC = 0x03,
+  CWK_CLASS_DEVICE = 0x04,
+  CWK_CLASS_ROOT = 0x07,
+  CWK_CLASS_ABSOLUTE = 0x08,
+  CWK_CLASS_WINDOWS = 0x10,
+  CWK_CLASS_ASCII = 0x20
+};
+
 /**
  * The segment type can be used to identify whether a segment is a special
  * segment or not.
@@ -61,6 +135,18 @@ enum cwk_segment_type
   CWK_BACK
 };
 
+/**
+ * A span describes a single segment of a path, which is determined by
+ * cwk_path_split. Unlike a segment, it only stores the position of the segment
+ * within the path, so a whole array of them can be filled at once.
+ */
+struct cwk_span
+{
+  size_t offset;
+  size_t length;
+  enum cwk_segment_type type;
+};
+
 /**
  * @brief Determines the style which is used for the path parsing and
  * generation.
@@ -93,6 +179,25 @@ enum cwk_path_style
 CWK_PUBLIC size_t cwk_path_get_absolute(const char *base, const char *path,
   char *buffer, size_t buffer_size);
 
+/**
+ * @brief Generates an absolute path based on a base with known sizes.
+ *
+ * This function works just like cwk_path_get_absolute, but the paths don't
+ * have to be null-terminated. No character beyond the submitted sizes is read.
+ *
+ * @param base The absolute base path on which the relative path will be
+ * applied.
+ * @param base_size The number of characters in the base path.
+ * @param path The relative path which will be applied on the base path.
+ * @param path_size The number of characters in the path.
+ * @param buffer The buffer where the result will be written to.
+ * @param buffer_size The size of the buffer.
+ * @return Returns the total amount of characters of the new path.
+ */
+CWK_PUBLIC size_t cwk_path_get_absolute_sized(const char *base,
+  size_t base_size, const char *path, size_t path_size, char *buffer,
+  size_t buffer_size);
+
 /**
  * @brief Generates a relative path based on a base.
  *
@@ -114,6 +219,24 @@ CWK_PUBLIC size_t cwk_path_get_absolute(const char *base, const char *path,
 CWK_PUBLIC size_t cwk_path_get_relative(const char *base_directory,
   const char *path, char *buffer, size_t buffer_size);
 
+/**
+ * @brief Generates a relative path based on a base with known sizes.
+ *
+ * This function works just like cwk_path_get_relative, but the paths don't
+ * have to be null-terminated. No character beyond the submitted sizes is read.
+ *
+ * @param base_directory The base path from which the relative path will start.
+ * @param base_directory_size The number of characters in the base path.
+ * @param path The target path where the relative path will point to.
+ * @param path_size The number of characters in the target path.
+ * @param buffer The buffer where the result will be written to.
+ * @param buffer_size The size of the buffer.
+ * @return Returns the total amount of characters of the new path.
+ */
+CWK_PUBLIC size_t cwk_path_get_relative_sized(const char *base_directory,
+  size_t base_directory_size, const char *path, size_t path_size,
+  char *buffer, size_t buffer_size);
+
 /**
  * @brief Joins two paths together.
  *
@@ -135,6 +258,23 @@ CWK_PUBLIC size_t cwk_path_get_relative(const char *base_directory,
 CWK_PUBLIC size_t cwk_path_join(const char *path_a, const char *path_b,
   char *buffer, size_t buffer_size);
 
+/**
+ * @brief Joins two paths with known sizes together.
+ *
+ * This function works just like cwk_path_join, but the paths don't have to be
+ * null-terminated. No character beyond the submitted sizes is read.
+ *
+ * @param path_a The first path which comes first.
+ * @param path_a_size The number of characters in the first path.
+ * @param path_b The second path which comes after the first.
+ * @param path_b_size The number of characters in the second path.
+ * @param buffer The buffer where the result will be written to.
+ * @param buffer_size The size of the buffer.
+ * @return Returns the total amount of characters of the new path.
+ */
+CWK_PUBLIC size_t cwk_path_join_sized(const char *path_a, size_t path_a_size,
+  const char *path_b, size_t path_b_size, char *buffer, size_t buffer_size);
+
 /**
  * @brief Joins multiple paths together.
  *
@@ -168,6 +308,19 @@ CWK_PUBLIC size_t cwk_path_join_multiple(const char **paths, char *buffer,
  */
 CWK_PUBLIC void cwk_path_get_root(const char *path, size_t *length);
 
+/**
+ * @brief Determines the root of a path with a known size.
+ *
+ * This function works just like cwk_path_get_root, but the path doesn't have
+ * to be null-terminated. No character beyond the submitted size is read.
+ *
+ * @param path The path which will be inspected.
+ * @param path_size The number of characters in the path.
+ * @param length The output of the root length.
+ */
+CWK_PUBLIC void cwk_path_get_root_sized(const char *path, size_t path_size,
+  size_t *length);
+
 /**
  * @brief Changes the root of a path.
  *
@@ -188,6 +341,25 @@ CWK_PUBLIC void cwk_path_get_root(const char *path, size_t *length);
 CWK_PUBLIC size_t cwk_path_change_root(const char *path, const char *new_root,
   char *buffer, size_t buffer_size);
 
+/**
+ * @brief Changes the root of a path with a known size.
+ *
+ * This function works just like cwk_path_change_root, but neither the path
+ * nor the new root have to be null-terminated. They must not contain any
+ * null-terminating characters within the submitted sizes.
+ *
+ * @param path The original path which will get a new root.
+ * @param path_size The number of characters in the path.
+ * @param new_root The new root which will be placed in the path.
+ * @param new_root_size The number of characters in the new root.
+ * @param buffer The buffer where the result will be written to.
+ * @param buffer_size The size of the buffer.
+ * @return Returns the total amount of characters of the new path.
+ */
+CWK_PUBLIC size_t cwk_path_change_root_sized(const char *path,
+  size_t path_size, const char *new_root, size_t new_root_size, char *buffer,
+  size_t buffer_size);
+
 /**
  * @brief Determine whether the path is absolute or not.
  *
@@ -249,6 +421,25 @@ CWK_PUBLIC void cwk_path_get_basename(const char *path, const char **basename,
 CWK_PUBLIC size_t cwk_path_change_basename(const char *path,
   const char *new_basename, char *buffer, size_t buffer_size);
 
+/**
+ * @brief Changes the basename of a path with a known size.
+ *
+ * This function works just like cwk_path_change_basename, but neither the
+ * path nor the new basename have to be null-terminated. They must not contain
+ * any null-terminating characters within the submitted sizes.
+ *
+ * @param path The original path which will be used for the modified path.
+ * @param path_size The number of characters in the path.
+ * @param new_basename The new basename which will replace the old one.
+ * @param new_basename_size The number of characters in the new basename.
+ * @param buffer The buffer where the result will be written to.
+ * @param buffer_size The size of the buffer.
+ * @return Returns the total amount of characters of the new path.
+ */
+CWK_PUBLIC size_t cwk_path_change_basename_sized(const char *path,
+  size_t path_size, const char *new_basename, size_t new_basename_size,
+  char *buffer, size_t buffer_size);
+
 /**
  * @brief Gets the dirname of a file path.
  *
@@ -315,6 +506,113 @@ CWK_PUBLIC bool cwk_path_has_extension(const char *path);
 CWK_PUBLIC size_t cwk_path_change_extension(const char *path,
   const char *new_extension, char *buffer, size_t buffer_size);
 
+/**
+ * @brief Changes the extension of a path with a known size.
+ *
+ * This function works just like cwk_path_change_extension, but neither the
+ * path nor the new extension have to be null-terminated. They must not contain
+ * any null-terminating characters within the submitted sizes.
+ *
+ * @param path The path which will be used to make the change.
+ * @param path_size The number of characters in the path.
+ * @param new_extension The extension which will be placed within the new path.
+ * @param new_extension_size The number of characters in the new extension.
+ * @param buffer The buffer where the result will be written to.
+ * @param buffer_size The size of the buffer.
+ * @return Returns the total amount of characters of the new path.
+ */
+CWK_PUBLIC size_t cwk_path_change_extension_sized(const char *path,
+  size_t path_size, const char *new_extension, size_t new_extension_size,
+  char *buffer, size_t buffer_size);
+
+/**
+ * @brief Changes the root of multiple paths at once.
+ *
+ * This function changes the root of every submitted path just like
+ * cwk_path_change_root does it, but writes all results one after another into
+ * the same buffer. Every result is null-terminated and its position within the
+ * buffer is written to the offsets. If the buffer is too small, the results
+ * which don't fit are truncated, but the offsets are still calculated. The
+ * buffer must not overlap with any of the paths.
+ *
+ * @param paths The paths which will be changed.
+ * @param count The number of paths.
+ * @param new_root The new root which will be placed in every path.
+ * @param buffer The output buffer where the results will be written to.
+ * @param buffer_size The size of the output buffer.
+ * @param offsets The offsets of the results within the buffer, one per path.
+ * @return Returns the total size of all results including their
+ * null-terminating characters.
+ */
+CWK_PUBLIC size_t cwk_path_change_root_batch(const char **paths, size_t count,
+  const char *new_root, char *buffer, size_t buffer_size, size_t *offsets);
+
+/**
+ * @brief Changes the basename of multiple paths at once.
+ *
+ * This function changes the basename of every submitted path just like
+ * cwk_path_change_basename does it, but writes all results one after another
+ * into the same buffer. The buffer and the offsets are used just like
+ * cwk_path_change_root_batch uses them.
+ *
+ * @param paths The paths which will be changed.
+ * @param count The number of paths.
+ * @param new_basename The new basename which will be placed in every path.
+ * @param buffer The output buffer where the results will be written to.
+ * @param buffer_size The size of the output buffer.
+ * @param offsets The offsets of the results within the buffer, one per path.
+ * @return Returns the total size of all results including their
+ * null-terminating characters.
+ */
+CWK_PUBLIC size_t cwk_path_change_basename_batch(const char **paths,
+  size_t count, const char *new_basename, char *buffer, size_t buffer_size,
+  size_t *offsets);
+
+/**
+ * @brief Changes the extension of multiple paths at once.
+ *
+ * This function changes the extension of every submitted path just like
+ * cwk_path_change_extension does it, but writes all results one after another
+ * into the same buffer. The buffer and the offsets are used just like
+ * cwk_path_change_root_batch uses them.
+ *
+ * @param paths The paths which will be changed.
+ * @param count The number of paths.
+ * @param new_extension The new extension which will be placed in every path.
+ * @param buffer The output buffer where the results will be written to.
+ * @param buffer_size The size of the output buffer.
+ * @param offsets The offsets of the results within the buffer, one per path.
+ * @return Returns the total size of all results including their
+ * null-terminating characters.
+ */
+CWK_PUBLIC size_t cwk_path_change_extension_batch(const char **paths,
+  size_t count, const char *new_extension, char *buffer, size_t buffer_size,
+  size_t *offsets);
+
+/**
+ * @brief Changes the root and the extension of multiple paths at once.
+ *
+ * This function changes both the extension and the root of every submitted
+ * path, while every path is only scanned once. This can be used to map source
+ * files to output files, for instance "main.c" to "build/main.o". The result
+ * is the same as changing the extension first and the root of the original
+ * path afterwards. The buffer and the offsets are used just like
+ * cwk_path_change_root_batch uses them.
+ *
+ * @param paths The paths which will be changed.
+ * @param count The number of paths.
+ * @param new_root The new root which will be placed in every path.
+ * @param new_extension The new extension which will be placed in every path.
+ * @param buffer The output buffer where the results will be written to.
+ * @param buffer_size The size of the output buffer.
+ * @param offsets The offsets of the results within the buffer, one per path.
+ * @return Returns the total size of all results including their
+ * null-terminating characters.
+ */
+CWK_PUBLIC size_t cwk_path_relocate_batch(const char **paths, size_t count,
+  const char *new_root, const char *new_extension, char *buffer,
+  size_t buffer_size, size_t *offsets);
+
 /**
  * @brief Creates a normalized version of the path.
  *
@@ -341,12 +639,71 @@ CWK_PUBLIC size_t cwk_path_change_extension(const char *path,
 CWK_PUBLIC size_t cwk_path_normalize(const char *path, char *buffer,
   size_t buffer_size);
 
+/**
+ * @brief Creates a normalized version of a path with a known size.
+ *
+ * This function works just like cwk_path_normalize, but the path doesn't have
+ * to be null-terminated. No character beyond the submitted size is read, so
+ * the function can be used on a part of a larger string.
+ *
+ * @param path The path which will be normalized.
+ * @param path_size The number of characters in the path.
+ * @param buffer The buffer where the result will be written to.
+ * @param buffer_size The size of the buffer.
+ * @return Returns the total amount of characters of the new path.
+ */
+CWK_PUBLIC size_t cwk_path_normalize_sized(const char *path, size_t path_size,
+  char *buffer, size_t buffer_size);
+
+/**
+ * @brief Normalizes a path in place.
+ *
+ * This function normalizes the path within its own memory, using the same
+ * rules as cwk_path_normalize. The path is processed in a single forward pass
+ * and the normalized path is never longer than the original one, so no
+ * additional buffer is required.
+ *
+ * @param path The path which will be normalized.
+ * @return Returns the length of the normalized path.
+ */
+CWK_PUBLIC size_t cwk_path_normalize_inplace(char *path);
+
+/**
+ * @brief Determines whether a path is normalized.
+ *
+ * This function checks whether the path is equal to its normalized version,
+ * so that cwk_path_normalize would not change anything. The path is only
+ * scanned once and nothing is written.
+ *
+ * @param path The path which will be checked.
+ * @return Returns true if the path is normalized or false otherwise.
+ */
+CWK_PUBLIC bool cwk_path_is_normalized(const char *path);
+
+/**
+ * @brief Gets the normalized version of a path.
+ *
+ * This function returns the path itself if it is already normalized, without
+ * touching the buffer. Otherwise the path is normalized into the buffer and
+ * the buffer is returned. The result is always null-terminated, but it will
+ * be truncated if the buffer is too small.
+ *
+ * @param path The path which will be normalized.
+ * @param buffer The buffer where the normalized path might be written to.
+ * @param buffer_size The size of the buffer.
+ * @param length The total length of the normalized path.
+ * @return Returns either the path or the buffer.
+ */
+CWK_PUBLIC const char *cwk_path_get_normalized(const char *path, char *buffer,
+  size_t buffer_size, size_t *length);
+
 /**
  * @brief Finds common portions in two paths.
  *
  * This function finds common portions in two paths and returns the number
  * characters from the beginning of the base path which are equal to the other
- * path.
+ * path. Windows paths are compared case insensitively, which includes UTF-8
+ * letters whose folded form has the same encoded length.
  *
  * @param path_base The base path which will be compared with the other path.
  * @param path_other The other path which will compared with the base path.
@@ -355,6 +712,109 @@ CWK_PUBLIC size_t cwk_path_normalize(const char *path, char *buffer,
 CWK_PUBLIC size_t cwk_path_get_intersection(const char *path_base,
   const char *path_other);
 
+/**
+ * @brief Finds common portions in multiple paths.
+ *
+ * This function finds the common portion of all submitted paths and returns
+ * the number of characters from the beginning of the first path which are
+ * equal to all the other paths. The paths are compared segment by segment,
+ * using the same rules as cwk_path_get_intersection.
+ *
+ * @param paths An array of paths which will be compared.
+ * @param count The number of paths in the array.
+ * @return Returns the number of characters which are common in the first path.
+ */
+CWK_PUBLIC size_t cwk_path_get_intersection_multiple(const char **paths,
+  size_t count);
+
+/**
+ * @brief Compares two paths segment by segment.
+ *
+ * This function compares two paths and determines their order. Paths are
+ * ordered by their segments, which means that a separator sorts before any
+ * other character. For instance "a/b" sorts before "a-b", so the contents of
+ * a folder stay together. Windows paths are compared case insensitively and
+ * both of its separators are equal. The paths are not normalized, so they
+ * should already be normalized to get a strict segment order.
+ *
+ * @param path_a The first path which will be compared.
+ * @param path_b The second path which will be compared.
+ * @return Returns a negative value if the first path sorts before the second
+ * path, a positive value if it sorts after it or zero if both are equal.
+ */
+CWK_PUBLIC int cwk_path_compare(const char *path_a, const char *path_b);
+
+/**
+ * @brief Sorts an array of paths segment by segment.
+ *
+ * This function sorts an array of paths in place, using the same order as
+ * cwk_path_compare. Common prefixes of the paths are only compared once, which
+ * makes this faster than a sort based on comparisons for large arrays of paths
+ * with long prefixes. The sort is not stable.
+ *
+ * @param paths The array of paths which will be sorted.
+ * @param count The number of paths in the array.
+ */
+CWK_PUBLIC void cwk_path_sort(const char **paths, size_t count);
+
+#ifdef CWK_THREADS
+/**
+ * @brief Sorts an array of paths segment by segment with several threads.
+ *
+ * This function sorts an array of paths in place, in the same order as
+ * cwk_path_sort. The array is split into ranges by the same partitions the
+ * sequential sort uses, so every range holds all paths with a common prefix,
+ * and the ranges are sorted by different threads. Arrays which are too small
+ * to be worth the threads are sorted by the calling thread alone. This
+ * function is not available if CWK_NO_THREADS is defined.
+ *
+ * @param paths The array of paths which will be sorted.
+ * @param count The number of paths in the array.
+ * @param thread_count The maximum number of threads including the calling
+ * thread, or zero to use one thread for every processor.
+ */
+CWK_PUBLIC void cwk_path_sort_parallel(const char **paths, size_t count,
+  size_t thread_count);
+#endif
+
+/**
+ * @brief Finds all unique paths in an array of paths.
+ *
+ * This function assigns an id to every path, so that two paths get the same
+ * id if they are equal after normalization. The ids are assigned in the order
+ * in which the unique paths appear first, starting at zero. So a path is the
+ * first one of its kind if its id is equal to the number of unique paths found
+ * before it. The paths are never normalized into a buffer, instead the
+ * normalized segments are hashed and compared directly.
+ *
+ * The table is used as a hash table and must be at least as large as the
+ * number of paths, but a table which is twice as large is recommended. The
+ * content of the table is overwritten.
+ *
+ * @param paths The array of paths which will be deduplicated.
+ * @param count The number of paths in the array.
+ * @param ids The array which receives the id of every path.
+ * @param table The memory which is used as a hash table.
+ * @param table_size The number of entries in the table.
+ * @return Returns the number of unique paths, or zero if the table is too
+ * small.
+ */
+CWK_PUBLIC size_t cwk_path_dedup(const char **paths, size_t count, size_t *ids,
+  size_t *table, size_t table_size);
+
+/**
+ * @brief Hashes a path the way it would be after normalization.
+ *
+ * This function calculates a hash of the path, which is the same for all paths
+ * which are equal after normalization, using the same rules as
+ * cwk_path_dedup. Windows paths are hashed case insensitively and both of its
+ * separators are equal. The path is never normalized into a buffer.
+ *
+ * @param path The path which will be hashed.
+ * @return Returns the hash of the path.
+ */
+CWK_PUBLIC size_t cwk_path_hash(const char *path);
+
 /**
  * @brief Gets the first segment of a path.
  *
@@ -424,6 +884,84 @@ CWK_PUBLIC bool cwk_path_get_previous_segment(struct cwk_segment *segment);
 CWK_PUBLIC enum cwk_segment_type cwk_path_get_segment_type(
   const struct cwk_segment *segment);
 
+/**
+ * @brief Splits a path into all of its segments at once.
+ *
+ * This function determines the offset, the length and the type of every
+ * segment of the path and writes them to the submitted array of spans. The
+ * segments are the same ones which cwk_path_get_first_segment and
+ * cwk_path_get_next_segment would return. If there are more segments than the
+ * array can hold, only the first ones are written, but all of them are
+ * counted.
+ *
+ * @param path The path which will be split.
+ * @param spans The array where the spans will be written to.
+ * @param max The number of spans which fit into the array.
+ * @return Returns the total number of segments in the path.
+ */
+CWK_PUBLIC size_t cwk_path_split(const char *path, struct cwk_span *spans,
+  size_t max);
+
+/**
+ * @brief Splits a path with a known size into all of its segments at once.
+ *
+ * This function works just like cwk_path_split, but the path doesn't have to
+ * be null-terminated. The path must not contain any null-terminating
+ * characters within the submitted size.
+ *
+ * @param path The path which will be split.
+ * @param path_size The number of characters in the path.
+ * @param spans The array where the spans will be written to.
+ * @param max The number of spans which fit into the array.
+ * @return Returns the total number of segments in the path.
+ */
+CWK_PUBLIC size_t cwk_path_split_sized(const char *path, size_t path_size,
+  struct cwk_span *spans, size_t max);
+
+/**
+ * @brief Gets the first segment of a path with a known size.
+ *
+ * This function finds the first segment of a path, just like
+ * cwk_path_get_first_segment, and stores its position in the span. The path
+ * doesn't have to be null-terminated, but it must not contain any
+ * null-terminating characters within the submitted size.
+ *
+ * @param path The path which will be inspected.
+ * @param path_size The number of characters in the path.
+ * @param span The span which will be filled.
+ * @return Returns true if there is a segment or false if there is none.
+ */
+CWK_PUBLIC bool cwk_path_get_first_span(const char *path, size_t path_size,
+  struct cwk_span *span);
+
+/**
+ * @brief Advances to the next segment of a path with a known size.
+ *
+ * This function moves the span to the segment which follows it. If there is
+ * no other segment, the span stays unchanged and false is returned.
+ *
+ * @param path The path which will be inspected.
+ * @param path_size The number of characters in the path.
+ * @param span The span which will be advanced.
+ * @return Returns true if there is another segment or false otherwise.
+ */
+CWK_PUBLIC bool cwk_path_get_next_span(const char *path, size_t path_size,
+  struct cwk_span *span);
+
+/**
+ * @brief Gets the last segment of a path with a known size.
+ *
+ * This function finds the last segment of a path, just like
+ * cwk_path_get_last_segment, without looking at any of the other segments.
+ *
+ * @param path The path which will be inspected.
+ * @param path_size The number of characters in the path.
+ * @param span The span which will be filled.
+ * @return Returns true if there is a segment or false if there is none.
+ */
+CWK_PUBLIC bool cwk_path_get_last_span(const char *path, size_t path_size,
+  struct cwk_span *span);
+
 /**
  * @brief Changes the content of a segment.
  *
@@ -458,16 +996,1005 @@ CWK_PUBLIC size_t cwk_path_change_segment(struct cwk_segment *segment,
 CWK_PUBLIC bool cwk_path_is_separator(const char *str);
 
 /**
- * @brief Guesses the path style.
+ * @brief Builds a prefix trie from an array of paths.
  *
- * This function guesses the path style based on a submitted path-string. The
- * guessing will look at the root and the type of slashes contained in the
- * path and return the style which is more likely used in the path.
+ * This function builds a trie of the submitted paths, which allows to find the
+ * longest path containing another path in time proportional to the depth of
+ * that path. The paths are normalized while they are inserted, so "a/./b" and
+ * "a/b" are the same entry. The empty path stays apart from ".", just like
+ * after cwk_path_normalize. The trie is written to the buffer, but only if it
+ * is large enough. The buffer must be aligned to at least four bytes. Once
+ * built, the trie is never modified and can be shared between threads.
  *
- * @param path The path which will be inspected.
- * @return Returns the style which is most likely used for the path.
+ * The paths array is sorted by this function. Every unique path becomes an
+ * entry, and the entries are numbered in sorted order, starting at zero. The
+ * spans must have room for one span per path, which keeps track of the
+ * position within that path while the paths are sorted. Their content is
+ * overwritten.
+ *
+ * @param paths The array of paths which will be inserted.
+ * @param count The number of paths in the array.
+ * @param spans The array of spans which is used while sorting.
+ * @param buffer The buffer where the trie will be written to.
+ * @param buffer_size The size of the buffer.
+ * @return Returns the size of the trie, or zero if the trie is too large.
  */
-CWK_PUBLIC enum cwk_path_style cwk_path_guess_style(const char *path);
+CWK_PUBLIC size_t cwk_ptrie_build(const char **paths, size_t count,
+  struct cwk_span *spans, void *buffer, size_t buffer_size);
+
+/**
+ * @brief Gets the number of entries in a prefix trie.
+ *
+ * @param trie The prefix trie.
+ * @return Returns the number of unique paths in the trie.
+ */
+CWK_PUBLIC size_t cwk_ptrie_get_entry_count(const void *trie);
+
+/**
+ * @brief Finds the longest entry of a prefix trie containing a path.
+ *
+ * This function searches the trie for the longest entry which contains the
+ * submitted path. An entry contains a path if the root is equal and all
+ * segments of the entry are the first segments of the path after
+ * normalization. The empty path has no root at all, so an entry of the empty
+ * path contains every path. The trie must be used with the same path style
+ * which was used to build it.
+ *
+ * @param trie The prefix trie.
+ * @param path The path which will be searched.
+ * @param entry The index of the longest entry containing the path.
+ * @param length The number of characters in the path which are contained in
+ * the entry.
+ * @return Returns true if an entry contains the path or false otherwise.
+ */
+CWK_PUBLIC bool cwk_ptrie_find_longest(const void *trie, const char *path,
+  size_t *entry, size_t *length);
+
+/**
+ * @brief Finds an entry of a prefix trie.
+ *
+ * This function searches the trie for an entry which is equal to the submitted
+ * path after normalization.
+ *
+ * @param trie The prefix trie.
+ * @param path The path which will be searched.
+ * @param entry The index of the entry.
+ * @return Returns true if the entry exists or false otherwise.
+ */
+CWK_PUBLIC bool cwk_ptrie_find(const void *trie, const char *path,
+  size_t *entry);
+
+/**
+ * @brief Finds all entries of a prefix trie within a path.
+ *
+ * This function searches the trie for all entries which are contained in the
+ * submitted path, including the path itself. Since the entries are numbered
+ * in sorted order, those entries are always next to each other.
+ *
+ * @param trie The prefix trie.
+ * @param path The path which will be searched.
+ * @param first The index of the first entry within the path.
+ * @param count The number of entries within the path.
+ * @return Returns true if there are any entries within the path or false
+ * otherwise.
+ */
+CWK_PUBLIC bool cwk_ptrie_find_prefix(const void *trie, const char *path,
+  size_t *first, size_t *count);
+
+/**
+ * @brief Gets the path of an entry in a prefix trie.
+ *
+ * This function writes the normalized path of an entry to the buffer. The
+ * result is truncated if the buffer is too small, but the full length is
+ * returned.
+ *
+ * @param trie The prefix trie.
+ * @param entry The index of the entry.
+ * @param buffer The buffer where the path will be written to.
+ * @param buffer_size The size of the buffer.
+ * @return Returns the total length of the path, or zero if the entry does not
+ * exist.
+ */
+CWK_PUBLIC size_t cwk_ptrie_get_path(const void *trie, size_t entry,
+  char *buffer, size_t buffer_size);
+
+/**
+ * @brief Determines whether memory contains a valid prefix trie.
+ *
+ * This function verifies that the submitted memory contains a prefix trie
+ * which can be used safely, for instance after it has been read or mapped
+ * from a file. A trie is only valid if it has been built on a machine with the
+ * same byte order. The trie functions don't verify the trie themselves, so
+ * this should be used for any trie which is not trusted.
+ *
+ * @param buffer The memory which contains the trie.
+ * @param buffer_size The size of the memory.
+ * @return Returns true if the memory contains a valid trie or false otherwise.
+ */
+CWK_PUBLIC bool cwk_ptrie_is_valid(const void *buffer, size_t buffer_size);
+
+/**
+ * @brief Builds a front-coded list from an array of paths.
+ *
+ * This function builds a compact list of the submitted paths. The paths are
+ * normalized and sorted, and equal paths are only stored once. The empty path
+ * is stored empty and comes first, so it is not equal to ".". Every path only
+ * stores the segments which are not shared with the previous path, except for
+ * the first path of every block, which is stored in full. The block size
+ * determines how many paths have to be decoded at most to access any path.
+ * The list is written to the buffer, but only if it is large enough. The
+ * buffer must be aligned to at least eight bytes.
+ *
+ * The paths array is sorted by this function. The spans must have room for
+ * one span per path, just like for cwk_ptrie_build.
+ *
+ * @param paths The array of paths which will be stored.
+ * @param count The number of paths in the array.
+ * @param block_size The number of paths in every block.
+ * @param spans The array of spans which is used while sorting.
+ * @param buffer The buffer where the list will be written to.
+ * @param buffer_size The size of the buffer.
+ * @return Returns the size of the list, or zero if the block size is invalid.
+ */
+CWK_PUBLIC size_t cwk_plist_build(const char **paths, size_t count,
+  size_t block_size, struct cwk_span *spans, void *buffer, size_t buffer_size);
+
+/**
+ * @brief Gets the number of paths in a front-coded list.
+ *
+ * @param list The front-coded list.
+ * @return Returns the number of unique paths in the list.
+ */
+CWK_PUBLIC size_t cwk_plist_get_count(const void *list);
+
+/**
+ * @brief Gets the length of the longest path in a front-coded list.
+ *
+ * A buffer which is used to decode paths of the list must be larger than this
+ * length, so it can hold the null-terminating character as well.
+ *
+ * @param list The front-coded list.
+ * @return Returns the length of the longest path in the list.
+ */
+CWK_PUBLIC size_t cwk_plist_get_max_length(const void *list);
+
+/**
+ * @brief Decodes a path of a front-coded list.
+ *
+ * This function decodes the path with the submitted index into the buffer and
+ * initializes the cursor, so that it can be used to decode the following paths.
+ *
+ * @param list The front-coded list.
+ * @param index The index of the path.
+ * @param cursor The cursor which will be initialized.
+ * @param buffer The buffer where the path will be decoded to.
+ * @param buffer_size The size of the buffer.
+ * @return Returns true if the path was decoded or false if the index or the
+ * buffer size is invalid.
+ */
+CWK_PUBLIC bool cwk_plist_seek(const void *list, size_t index,
+  struct cwk_plist_cursor *cursor, char *buffer, size_t buffer_size);
+
+/**
+ * @brief Decodes the next path of a front-coded list.
+ *
+ * This function advances the cursor to the next path of the list. Only the
+ * part of the path which is not shared with the previous path is copied.
+ *
+ * @param cursor The cursor which will be advanced.
+ * @return Returns true if there was another path or false otherwise.
+ */
+CWK_PUBLIC bool cwk_plist_next(struct cwk_plist_cursor *cursor);
+
+/**
+ * @brief Finds a path in a front-coded list.
+ *
+ * This function searches the list for a path which is equal to the submitted
+ * path after normalization. If the path is found, the cursor points to it. The
+ * list must be used with the same path style which was used to build it.
+ *
+ * @param list The front-coded list.
+ * @param path The path which will be searched.
+ * @param cursor The cursor which will point to the path.
+ * @param buffer The buffer where paths will be decoded to.
+ * @param buffer_size The size of the buffer.
+ * @return Returns true if the path was found or false otherwise.
+ */
+CWK_PUBLIC bool cwk_plist_find(const void *list, const char *path,
+  struct cwk_plist_cursor *cursor, char *buffer, size_t buffer_size);
+
+/**
+ * @brief Builds a compiled set of file extensions.
+ *
+ * This function builds a set of extensions in the submitted buffer, which can
+ * be used to match paths against all extensions at once. Each extension is
+ * found with a single lookup in a perfect hash table, no matter how many
+ * extensions the set contains. The leading dot of the extensions is optional
+ * and extensions may contain dots themselves, like "tar.gz". If the case is
+ * ignored, extensions are compared the same way as paths in the Windows style.
+ * The buffer must be aligned to at least eight bytes. If the buffer is NULL or
+ * too small, the required size is returned but nothing is written.
+ *
+ * @param extensions The extensions which will be added to the set.
+ * @param count The number of extensions.
+ * @param ignore_case Whether the case of the extensions is ignored.
+ * @param buffer The buffer where the set will be written to.
+ * @param buffer_size The size of the buffer.
+ * @return Returns the size of the set or zero if an extension is empty.
+ */
+CWK_PUBLIC size_t cwk_extset_build(const char **extensions, size_t count,
+  bool ignore_case, void *buffer, size_t buffer_size);
+
+/**
+ * @brief Finds an extension in a compiled set of extensions.
+ *
+ * This function searches the set for the submitted extension, which may start
+ * with a dot. The id of an extension is the index which was used to build the
+ * set. If an extension was submitted more than once, the first index is used.
+ *
+ * @param set The compiled set of extensions.
+ * @param extension The extension which will be searched.
+ * @param id The id of the extension.
+ * @return Returns true if the extension was found or false otherwise.
+ */
+CWK_PUBLIC bool cwk_extset_find(const void *set, const char *extension,
+  size_t *id);
+
+/**
+ * @brief Matches the extension of a path against a compiled set.
+ *
+ * This function checks whether the last segment of the path ends with one of
+ * the extensions of the set. If multiple extensions match, like "gz" and
+ * "tar.gz" for "archive.tar.gz", the longest one wins. Just like with
+ * cwk_path_get_extension, a dot at the beginning of the segment starts an
+ * extension as well, so ".gitignore" matches "gitignore".
+ *
+ * @param set The compiled set of extensions.
+ * @param path The path which will be matched.
+ * @param id The id of the matching extension.
+ * @return Returns true if an extension matched or false otherwise.
+ */
+CWK_PUBLIC bool cwk_extset_match(const void *set, const char *path,
+  size_t *id);
+
+/**
+ * A hash map which maps normalized paths to values, stored in the memory
+ * which is provided by the caller.
+ */
+struct cwk_pathmap;
+
+/**
+ * @brief Initializes a map of paths.
+ *
+ * This function initializes a hash map in the submitted buffer. The keys of
+ * the map are normalized paths, which are stored in the buffer as well. The
+ * map never grows, once the buffer is full no new paths can be inserted. The
+ * buffer must be aligned to at least eight bytes and must not be moved while
+ * the map is used.
+ *
+ * @param buffer The buffer where the map will be stored.
+ * @param buffer_size The size of the buffer.
+ * @return Returns the map or NULL if the buffer is too small.
+ */
+CWK_PUBLIC struct cwk_pathmap *cwk_pathmap_init(void *buffer,
+  size_t buffer_size);
+
+/**
+ * @brief Inserts a path into a map of paths.
+ *
+ * This function normalizes the path and stores it in the map together with
+ * the value. If a path which is equal after normalization is already in the
+ * map, its value is replaced instead. Windows paths are compared case
+ * insensitively.
+ *
+ * @param map The map where the path will be inserted.
+ * @param path The path which will be inserted.
+ * @param value The value which will be stored for the path.
+ * @return Returns true if the path was inserted or updated, or false if the
+ * map is full.
+ */
+CWK_PUBLIC bool cwk_pathmap_insert(struct cwk_pathmap *map, const char *path,
+  size_t value);
+
+/**
+ * @brief Finds a path in a map of paths.
+ *
+ * This function searches the map for a path which is equal to the submitted
+ * path after normalization. The submitted path does not have to be
+ * normalized, its normalized segments are hashed and compared with the keys
+ * directly, without writing the normalized path anywhere.
+ *
+ * @param map The map which will be searched.
+ * @param path The path which will be searched.
+ * @param value The value of the path.
+ * @return Returns true if the path was found or false otherwise.
+ */
+CWK_PUBLIC bool cwk_pathmap_find(const struct cwk_pathmap *map,
+  const char *path, size_t *value);
+
+/**
+ * @brief Gets the number of paths in a map of paths.
+ *
+ * @param map The map which will be inspected.
+ * @return Returns the number of paths in the map.
+ */
+CWK_PUBLIC size_t cwk_pathmap_get_count(const struct cwk_pathmap *map);
+
+#ifdef CWK_FILESYSTEM
+/**
+ * A cache of resolved directories and symbolic links, which can be shared by
+ * multiple calls to cwk_path_resolve and multiple threads. The cache lives in
+ * memory which is provided by the caller.
+ */
+struct cwk_resolve_cache;
+
+/**
+ * @brief Initializes a cache for resolved paths.
+ *
+ * This function initializes a cache in the submitted buffer, which can be used
+ * with cwk_path_resolve. The cache never grows, once the buffer is full new
+ * directories are simply not cached anymore. The buffer must be aligned to at
+ * least eight bytes and must not be moved while the cache is used.
+ *
+ * @param buffer The buffer where the cache will be stored.
+ * @param buffer_size The size of the buffer.
+ * @return Returns the cache or NULL if the buffer is too small.
+ */
+CWK_PUBLIC struct cwk_resolve_cache *cwk_resolve_cache_init(void *buffer,
+  size_t buffer_size);
+
+/**
+ * @brief Gets the number of entries in a cache for resolved paths.
+ *
+ * @param cache The cache which will be inspected.
+ * @return Returns the number of directories and links in the cache.
+ */
+CWK_PUBLIC size_t cwk_resolve_cache_get_count(
+  const struct cwk_resolve_cache *cache);
+
+/**
+ * @brief Resolves a path on the filesystem.
+ *
+ * This function generates the canonical absolute path of an existing file,
+ * just like realpath. Relative paths are resolved from the current working
+ * directory and all symbolic links are followed. Directories and links which
+ * have been looked up before are taken from the cache, so only the last
+ * segment of a path needs to be checked on the filesystem. The cache may be
+ * NULL. The path must use the unix style. The result is always
+ * null-terminated, but it is truncated if the buffer is too small.
+ *
+ * @param path The path which will be resolved.
+ * @param cache The cache of resolved directories and links or NULL.
+ * @param buffer The buffer where the result will be written to.
+ * @param buffer_size The size of the result buffer.
+ * @return Returns the total size of the resolved path or zero on failure, in
+ * which case errno is set.
+ */
+CWK_PUBLIC size_t cwk_path_resolve(const char *path,
+  struct cwk_resolve_cache *cache, char *buffer, size_t buffer_size);
+
+/**
+ * A cache of open directories, which is used to open and inspect files
+ * relative to their deepest cached parent directory. The cache lives in memory
+ * which is provided by the caller and must not be shared by multiple threads.
+ */
+struct cwk_dircache;
+
+/**
+ * @brief Initializes a cache of open directories.
+ *
+ * This function initializes a cache in the submitted buffer. Every directory
+ * in the cache keeps a file descriptor open, and the directory which has not
+ * been used for the longest time is closed once the buffer is full. The
+ * cache needs about one kilobyte of the buffer for itself and a bit less than
+ * 300 bytes for every directory. The buffer must be
+ * aligned to at least eight bytes and must not be moved while the cache is
+ * used.
+ *
+ * @param buffer The buffer where the cache will be stored.
+ * @param buffer_size The size of the buffer.
+ * @return Returns the cache or NULL if the buffer is too small.
+ */
+CWK_PUBLIC struct cwk_dircache *cwk_dircache_init(void *buffer,
+  size_t buffer_size);
+
+/**
+ * @brief Closes all directories of a cache of open directories.
+ *
+ * This function closes all file descriptors of the cache and removes all
+ * directories from it. It must be called before the buffer of the cache is
+ * released, and it can be used to forget directories which have been moved.
+ *
+ * @param cache The cache which will be cleared.
+ */
+CWK_PUBLIC void cwk_dircache_clear(struct cwk_dircache *cache);
+
+/**
+ * @brief Gets the number of directories in a cache of open directories.
+ *
+ * @param cache The cache which will be inspected.
+ * @return Returns the number of open directories in the cache.
+ */
+CWK_PUBLIC size_t cwk_dircache_get_count(const struct cwk_dircache *cache);
+
+/**
+ * @brief Opens a file using a cache of open directories.
+ *
+ * This function opens a file just like open, but only the last segment of the
+ * path is looked up by the kernel. The parent directories are taken from the
+ * cache or opened and added to it. Back segments are looked up on the
+ * filesystem as well, so symbolic links behave the same way as with open.
+ * Relative paths are resolved from the current working directory at the time
+ * their directories are cached. The path must use the unix style.
+ *
+ * @param cache The cache of open directories.
+ * @param path The path of the file which will be opened.
+ * @param flags The flags which are passed to openat.
+ * @param mode The mode which is used if a file is created.
+ * @return Returns the new file descriptor or -1 on failure, in which case
+ * errno is set.
+ */
+CWK_PUBLIC int cwk_dircache_open(struct cwk_dircache *cache, const char *path,
+  int flags, mode_t mode);
+
+/**
+ * @brief Gets information about a file using a cache of open directories.
+ *
+ * This function works just like stat, but only the last segment of the path is
+ * looked up by the kernel, using the same rules as cwk_dircache_open.
+ *
+ * @param cache The cache of open directories.
+ * @param path The path of the file which will be inspected.
+ * @param info The information about the file.
+ * @param flags The flags which are passed to fstatat.
+ * @return Returns zero on success or -1 on failure, in which case errno is
+ * set.
+ */
+CWK_PUBLIC int cwk_dircache_stat(struct cwk_dircache *cache, const char *path,
+  struct stat *info, int flags);
+
+/**
+ * @brief Gets information about many files using a cache of open directories.
+ *
+ * This function sorts the array of paths in place with cwk_path_sort and then
+ * inspects every file with cwk_dircache_stat. Files of the same directory are
+ * next to each other after sorting, so they all use the same cached directory.
+ * The information and the error of a path are written at the position where
+ * the path ends up after sorting. The error is zero if the file was inspected
+ * successfully or the value of errno otherwise.
+ *
+ * @param cache The cache of open directories.
+ * @param paths The array of paths which will be sorted and inspected.
+ * @param count The number of paths in the array.
+ * @param infos The array which receives the information about the files.
+ * @param errors The array which receives the errors.
+ * @param flags The flags which are passed to fstatat.
+ * @return Returns the number of files which were inspected successfully.
+ */
+CWK_PUBLIC size_t cwk_dircache_stat_batch(struct cwk_dircache *cache,
+  const char **paths, size_t count, struct stat *infos, int *errors,
+  int flags);
+
+/**
+ * The method which is used by cwk_path_stat_batch to inspect the files.
+ */
+enum cwk_stat_method
+{
+  CWK_STAT_AUTO,
+  CWK_STAT_IO_URING,
+  CWK_STAT_THREADS
+};
+
+/**
+ * The results of cwk_path_stat_batch, which are stored in one array for every
+ * field. Every array which is not NULL must have room for one value per path.
+ * The modification time is stored in nanoseconds since the epoch.
+ */
+struct cwk_stat_results
+{
+  int *errors;
+  uint32_t *modes;
+  uint64_t *sizes;
+  uint64_t *inodes;
+  int64_t *mtimes;
+};
+
+/**
+ * @brief Gets information about many files at once.
+ *
+ * This function sorts the array of paths in place with cwk_path_sort and then
+ * inspects all files, keeping up to queue_depth requests in flight. On linux
+ * the requests are submitted as statx operations through io_uring, otherwise
+ * or if io_uring is not available they are spread over a pool of threads.
+ * Files of the same directory are next to each other after sorting, so they
+ * are submitted together. The results are written at the position where the
+ * path ends up after sorting. The error is zero if the file was inspected
+ * successfully or the value of errno otherwise, in which case the other
+ * fields are not written.
+ *
+ * @param paths The array of paths which will be sorted and inspected.
+ * @param count The number of paths in the array.
+ * @param results The arrays which receive the results.
+ * @param queue_depth The maximum number of requests in flight.
+ * @param flags The flags which are passed to statx or fstatat.
+ * @param method The method which is used, CWK_STAT_AUTO picks io_uring if it
+ * is available.
+ * @return Returns the number of files which were inspected successfully. If
+ * the requested method is not available, all errors are set to ENOSYS.
+ */
+CWK_PUBLIC size_t cwk_path_stat_batch(const char **paths, size_t count,
+  struct cwk_stat_results *results, size_t queue_depth, int flags,
+  enum cwk_stat_method method);
+
+/**
+ * The totals of a directory of a usage tree, which include all files and
+ * directories below it. The size and the blocks include the directories
+ * themselves as well. The number of blocks is counted in units of 512 bytes,
+ * just like st_blocks. The errors are the number of files and directories
+ * which could not be inspected.
+ */
+struct cwk_usage_totals
+{
+  uint64_t size;
+  uint64_t blocks;
+  uint64_t files;
+  uint64_t directories;
+  uint64_t errors;
+};
+
+/**
+ * @brief Determines the disk usage of a directory tree.
+ *
+ * This function walks the directory tree below the submitted path with
+ * multiple threads and writes a tree of totals to the buffer, which contains
+ * an entry for every directory. The directories are opened relative to their
+ * parent directory, so no paths are generated during the walk. Every
+ * directory is queued for the threads no matter how deep it is, and it is
+ * read by a single thread, which counts its files without any locks.
+ * Directories which are deeper than max_depth, or which don't fit into the
+ * buffer anymore, don't get their own entry. They are counted as part of
+ * their closest parent which has an entry instead. The depth of the tree is
+ * not limited by the number of file descriptors, and the totals only lack
+ * what is counted in errors. The root is entry zero and has a depth of zero.
+ * Symbolic links are not followed, and unlike du, files with multiple hard
+ * links are counted once for every link. The buffer must be aligned to at
+ * least eight bytes.
+ *
+ * @param path The path of the directory which will be walked.
+ * @param buffer The buffer where the tree will be written to.
+ * @param buffer_size The size of the buffer.
+ * @param max_depth The maximum depth of directories which get an entry.
+ * @param thread_count The number of threads or zero to use one thread per
+ * processor.
+ * @return Returns the number of entries in the tree or zero on failure, in
+ * which case errno is set.
+ */
+CWK_PUBLIC size_t cwk_usage_scan(const char *path, void *buffer,
+  size_t buffer_size, size_t max_depth, size_t thread_count);
+
+/**
+ * @brief Gets the number of entries in a usage tree.
+ *
+ * @param usage The usage tree.
+ * @return Returns the number of directories which have an entry.
+ */
+CWK_PUBLIC size_t cwk_usage_get_count(const void *usage);
+
+/**
+ * @brief Gets the totals of an entry in a usage tree.
+ *
+ * @param usage The usage tree.
+ * @param entry The index of the entry.
+ * @param totals The totals of the directory and everything below it.
+ * @return Returns true if the entry exists or false otherwise.
+ */
+CWK_PUBLIC bool cwk_usage_get_totals(const void *usage, size_t entry,
+  struct cwk_usage_totals *totals);
+
+/**
+ * @brief Finds an entry in a usage tree.
+ *
+ * This function searches the entry of a directory by its path relative to the
+ * walked directory. The path is normalized while it is searched, so "a/./b"
+ * and "a/c/../b" find the same entry, and an empty path finds the root.
+ *
+ * @param usage The usage tree.
+ * @param path The relative path of the directory.
+ * @param entry The index of the entry.
+ * @return Returns true if the entry exists or false otherwise.
+ */
+CWK_PUBLIC bool cwk_usage_find(const void *usage, const char *path,
+  size_t *entry);
+
+/**
+ * @brief Gets the path of an entry in a usage tree.
+ *
+ * This function writes the path of an entry relative to the walked directory
+ * to the buffer, using the separator of the current path style. The path of
+ * the root is ".". The result is truncated if the buffer is too small, but
+ * the full length is returned.
+ *
+ * @param usage The usage tree.
+ * @param entry The index of the entry.
+ * @param buffer The buffer where the path will be written to.
+ * @param buffer_size The size of the buffer.
+ * @return Returns the total length of the path, or zero if the entry does not
+ * exist.
+ */
+CWK_PUBLIC size_t cwk_usage_get_path(const void *usage, size_t entry,
+  char *buffer, size_t buffer_size);
+
+/**
+ * @brief Finds the largest directories in a usage tree.
+ *
+ * This function finds the entries with the largest number of blocks, except
+ * the root, and writes them to the array with the largest one first.
+ *
+ * @param usage The usage tree.
+ * @param entries The array which receives the indices of the entries.
+ * @param count The maximum number of entries which will be written.
+ * @return Returns the number of entries which have been written.
+ */
+CWK_PUBLIC size_t cwk_usage_get_largest(const void *usage, size_t *entries,
+  size_t count);
+
+/**
+ * The information which is stored for every entry of a snapshot. The
+ * modification time is stored in nanoseconds since the epoch. The digest
+ * covers the name and the information of the entry and of everything below
+ * it, so two directories with the same digest have the same contents.
+ */
+struct cwk_snapshot_info
+{
+  uint32_t mode;
+  uint64_t size;
+  int64_t mtime;
+  uint64_t inode;
+  uint64_t digest;
+};
+
+/**
+ * The kind of a change which is reported by cwk_snapshot_diff_next.
+ *
+ * CWK_SNAPSHOT_ADDED - the entry only exists in the new snapshot
+ * CWK_SNAPSHOT_REMOVED - the entry only exists in the old snapshot
+ * CWK_SNAPSHOT_MODIFIED - the type, size, modification time or inode changed
+ */
+enum cwk_snapshot_change
+{
+  CWK_SNAPSHOT_ADDED,
+  CWK_SNAPSHOT_REMOVED,
+  CWK_SNAPSHOT_MODIFIED
+};
+
+/**
+ * A diff walks two snapshots at the same time and stops at every change. The
+ * old entry is set for removed and modified entries, and the new entry is set
+ * for added and modified entries. The positions are used internally.
+ */
+struct cwk_snapshot_diff
+{
+  const void *old_snapshot;
+  const void *new_snapshot;
+  size_t old_position;
+  size_t new_position;
+  enum cwk_snapshot_change change;
+  size_t old_entry;
+  size_t new_entry;
+};
+
+/**
+ * @brief Takes a snapshot of a directory tree.
+ *
+ * This function walks the directory tree below the submitted path and writes
+ * a snapshot to the buffer, which contains the name, the type, the size, the
+ * modification time and the inode of every file and directory. The entries
+ * are stored in the order of a depth-first walk and the entries of every
+ * directory are sorted by name, so two snapshots can be compared with a single
+ * pass over both. The snapshot doesn't contain any pointers, so it can be
+ * written to a file and loaded again later. Symbolic links are not followed
+ * and directories which can't be read because of their permissions don't have
+ * any entries. The buffer must be aligned to at least eight bytes.
+ *
+ * @param path The path of the directory which will be walked.
+ * @param buffer The buffer where the snapshot will be written to.
+ * @param buffer_size The size of the buffer.
+ * @return Returns the size of the snapshot in bytes or zero on failure, in
+ * which case errno is set.
+ */
+CWK_PUBLIC size_t cwk_snapshot_create(const char *path, void *buffer,
+  size_t buffer_size);
+
+/**
+ * @brief Checks whether a snapshot is valid.
+ *
+ * This function checks whether a snapshot which has been loaded from a file
+ * is complete and consistent, so it can be used with all other functions.
+ * Snapshots which are written by a different version of this library or on a
+ * system with a different byte order are rejected.
+ *
+ * @param snapshot The snapshot which will be checked.
+ * @param size The size of the snapshot in bytes.
+ * @return Returns true if the snapshot is valid or false otherwise.
+ */
+CWK_PUBLIC bool cwk_snapshot_is_valid(const void *snapshot, size_t size);
+
+/**
+ * @brief Gets the number of entries in a snapshot.
+ *
+ * @param snapshot The snapshot.
+ * @return Returns the number of entries including the root.
+ */
+CWK_PUBLIC size_t cwk_snapshot_get_count(const void *snapshot);
+
+/**
+ * @brief Gets the information of an entry in a snapshot.
+ *
+ * @param snapshot The snapshot.
+ * @param entry The entry which has been reported by a diff.
+ * @param info The information of the entry.
+ */
+CWK_PUBLIC void cwk_snapshot_get_info(const void *snapshot, size_t entry,
+  struct cwk_snapshot_info *info);
+
+/**
+ * @brief Gets the path of an entry in a snapshot.
+ *
+ * This function writes the path of an entry relative to the walked directory
+ * to the buffer, using the separator of the current path style. The path of
+ * the root is ".". The result is truncated if the buffer is too small, but
+ * the full length is returned.
+ *
+ * @param snapshot The snapshot.
+ * @param entry The entry which has been reported by a diff.
+ * @param buffer The buffer where the path will be written to.
+ * @param buffer_size The size of the buffer.
+ * @return Returns the total length of the path.
+ */
+CWK_PUBLIC size_t cwk_snapshot_get_path(const void *snapshot, size_t entry,
+  char *buffer, size_t buffer_size);
+
+/**
+ * @brief Starts to compare two snapshots.
+ *
+ * This function compares two snapshots and stops at the first change. The
+ * snapshots are walked at the same time and the entries of every directory
+ * are merged by name. Directories with the same digest in both snapshots are
+ * skipped as a whole, so the time it takes only depends on the number of
+ * changes and the size of the directories which contain them. An added or
+ * removed directory is reported first, followed by everything below it.
+ *
+ * @param diff The diff which will be initialized.
+ * @param old_snapshot The old snapshot.
+ * @param new_snapshot The new snapshot.
+ * @return Returns true if there is a change or false otherwise.
+ */
+CWK_PUBLIC bool cwk_snapshot_diff_first(struct cwk_snapshot_diff *diff,
+  const void *old_snapshot, const void *new_snapshot);
+
+/**
+ * @brief Advances to the next change between two snapshots.
+ *
+ * @param diff The diff which has been initialized by cwk_snapshot_diff_first.
+ * @return Returns true if there is another change or false otherwise.
+ */
+CWK_PUBLIC bool cwk_snapshot_diff_next(struct cwk_snapshot_diff *diff);
+
+#ifdef CWK_INOTIFY
+/**
+ * A live index of a directory tree, which is kept up to date with inotify.
+ * It is stored in a buffer which is provided by the caller.
+ */
+struct cwk_watch;
+
+/**
+ * The kind of a change which is reported by cwk_watch_changes_next.
+ *
+ * CWK_WATCH_ADDED - the entry did not exist at the queried generation
+ * CWK_WATCH_REMOVED - the entry existed at the queried generation but is gone
+ * CWK_WATCH_MODIFIED - the contents or the attributes of the entry changed
+ */
+enum cwk_watch_change
+{
+  CWK_WATCH_ADDED,
+  CWK_WATCH_REMOVED,
+  CWK_WATCH_MODIFIED
+};
+
+/**
+ * The changes of a live index since a generation, which are walked with
+ * cwk_watch_changes_first and cwk_watch_changes_next. The position is used
+ * internally.
+ */
+struct cwk_watch_changes
+{
+  const struct cwk_watch *watch;
+  uint64_t generation;
+  uint32_t position;
+  size_t entry;
+  enum cwk_watch_change change;
+};
+
+/**
+ * @brief Starts to watch a directory tree.
+ *
+ * This function normalizes the submitted path, walks the directory tree below
+ * it and adds an inotify watch to every directory. Every file and directory
+ * gets an entry in the index, which only stores the name of the entry and a
+ * link to its parent, so every name is only stored once. The index starts at
+ * generation zero. Symbolic links are not followed. The buffer must be
+ * aligned to at least eight bytes.
+ *
+ * @param buffer The buffer where the index will be stored.
+ * @param buffer_size The size of the buffer.
+ * @param path The path of the directory which will be watched.
+ * @return Returns the index or NULL on failure, in which case errno is set.
+ */
+CWK_PUBLIC struct cwk_watch *cwk_watch_init(void *buffer, size_t buffer_size,
+  const char *path);
+
+/**
+ * @brief Stops to watch a directory tree.
+ *
+ * This function closes the inotify instance of the index. The buffer may be
+ * freed or reused afterwards.
+ *
+ * @param watch The index which will be closed.
+ */
+CWK_PUBLIC void cwk_watch_close(struct cwk_watch *watch);
+
+/**
+ * @brief Gets the file descriptor of a live index.
+ *
+ * The file descriptor becomes readable when there are changes which have not
+ * been applied with cwk_watch_update yet, so it can be used with poll.
+ *
+ * @param watch The index.
+ * @return Returns the file descriptor of the inotify instance.
+ */
+CWK_PUBLIC int cwk_watch_get_fd(const struct cwk_watch *watch);
+
+/**
+ * @brief Applies all pending changes to a live index.
+ *
+ * This function reads all pending inotify events without blocking and applies
+ * them to the index. All changes of one update share a new generation, and an
+ * entry which changes several times is only recorded once. A directory which
+ * is moved within the tree keeps all of its entries, so it is not walked
+ * again. New directories are walked and watched right away. If the kernel
+ * dropped events, the index can't be trusted anymore and the update fails
+ * with EOVERFLOW. If the watched directory itself is removed or moved, the
+ * update fails with ENOENT, and if the buffer is too small for the tree, it
+ * fails with ENOBUFS. In all of these cases the index must be initialized
+ * again. Entries which have been reported as removed may be reused by the
+ * next update.
+ *
+ * @param watch The index which will be updated.
+ * @return Returns zero on success or -1 on failure, in which case errno is
+ * set.
+ */
+CWK_PUBLIC int cwk_watch_update(struct cwk_watch *watch);
+
+/**
+ * @brief Gets the current generation of a live index.
+ *
+ * @param watch The index.
+ * @return Returns the generation of the last update which changed anything.
+ */
+CWK_PUBLIC uint64_t cwk_watch_get_generation(const struct cwk_watch *watch);
+
+/**
+ * @brief Gets the oldest generation whose changes are known.
+ *
+ * The index forgets the oldest changes when it runs out of space. Changes
+ * since a generation older than this one are incomplete, and the caller has
+ * to compare the whole tree instead.
+ *
+ * @param watch The index.
+ * @return Returns the oldest generation which can be queried.
+ */
+CWK_PUBLIC uint64_t cwk_watch_get_oldest_generation(
+  const struct cwk_watch *watch);
+
+/**
+ * @brief Gets the number of entries in a live index.
+ *
+ * @param watch The index.
+ * @return Returns the number of files and directories including the root.
+ */
+CWK_PUBLIC size_t cwk_watch_get_count(const struct cwk_watch *watch);
+
+/**
+ * @brief Finds an entry in a live index.
+ *
+ * This function searches the entry of a path, which is either relative to the
+ * watched directory or an absolute path below it. The path is normalized the
+ * same way as the path of the watched directory, so "a/./b" and "a/c/../b"
+ * find the same entry.
+ *
+ * @param watch The index.
+ * @param path The path of the entry.
+ * @param entry The entry which has been found.
+ * @return Returns true if the entry exists or false otherwise.
+ */
+CWK_PUBLIC bool cwk_watch_find(const struct cwk_watch *watch,
+  const char *path, size_t *entry);
+
+/**
+ * @brief Gets the path of an entry in a live index.
+ *
+ * This function writes the path of an entry relative to the watched directory
+ * to the buffer, using the separator of the current path style. The path of
+ * the root is ".". The path of a removed entry is built from the current path
+ * of its parent. The result is truncated if the buffer is too small, but the
+ * full length is returned.
+ *
+ * @param watch The index.
+ * @param entry The entry which has been found or reported as a change.
+ * @param buffer The buffer where the path will be written to.
+ * @param buffer_size The size of the buffer.
+ * @return Returns the total length of the path.
+ */
+CWK_PUBLIC size_t cwk_watch_get_path(const struct cwk_watch *watch,
+  size_t entry, char *buffer, size_t buffer_size);
+
+/**
+ * @brief Starts to walk the changes of a live index since a generation.
+ *
+ * This function finds the first entry which has changed after the submitted
+ * generation. The changes are walked from the newest to the oldest one, and
+ * every entry is only reported once. An entry which has been added and
+ * removed again is not reported at all. A moved entry is removed at its old
+ * path and added at its new path, while the entries below a moved directory
+ * are not reported, since they moved along with it.
+ *
+ * @param changes The changes which will be initialized.
+ * @param watch The index.
+ * @param generation The generation which the caller has seen last.
+ * @return Returns true if there is a change or false otherwise.
+ */
+CWK_PUBLIC bool cwk_watch_changes_first(struct cwk_watch_changes *changes,
+  const struct cwk_watch *watch, uint64_t generation);
+
+/**
+ * @brief Advances to the next change of a live index.
+ *
+ * @param changes The changes which have been initialized by
+ * cwk_watch_changes_first.
+ * @return Returns true if there is another change or false otherwise.
+ */
+CWK_PUBLIC bool cwk_watch_changes_next(struct cwk_watch_changes *changes);
+#endif
+#endif
+
+/**
+ * @brief Guesses the path style.
+ *
+ * This function guesses the path style based on a submitted path-string. The
+ * guessing will look at the root and the type of slashes contained in the
+ * path and return the style which is more likely used in the path.
+ *
+ * @param path The path which will be inspected.
+ * @return Returns the style which is most likely used for the path.
+ */
+CWK_PUBLIC enum cwk_path_style cwk_path_guess_style(const char *path);
+
+/**
+ * @brief Classifies an array of paths.
+ *
+ * This function determines the style, the kind of root and whether the path
+ * is absolute for every path, and writes the result as a single byte per path.
+ * The style is guessed using the same rules as cwk_path_guess_style, and the
+ * root is determined using the guessed style. The classes can be used to
+ * route paths to code which is specialized for a style.
+ *
+ * @param paths The array of paths which will be classified.
+ * @param count The number of paths in the array.
+ * @param classes The array where the classes will be written to, which is a
+ * combination of the values of enum cwk_path_class.
+ */
+CWK_PUBLIC void cwk_path_classify(const char **paths, size_t count,
+  unsigned char *classes);
 
 /**
  * @brief Configures which path style is used.
@@ -0,0 +1,1595 @@
+#pragma once
+
+#ifndef CWK_LIBRARY_HPP
+#define CWK_LIBRARY_HPP
+
+#if !(__cplusplus >= 201703L || (defined(_MSVC_LANG) && _MSVC_LANG >= 201703L))
+#error "cwalk.hpp requires C++17 or later"
+#endif
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <cwalk.h>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#if __has_include(<version>)
+#include <version>
+#endif
+#if defined(__cpp_lib_ranges)
+#include <ranges>
+#endif
+
+/**
+ * This header wraps the C functions of cwalk for C++17 and later. Functions
+ * which only inspect a path work on std::string_view and never allocate any
+ * memory, the results point into the submitted path. Functions which create
+ * new paths write into a buffer of the caller or into a std::string, which is
+ * resized to the exact length of the result before it is written. All of them
+ * are inline and call the C functions of cwalk.h, so the library itself stays
+ * exactly the same.
+ */
+namespace cwk {
+
+/**
+ * A null-terminated string, which is required by the functions that don't have
+ * a sized counterpart in C, such as guess_style or the path map. It can be
+ * created from a C string or a std::string, but deliberately not from a
+ * std::string_view, since a view doesn't have to be terminated.
+ */
+class zstring
+{
+public:
+  zstring(const char *str) noexcept : str_(str)
+  {
+  }
+
+  zstring(const std::string &str) noexcept : str_(str.c_str())
+  {
+  }
+
+  const char *c_str() const noexcept
+  {
+    return str_;
+  }
+
+private:
+  const char *str_;
+};
+
+/**
+ * A segment of a path, which is returned by the segment iterator. The value
+ * points into the path, so the path must outlive the segment.
+ */
+struct segment
+{
+  std::string_view value;
+  std::size_t offset;
+  cwk_segment_type type;
+};
+
+/**
+ * An iterator over all segments of a path. A default constructed iterator is
+ * the end of every path.
+ */
+class segment_iterator
+{
+public:
+  using iterator_category = std::forward_iterator_tag;
+  using value_type = segment;
+  using difference_type = std::ptrdiff_t;
+  using pointer = const segment *;
+  using reference = const segment &;
+
+  segment_iterator() noexcept = default;
+
+  explicit segment_iterator(std::string_view path) noexcept : path_(path)
+  {
+    // An empty view might not point to any memory at all, so we don't pass it
+    // to the C function.
+    valid_ = !path_.empty() &&
+             cwk_path_get_first_span(path_.data(), path_.size(), &span_);
+    update();
+  }
+
+  reference operator*() const noexcept
+  {
+    return current_;
+  }
+
+  pointer operator->() const noexcept
+  {
+    return &current_;
+  }
+
+  segment_iterator &operator++() noexcept
+  {
+    valid_ = cwk_path_get_next_span(path_.data(), path_.size(), &span_);
+    update();
+    return *this;
+  }
+
+  segment_iterator operator++(int) noexcept
+  {
+    segment_iterator previous(*this);
+    ++*this;
+    return previous;
+  }
+
+  friend bool operator==(const segment_iterator &a,
+    const segment_iterator &b) noexcept
+  {
+    // All iterators which reached the end are equal, no matter which path they
+    // were iterating.
+    if (!a.valid_ || !b.valid_) {
+      return a.valid_ == b.valid_;
+    }
+
+    return a.path_.data() == b.path_.data() && a.span_.offset == b.span_.offset;
+  }
+
+  friend bool operator!=(const segment_iterator &a,
+    const segment_iterator &b) noexcept
+  {
+    return !(a == b);
+  }
+
+private:
+  void update() noexcept
+  {
+    if (valid_) {
+      current_.value = path_.substr(span_.offset, span_.length);
+      current_.offset = span_.offset;
+      current_.type = span_.type;
+    }
+  }
+
+  std::string_view path_;
+  cwk_span span_{};
+  segment current_{};
+  bool valid_ = false;
+};
+
+/**
+ * The segments of a path, which can be used in a range-based for loop.
+ */
+class segment_range
+{
+public:
+  explicit segment_range(std::string_view path) noexcept : path_(path)
+  {
+  }
+
+  segment_iterator begin() const noexcept
+  {
+    return segment_iterator(path_);
+  }
+
+  segment_iterator end() const noexcept
+  {
+    return segment_iterator();
+  }
+
+private:
+  std::string_view path_;
+};
+
+namespace detail {
+
+inline const char *data(std::string_view value) noexcept
+{
+  // An empty view might not point anywhere, but the C functions always need a
+  // valid pointer.
+  return value.empty() ? "" : value.data();
+}
+
+template <typename Function>
+std::string &assign(std::string &result, Function function)
+{
+  std::size_t size;
+
+  // The first call only measures the result, so the string can be resized to
+  // the exact length. The second call writes the result and its
+  // null-terminating character, which the string already holds.
+  size = function(nullptr, 0);
+  result.resize(size);
+  function(&result[0], size + 1);
+  return result;
+}
+
+} // namespace detail
+
+/**
+ * @brief Sets the path style.
+ *
+ * @param style The new style which will be used from now on.
+ */
+inline void set_style(cwk_path_style style) noexcept
+{
+  cwk_path_set_style(style);
+}
+
+/**
+ * @brief Gets the path style.
+ *
+ * @return Returns the current path style configuration.
+ */
+inline cwk_path_style get_style() noexcept
+{
+  return cwk_path_get_style();
+}
+
+/**
+ * @brief Guesses the path style.
+ *
+ * @param path The path which will be inspected.
+ * @return Returns the style which is most likely used for the path.
+ */
+inline cwk_path_style guess_style(zstring path) noexcept
+{
+  return cwk_path_guess_style(path.c_str());
+}
+
+/**
+ * @brief Gets the root of a path.
+ *
+ * @param path The path which will be inspected.
+ * @return Returns the root, which is empty if the path has none.
+ */
+inline std::string_view root(std::string_view path) noexcept
+{
+  std::size_t length;
+
+  if (path.empty()) {
+    return path;
+  }
+
+  cwk_path_get_root_sized(path.data(), path.size(), &length);
+  return path.substr(0, length);
+}
+
+/**
+ * @brief Determines whether a path is absolute.
+ *
+ * @param path The path which will be inspected.
+ * @return Returns true if the path is absolute or false otherwise.
+ */
+inline bool is_absolute(std::string_view path) noexcept
+{
+  std::string_view path_root;
+
+  // Just like in the C library, a path is absolute if its root ends with a
+  // separator.
+  path_root = root(path);
+  return !path_root.empty() && cwk_path_is_separator(&path_root.back());
+}
+
+/**
+ * @brief Determines whether a path is relative.
+ *
+ * @param path The path which will be inspected.
+ * @return Returns true if the path is relative or false otherwise.
+ */
+inline bool is_relative(std::string_view path) noexcept
+{
+  return !is_absolute(path);
+}
+
+/**
+ * @brief Gets the basename of a path.
+ *
+ * @param path The path which will be inspected.
+ * @return Returns the last segment of the path, which is empty if there is
+ * none.
+ */
+inline std::string_view basename(std::string_view path) noexcept
+{
+  cwk_span span;
+
+  if (path.empty() ||
+      !cwk_path_get_last_span(path.data(), path.size(), &span)) {
+    return std::string_view();
+  }
+
+  return path.substr(span.offset, span.length);
+}
+
+/**
+ * @brief Gets the dirname of a path.
+ *
+ * @param path The path which will be inspected.
+ * @return Returns the path up to its last segment, which is empty if there is
+ * no segment.
+ */
+inline std::string_view dirname(std::string_view path) noexcept
+{
+  cwk_span span;
+
+  if (path.empty() ||
+      !cwk_path_get_last_span(path.data(), path.size(), &span)) {
+    return std::string_view();
+  }
+
+  return path.substr(0, span.offset);
+}
+
+/**
+ * @brief Gets the extension of a path.
+ *
+ * @param path The path which will be inspected.
+ * @return Returns the extension including its dot, which is empty if there is
+ * none.
+ */
+inline std::string_view extension(std::string_view path) noexcept
+{
+  std::string_view name;
+  std::size_t dot;
+
+  name = basename(path);
+  dot = name.rfind('.');
+  if (dot == std::string_view::npos) {
+    return std::string_view();
+  }
+
+  return name.substr(dot);
+}
+
+/**
+ * @brief Determines whether a path has an extension.
+ *
+ * @param path The path which will be inspected.
+ * @return Returns true if the last segment of the path contains a dot.
+ */
+inline bool has_extension(std::string_view path) noexcept
+{
+  return basename(path).find('.') != std::string_view::npos;
+}
+
+/**
+ * @brief Gets the segments of a path.
+ *
+ * @param path The path which will be iterated.
+ * @return Returns a range of all segments, which point into the path.
+ */
+inline segment_range segments(std::string_view path) noexcept
+{
+  return segment_range(path);
+}
+
+#if defined(__cpp_lib_ranges)
+
+/**
+ * An iterator over the segments of a path which remain after the path is
+ * normalized. It follows the rules of cwk_path_normalize, so "." segments are
+ * always skipped and a ".." segment removes the normal segment in front of it.
+ * Every step only inspects as much of the path as necessary to decide whether
+ * the next segment remains, nothing is written anywhere.
+ */
+class normalized_segment_iterator
+{
+public:
+  using iterator_concept = std::forward_iterator_tag;
+  using iterator_category = std::input_iterator_tag;
+  using value_type = segment;
+  using difference_type = std::ptrdiff_t;
+
+  normalized_segment_iterator() noexcept = default;
+
+  explicit normalized_segment_iterator(std::string_view path) noexcept
+    : path_(path)
+  {
+    std::size_t root_length;
+
+    if (path_.empty()) {
+      return;
+    }
+
+    // Back segments can never leave the root of an absolute path, so they are
+    // dropped once there is no normal segment left which they could remove.
+    cwk_path_get_root_sized(path_.data(), path_.size(), &root_length);
+    absolute_ = root_length > 0 &&
+                cwk_path_is_separator(&path_[root_length - 1]);
+    valid_ = cwk_path_get_first_span(path_.data(), path_.size(), &span_);
+    skip_removed();
+  }
+
+  value_type operator*() const noexcept
+  {
+    return segment{path_.substr(span_.offset, span_.length), span_.offset,
+      span_.type};
+  }
+
+  normalized_segment_iterator &operator++() noexcept
+  {
+    step();
+    skip_removed();
+    return *this;
+  }
+
+  normalized_segment_iterator operator++(int) noexcept
+  {
+    normalized_segment_iterator previous(*this);
+    ++*this;
+    return previous;
+  }
+
+  friend bool operator==(const normalized_segment_iterator &a,
+    const normalized_segment_iterator &b) noexcept
+  {
+    if (!a.valid_ || !b.valid_) {
+      return a.valid_ == b.valid_;
+    }
+
+    return a.path_.data() == b.path_.data() && a.span_.offset == b.span_.offset;
+  }
+
+private:
+  bool is_removed() const noexcept
+  {
+    cwk_span next;
+    std::ptrdiff_t counter;
+
+    if (span_.type == CWK_CURRENT) {
+      return true;
+    } else if (span_.type == CWK_BACK) {
+      return absolute_ || depth_ > 0;
+    }
+
+    // A normal segment is removed if more back segments than normal segments
+    // follow it at any point. This is the same look-ahead which the C library
+    // does, and it stops as soon as the segment is known to be removed.
+    next = span_;
+    counter = 0;
+    while (cwk_path_get_next_span(path_.data(), path_.size(), &next)) {
+      if (next.type == CWK_NORMAL) {
+        ++counter;
+      } else if (next.type == CWK_BACK && --counter < 0) {
+        return true;
+      }
+    }
+
+    return false;
+  }
+
+  void step() noexcept
+  {
+    // The depth is the number of normal segments which a following back
+    // segment could still remove, no matter whether they remain or not.
+    if (span_.type == CWK_NORMAL) {
+      ++depth_;
+    } else if (span_.type == CWK_BACK && depth_ > 0) {
+      --depth_;
+    }
+
+    valid_ = cwk_path_get_next_span(path_.data(), path_.size(), &span_);
+  }
+
+  void skip_removed() noexcept
+  {
+    while (valid_ && is_removed()) {
+      step();
+    }
+  }
+
+  std::string_view path_;
+  cwk_span span_{};
+  std::size_t depth_ = 0;
+  bool absolute_ = false;
+  bool valid_ = false;
+};
+
+/**
+ * A view of the segments which remain after a path is normalized. It can be
+ * combined with the adaptors of std::views, for instance to only inspect the
+ * first few remaining segments.
+ */
+class normalized_segment_view
+  : public std::ranges::view_interface<normalized_segment_view>
+{
+public:
+  normalized_segment_view() noexcept = default;
+
+  explicit normalized_segment_view(std::string_view path) noexcept
+    : path_(path)
+  {
+  }
+
+  normalized_segment_iterator begin() const noexcept
+  {
+    return normalized_segment_iterator(path_);
+  }
+
+  normalized_segment_iterator end() const noexcept
+  {
+    return normalized_segment_iterator();
+  }
+
+private:
+  std::string_view path_;
+};
+
+/**
+ * @brief Gets the segments of a path which remain after normalization.
+ *
+ * @param path The path which will be iterated.
+ * @return Returns a lazy view of the remaining segments, which point into the
+ * path. A path without remaining segments, like "a/..", yields nothing.
+ */
+inline normalized_segment_view normalized_segments(
+  std::string_view path) noexcept
+{
+  return normalized_segment_view(path);
+}
+
+#endif
+
+/**
+ * @brief Splits a path into all of its segments at once.
+ *
+ * @param path The path which will be split.
+ * @param spans The array where the spans will be written to.
+ * @param max The number of spans which fit into the array.
+ * @return Returns the total number of segments in the path.
+ */
+inline std::size_t split(std::string_view path, cwk_span *spans,
+  std::size_t max) noexcept
+{
+  if (path.empty()) {
+    return 0;
+  }
+
+  return cwk_path_split_sized(path.data(), path.size(), spans, max);
+}
+
+/**
+ * @brief Creates a normalized version of the path.
+ *
+ * @param path The path which will be normalized.
+ * @param buffer The buffer where the result will be written to.
+ * @param buffer_size The size of the buffer.
+ * @return Returns the total size which the output would have if it was not
+ * truncated.
+ */
+inline std::size_t normalize(std::string_view path, char *buffer,
+  std::size_t buffer_size) noexcept
+{
+  return cwk_path_normalize_sized(detail::data(path), path.size(), buffer,
+    buffer_size);
+}
+
+/**
+ * @brief Creates a normalized version of the path.
+ *
+ * @param path The path which will be normalized.
+ * @param result The string where the result will be stored.
+ * @return Returns the result.
+ */
+inline std::string &normalize(std::string_view path, std::string &result)
+{
+  return detail::assign(result, [&](char *buffer, std::size_t buffer_size) {
+    return cwk_path_normalize_sized(detail::data(path), path.size(), buffer,
+      buffer_size);
+  });
+}
+
+/**
+ * @brief Joins two paths together.
+ *
+ * @param path_a The first path which comes first.
+ * @param path_b The second path which comes after the first.
+ * @param buffer The buffer where the result will be written to.
+ * @param buffer_size The size of the buffer.
+ * @return Returns the total size which the output would have if it was not
+ * truncated.
+ */
+inline std::size_t join(std::string_view path_a, std::string_view path_b,
+  char *buffer, std::size_t buffer_size) noexcept
+{
+  return cwk_path_join_sized(detail::data(path_a), path_a.size(),
+    detail::data(path_b), path_b.size(), buffer, buffer_size);
+}
+
+/**
+ * @brief Joins two paths together.
+ *
+ * @param path_a The first path which comes first.
+ * @param path_b The second path which comes after the first.
+ * @param result The string where the result will be stored.
+ * @return Returns the result.
+ */
+inline std::string &join(std::string_view path_a, std::string_view path_b,
+  std::string &result)
+{
+  return detail::assign(result, [&](char *buffer, std::size_t buffer_size) {
+    return cwk_path_join_sized(detail::data(path_a), path_a.size(),
+      detail::data(path_b), path_b.size(), buffer, buffer_size);
+  });
+}
+
+/**
+ * @brief Generates an absolute path based on a base.
+ *
+ * @param base The absolute base path on which the relative path will be
+ * applied.
+ * @param path The relative path which will be applied on the base path.
+ * @param buffer The buffer where the result will be written to.
+ * @param buffer_size The size of the buffer.
+ * @return Returns the total size which the output would have if it was not
+ * truncated.
+ */
+inline std::size_t absolute(std::string_view base, std::string_view path,
+  char *buffer, std::size_t buffer_size) noexcept
+{
+  return cwk_path_get_absolute_sized(detail::data(base), base.size(),
+    detail::data(path), path.size(), buffer, buffer_size);
+}
+
+/**
+ * @brief Generates an absolute path based on a base.
+ *
+ * @param base The absolute base path on which the relative path will be
+ * applied.
+ * @param path The relative path which will be applied on the base path.
+ * @param result The string where the result will be stored.
+ * @return Returns the result.
+ */
+inline std::string &absolute(std::string_view base, std::string_view path,
+  std::string &result)
+{
+  return detail::assign(result, [&](char *buffer, std::size_t buffer_size) {
+    return cwk_path_get_absolute_sized(detail::data(base), base.size(),
+      detail::data(path), path.size(), buffer, buffer_size);
+  });
+}
+
+/**
+ * @brief Generates a relative path based on a base.
+ *
+ * @param base_directory The base directory of the relative path.
+ * @param path The target path of the relative path.
+ * @param buffer The buffer where the result will be written to.
+ * @param buffer_size The size of the buffer.
+ * @return Returns the total size which the output would have if it was not
+ * truncated.
+ */
+inline std::size_t relative(std::string_view base_directory,
+  std::string_view path, char *buffer, std::size_t buffer_size) noexcept
+{
+  return cwk_path_get_relative_sized(detail::data(base_directory),
+    base_directory.size(), detail::data(path), path.size(), buffer,
+    buffer_size);
+}
+
+/**
+ * @brief Generates a relative path based on a base.
+ *
+ * @param base_directory The base directory of the relative path.
+ * @param path The target path of the relative path.
+ * @param result The string where the result will be stored.
+ * @return Returns the result.
+ */
+inline std::string &relative(std::string_view base_directory,
+  std::string_view path, std::string &result)
+{
+  return detail::assign(result, [&](char *buffer, std::size_t buffer_size) {
+    return cwk_path_get_relative_sized(detail::data(base_directory),
+      base_directory.size(), detail::data(path), path.size(), buffer,
+      buffer_size);
+  });
+}
+
+/**
+ * @brief Changes the root of a path.
+ *
+ * @param path The original path which will get a new root.
+ * @param new_root The new root which will be placed in the path.
+ * @param buffer The buffer where the result will be written to.
+ * @param buffer_size The size of the buffer.
+ * @return Returns the total size which the output would have if it was not
+ * truncated.
+ */
+inline std::size_t change_root(std::string_view path, std::string_view new_root,
+  char *buffer, std::size_t buffer_size) noexcept
+{
+  return cwk_path_change_root_sized(detail::data(path), path.size(),
+    detail::data(new_root), new_root.size(), buffer, buffer_size);
+}
+
+/**
+ * @brief Changes the root of a path.
+ *
+ * @param path The original path which will get a new root.
+ * @param new_root The new root which will be placed in the path.
+ * @param result The string where the result will be stored.
+ * @return Returns the result.
+ */
+inline std::string &change_root(std::string_view path,
+  std::string_view new_root, std::string &result)
+{
+  return detail::assign(result, [&](char *buffer, std::size_t buffer_size) {
+    return cwk_path_change_root_sized(detail::data(path), path.size(),
+      detail::data(new_root), new_root.size(), buffer, buffer_size);
+  });
+}
+
+/**
+ * @brief Changes the basename of a path.
+ *
+ * @param path The original path which will be used for the modified path.
+ * @param new_basename The new basename which will replace the old one.
+ * @param buffer The buffer where the result will be written to.
+ * @param buffer_size The size of the buffer.
+ * @return Returns the total size which the output would have if it was not
+ * truncated.
+ */
+inline std::size_t change_basename(std::string_view path,
+  std::string_view new_basename, char *buffer, std::size_t buffer_size) noexcept
+{
+  return cwk_path_change_basename_sized(detail::data(path), path.size(),
+    detail::data(new_basename), new_basename.size(), buffer, buffer_size);
+}
+
+/**
+ * @brief Changes the basename of a path.
+ *
+ * @param path The original path which will be used for the modified path.
+ * @param new_basename The new basename which will replace the old one.
+ * @param result The string where the result will be stored.
+ * @return Returns the result.
+ */
+inline std::string &change_basename(std::string_view path,
+  std::string_view new_basename, std::string &result)
+{
+  return detail::assign(result, [&](char *buffer, std::size_t buffer_size) {
+    return cwk_path_change_basename_sized(detail::data(path), path.size(),
+      detail::data(new_basename), new_basename.size(), buffer, buffer_size);
+  });
+}
+
+/**
+ * @brief Changes the extension of a path.
+ *
+ * @param path The path which will be used to make the change.
+ * @param new_extension The extension which will be placed within the new path.
+ * @param buffer The buffer where the result will be written to.
+ * @param buffer_size The size of the buffer.
+ * @return Returns the total size which the output would have if it was not
+ * truncated.
+ */
+inline std::size_t change_extension(std::string_view path,
+  std::string_view new_extension, char *buffer,
+  std::size_t buffer_size) noexcept
+{
+  return cwk_path_change_extension_sized(detail::data(path), path.size(),
+    detail::data(new_extension), new_extension.size(), buffer, buffer_size);
+}
+
+/**
+ * @brief Changes the extension of a path.
+ *
+ * @param path The path which will be used to make the change.
+ * @param new_extension The extension which will be placed within the new path.
+ * @param result The string where the result will be stored.
+ * @return Returns the result.
+ */
+inline std::string &change_extension(std::string_view path,
+  std::string_view new_extension, std::string &result)
+{
+  return detail::assign(result, [&](char *buffer, std::size_t buffer_size) {
+    return cwk_path_change_extension_sized(detail::data(path), path.size(),
+      detail::data(new_extension), new_extension.size(), buffer, buffer_size);
+  });
+}
+
+/**
+ * A normalized path, which owns its characters. Paths which fit into the
+ * inline storage don't allocate any memory, which covers almost all paths in
+ * practice. Longer paths are stored on the heap. The path is normalized with
+ * the current path style when it is created, and the length of its root and
+ * the number of its segments are determined only once at that time. Comparison
+ * and hashing use the current path style as well, so the style should not be
+ * changed while paths are in use.
+ */
+class path
+{
+public:
+  /**
+   * The number of characters which are stored inline, not counting the
+   * null-terminating character. This makes the whole path 256 bytes large.
+   */
+  static constexpr std::size_t inline_capacity = 239;
+
+  path() noexcept
+  {
+    inline_[0] = '\0';
+  }
+
+  path(std::string_view value)
+  {
+    char *buffer;
+
+    // The path is copied first and then normalized in place, which never
+    // makes it any longer. So we need at most one allocation, which we can
+    // even give up again if the normalized path fits inline.
+    buffer = value.size() > inline_capacity ? new char[value.size() + 1]
+                                            : inline_;
+    if (!value.empty()) {
+      std::memcpy(buffer, value.data(), value.size());
+    }
+    buffer[value.size()] = '\0';
+    adopt(buffer, cwk_path_normalize_inplace(buffer));
+  }
+
+  path(const char *value) : path(std::string_view(value))
+  {
+  }
+
+  path(const std::string &value) : path(std::string_view(value))
+  {
+  }
+
+  path(const path &other)
+  {
+    copy_from(other);
+  }
+
+  path(path &&other) noexcept
+  {
+    move_from(other);
+  }
+
+  ~path()
+  {
+    release();
+  }
+
+  path &operator=(const path &other)
+  {
+    path copy(other);
+
+    // The copy might throw while allocating, so we only replace our own
+    // content once it succeeded.
+    release();
+    move_from(copy);
+    return *this;
+  }
+
+  path &operator=(path &&other) noexcept
+  {
+    if (this != &other) {
+      release();
+      move_from(other);
+    }
+
+    return *this;
+  }
+
+  friend void swap(path &a, path &b) noexcept
+  {
+    path temporary(std::move(a));
+
+    a = std::move(b);
+    b = std::move(temporary);
+  }
+
+  const char *c_str() const noexcept
+  {
+    return data();
+  }
+
+  const char *data() const noexcept
+  {
+    return is_inline() ? inline_ : heap_;
+  }
+
+  std::size_t size() const noexcept
+  {
+    return size_;
+  }
+
+  bool empty() const noexcept
+  {
+    return size_ == 0;
+  }
+
+  std::string_view view() const noexcept
+  {
+    return std::string_view(data(), size_);
+  }
+
+  operator std::string_view() const noexcept
+  {
+    return view();
+  }
+
+  operator zstring() const noexcept
+  {
+    return zstring(data());
+  }
+
+  /**
+   * @brief Gets the root of the path.
+   *
+   * @return Returns the root, which is empty if the path has none.
+   */
+  std::string_view root() const noexcept
+  {
+    return view().substr(0, root_length_);
+  }
+
+  /**
+   * @brief Gets the number of segments of the path.
+   *
+   * @return Returns the number of segments after the root.
+   */
+  std::size_t segment_count() const noexcept
+  {
+    return segment_count_;
+  }
+
+  /**
+   * @brief Determines whether the path is absolute.
+   *
+   * @return Returns true if the path is absolute or false otherwise.
+   */
+  bool is_absolute() const noexcept
+  {
+    return root_length_ > 0 && cwk_path_is_separator(&data()[root_length_ - 1]);
+  }
+
+  /**
+   * @brief Determines whether the path is relative.
+   *
+   * @return Returns true if the path is relative or false otherwise.
+   */
+  bool is_relative() const noexcept
+  {
+    return !is_absolute();
+  }
+
+  /**
+   * @brief Gets the basename of the path.
+   *
+   * @return Returns the last segment of the path, which is empty if there is
+   * none.
+   */
+  std::string_view basename() const noexcept
+  {
+    return cwk::basename(view());
+  }
+
+  /**
+   * @brief Gets the extension of the path.
+   *
+   * @return Returns the extension including its dot, which is empty if there
+   * is none.
+   */
+  std::string_view extension() const noexcept
+  {
+    return cwk::extension(view());
+  }
+
+  /**
+   * @brief Joins another path to this one.
+   *
+   * @param other The path which comes after this one.
+   * @return Returns the joined and normalized path.
+   */
+  path join(std::string_view other) const
+  {
+    path result;
+    char *buffer;
+    std::size_t size;
+
+    // We try to join the paths into the inline storage of the result first,
+    // and only allocate if it doesn't fit.
+    size = cwk_path_join_sized(data(), size_, detail::data(other),
+      other.size(), result.inline_, sizeof(result.inline_));
+    buffer = result.inline_;
+    if (size > inline_capacity) {
+      buffer = new char[size + 1];
+      cwk_path_join_sized(data(), size_, detail::data(other), other.size(),
+        buffer, size + 1);
+    }
+
+    result.adopt(buffer, size);
+    return result;
+  }
+
+  friend path operator/(const path &a, std::string_view b)
+  {
+    return a.join(b);
+  }
+
+  friend bool operator==(const path &a, const path &b) noexcept
+  {
+    // The case folding never changes the length of a path, so paths of
+    // different sizes can never be equal.
+    return a.size_ == b.size_ && cwk_path_compare(a.data(), b.data()) == 0;
+  }
+
+  friend bool operator!=(const path &a, const path &b) noexcept
+  {
+    return !(a == b);
+  }
+
+  friend bool operator<(const path &a, const path &b) noexcept
+  {
+    return cwk_path_compare(a.data(), b.data()) < 0;
+  }
+
+  friend bool operator<=(const path &a, const path &b) noexcept
+  {
+    return cwk_path_compare(a.data(), b.data()) <= 0;
+  }
+
+  friend bool operator>(const path &a, const path &b) noexcept
+  {
+    return cwk_path_compare(a.data(), b.data()) > 0;
+  }
+
+  friend bool operator>=(const path &a, const path &b) noexcept
+  {
+    return cwk_path_compare(a.data(), b.data()) >= 0;
+  }
+
+private:
+  bool is_inline() const noexcept
+  {
+    return size_ <= inline_capacity;
+  }
+
+  void adopt(char *buffer, std::size_t size) noexcept
+  {
+    std::size_t root_length;
+
+    // A heap buffer is only kept if the path doesn't fit inline, so the size
+    // alone tells us where the path is stored.
+    if (buffer != inline_ && size <= inline_capacity) {
+      std::memcpy(inline_, buffer, size + 1);
+      delete[] buffer;
+    } else if (buffer != inline_) {
+      heap_ = buffer;
+    }
+
+    size_ = size;
+    cwk_path_get_root(data(), &root_length);
+    root_length_ = static_cast<std::uint32_t>(root_length);
+    segment_count_ = static_cast<std::uint32_t>(
+      cwk_path_split_sized(data(), size_, nullptr, 0));
+  }
+
+  void copy_from(const path &other)
+  {
+    if (other.is_inline()) {
+      std::memcpy(inline_, other.inline_, other.size_ + 1);
+    } else {
+      heap_ = new char[other.size_ + 1];
+      std::memcpy(heap_, other.heap_, other.size_ + 1);
+    }
+
+    size_ = other.size_;
+    root_length_ = other.root_length_;
+    segment_count_ = other.segment_count_;
+  }
+
+  void move_from(path &other) noexcept
+  {
+    // Only the used part of the inline storage is copied, and a heap buffer
+    // is just taken over. The other path is left empty.
+    if (other.is_inline()) {
+      std::memcpy(inline_, other.inline_, other.size_ + 1);
+    } else {
+      heap_ = other.heap_;
+    }
+
+    size_ = other.size_;
+    root_length_ = other.root_length_;
+    segment_count_ = other.segment_count_;
+    other.size_ = 0;
+    other.root_length_ = 0;
+    other.segment_count_ = 0;
+    other.inline_[0] = '\0';
+  }
+
+  void release() noexcept
+  {
+    if (!is_inline()) {
+      delete[] heap_;
+    }
+  }
+
+  union
+  {
+    char inline_[inline_capacity + 1];
+    char *heap_;
+  };
+  std::size_t size_ = 0;
+  std::uint32_t root_length_ = 0;
+  std::uint32_t segment_count_ = 0;
+};
+
+/**
+ * A map of normalized paths to values, which owns the memory of a
+ * cwk_pathmap. Paths can be looked up without normalizing them first. Just
+ * like the C map, it never grows, so the size of its memory must be chosen
+ * when it is created.
+ */
+class pathmap
+{
+public:
+  /**
+   * The smallest size of the memory of a map, which is enough for the map
+   * itself and a few dozen paths.
+   */
+  static constexpr std::size_t minimum_size = 4096;
+
+  explicit pathmap(std::size_t buffer_size = 65536)
+  {
+    if (buffer_size < minimum_size) {
+      buffer_size = minimum_size;
+    }
+
+    // The map requires memory which is aligned to eight bytes. It is stored at
+    // the beginning of that memory, so we don't need to keep its pointer.
+    memory_.reset(new std::uint64_t[buffer_size / sizeof(std::uint64_t)]);
+    cwk_pathmap_init(memory_.get(), buffer_size / sizeof(std::uint64_t) *
+                                      sizeof(std::uint64_t));
+  }
+
+  /**
+   * @brief Inserts a path into the map.
+   *
+   * @param path The path which will be inserted.
+   * @param value The value which will be stored for the path.
+   * @return Returns true if the path was inserted or updated, or false if the
+   * map is full.
+   */
+  bool insert(zstring path, std::size_t value) noexcept
+  {
+    return cwk_pathmap_insert(get(), path.c_str(), value);
+  }
+
+  /**
+   * @brief Finds a path in the map.
+   *
+   * @param path The path which will be searched.
+   * @return Returns the value of the path, which is empty if the path was not
+   * found.
+   */
+  std::optional<std::size_t> find(zstring path) const noexcept
+  {
+    std::size_t value;
+
+    if (!cwk_pathmap_find(get(), path.c_str(), &value)) {
+      return std::nullopt;
+    }
+
+    return value;
+  }
+
+  bool contains(zstring path) const noexcept
+  {
+    return find(path).has_value();
+  }
+
+  std::size_t size() const noexcept
+  {
+    return cwk_pathmap_get_count(get());
+  }
+
+  cwk_pathmap *get() noexcept
+  {
+    return reinterpret_cast<cwk_pathmap *>(memory_.get());
+  }
+
+  const cwk_pathmap *get() const noexcept
+  {
+    return reinterpret_cast<const cwk_pathmap *>(memory_.get());
+  }
+
+private:
+  std::unique_ptr<std::uint64_t[]> memory_;
+};
+
+/**
+ * A path with a fixed capacity, which is the result of the compile-time
+ * functions in the cwk::literal namespace. It holds the characters of the path
+ * together with a null-terminating character, so it can be used wherever a C
+ * string is required.
+ */
+template <std::size_t Capacity> class fixed_path
+{
+public:
+  constexpr fixed_path() noexcept = default;
+
+  constexpr const char *c_str() const noexcept
+  {
+    return data_;
+  }
+
+  constexpr const char *data() const noexcept
+  {
+    return data_;
+  }
+
+  constexpr std::size_t size() const noexcept
+  {
+    return size_;
+  }
+
+  constexpr bool empty() const noexcept
+  {
+    return size_ == 0;
+  }
+
+  constexpr std::string_view view() const noexcept
+  {
+    return std::string_view(data_, size_);
+  }
+
+  constexpr operator std::string_view() const noexcept
+  {
+    return view();
+  }
+
+  static constexpr std::size_t capacity() noexcept
+  {
+    return Capacity - 1;
+  }
+
+  constexpr void push_back(char c) noexcept
+  {
+    // The capacity is always large enough for the results of the functions
+    // which create a fixed path, so this never truncates anything.
+    if (size_ < Capacity - 1) {
+      data_[size_++] = c;
+    }
+  }
+
+  constexpr void resize(std::size_t size) noexcept
+  {
+    // This is only used to shrink the path, which happens when a back segment
+    // removes a previously written segment.
+    while (size_ > size) {
+      data_[--size_] = '\0';
+    }
+  }
+
+  friend constexpr bool operator==(const fixed_path &a,
+    std::string_view b) noexcept
+  {
+    return a.view() == b;
+  }
+
+  friend constexpr bool operator==(std::string_view a,
+    const fixed_path &b) noexcept
+  {
+    return a == b.view();
+  }
+
+  friend constexpr bool operator!=(const fixed_path &a,
+    std::string_view b) noexcept
+  {
+    return a.view() != b;
+  }
+
+  friend constexpr bool operator!=(std::string_view a,
+    const fixed_path &b) noexcept
+  {
+    return a != b.view();
+  }
+
+private:
+  char data_[Capacity]{};
+  std::size_t size_ = 0;
+};
+
+/**
+ * Compile-time versions of the path functions. The C library keeps the path
+ * style in a global variable, which can not be read in a constant expression.
+ * That's why all of these functions take the style as an argument, which
+ * defaults to the style the C library uses on this platform. They follow the
+ * exact same rules as the C functions, so a literal path can be normalized or
+ * joined while compiling and end up in the binary as it is.
+ */
+namespace literal {
+
+#if defined(WIN32) || defined(_WIN32) ||                                       \
+  defined(__WIN32) && !defined(__CYGWIN__)
+inline constexpr cwk_path_style default_style = CWK_STYLE_WINDOWS;
+#else
+inline constexpr cwk_path_style default_style = CWK_STYLE_UNIX;
+#endif
+
+} // namespace literal
+
+namespace detail {
+
+constexpr bool is_separator(char c, cwk_path_style style) noexcept
+{
+  return c == '/' || (style == CWK_STYLE_WINDOWS && c == '\\');
+}
+
+constexpr char get_separator(cwk_path_style style) noexcept
+{
+  return style == CWK_STYLE_WINDOWS ? '\\' : '/';
+}
+
+template <std::size_t N>
+constexpr std::string_view from_literal(const char (&path)[N]) noexcept
+{
+  std::size_t length = 0;
+
+  // A C function stops at the first null-terminating character, so we do the
+  // same in case there is one within the array.
+  while (length < N && path[length] != '\0') {
+    ++length;
+  }
+
+  return std::string_view(path, length);
+}
+
+constexpr std::size_t get_root_length(std::string_view path,
+  cwk_path_style style) noexcept
+{
+  std::size_t i = 2;
+
+  if (style != CWK_STYLE_WINDOWS) {
+    return !path.empty() && is_separator(path[0], style) ? 1 : 0;
+  }
+
+  // This follows the windows root detection of the C library. A single
+  // separator is the root, two separators start a device or network path and
+  // a colon as the second character ends a drive letter.
+  if (!path.empty() && is_separator(path[0], style)) {
+    if (path.size() < 2 || !is_separator(path[1], style)) {
+      return 1;
+    }
+
+    if (path.size() > 3 && (path[2] == '?' || path[2] == '.') &&
+        is_separator(path[3], style)) {
+      return 4;
+    }
+
+    // The network path consists of the server name, any number of separators
+    // and the share name with an optional separator at the end.
+    while (i < path.size() && !is_separator(path[i], style)) {
+      ++i;
+    }
+
+    while (i < path.size() && is_separator(path[i], style)) {
+      ++i;
+    }
+
+    while (i < path.size() && !is_separator(path[i], style)) {
+      ++i;
+    }
+
+    if (i < path.size()) {
+      ++i;
+    }
+
+    return i;
+  }
+
+  if (path.size() > 1 && path[1] == ':') {
+    return path.size() > 2 && is_separator(path[2], style) ? 3 : 2;
+  }
+
+  return 0;
+}
+
+constexpr cwk_segment_type get_segment_type(std::string_view segment) noexcept
+{
+  if (segment == ".") {
+    return CWK_CURRENT;
+  } else if (segment == "..") {
+    return CWK_BACK;
+  }
+
+  return CWK_NORMAL;
+}
+
+template <std::size_t Capacity>
+constexpr fixed_path<Capacity> join_and_normalize(const std::string_view *paths,
+  std::size_t count, cwk_path_style style) noexcept
+{
+  fixed_path<Capacity> result;
+  std::size_t stack[Capacity]{};
+  std::size_t root_length = 0, depth = 0, i = 0, p = 0, begin = 0, end = 0;
+  bool absolute = false, has_segment = false;
+  cwk_segment_type type = CWK_NORMAL;
+  std::string_view path, segment;
+
+  // The root of the first path is copied as it is, except for the separators
+  // which must all be backslashes on windows.
+  root_length = get_root_length(paths[0], style);
+  absolute = root_length > 0 && is_separator(paths[0][root_length - 1], style);
+  for (i = 0; i < root_length; ++i) {
+    result.push_back(is_separator(paths[0][i], style) ? get_separator(style)
+                                                      : paths[0][i]);
+  }
+
+  // The C library decides for every segment whether a following back segment
+  // removes it. Here we get the same result with a stack of the positions
+  // where the normal segments begin, so a back segment can just shrink the
+  // result again. Back segments which could not remove anything are only kept
+  // for relative paths and always come before any normal segment.
+  for (p = 0; p < count; ++p) {
+    path = paths[p];
+
+    // Just like the joined segments of the C library, the root is skipped in
+    // every path until one of them has a segment.
+    begin = p == 0 ? root_length
+                   : (has_segment ? 0 : get_root_length(path, style));
+    while (begin < path.size()) {
+      while (begin < path.size() && is_separator(path[begin], style)) {
+        ++begin;
+      }
+
+      end = begin;
+      while (end < path.size() && !is_separator(path[end], style)) {
+        ++end;
+      }
+
+      if (begin == end) {
+        break;
+      }
+
+      has_segment = true;
+      segment = path.substr(begin, end - begin);
+      begin = end;
+      type = get_segment_type(segment);
+      if (type == CWK_CURRENT || (type == CWK_BACK && depth == 0 && absolute)) {
+        continue;
+      } else if (type == CWK_BACK && depth > 0) {
+        result.resize(stack[--depth]);
+        continue;
+      }
+
+      // Kept back segments are not on the stack, since nothing may remove them
+      // anymore.
+      if (type == CWK_NORMAL) {
+        stack[depth++] = result.size();
+      }
+
+      if (result.size() > root_length) {
+        result.push_back(get_separator(style));
+      }
+
+      for (i = 0; i < segment.size(); ++i) {
+        result.push_back(segment[i]);
+      }
+    }
+  }
+
+  // A relative path where all segments are removed stays in the current
+  // directory, which must be a "." since an empty path means something else.
+  if (has_segment && result.empty()) {
+    result.push_back('.');
+  }
+
+  return result;
+}
+
+} // namespace detail
+
+namespace literal {
+
+/**
+ * @brief Creates a normalized version of the path at compile-time.
+ *
+ * @param path The literal path which will be normalized.
+ * @param style The style which will be used for the path.
+ * @return Returns the normalized path, which is never longer than the
+ * submitted one.
+ */
+template <std::size_t N>
+constexpr fixed_path<N> normalize(const char (&path)[N],
+  cwk_path_style style = default_style) noexcept
+{
+  std::string_view paths[1] = {detail::from_literal(path)};
+
+  return detail::join_and_normalize<N>(paths, 1, style);
+}
+
+/**
+ * @brief Joins two paths together at compile-time.
+ *
+ * @param path_a The first literal path which comes first.
+ * @param path_b The second literal path which comes after the first.
+ * @param style The style which will be used for the paths.
+ * @return Returns the joined and normalized path.
+ */
+template <std::size_t N, std::size_t M>
+constexpr fixed_path<N + M> join(const char (&path_a)[N],
+  const char (&path_b)[M], cwk_path_style style = default_style) noexcept
+{
+  std::string_view paths[2] = {detail::from_literal(path_a),
+    detail::from_literal(path_b)};
+
+  // Both sizes include a null-terminating character, which leaves enough room
+  // for the separator between the paths.
+  return detail::join_and_normalize<N + M>(paths, 2, style);
+}
+
+/**
+ * @brief Gets the basename of a path at compile-time.
+ *
+ * @param path The path which will be inspected.
+ * @param style The style which will be used for the path.
+ * @return Returns the last segment of the path, which is empty if there is
+ * none.
+ */
+constexpr std::string_view basename(std::string_view path,
+  cwk_path_style style = default_style) noexcept
+{
+  std::size_t root_length = 0, begin = 0, end = 0;
+
+  // We search backwards for the last segment, but we must not enter the root
+  // since it is not part of any segment.
+  root_length = detail::get_root_length(path, style);
+  end = path.size();
+  while (end > root_length && detail::is_separator(path[end - 1], style)) {
+    --end;
+  }
+
+  begin = end;
+  while (begin > root_length && !detail::is_separator(path[begin - 1], style)) {
+    --begin;
+  }
+
+  return path.substr(begin, end - begin);
+}
+
+/**
+ * @brief Gets the extension of a path at compile-time.
+ *
+ * @param path The path which will be inspected.
+ * @param style The style which will be used for the path.
+ * @return Returns the extension including its dot, which is empty if there is
+ * none.
+ */
+constexpr std::string_view extension(std::string_view path,
+  cwk_path_style style = default_style) noexcept
+{
+  std::string_view name;
+  std::size_t dot = 0;
+
+  name = basename(path, style);
+  dot = name.rfind('.');
+  if (dot == std::string_view::npos) {
+    return std::string_view();
+  }
+
+  return name.substr(dot);
+}
+
+} // namespace literal
+
+} // namespace cwk
+
+// Paths which are equal get the same hash, since both follow the rules of the
+// current path style.
+template <> struct std::hash<cwk::path>
+{
+  std::size_t operator()(const cwk::path &path) const noexcept
+  {
+    return cwk_path_hash(path.c_str());
+  }
+};
+
+#if defined(__cpp_lib_ranges)
+// The segments point into the path and not into the view, so they stay valid
+// even if the view is a temporary.
+template <>
+inline constexpr bool
+  std::ranges::enable_borrowed_range<cwk::normalized_segment_view> = true;
+#endif
+
+#endif
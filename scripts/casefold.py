@@ -0,0 +1,98 @@
+#!/usr/bin/env python3
+"""Generates the case folding table of src/cwalk.c.
+
+The table contains the simple case folding of all code points, for which the
+folded code point has the same length in UTF-8. This way a path has the same
+length after folding, which allows to compare and hash paths byte by byte.
+The table is written between the markers in src/cwalk.c:
+
+    python3 scripts/casefold.py src/cwalk.c
+"""
+
+import sys
+import unicodedata
+
+BEGIN = "// The following table is generated by scripts/casefold.py."
+END = "// End of the generated table."
+
+
+def utf8_length(code_point):
+    if code_point < 0x80:
+        return 1
+    if code_point < 0x800:
+        return 2
+    if code_point < 0x10000:
+        return 3
+    return 4
+
+
+def fold(code_point):
+    # The simple case folding maps every character to the lowercase version of
+    # its uppercase version, as long as both are single characters. This puts
+    # characters like "ς" and "σ" into the same class.
+    char = chr(code_point)
+    upper = char.upper()
+    if len(upper) != 1:
+        upper = char
+    lower = upper.lower()
+    if len(lower) != 1:
+        return code_point
+    return ord(lower)
+
+
+def generate_ranges():
+    ranges = []
+    for code_point in range(0x80, 0x110000):
+        if 0xD800 <= code_point <= 0xDFFF:
+            continue
+        folded = fold(code_point)
+        if folded == code_point:
+            continue
+        if utf8_length(folded) != utf8_length(code_point):
+            continue
+
+        # Consecutive code points with the same difference are merged into a
+        # single range. Upper and lowercase characters are often alternating,
+        # which results in a range with a stride of two.
+        delta = folded - code_point
+        if ranges:
+            first, last, last_delta, stride = ranges[-1]
+            if last_delta == delta:
+                if stride in (0, 1) and code_point == last + 1:
+                    ranges[-1] = (first, code_point, delta, 1)
+                    continue
+                if stride in (0, 2) and code_point == last + 2:
+                    ranges[-1] = (first, code_point, delta, 2)
+                    continue
+        ranges.append((code_point, code_point, delta, 0))
+    return ranges
+
+
+def generate_table():
+    lines = [
+        BEGIN,
+        "// Unicode %s, %d ranges." % (unicodedata.unidata_version,
+                                      len(generate_ranges())),
+        "static const struct cwk_fold_range fold_ranges[] = {",
+    ]
+    for first, last, delta, stride in generate_ranges():
+        lines.append("  {0x%05X, 0x%05X, %d, %d}," % (first, last, delta,
+                                                      max(stride, 1)))
+    lines.append("};")
+    lines.append(END)
+    return "\n".join(lines)
+
+
+def main():
+    path = sys.argv[1] if len(sys.argv) > 1 else "src/cwalk.c"
+    with open(path, encoding="utf-8") as file:
+        source = file.read()
+    begin = source.index(BEGIN)
+    end = source.index(END) + len(END)
+    source = source[:begin] + generate_table() + source[end:]
+    with open(path, "w", encoding="utf-8") as file:
+        file.write(source)
+
+
+if __name__ == "__main__":
+    main()
@@ -1,10 +1,52 @@
+#if defined(__linux__) && !defined(_GNU_SOURCE)
+#define _GNU_SOURCE
+#endif
+
 #include <assert.h>
-#include <ctype.h>
 #include <cwalk.h>
 #include <stdarg.h>
+#include <stdint.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 
+#ifdef CWK_THREADS
+#include <pthread.h>
+#include <unistd.h>
+#endif
+
+#ifdef CWK_FILESYSTEM
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stdatomic.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+
+#ifdef CWK_INOTIFY
+#include <sys/inotify.h>
+#endif
+
+/**
+ * Batches of statx operations are submitted through io_uring on linux, if the
+ * headers are recent enough to know about statx operations, which have been
+ * added in linux 5.6 together with IORING_FEAT_RW_CUR_POS.
+ */
+#if defined(__linux__) && defined(__has_include)
+#if __has_include(<linux/io_uring.h>)
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <time.h>
+#if defined(IORING_FEAT_RW_CUR_POS) && defined(STATX_BASIC_STATS) &&           \
+  defined(__NR_io_uring_setup)
+#define CWK_IO_URING
+#endif
+#endif
+#endif
+#endif
+
 /**
  * We try to default to a different path style depending on the operating
  * system. So this should detect whether we should use windows or unix paths.
@@ -35,9 +77,200 @@ struct cwk_segment_joined
 {
   struct cwk_segment segment;
   const char **paths;
+  const size_t *sizes;
   size_t path_index;
 };
 
+/**
+ * A range of code points which are folded to other code points for case
+ * insensitive comparisons. Every code point from the first to the last one,
+ * which is a multiple of the stride away from the first one, is moved by the
+ * delta. Only code points which keep their length in UTF-8 are folded, so
+ * paths keep their length and can still be compared byte by byte.
+ */
+struct cwk_fold_range
+{
+  uint32_t first;
+  uint32_t last;
+  int32_t delta;
+  uint32_t stride;
+};
+
+// The following table is generated by scripts/casefold.py.
+// Unicode 14.0.0, 169 ranges.
+static const struct cwk_fold_range fold_ranges[] = {
+  {0x000B5, 0x000B5, 775, 1},
+  {0x000C0, 0x000D6, 32, 1},
+  {0x000D8, 0x000DE, 32, 1},
+  {0x00100, 0x0012E, 1, 2},
+  {0x00132, 0x00136, 1, 2},
+  {0x00139, 0x00147, 1, 2},
+  {0x0014A, 0x00176, 1, 2},
+  {0x00178, 0x00178, -121, 1},
+  {0x00179, 0x0017D, 1, 2},
+  {0x00181, 0x00181, 210, 1},
+  {0x00182, 0x00184, 1, 2},
+  {0x00186, 0x00186, 206, 1},
+  {0x00187, 0x00187, 1, 1},
+  {0x00189, 0x0018A, 205, 1},
+  {0x0018B, 0x0018B, 1, 1},
+  {0x0018E, 0x0018E, 79, 1},
+  {0x0018F, 0x0018F, 202, 1},
+  {0x00190, 0x00190, 203, 1},
+  {0x00191, 0x00191, 1, 1},
+  {0x00193, 0x00193, 205, 1},
+  {0x00194, 0x00194, 207, 1},
+  {0x00196, 0x00196, 211, 1},
+  {0x00197, 0x00197, 209, 1},
+  {0x00198, 0x00198, 1, 1},
+  {0x0019C, 0x0019C, 211, 1},
+  {0x0019D, 0x0019D, 213, 1},
+  {0x0019F, 0x0019F, 214, 1},
+  {0x001A0, 0x001A4, 1, 2},
+  {0x001A6, 0x001A6, 218, 1},
+  {0x001A7, 0x001A7, 1, 1},
+  {0x001A9, 0x001A9, 218, 1},
+  {0x001AC, 0x001AC, 1, 1},
+  {0x001AE, 0x001AE, 218, 1},
+  {0x001AF, 0x001AF, 1, 1},
+  {0x001B1, 0x001B2, 217, 1},
+  {0x001B3, 0x001B5, 1, 2},
+  {0x001B7, 0x001B7, 219, 1},
+  {0x001B8, 0x001B8, 1, 1},
+  {0x001BC, 0x001BC, 1, 1},
+  {0x001C4, 0x001C4, 2, 1},
+  {0x001C5, 0x001C5, 1, 1},
+  {0x001C7, 0x001C7, 2, 1},
+  {0x001C8, 0x001C8, 1, 1},
+  {0x001CA, 0x001CA, 2, 1},
+  {0x001CB, 0x001DB, 1, 2},
+  {0x001DE, 0x001EE, 1, 2},
+  {0x001F1, 0x001F1, 2, 1},
+  {0x001F2, 0x001F4, 1, 2},
+  {0x001F6, 0x001F6, -97, 1},
+  {0x001F7, 0x001F7, -56, 1},
+  {0x001F8, 0x0021E, 1, 2},
+  {0x00220, 0x00220, -130, 1},
+  {0x00222, 0x00232, 1, 2},
+  {0x0023B, 0x0023B, 1, 1},
+  {0x0023D, 0x0023D, -163, 1},
+  {0x00241, 0x00241, 1, 1},
+  {0x00243, 0x00243, -195, 1},
+  {0x00244, 0x00244, 69, 1},
+  {0x00245, 0x00245, 71, 1},
+  {0x00246, 0x0024E, 1, 2},
+  {0x00345, 0x00345, 116, 1},
+  {0x00370, 0x00372, 1, 2},
+  {0x00376, 0x00376, 1, 1},
+  {0x0037F, 0x0037F, 116, 1},
+  {0x00386, 0x00386, 38, 1},
+  {0x00388, 0x0038A, 37, 1},
+  {0x0038C, 0x0038C, 64, 1},
+  {0x0038E, 0x0038F, 63, 1},
+  {0x00391, 0x003A1, 32, 1},
+  {0x003A3, 0x003AB, 32, 1},
+  {0x003C2, 0x003C2, 1, 1},
+  {0x003CF, 0x003CF, 8, 1},
+  {0x003D0, 0x003D0, -30, 1},
+  {0x003D1, 0x003D1, -25, 1},
+  {0x003D5, 0x003D5, -15, 1},
+  {0x003D6, 0x003D6, -22, 1},
+  {0x003D8, 0x003EE, 1, 2},
+  {0x003F0, 0x003F0, -54, 1},
+  {0x003F1, 0x003F1, -48, 1},
+  {0x003F4, 0x003F4, -60, 1},
+  {0x003F5, 0x003F5, -64, 1},
+  {0x003F7, 0x003F7, 1, 1},
+  {0x003F9, 0x003F9, -7, 1},
+  {0x003FA, 0x003FA, 1, 1},
+  {0x003FD, 0x003FF, -130, 1},
+  {0x00400, 0x0040F, 80, 1},
+  {0x00410, 0x0042F, 32, 1},
+  {0x00460, 0x00480, 1, 2},
+  {0x0048A, 0x004BE, 1, 2},
+  {0x004C0, 0x004C0, 15, 1},
+  {0x004C1, 0x004CD, 1, 2},
+  {0x004D0, 0x0052E, 1, 2},
+  {0x00531, 0x00556, 48, 1},
+  {0x010A0, 0x010C5, 7264, 1},
+  {0x010C7, 0x010C7, 7264, 1},
+  {0x010CD, 0x010CD, 7264, 1},
+  {0x013A0, 0x013EF, 38864, 1},
+  {0x013F0, 0x013F5, 8, 1},
+  {0x01C88, 0x01C88, 35267, 1},
+  {0x01C90, 0x01CBA, -3008, 1},
+  {0x01CBD, 0x01CBF, -3008, 1},
+  {0x01E00, 0x01E94, 1, 2},
+  {0x01E9B, 0x01E9B, -58, 1},
+  {0x01EA0, 0x01EFE, 1, 2},
+  {0x01F08, 0x01F0F, -8, 1},
+  {0x01F18, 0x01F1D, -8, 1},
+  {0x01F28, 0x01F2F, -8, 1},
+  {0x01F38, 0x01F3F, -8, 1},
+  {0x01F48, 0x01F4D, -8, 1},
+  {0x01F59, 0x01F5F, -8, 2},
+  {0x01F68, 0x01F6F, -8, 1},
+  {0x01F88, 0x01F8F, -8, 1},
+  {0x01F98, 0x01F9F, -8, 1},
+  {0x01FA8, 0x01FAF, -8, 1},
+  {0x01FB8, 0x01FB9, -8, 1},
+  {0x01FBA, 0x01FBB, -74, 1},
+  {0x01FBC, 0x01FBC, -9, 1},
+  {0x01FC8, 0x01FCB, -86, 1},
+  {0x01FCC, 0x01FCC, -9, 1},
+  {0x01FD8, 0x01FD9, -8, 1},
+  {0x01FDA, 0x01FDB, -100, 1},
+  {0x01FE8, 0x01FE9, -8, 1},
+  {0x01FEA, 0x01FEB, -112, 1},
+  {0x01FEC, 0x01FEC, -7, 1},
+  {0x01FF8, 0x01FF9, -128, 1},
+  {0x01FFA, 0x01FFB, -126, 1},
+  {0x01FFC, 0x01FFC, -9, 1},
+  {0x02132, 0x02132, 28, 1},
+  {0x02160, 0x0216F, 16, 1},
+  {0x02183, 0x02183, 1, 1},
+  {0x024B6, 0x024CF, 26, 1},
+  {0x02C00, 0x02C2F, 48, 1},
+  {0x02C60, 0x02C60, 1, 1},
+  {0x02C63, 0x02C63, -3814, 1},
+  {0x02C67, 0x02C6B, 1, 2},
+  {0x02C72, 0x02C72, 1, 1},
+  {0x02C75, 0x02C75, 1, 1},
+  {0x02C80, 0x02CE2, 1, 2},
+  {0x02CEB, 0x02CED, 1, 2},
+  {0x02CF2, 0x02CF2, 1, 1},
+  {0x0A640, 0x0A66C, 1, 2},
+  {0x0A680, 0x0A69A, 1, 2},
+  {0x0A722, 0x0A72E, 1, 2},
+  {0x0A732, 0x0A76E, 1, 2},
+  {0x0A779, 0x0A77B, 1, 2},
+  {0x0A77D, 0x0A77D, -35332, 1},
+  {0x0A77E, 0x0A786, 1, 2},
+  {0x0A78B, 0x0A78B, 1, 1},
+  {0x0A790, 0x0A792, 1, 2},
+  {0x0A796, 0x0A7A8, 1, 2},
+  {0x0A7B3, 0x0A7B3, 928, 1},
+  {0x0A7B4, 0x0A7C2, 1, 2},
+  {0x0A7C4, 0x0A7C4, -48, 1},
+  {0x0A7C6, 0x0A7C6, -35384, 1},
+  {0x0A7C7, 0x0A7C9, 1, 2},
+  {0x0A7D0, 0x0A7D0, 1, 1},
+  {0x0A7D6, 0x0A7D8, 1, 2},
+  {0x0A7F5, 0x0A7F5, 1, 1},
+  {0x0FF21, 0x0FF3A, 32, 1},
+  {0x10400, 0x10427, 40, 1},
+  {0x104B0, 0x104D3, 40, 1},
+  {0x10570, 0x1057A, 39, 1},
+  {0x1057C, 0x1058A, 39, 1},
+  {0x1058C, 0x10592, 39, 1},
+  {0x10594, 0x10595, 39, 1},
+  {0x10C80, 0x10CB2, 64, 1},
+  {0x118A0, 0x118BF, 32, 1},
+  {0x16E40, 0x16E5F, 32, 1},
+  {0x1E900, 0x1E921, 34, 1},
+};
+// End of the generated table.
+
 static size_t cwk_path_output_sized(char *buffer, size_t buffer_size,
   size_t position, const char *str, size_t length)
 {
@@ -98,17 +331,6 @@ static size_t cwk_path_output_dot(char *buffer, size_t buffer_size,
   return cwk_path_output_sized(buffer, buffer_size, position, ".", 1);
 }
 
-static size_t cwk_path_output(char *buffer, size_t buffer_size, size_t position,
-  const char *str)
-{
-  size_t length;
-
-  // This just does a sized output internally, but first measuring the
-  // null-terminated string.
-  length = strlen(str);
-  return cwk_path_output_sized(buffer, buffer_size, position, str, length);
-}
-
 static void cwk_path_terminate_output(char *buffer, size_t buffer_size,
   size_t pos)
 {
@@ -121,12 +343,171 @@ static void cwk_path_terminate_output(char *buffer, size_t buffer_size,
   }
 }
 
+static bool cwk_path_is_ascii(const char *str, size_t size)
+{
+  uint64_t block;
+
+  // We check eight characters at once, which is a lot faster than checking
+  // them one by one. A character is not ASCII if its highest bit is set.
+  while (size >= sizeof(block)) {
+    memcpy(&block, str, sizeof(block));
+    if ((block & 0x8080808080808080) != 0) {
+      return false;
+    }
+
+    str += sizeof(block);
+    size -= sizeof(block);
+  }
+
+  while (size > 0) {
+    if ((unsigned char)*str & 0x80) {
+      return false;
+    }
+
+    ++str;
+    --size;
+  }
+
+  return true;
+}
+
+static unsigned char cwk_path_fold_ascii(unsigned char c)
+{
+  // This is the same as tolower in the "C" locale, but it doesn't depend on
+  // the locale of the process.
+  if (c >= 'A' && c <= 'Z') {
+    return (unsigned char)(c - 'A' + 'a');
+  }
+
+  return c;
+}
+
+static size_t cwk_path_decode_utf8(const unsigned char *c,
+  const unsigned char *end, uint32_t *code_point)
+{
+  size_t length, i;
+  unsigned char min, max;
+
+  // We determine the length of the sequence from the first byte, as well as
+  // the valid range of the second byte, which excludes overlong sequences,
+  // surrogates and code points beyond the unicode range.
+  min = 0x80;
+  max = 0xbf;
+  if (*c >= 0xc2 && *c <= 0xdf) {
+    length = 2;
+    *code_point = *c & 0x1f;
+  } else if (*c >= 0xe0 && *c <= 0xef) {
+    length = 3;
+    *code_point = *c & 0x0f;
+    min = *c == 0xe0 ? 0xa0 : 0x80;
+    max = *c == 0xed ? 0x9f : 0xbf;
+  } else if (*c >= 0xf0 && *c <= 0xf4) {
+    length = 4;
+    *code_point = *c & 0x07;
+    min = *c == 0xf0 ? 0x90 : 0x80;
+    max = *c == 0xf4 ? 0x8f : 0xbf;
+  } else {
+    return 0;
+  }
+
+  // Now we read the continuation bytes. A null-terminating character or the
+  // end of the string stops the sequence, which makes it invalid.
+  for (i = 1; i < length; ++i) {
+    if ((end && c + i >= end) || c[i] < min || c[i] > max) {
+      return 0;
+    }
+
+    *code_point = *code_point << 6 | (c[i] & 0x3f);
+    min = 0x80;
+    max = 0xbf;
+  }
+
+  return length;
+}
+
+static uint32_t cwk_path_fold_code_point(uint32_t code_point)
+{
+  size_t low, high, middle;
+  const struct cwk_fold_range *range;
+
+  // The ranges are sorted, so we can use a binary search to find the range
+  // which might contain the code point.
+  low = 0;
+  high = sizeof(fold_ranges) / sizeof(*fold_ranges);
+  while (low < high) {
+    middle = low + (high - low) / 2;
+    range = &fold_ranges[middle];
+    if (code_point < range->first) {
+      high = middle;
+    } else if (code_point > range->last) {
+      low = middle + 1;
+    } else if ((code_point - range->first) % range->stride == 0) {
+      return (uint32_t)((int32_t)code_point + range->delta);
+    } else {
+      break;
+    }
+  }
+
+  return code_point;
+}
+
+static unsigned char cwk_path_fold_char(const char *begin, const char *c,
+  const char *end)
+{
+  size_t length;
+  uint32_t code_point;
+  const unsigned char *start;
+
+  // Most characters are ASCII, which we can fold right away.
+  if (!((unsigned char)*c & 0x80)) {
+    return cwk_path_fold_ascii((unsigned char)*c);
+  }
+
+  // Otherwise we have to find the beginning of the UTF-8 sequence, which is at
+  // most three bytes before this one. We don't go beyond the beginning of the
+  // string.
+  start = (const unsigned char *)c;
+  while ((const char *)start > begin && start + 3 > (const unsigned char *)c &&
+         (*start & 0xc0) == 0x80) {
+    --start;
+  }
+
+  // If the sequence is invalid or does not contain this byte, it is not folded.
+  // Otherwise we fold the code point and return the byte of the folded
+  // sequence, which has the same length.
+  length = cwk_path_decode_utf8(start, (const unsigned char *)end, &code_point);
+  if (start + length <= (const unsigned char *)c) {
+    return (unsigned char)*c;
+  }
+
+  code_point = cwk_path_fold_code_point(code_point);
+  length = (size_t)((const unsigned char *)c - start);
+  if (length == 0) {
+    // This is the first byte, which contains the marker of the length.
+    if (code_point < 0x800) {
+      return (unsigned char)(0xc0 | code_point >> 6);
+    } else if (code_point < 0x10000) {
+      return (unsigned char)(0xe0 | code_point >> 12);
+    }
+    return (unsigned char)(0xf0 | code_point >> 18);
+  }
+
+  // All other bytes contain six bits each, starting with the highest ones.
+  if (code_point < 0x800) {
+    return (unsigned char)(0x80 | (code_point & 0x3f));
+  } else if (code_point < 0x10000) {
+    return (unsigned char)(0x80 | (code_point >> (6 * (2 - length)) & 0x3f));
+  }
+  return (unsigned char)(0x80 | (code_point >> (6 * (3 - length)) & 0x3f));
+}
+
 static bool cwk_path_is_string_equal(const char *first, const char *second,
   size_t first_size, size_t second_size)
 {
-  bool are_both_separators;
+  size_t i;
 
-  // The two strings are not equal if the sizes are not equal.
+  // The two strings are not equal if the sizes are not equal. The case folding
+  // never changes the length of a string.
   if (first_size != second_size) {
     return false;
   }
@@ -138,35 +519,46 @@ static bool cwk_path_is_string_equal(const char *first, const char *second,
   }
 
   // However, if this is windows we will have to compare case insensitively.
-  // Since there is no standard method to do that we will have to do it on our
-  // own.
-  while (*first && *second && first_size > 0) {
-    // We can consider the string to be not equal if the two lowercase
-    // characters are not equal. The two chars may also be separators, which
-    // means they would be equal.
-    are_both_separators = strchr(separators[path_style], *first) != NULL &&
-                          strchr(separators[path_style], *second) != NULL;
-
-    if (tolower(*first) != tolower(*second) && !are_both_separators) {
-      return false;
+  // Most paths are ASCII only, which only requires to fold each single
+  // character.
+  if (cwk_path_is_ascii(first, first_size) &&
+      cwk_path_is_ascii(second, second_size)) {
+    for (i = 0; i < first_size; ++i) {
+      // The two chars may also be separators, which means they would be equal.
+      if (first[i] != second[i] &&
+          cwk_path_fold_ascii((unsigned char)first[i]) !=
+            cwk_path_fold_ascii((unsigned char)second[i]) &&
+          !(cwk_path_is_separator(&first[i]) &&
+            cwk_path_is_separator(&second[i]))) {
+        return false;
+      }
     }
 
-    first++;
-    second++;
+    return true;
+  }
 
-    --first_size;
+  // Otherwise we have to fold every character with the unicode case folding.
+  // Since this never changes the length, we can still compare byte by byte.
+  // Equal bytes might still be folded differently, since a byte is folded
+  // together with the rest of its sequence.
+  for (i = 0; i < first_size; ++i) {
+    if (cwk_path_fold_char(first, &first[i], first + first_size) !=
+          cwk_path_fold_char(second, &second[i], second + second_size) &&
+        !(cwk_path_is_separator(&first[i]) &&
+          cwk_path_is_separator(&second[i]))) {
+      return false;
+    }
   }
 
-  // The string must be equal since they both have the same length and all the
-  // characters are the same.
   return true;
 }
 
-static const char *cwk_path_find_next_stop(const char *c)
+static const char *cwk_path_find_next_stop(const char *c, const char *end)
 {
-  // We just move forward until we find a '\0' or a separator, which will be our
-  // next "stop".
-  while (*c != '\0' && !cwk_path_is_separator(c)) {
+  // We just move forward until we find a '\0', a separator or the end, which
+  // will be our next "stop". The end is NULL if the path is only terminated by
+  // a '\0'.
+  while (c != end && *c != '\0' && !cwk_path_is_separator(c)) {
     ++c;
   }
 
@@ -192,7 +584,7 @@ static const char *cwk_path_find_previous_stop(const char *begin, const char *c)
 }
 
 static bool cwk_path_get_first_segment_without_root(const char *path,
-  const char *segments, struct cwk_segment *segment)
+  const char *segments, const char *end, struct cwk_segment *segment)
 {
   // Let's remember the path. We will move the path pointer afterwards, that's
   // why this has to be done first.
@@ -204,7 +596,7 @@ static bool cwk_path_get_first_segment_without_root(const char *path,
 
   // Now let's check whether this is an empty string. An empty string has no
   // segment it could use.
-  if (*segments == '\0') {
+  if (segments == end || *segments == '\0') {
     return false;
   }
 
@@ -213,7 +605,7 @@ static bool cwk_path_get_first_segment_without_root(const char *path,
   // since there is none.
   while (cwk_path_is_separator(segments)) {
     ++segments;
-    if (*segments == '\0') {
+    if (segments == end || *segments == '\0') {
       return false;
     }
   }
@@ -223,7 +615,7 @@ static bool cwk_path_get_first_segment_without_root(const char *path,
 
   // Now let's determine the end of the segment, which we do by moving the path
   // pointer further until we find a separator.
-  segments = cwk_path_find_next_stop(segments);
+  segments = cwk_path_find_next_stop(segments, end);
 
   // And finally, calculate the size of the segment by subtracting the position
   // from the end.
@@ -234,43 +626,123 @@ static bool cwk_path_get_first_segment_without_root(const char *path,
   return true;
 }
 
+static bool cwk_path_get_next_segment_bounded(struct cwk_segment *segment,
+  const char *end)
+{
+  const char *c;
+
+  // First we jump to the end of the previous segment. The first character must
+  // be either the end of the path or a separator.
+  c = segment->begin + segment->size;
+  if (c == end || *c == '\0') {
+    return false;
+  }
+
+  // Now we skip all separator until we reach something else. We are not yet
+  // guaranteed to have a segment, since the string could just end afterwards.
+  assert(cwk_path_is_separator(c));
+  do {
+    ++c;
+  } while (c != end && cwk_path_is_separator(c));
+
+  // If the string ends here, we can safely assume that there is no other
+  // segment after this one.
+  if (c == end || *c == '\0') {
+    return false;
+  }
+
+  // Now we are safe to assume there is a segment. We store the beginning of
+  // this segment in the segment struct of the caller.
+  segment->begin = c;
+
+  // And now determine the size of this segment, and store it in the struct of
+  // the caller as well.
+  c = cwk_path_find_next_stop(c, end);
+  segment->end = c;
+  segment->size = (size_t)(c - segment->begin);
+
+  // Tell the caller that we found a segment.
+  return true;
+}
+
 static bool cwk_path_get_last_segment_without_root(const char *path,
-  struct cwk_segment *segment)
+  const char *end, struct cwk_segment *segment)
 {
   // Now this is fairly similar to the normal algorithm, however, it will assume
   // that there is no root in the path. So we grab the first segment at this
   // position, assuming there is no root.
-  if (!cwk_path_get_first_segment_without_root(path, path, segment)) {
+  if (!cwk_path_get_first_segment_without_root(path, path, end, segment)) {
     return false;
   }
 
   // Now we find our last segment. The segment struct of the caller
   // will contain the last segment, since the function we call here will not
   // change the segment struct when it reaches the end.
-  while (cwk_path_get_next_segment(segment)) {
+  while (cwk_path_get_next_segment_bounded(segment, end)) {
+    // We just loop until there is no other segment left.
+  }
+
+  return true;
+}
+
+static bool cwk_path_get_first_segment_bounded(const char *path,
+  const char *end, struct cwk_segment *segment)
+{
+  size_t length;
+
+  // We skip the root since that's not part of the first segment. The root is
+  // treated as a separate entity.
+  cwk_path_get_root_sized(path, end != NULL ? (size_t)(end - path) : SIZE_MAX,
+    &length);
+  return cwk_path_get_first_segment_without_root(path, path + length, end,
+    segment);
+}
+
+static bool cwk_path_get_last_segment_bounded(const char *path,
+  const char *end, struct cwk_segment *segment)
+{
+  // There is no last segment if there is no first segment. Otherwise we move
+  // forward until there is no other segment left.
+  if (!cwk_path_get_first_segment_bounded(path, end, segment)) {
+    return false;
+  }
+
+  while (cwk_path_get_next_segment_bounded(segment, end)) {
     // We just loop until there is no other segment left.
   }
 
   return true;
 }
 
+static const char *cwk_path_get_joined_end(const struct cwk_segment_joined *sj)
+{
+  // Paths without a size end at their null-terminating character.
+  if (sj->sizes == NULL) {
+    return NULL;
+  }
+
+  return sj->paths[sj->path_index] + sj->sizes[sj->path_index];
+}
+
 static bool cwk_path_get_first_segment_joined(const char **paths,
-  struct cwk_segment_joined *sj)
+  const size_t *sizes, struct cwk_segment_joined *sj)
 {
   bool result;
 
   // Prepare the first segment. We position the joined segment on the first path
-  // and assign the path array to the struct.
+  // and assign the path array to the struct. The sizes are optional, paths
+  // without a size end at their null-terminating character.
   sj->path_index = 0;
   sj->paths = paths;
+  sj->sizes = sizes;
 
   // We loop through all paths until we find one which has a segment. The result
   // is stored in a variable, so we can let the caller know whether we found one
   // or not.
   result = false;
   while (paths[sj->path_index] != NULL &&
-         (result = cwk_path_get_first_segment(paths[sj->path_index],
-            &sj->segment)) == false) {
+         (result = cwk_path_get_first_segment_bounded(paths[sj->path_index],
+            cwk_path_get_joined_end(sj), &sj->segment)) == false) {
     ++sj->path_index;
   }
 
@@ -285,7 +757,8 @@ static bool cwk_path_get_next_segment_joined(struct cwk_segment_joined *sj)
     // We reached already the end of all paths, so there is no other segment
     // left.
     return false;
-  } else if (cwk_path_get_next_segment(&sj->segment)) {
+  } else if (cwk_path_get_next_segment_bounded(&sj->segment,
+               cwk_path_get_joined_end(sj))) {
     // There was another segment on the current path, so we are good to
     // continue.
     return true;
@@ -308,7 +781,7 @@ static bool cwk_path_get_next_segment_joined(struct cwk_segment_joined *sj)
     // here - for the first time we do this we want to skip the root, but
     // afterwards we will consider that to be part of the segments.
     result = cwk_path_get_first_segment_without_root(sj->paths[sj->path_index],
-      sj->paths[sj->path_index], &sj->segment);
+      sj->paths[sj->path_index], cwk_path_get_joined_end(sj), &sj->segment);
 
   } while (!result);
 
@@ -347,11 +820,11 @@ static bool cwk_path_get_previous_segment_joined(struct cwk_segment_joined *sj)
     // If this is the first path we will have to consider that this path might
     // include a root, otherwise we just treat is as a segment.
     if (sj->path_index == 0) {
-      result = cwk_path_get_last_segment(sj->paths[sj->path_index],
-        &sj->segment);
+      result = cwk_path_get_last_segment_bounded(sj->paths[sj->path_index],
+        cwk_path_get_joined_end(sj), &sj->segment);
     } else {
       result = cwk_path_get_last_segment_without_root(sj->paths[sj->path_index],
-        &sj->segment);
+        cwk_path_get_joined_end(sj), &sj->segment);
     }
 
   } while (!result);
@@ -473,27 +946,37 @@ cwk_path_segment_joined_skip_invisible(struct cwk_segment_joined *sj,
   return true;
 }
 
-static void cwk_path_get_root_windows(const char *path, size_t *length)
+static bool cwk_path_is_end_at(const char *path, size_t size, size_t i)
 {
-  const char *c;
-  bool is_device_path;
+  // The path ends either at the null-terminating character or at the submitted
+  // size, whichever comes first.
+  return i >= size || path[i] == '\0';
+}
+
+static bool cwk_path_is_separator_at(const char *path, size_t size, size_t i)
+{
+  return !cwk_path_is_end_at(path, size, i) && cwk_path_is_separator(&path[i]);
+}
+
+static void cwk_path_get_root_windows(const char *path, size_t size,
+  size_t *length)
+{
+  size_t i;
 
   // We can not determine the root if this is an empty string. So we set the
   // root to NULL and the length to zero and cancel the whole thing.
-  c = path;
   *length = 0;
-  if (!*c) {
+  if (cwk_path_is_end_at(path, size, 0)) {
     return;
   }
 
   // Now we have to verify whether this is a windows network path (UNC), which
   // we will consider our root.
-  if (cwk_path_is_separator(c)) {
-    ++c;
+  if (cwk_path_is_separator_at(path, size, 0)) {
 
     // Check whether the path starts with a single backslash, which means this
     // is not a network path - just a normal path starting with a backslash.
-    if (!cwk_path_is_separator(c)) {
+    if (!cwk_path_is_separator_at(path, size, 1)) {
       // Okay, this is not a network path but we still use the backslash as a
       // root.
       ++(*length);
@@ -502,14 +985,11 @@ static void cwk_path_get_root_windows(const char *path, size_t *length)
 
     // A device path is a path which starts with "\\." or "\\?". A device path
     // can be a UNC path as well, in which case it will take up one more
-    // segment. So, this is a network or device path. Skip the previous
-    // separator. Now we need to determine whether this is a device path. We
-    // might advance one character here if the server name starts with a '?' or
-    // a '.', but that's fine since we will search for a separator afterwards
-    // anyway.
-    ++c;
-    is_device_path = (*c == '?' || *c == '.') && cwk_path_is_separator(++c);
-    if (is_device_path) {
+    // segment. So, this is a network or device path. Now we need to determine
+    // whether this is a device path.
+    if (!cwk_path_is_end_at(path, size, 2) &&
+        (path[2] == '?' || path[2] == '.') &&
+        cwk_path_is_separator_at(path, size, 3)) {
       // That's a device path, and the root must be either "\\.\" or "\\?\"
       // which is 4 characters long. (at least that's how Windows
       // GetFullPathName behaves.)
@@ -517,50 +997,58 @@ static void cwk_path_get_root_windows(const char *path, size_t *length)
       return;
     }
 
-    // We will grab anything up to the next stop. The next stop might be a '\0'
-    // or another separator. That will be the server name.
-    c = cwk_path_find_next_stop(c);
+    // We will grab anything up to the next stop. The next stop might be the
+    // end of the path or another separator. That will be the server name.
+    i = 2;
+    while (!cwk_path_is_end_at(path, size, i) &&
+           !cwk_path_is_separator_at(path, size, i)) {
+      ++i;
+    }
 
     // If this is a separator and not the end of a string we wil have to include
-    // it. However, if this is a '\0' we must not skip it.
-    while (cwk_path_is_separator(c)) {
-      ++c;
+    // it. However, if this is the end we must not skip it.
+    while (cwk_path_is_separator_at(path, size, i)) {
+      ++i;
     }
 
     // We are now skipping the shared folder name, which will end after the
     // next stop.
-    c = cwk_path_find_next_stop(c);
+    while (!cwk_path_is_end_at(path, size, i) &&
+           !cwk_path_is_separator_at(path, size, i)) {
+      ++i;
+    }
 
     // Then there might be a separator at the end. We will include that as well,
     // it will mark the path as absolute.
-    if (cwk_path_is_separator(c)) {
-      ++c;
+    if (cwk_path_is_separator_at(path, size, i)) {
+      ++i;
     }
 
     // Finally, calculate the size of the root.
-    *length = (size_t)(c - path);
+    *length = i;
     return;
   }
 
   // Move to the next and check whether this is a colon.
-  if (*++c == ':') {
+  if (!cwk_path_is_end_at(path, size, 1) && path[1] == ':') {
     *length = 2;
 
     // Now check whether this is a backslash (or slash). If it is not, we could
     // assume that the next character is a '\0' if it is a valid path. However,
     // we will not assume that - since ':' is not valid in a path it must be a
     // mistake by the caller than. We will try to understand it anyway.
-    if (cwk_path_is_separator(++c)) {
+    if (cwk_path_is_separator_at(path, size, 2)) {
       *length = 3;
     }
   }
 }
 
-static void cwk_path_get_root_unix(const char *path, size_t *length)
+static void cwk_path_get_root_unix(const char *path, size_t size,
+  size_t *length)
 {
   // The slash of the unix path represents the root. There is no root if there
   // is no slash.
-  if (cwk_path_is_separator(path)) {
+  if (cwk_path_is_separator_at(path, size, 0)) {
     *length = 1;
   } else {
     *length = 0;
@@ -603,14 +1091,14 @@ static void cwk_path_fix_root(char *buffer, size_t buffer_size, size_t length)
 }
 
 static size_t cwk_path_join_and_normalize_multiple(const char **paths,
-  char *buffer, size_t buffer_size)
+  const size_t *sizes, char *buffer, size_t buffer_size)
 {
   size_t pos;
   bool absolute, has_segment_output;
   struct cwk_segment_joined sj;
 
   // We initialize the position after the root, which should get us started.
-  cwk_path_get_root(paths[0], &pos);
+  cwk_path_get_root_sized(paths[0], sizes != NULL ? sizes[0] : SIZE_MAX, &pos);
 
   // Determine whether the path is absolute or not. We need that to determine
   // later on whether we can remove superfluous "../" or not.
@@ -623,7 +1111,7 @@ static size_t cwk_path_join_and_normalize_multiple(const char **paths,
 
   // So we just grab the first segment. If there is no segment we will always
   // output a "/", since we currently only support absolute paths here.
-  if (!cwk_path_get_first_segment_joined(paths, &sj)) {
+  if (!cwk_path_get_first_segment_joined(paths, sizes, &sj)) {
     goto done;
   }
 
@@ -678,40 +1166,61 @@ done:
   return pos;
 }
 
+static bool cwk_path_is_absolute_sized(const char *path, size_t path_size)
+{
+  size_t length;
+
+  cwk_path_get_root_sized(path, path_size, &length);
+  return cwk_path_is_root_absolute(path, length);
+}
+
 size_t cwk_path_get_absolute(const char *base, const char *path, char *buffer,
   size_t buffer_size)
 {
-  size_t i;
+  return cwk_path_get_absolute_sized(base, strlen(base), path, strlen(path),
+    buffer, buffer_size);
+}
+
+size_t cwk_path_get_absolute_sized(const char *base, size_t base_size,
+  const char *path, size_t path_size, char *buffer, size_t buffer_size)
+{
+  size_t i, sizes[3];
   const char *paths[4];
 
   // The basename should be an absolute path if the caller is using the API
   // correctly. However, he might not and in that case we will append a fake
   // root at the beginning.
-  if (cwk_path_is_absolute(base)) {
+  if (cwk_path_is_absolute_sized(base, base_size)) {
     i = 0;
   } else if (path_style == CWK_STYLE_WINDOWS) {
     paths[0] = "\\";
+    sizes[0] = 1;
     i = 1;
   } else {
     paths[0] = "/";
+    sizes[0] = 1;
     i = 1;
   }
 
-  if (cwk_path_is_absolute(path)) {
+  if (cwk_path_is_absolute_sized(path, path_size)) {
     // If the submitted path is not relative the base path becomes irrelevant.
     // We will only normalize the submitted path instead.
-    paths[i++] = path;
+    paths[i] = path;
+    sizes[i++] = path_size;
     paths[i] = NULL;
   } else {
     // Otherwise we append the relative path to the base path and normalize it.
     // The result will be a new absolute path.
-    paths[i++] = base;
-    paths[i++] = path;
+    paths[i] = base;
+    sizes[i++] = base_size;
+    paths[i] = path;
+    sizes[i++] = path_size;
     paths[i] = NULL;
   }
 
   // Finally join everything together and normalize it.
-  return cwk_path_join_and_normalize_multiple(paths, buffer, buffer_size);
+  return cwk_path_join_and_normalize_multiple(paths, sizes, buffer,
+    buffer_size);
 }
 
 static void cwk_path_skip_segments_until_diverge(struct cwk_segment_joined *bsj,
@@ -752,6 +1261,14 @@ static void cwk_path_skip_segments_until_diverge(struct cwk_segment_joined *bsj,
 
 size_t cwk_path_get_relative(const char *base_directory, const char *path,
   char *buffer, size_t buffer_size)
+{
+  return cwk_path_get_relative_sized(base_directory, strlen(base_directory),
+    path, strlen(path), buffer, buffer_size);
+}
+
+size_t cwk_path_get_relative_sized(const char *base_directory,
+  size_t base_directory_size, const char *path, size_t path_size,
+  char *buffer, size_t buffer_size)
 {
   size_t pos, base_root_length, path_root_length;
   bool absolute, base_available, other_available, has_output;
@@ -763,8 +1280,9 @@ size_t cwk_path_get_relative(const char *base_directory, const char *path,
   // First we compare the roots of those two paths. If the roots are not equal
   // we can't continue, since there is no way to get a relative path from
   // different roots.
-  cwk_path_get_root(base_directory, &base_root_length);
-  cwk_path_get_root(path, &path_root_length);
+  cwk_path_get_root_sized(base_directory, base_directory_size,
+    &base_root_length);
+  cwk_path_get_root_sized(path, path_size, &path_root_length);
   if (base_root_length != path_root_length ||
       !cwk_path_is_string_equal(base_directory, path, base_root_length,
         path_root_length)) {
@@ -783,8 +1301,8 @@ size_t cwk_path_get_relative(const char *base_directory, const char *path,
   base_paths[1] = NULL;
   other_paths[0] = path;
   other_paths[1] = NULL;
-  cwk_path_get_first_segment_joined(base_paths, &bsj);
-  cwk_path_get_first_segment_joined(other_paths, &osj);
+  cwk_path_get_first_segment_joined(base_paths, &base_directory_size, &bsj);
+  cwk_path_get_first_segment_joined(other_paths, &path_size, &osj);
 
   // Okay, now we skip until the segments diverge. We don't have anything to do
   // with the segments which are equal.
@@ -859,18 +1377,29 @@ size_t cwk_path_get_relative(const char *base_directory, const char *path,
 
 size_t cwk_path_join(const char *path_a, const char *path_b, char *buffer,
   size_t buffer_size)
+{
+  return cwk_path_join_sized(path_a, strlen(path_a), path_b, strlen(path_b),
+    buffer, buffer_size);
+}
+
+size_t cwk_path_join_sized(const char *path_a, size_t path_a_size,
+  const char *path_b, size_t path_b_size, char *buffer, size_t buffer_size)
 {
   const char *paths[3];
+  size_t sizes[2];
 
   // This is simple. We will just create an array with the two paths which we
   // wish to join.
   paths[0] = path_a;
   paths[1] = path_b;
   paths[2] = NULL;
+  sizes[0] = path_a_size;
+  sizes[1] = path_b_size;
 
   // And then call the join and normalize function which will do the hard work
   // for us.
-  return cwk_path_join_and_normalize_multiple(paths, buffer, buffer_size);
+  return cwk_path_join_and_normalize_multiple(paths, sizes, buffer,
+    buffer_size);
 }
 
 size_t cwk_path_join_multiple(const char **paths, char *buffer,
@@ -878,49 +1407,61 @@ size_t cwk_path_join_multiple(const char **paths, char *buffer,
 {
   // We can just call the internal join and normalize function for this one,
   // since it will handle everything.
-  return cwk_path_join_and_normalize_multiple(paths, buffer, buffer_size);
+  return cwk_path_join_and_normalize_multiple(paths, NULL, buffer,
+    buffer_size);
 }
 
 void cwk_path_get_root(const char *path, size_t *length)
+{
+  // The path is null-terminated, so we don't need to limit the size.
+  cwk_path_get_root_sized(path, SIZE_MAX, length);
+}
+
+void cwk_path_get_root_sized(const char *path, size_t path_size,
+  size_t *length)
 {
   // We use a different implementation here based on the configuration of the
   // library.
   if (path_style == CWK_STYLE_WINDOWS) {
-    cwk_path_get_root_windows(path, length);
+    cwk_path_get_root_windows(path, path_size, length);
   } else {
-    cwk_path_get_root_unix(path, length);
+    cwk_path_get_root_unix(path, path_size, length);
   }
 }
 
 size_t cwk_path_change_root(const char *path, const char *new_root,
   char *buffer, size_t buffer_size)
+{
+  // We determine the sizes of the new root and the path. We need that to
+  // determine the size of the part after the root (the tail).
+  return cwk_path_change_root_sized(path, strlen(path), new_root,
+    strlen(new_root), buffer, buffer_size);
+}
+
+size_t cwk_path_change_root_sized(const char *path, size_t path_size,
+  const char *new_root, size_t new_root_size, char *buffer, size_t buffer_size)
 {
   const char *tail;
-  size_t root_length, path_length, tail_length, new_root_length, new_path_size;
+  size_t root_length, tail_length, new_path_size;
 
   // First we need to determine the actual size of the root which we will
   // change.
-  cwk_path_get_root(path, &root_length);
-
-  // Now we determine the sizes of the new root and the path. We need that to
-  // determine the size of the part after the root (the tail).
-  new_root_length = strlen(new_root);
-  path_length = strlen(path);
+  cwk_path_get_root_sized(path, path_size, &root_length);
 
   // Okay, now we calculate the position of the tail and the length of it.
   tail = path + root_length;
-  tail_length = path_length - root_length;
+  tail_length = path_size - root_length;
 
   // We first output the tail and then the new root, that's because the source
   // path and the buffer may be overlapping. This way the root will not
   // overwrite the tail.
-  cwk_path_output_sized(buffer, buffer_size, new_root_length, tail,
+  cwk_path_output_sized(buffer, buffer_size, new_root_size, tail,
     tail_length);
-  cwk_path_output_sized(buffer, buffer_size, 0, new_root, new_root_length);
+  cwk_path_output_sized(buffer, buffer_size, 0, new_root, new_root_size);
 
   // Finally we calculate the size o the new path and terminate the output with
   // a '\0'.
-  new_path_size = tail_length + new_root_length;
+  new_path_size = tail_length + new_root_size;
   cwk_path_terminate_output(buffer, buffer_size, new_path_size);
 
   return new_path_size;
@@ -969,32 +1510,82 @@ void cwk_path_get_basename(const char *path, const char **basename,
   }
 }
 
+static size_t cwk_path_change_segment_bounded(struct cwk_segment *segment,
+  const char *end, const char *value, size_t value_size, char *buffer,
+  size_t buffer_size)
+{
+  size_t pos, tail_size;
+
+  // First we have to output the head, which is the whole string up to the
+  // beginning of the segment. This part of the path will just stay the same.
+  pos = cwk_path_output_sized(buffer, buffer_size, 0, segment->path,
+    (size_t)(segment->begin - segment->path));
+
+  // In order to trip the submitted value, we will skip any separator at the
+  // beginning of it and behave as if it was never there.
+  while (value_size > 0 && cwk_path_is_separator(value)) {
+    ++value;
+    --value_size;
+  }
+
+  // Since we trim separators at the beginning and in the end of the value we
+  // have to subtract from the size until there are either no more characters
+  // left or the last character is no separator.
+  while (value_size > 0 && cwk_path_is_separator(&value[value_size - 1])) {
+    --value_size;
+  }
+
+  // We also have to determine the tail size, which is the part of the string
+  // following the current segment. This part will not change.
+  tail_size = end != NULL ? (size_t)(end - segment->end) : strlen(segment->end);
+
+  // Now we output the tail. We have to do that, because if the buffer and the
+  // source are overlapping we would override the tail if the value is
+  // increasing in length.
+  cwk_path_output_sized(buffer, buffer_size, pos + value_size, segment->end,
+    tail_size);
+
+  // Finally we can output the value in the middle of the head and the tail,
+  // where we have enough space to fit the whole trimmed value.
+  pos += cwk_path_output_sized(buffer, buffer_size, pos, value, value_size);
+
+  // Now we add the tail size to the current position and terminate the output -
+  // basically, ensure that there is a '\0' at the end of the buffer.
+  pos += tail_size;
+  cwk_path_terminate_output(buffer, buffer_size, pos);
+
+  // And now tell the caller how long the whole path would be.
+  return pos;
+}
+
 size_t cwk_path_change_basename(const char *path, const char *new_basename,
   char *buffer, size_t buffer_size)
+{
+  return cwk_path_change_basename_sized(path, strlen(path), new_basename,
+    strlen(new_basename), buffer, buffer_size);
+}
+
+size_t cwk_path_change_basename_sized(const char *path, size_t path_size,
+  const char *new_basename, size_t new_basename_size, char *buffer,
+  size_t buffer_size)
 {
   struct cwk_segment segment;
-  size_t pos, root_size, new_basename_size;
+  size_t pos, root_size;
 
   // First we try to get the last segment. We may only have a root without any
   // segments, in which case we will create one.
-  if (!cwk_path_get_last_segment(path, &segment)) {
+  if (!cwk_path_get_last_segment_bounded(path, path + path_size, &segment)) {
 
     // So there is no segment in this path. First we grab the root and output
     // that. We are not going to modify the root in any way.
-    cwk_path_get_root(path, &root_size);
+    cwk_path_get_root_sized(path, path_size, &root_size);
     pos = cwk_path_output_sized(buffer, buffer_size, 0, path, root_size);
 
     // We have to trim the separators from the beginning of the new basename.
     // This is quite easy to do.
-    while (cwk_path_is_separator(new_basename)) {
+    while (new_basename_size > 0 && cwk_path_is_separator(new_basename)) {
       ++new_basename;
-    }
-
-    // Now we measure the length of the new basename, this is a two step
-    // process. First we find the '\0' character at the end of the string.
-    new_basename_size = 0;
-    while (new_basename[new_basename_size]) {
-      ++new_basename_size;
+      --new_basename_size;
     }
 
     // And then we trim the separators at the end of the basename until we reach
@@ -1015,7 +1606,8 @@ size_t cwk_path_change_basename(const char *path, const char *new_basename,
 
   // If there is a last segment we can just forward this call, which is fairly
   // easy.
-  return cwk_path_change_segment(&segment, new_basename, buffer, buffer_size);
+  return cwk_path_change_segment_bounded(&segment, path + path_size,
+    new_basename, new_basename_size, buffer, buffer_size);
 }
 
 void cwk_path_get_dirname(const char *path, size_t *length)
@@ -1074,28 +1666,37 @@ bool cwk_path_has_extension(const char *path)
 
 size_t cwk_path_change_extension(const char *path, const char *new_extension,
   char *buffer, size_t buffer_size)
+{
+  return cwk_path_change_extension_sized(path, strlen(path), new_extension,
+    strlen(new_extension), buffer, buffer_size);
+}
+
+size_t cwk_path_change_extension_sized(const char *path, size_t path_size,
+  const char *new_extension, size_t new_extension_size, char *buffer,
+  size_t buffer_size)
 {
   struct cwk_segment segment;
   const char *c, *old_extension;
-  size_t pos, root_size, trail_size, new_extension_size;
+  size_t pos, root_size, trail_size;
 
   // First we try to get the last segment. We may only have a root without any
   // segments, in which case we will create one.
-  if (!cwk_path_get_last_segment(path, &segment)) {
+  if (!cwk_path_get_last_segment_bounded(path, path + path_size, &segment)) {
 
     // So there is no segment in this path. First we grab the root and output
     // that. We are not going to modify the root in any way. If there is no
     // root, this will end up with a root size 0, and nothing will be written.
-    cwk_path_get_root(path, &root_size);
+    cwk_path_get_root_sized(path, path_size, &root_size);
     pos = cwk_path_output_sized(buffer, buffer_size, 0, path, root_size);
 
     // Add a dot if the submitted value doesn't have any.
-    if (*new_extension != '.') {
+    if (new_extension_size == 0 || *new_extension != '.') {
       pos += cwk_path_output_dot(buffer, buffer_size, pos);
     }
 
     // And finally terminate the output and return the total size of the path.
-    pos += cwk_path_output(buffer, buffer_size, pos, new_extension);
+    pos += cwk_path_output_sized(buffer, buffer_size, pos, new_extension,
+      new_extension_size);
     cwk_path_terminate_output(buffer, buffer_size, pos);
     return pos;
   }
@@ -1116,22 +1717,24 @@ size_t cwk_path_change_extension(const char *path, const char *new_extension,
   // If the new extension starts with a dot, we will skip that dot. We always
   // output exactly one dot before the extension. If the extension contains
   // multiple dots, we will output those as part of the extension.
-  if (*new_extension == '.') {
+  if (new_extension_size > 0 && *new_extension == '.') {
     ++new_extension;
+    --new_extension_size;
   }
 
-  // We calculate the size of the new extension, including the dot, in order to
-  // output the trail - which is any part of the path coming after the
-  // extension. We must output this first, since the buffer may overlap with the
-  // submitted path - and it would be overridden by longer extensions.
-  new_extension_size = strlen(new_extension) + 1;
-  trail_size = cwk_path_output(buffer, buffer_size, pos + new_extension_size,
-    segment.end);
+  // We output the trail - which is any part of the path coming after the
+  // extension - right after the dot and the new extension. We must output this
+  // first, since the buffer may overlap with the submitted path - and it would
+  // be overridden by longer extensions.
+  trail_size = cwk_path_output_sized(buffer, buffer_size,
+    pos + new_extension_size + 1, segment.end,
+    (size_t)(path + path_size - segment.end));
 
   // Finally we output the dot and the new extension. The new extension itself
   // doesn't contain the dot anymore, so we must output that first.
   pos += cwk_path_output_dot(buffer, buffer_size, pos);
-  pos += cwk_path_output(buffer, buffer_size, pos, new_extension);
+  pos += cwk_path_output_sized(buffer, buffer_size, pos, new_extension,
+    new_extension_size);
 
   // Now we terminate the output with a null-terminating character, but before
   // we do that we must add the size of the trail to the position which we
@@ -1143,22 +1746,387 @@ size_t cwk_path_change_extension(const char *path, const char *new_extension,
   return pos;
 }
 
-size_t cwk_path_normalize(const char *path, char *buffer, size_t buffer_size)
+/**
+ * A rewrite which is applied to every path of a batch. Parts which are NULL are
+ * kept as they are, while the others are replaced. The values are already
+ * trimmed, so this only has to be done once for the whole batch.
+ */
+struct cwk_path_rewrite
 {
-  const char *paths[2];
+  const char *root;
+  size_t root_size;
+  const char *basename;
+  size_t basename_size;
+  const char *extension;
+  size_t extension_size;
+};
+
+static const char *cwk_path_find_last_segment(const char *path,
+  size_t root_length, const char **end)
+{
+  const char *begin;
+
+  // We search the last segment backwards from the end of the path, skipping
+  // any trailing separators. This way we don't have to iterate over all other
+  // segments of the path. The root never contains a segment.
+  while (*end > path + root_length && cwk_path_is_separator(*end - 1)) {
+    --*end;
+  }
+
+  begin = *end;
+  while (begin > path + root_length && !cwk_path_is_separator(begin - 1)) {
+    --begin;
+  }
+
+  return begin;
+}
+
+static size_t cwk_path_rewrite_single(const char *path,
+  const struct cwk_path_rewrite *rewrite, char *buffer, size_t buffer_size,
+  size_t pos)
+{
+  const char *path_end, *segment_begin, *segment_end, *cut_begin, *cut_end, *c;
+  size_t start, root_length;
+
+  // We determine the root and the last segment only once, no matter which parts
+  // of the path are replaced.
+  start = pos;
+  cwk_path_get_root(path, &root_length);
+  path_end = path + strlen(path);
+  segment_end = path_end;
+  segment_begin = cwk_path_find_last_segment(path, root_length, &segment_end);
+
+  // The cut is the part of the path which is replaced by the new basename or
+  // extension. If there is no segment, everything after the root is replaced,
+  // just like cwk_path_change_basename and cwk_path_change_extension do it.
+  cut_begin = path_end;
+  cut_end = path_end;
+  if (segment_begin == segment_end &&
+      (rewrite->basename != NULL || rewrite->extension != NULL)) {
+    cut_begin = path + root_length;
+  } else if (rewrite->basename != NULL) {
+    cut_begin = segment_begin;
+    cut_end = segment_end;
+  } else if (rewrite->extension != NULL) {
+    cut_begin = segment_end;
+    cut_end = segment_end;
+    for (c = segment_begin; c < segment_end; ++c) {
+      if (*c == '.') {
+        cut_begin = c;
+      }
+    }
+  }
+
+  // Since the buffer never overlaps with the path, we can simply output all
+  // parts one after another.
+  if (rewrite->root != NULL) {
+    pos += cwk_path_output_sized(buffer, buffer_size, pos, rewrite->root,
+      rewrite->root_size);
+  } else {
+    pos += cwk_path_output_sized(buffer, buffer_size, pos, path, root_length);
+  }
+
+  pos += cwk_path_output_sized(buffer, buffer_size, pos, path + root_length,
+    (size_t)(cut_begin - (path + root_length)));
+  if (rewrite->basename != NULL) {
+    pos += cwk_path_output_sized(buffer, buffer_size, pos, rewrite->basename,
+      rewrite->basename_size);
+  } else if (rewrite->extension != NULL) {
+    pos += cwk_path_output_dot(buffer, buffer_size, pos);
+    pos += cwk_path_output_sized(buffer, buffer_size, pos, rewrite->extension,
+      rewrite->extension_size);
+  }
+
+  pos += cwk_path_output_sized(buffer, buffer_size, pos, cut_end,
+    (size_t)(path_end - cut_end));
+  cwk_path_terminate_output(buffer, buffer_size, pos);
+
+  return pos - start;
+}
+
+static size_t cwk_path_rewrite_batch(const char **paths, size_t count,
+  const struct cwk_path_rewrite *rewrite, char *buffer, size_t buffer_size,
+  size_t *offsets)
+{
+  size_t i, pos;
+
+  // All paths are written one after another, each one with its own
+  // null-terminating character. If the buffer is too small, we still continue
+  // to calculate the offsets and the total size.
+  pos = 0;
+  for (i = 0; i < count; ++i) {
+    offsets[i] = pos;
+    pos += cwk_path_rewrite_single(paths[i], rewrite, buffer, buffer_size,
+             pos) +
+           1;
+  }
+
+  return pos;
+}
+
+static void cwk_path_set_rewrite_basename(struct cwk_path_rewrite *rewrite,
+  const char *new_basename)
+{
+  // The basename is trimmed the same way as cwk_path_change_segment does it.
+  while (cwk_path_is_separator(new_basename)) {
+    ++new_basename;
+  }
+
+  rewrite->basename = new_basename;
+  rewrite->basename_size = strlen(new_basename);
+  while (rewrite->basename_size > 0 &&
+         cwk_path_is_separator(&new_basename[rewrite->basename_size - 1])) {
+    --rewrite->basename_size;
+  }
+}
+
+static void cwk_path_set_rewrite_extension(struct cwk_path_rewrite *rewrite,
+  const char *new_extension)
+{
+  // We always output exactly one dot before the extension, so we skip the dot
+  // of the submitted extension if there is one.
+  if (*new_extension == '.') {
+    ++new_extension;
+  }
+
+  rewrite->extension = new_extension;
+  rewrite->extension_size = strlen(new_extension);
+}
+
+size_t cwk_path_change_root_batch(const char **paths, size_t count,
+  const char *new_root, char *buffer, size_t buffer_size, size_t *offsets)
+{
+  struct cwk_path_rewrite rewrite;
+
+  memset(&rewrite, 0, sizeof(rewrite));
+  rewrite.root = new_root;
+  rewrite.root_size = strlen(new_root);
+  return cwk_path_rewrite_batch(paths, count, &rewrite, buffer, buffer_size,
+    offsets);
+}
+
+size_t cwk_path_change_basename_batch(const char **paths, size_t count,
+  const char *new_basename, char *buffer, size_t buffer_size, size_t *offsets)
+{
+  struct cwk_path_rewrite rewrite;
+
+  memset(&rewrite, 0, sizeof(rewrite));
+  cwk_path_set_rewrite_basename(&rewrite, new_basename);
+  return cwk_path_rewrite_batch(paths, count, &rewrite, buffer, buffer_size,
+    offsets);
+}
+
+size_t cwk_path_change_extension_batch(const char **paths, size_t count,
+  const char *new_extension, char *buffer, size_t buffer_size, size_t *offsets)
+{
+  struct cwk_path_rewrite rewrite;
+
+  memset(&rewrite, 0, sizeof(rewrite));
+  cwk_path_set_rewrite_extension(&rewrite, new_extension);
+  return cwk_path_rewrite_batch(paths, count, &rewrite, buffer, buffer_size,
+    offsets);
+}
+
+size_t cwk_path_relocate_batch(const char **paths, size_t count,
+  const char *new_root, const char *new_extension, char *buffer,
+  size_t buffer_size, size_t *offsets)
+{
+  struct cwk_path_rewrite rewrite;
+
+  // Both the root and the extension are replaced while the path is scanned
+  // once, which is the same as changing the extension first and the root
+  // afterwards.
+  memset(&rewrite, 0, sizeof(rewrite));
+  rewrite.root = new_root;
+  rewrite.root_size = strlen(new_root);
+  cwk_path_set_rewrite_extension(&rewrite, new_extension);
+  return cwk_path_rewrite_batch(paths, count, &rewrite, buffer, buffer_size,
+    offsets);
+}
+
+size_t cwk_path_normalize(const char *path, char *buffer, size_t buffer_size)
+{
+  return cwk_path_normalize_sized(path, strlen(path), buffer, buffer_size);
+}
+
+size_t cwk_path_normalize_sized(const char *path, size_t path_size,
+  char *buffer, size_t buffer_size)
+{
+  const char *paths[2];
 
   // Now we initialize the paths which we will normalize. Since this function
   // only supports submitting a single path, we will only add that one.
   paths[0] = path;
   paths[1] = NULL;
 
-  return cwk_path_join_and_normalize_multiple(paths, buffer, buffer_size);
+  return cwk_path_join_and_normalize_multiple(paths, &path_size, buffer,
+    buffer_size);
 }
 
-size_t cwk_path_get_intersection(const char *path_base, const char *path_other)
+size_t cwk_path_normalize_inplace(char *path)
+{
+  size_t root_length, segment_count, size;
+  char *read, *write, *begin;
+  bool absolute, has_segments;
+
+  // The root stays where it is, we only have to fix the separators in it. We
+  // use the regular root detection, since the root is never modified by any
+  // of the segments.
+  cwk_path_get_root(path, &root_length);
+  absolute = cwk_path_is_root_absolute(path, root_length);
+  cwk_path_fix_root(path, root_length, root_length);
+
+  // The write position never overtakes the read position. Every segment which
+  // is written is preceded by at least one separator in the input, which
+  // makes room for the separator we write in front of it.
+  read = path + root_length;
+  write = read;
+  segment_count = 0;
+  has_segments = false;
+  while (*read != '\0') {
+    if (cwk_path_is_separator(read)) {
+      ++read;
+      continue;
+    }
+
+    begin = read;
+    while (*read != '\0' && !cwk_path_is_separator(read)) {
+      ++read;
+    }
+
+    size = (size_t)(read - begin);
+    has_segments = true;
+    if (size == 1 && begin[0] == '.') {
+      continue;
+    }
+
+    if (size == 2 && begin[0] == '.' && begin[1] == '.') {
+      // A back segment removes the last segment we have written. That segment
+      // is part of our output, so we never read any input which has been
+      // overwritten. If there is no segment to remove, the back segment is
+      // dropped at an absolute root and kept otherwise.
+      if (segment_count > 0) {
+        while (write > path + root_length && !cwk_path_is_separator(write - 1)) {
+          --write;
+        }
+        if (write > path + root_length) {
+          --write;
+        }
+        --segment_count;
+        continue;
+      } else if (absolute) {
+        continue;
+      }
+    } else {
+      ++segment_count;
+    }
+
+    if (write > path + root_length) {
+      write += cwk_path_output_separator(write, 1, 0);
+    }
+
+    memmove(write, begin, size);
+    write += size;
+  }
+
+  // Just like the regular normalization, a relative path which loses all of
+  // its segments becomes the current directory.
+  if (has_segments && write == path) {
+    write += cwk_path_output_current(write, 1, 0);
+  }
+
+  *write = '\0';
+  return (size_t)(write - path);
+}
+
+static bool cwk_path_scan_normalized(const char *path, size_t *length)
+{
+  size_t i;
+  const char *c, *begin;
+  bool may_go_back;
+
+  // The root must not contain any forward slashes on windows, since they would
+  // be replaced when normalizing the path.
+  cwk_path_get_root(path, length);
+  if (path_style == CWK_STYLE_WINDOWS) {
+    for (i = 0; i < *length; ++i) {
+      if (path[i] == '/') {
+        return false;
+      }
+    }
+  }
+
+  // A single "." is the normalized form of a relative path without any
+  // segments, so it is the only case in which a current segment may stay.
+  c = path + *length;
+  if (*length == 0 && c[0] == '.' && c[1] == '\0') {
+    *length = 1;
+    return true;
+  }
+
+  // A back segment can only remain at the beginning of a relative path, since
+  // it would otherwise remove the previous segment or be dropped at the root.
+  may_go_back = !cwk_path_is_root_absolute(path, *length);
+  while (*c != '\0') {
+    begin = c;
+    while (*c != '\0' && !cwk_path_is_separator(c)) {
+      ++c;
+    }
+
+    // This catches double separators and a separator right after the root.
+    if (c == begin) {
+      return false;
+    } else if (c - begin == 1 && begin[0] == '.') {
+      return false;
+    } else if (c - begin == 2 && begin[0] == '.' && begin[1] == '.') {
+      if (!may_go_back) {
+        return false;
+      }
+    } else {
+      may_go_back = false;
+    }
+
+    // Segments are separated by exactly one separator, which must be the one
+    // used for output. There must not be a trailing separator.
+    if (*c != '\0') {
+      if (*c != *separators[path_style] || c[1] == '\0') {
+        return false;
+      }
+      ++c;
+    }
+  }
+
+  *length = (size_t)(c - path);
+  return true;
+}
+
+bool cwk_path_is_normalized(const char *path)
+{
+  size_t length;
+
+  // We only scan the path, which is a lot cheaper than normalizing it and
+  // comparing the result.
+  return cwk_path_scan_normalized(path, &length);
+}
+
+const char *cwk_path_get_normalized(const char *path, char *buffer,
+  size_t buffer_size, size_t *length)
+{
+  // Most paths are already normalized, in which case we can just hand out the
+  // path itself without touching the buffer.
+  if (cwk_path_scan_normalized(path, length)) {
+    return path;
+  }
+
+  *length = cwk_path_normalize(path, buffer, buffer_size);
+  return buffer;
+}
+
+static bool cwk_path_get_common_depth(const char *path_base,
+  const char *path_other, size_t *depth, size_t *length)
 {
   bool absolute;
-  size_t base_root_length, other_root_length;
+  size_t base_root_length, other_root_length, count;
   const char *end;
   const char *paths_base[2], *paths_other[2];
   struct cwk_segment_joined base, other;
@@ -1170,7 +2138,16 @@ size_t cwk_path_get_intersection(const char *path_base, const char *path_other)
   cwk_path_get_root(path_other, &other_root_length);
   if (!cwk_path_is_string_equal(path_base, path_other, base_root_length,
         other_root_length)) {
-    return 0;
+    *depth = 0;
+    *length = 0;
+    return false;
+  }
+
+  // The common portion is at least as long as the root. If the caller already
+  // knows that nothing beyond the root can be common, we can stop here.
+  *length = base_root_length;
+  if (*depth == 0) {
+    return true;
   }
 
   // Configure our paths. We just have a single path in here for now.
@@ -1180,10 +2157,11 @@ size_t cwk_path_get_intersection(const char *path_base, const char *path_other)
   paths_other[1] = NULL;
 
   // So we get the first segment of both paths. If one of those paths don't have
-  // any segment, we will return 0.
-  if (!cwk_path_get_first_segment_joined(paths_base, &base) ||
-      !cwk_path_get_first_segment_joined(paths_other, &other)) {
-    return base_root_length;
+  // any segment, only the root is common.
+  if (!cwk_path_get_first_segment_joined(paths_base, NULL, &base) ||
+      !cwk_path_get_first_segment_joined(paths_other, NULL, &other)) {
+    *depth = 0;
+    return true;
   }
 
   // We now determine whether the path is absolute or not. This is required
@@ -1193,13 +2171,18 @@ size_t cwk_path_get_intersection(const char *path_base, const char *path_other)
   absolute = cwk_path_is_root_absolute(path_base, base_root_length);
 
   // We must keep track of the end of the previous segment. Initially, this is
-  // set to the beginning of the path. This means that 0 is returned if the
-  // first segment is not equal.
+  // set to the beginning of the path. This means that only the root is common
+  // if the first segment is not equal.
   end = path_base + base_root_length;
+  count = 0;
 
-  // Now we loop over both segments until one of them reaches the end or their
-  // contents are not equal.
+  // Now we loop over both segments until one of them reaches the end, their
+  // contents are not equal or we reached the maximum depth of the caller.
   do {
+    if (count == *depth) {
+      break;
+    }
+
     // We skip all segments which will be removed in each path, since we want to
     // know about the true path.
     if (!cwk_path_segment_joined_skip_invisible(&base, absolute) ||
@@ -1207,273 +2190,6350 @@ size_t cwk_path_get_intersection(const char *path_base, const char *path_other)
       break;
     }
 
+    // So the content of those two segments are not equal. We will stop right
+    // before this segment.
     if (!cwk_path_is_string_equal(base.segment.begin, other.segment.begin,
           base.segment.size, other.segment.size)) {
-      // So the content of those two segments are not equal. We will return the
-      // size up to the beginning.
-      return (size_t)(end - path_base);
+      break;
     }
 
     // Remember the end of the previous segment before we go to the next one.
     end = base.segment.end;
+    ++count;
   } while (cwk_path_get_next_segment_joined(&base) &&
            cwk_path_get_next_segment_joined(&other));
 
   // Now we calculate the length up to the last point where our paths pointed to
-  // the same place.
-  return (size_t)(end - path_base);
+  // the same place, and let the caller know how many segments that were.
+  *depth = count;
+  *length = (size_t)(end - path_base);
+  return true;
 }
 
-bool cwk_path_get_first_segment(const char *path, struct cwk_segment *segment)
+size_t cwk_path_get_intersection(const char *path_base, const char *path_other)
 {
-  size_t length;
-  const char *segments;
-
-  // We skip the root since that's not part of the first segment. The root is
-  // treated as a separate entity.
-  cwk_path_get_root(path, &length);
-  segments = path + length;
+  size_t depth, length;
 
-  // Now, after we skipped the root we can continue and find the actual segment
-  // content.
-  return cwk_path_get_first_segment_without_root(path, segments, segment);
+  // We don't limit the depth here, we want to compare all the segments of
+  // those two paths.
+  depth = SIZE_MAX;
+  cwk_path_get_common_depth(path_base, path_other, &depth, &length);
+  return length;
 }
 
-bool cwk_path_get_last_segment(const char *path, struct cwk_segment *segment)
+size_t cwk_path_get_intersection_multiple(const char **paths, size_t count)
 {
-  // We first grab the first segment. This might be our last segment as well,
-  // but we don't know yet. There is no last segment if there is no first
-  // segment, so we return false in that case.
-  if (!cwk_path_get_first_segment(path, segment)) {
-    return false;
+  size_t i, depth, length;
+
+  // There is nothing in common if there are no paths at all.
+  if (count == 0) {
+    return 0;
   }
 
-  // Now we find our last segment. The segment struct of the caller
-  // will contain the last segment, since the function we call here will not
-  // change the segment struct when it reaches the end.
-  while (cwk_path_get_next_segment(segment)) {
-    // We just loop until there is no other segment left.
+  // We compare the first path with all the other paths. If there is only a
+  // single path, we compare it with itself, which skips the invisible segments
+  // at the end.
+  depth = SIZE_MAX;
+  length = 0;
+  for (i = count > 1 ? 1 : 0; i < count; ++i) {
+    // The depth is the amount of segments which are common so far. Every path
+    // can only reduce it, so we never compare more segments than that. Once the
+    // depth reaches zero, only the roots have to be compared.
+    if (!cwk_path_get_common_depth(paths[0], paths[i], &depth, &length)) {
+      return 0;
+    }
   }
 
-  return true;
+  return length;
 }
 
-bool cwk_path_get_next_segment(struct cwk_segment *segment)
+static int cwk_path_get_sort_key(const char *begin, const char *c,
+  const char *end)
 {
-  const char *c;
-
-  // First we jump to the end of the previous segment. The first character must
-  // be either a '\0' or a separator.
-  c = segment->begin + segment->size;
-  if (*c == '\0') {
-    return false;
-  }
-
-  // Now we skip all separator until we reach something else. We are not yet
-  // guaranteed to have a segment, since the string could just end afterwards.
-  assert(cwk_path_is_separator(c));
-  do {
-    ++c;
-  } while (cwk_path_is_separator(c));
-
-  // If the string ends here, we can safely assume that there is no other
-  // segment after this one.
+  // The sort key of a character determines the order of paths. The end of the
+  // string comes first, followed by the separators. This way all paths within a
+  // folder are sorted before any path which just shares a prefix with the
+  // folder name, like "a/b" before "a-b". Windows paths are sorted case
+  // insensitively, and all of its separators are equal.
   if (*c == '\0') {
-    return false;
+    return 0;
+  } else if (cwk_path_is_separator(c)) {
+    return 1;
+  } else if (path_style == CWK_STYLE_WINDOWS) {
+    return cwk_path_fold_char(begin, c, end) + 2;
   }
 
-  // Now we are safe to assume there is a segment. We store the beginning of
-  // this segment in the segment struct of the caller.
-  segment->begin = c;
-
-  // And now determine the size of this segment, and store it in the struct of
-  // the caller as well.
-  c = cwk_path_find_next_stop(c);
-  segment->end = c;
-  segment->size = (size_t)(c - segment->begin);
-
-  // Tell the caller that we found a segment.
-  return true;
+  return (unsigned char)*c + 2;
 }
 
-bool cwk_path_get_previous_segment(struct cwk_segment *segment)
+static int cwk_path_compare_keys(const char *first, const char *second,
+  size_t depth)
 {
-  const char *c;
-
-  // The current position might point to the first character of the path, which
-  // means there are no previous segments available.
-  c = segment->begin;
-  if (c <= segment->segments) {
-    return false;
-  }
+  int first_key, second_key;
 
-  // We move towards the beginning of the path until we either reached the
-  // beginning or the character is no separator anymore.
+  // We just loop until the keys are different or both strings end. The keys
+  // before the depth are already known to be equal.
   do {
-    --c;
-    if (c < segment->segments) {
-      // So we reached the beginning here and there is no segment. So we return
-      // false and don't change the segment structure submitted by the caller.
-      return false;
-    }
-  } while (cwk_path_is_separator(c));
+    first_key = cwk_path_get_sort_key(first, first + depth, NULL);
+    second_key = cwk_path_get_sort_key(second, second + depth, NULL);
+    ++depth;
+  } while (first_key == second_key && first_key != 0);
 
-  // We are guaranteed now that there is another segment, since we moved before
-  // the previous separator and did not reach the segment path beginning.
-  segment->end = c + 1;
-  segment->begin = cwk_path_find_previous_stop(segment->segments, c);
-  segment->size = (size_t)(segment->end - segment->begin);
+  return first_key - second_key;
+}
 
-  return true;
+static void cwk_path_swap(const char **paths, size_t a, size_t b)
+{
+  const char *tmp;
+
+  tmp = paths[a];
+  paths[a] = paths[b];
+  paths[b] = tmp;
 }
 
-enum cwk_segment_type cwk_path_get_segment_type(
-  const struct cwk_segment *segment)
+static void cwk_path_sort_small(const char **paths, size_t count, size_t depth)
 {
-  // We just make a string comparison with the segment contents and return the
-  // appropriate type.
-  if (strncmp(segment->begin, ".", segment->size) == 0) {
-    return CWK_CURRENT;
-  } else if (strncmp(segment->begin, "..", segment->size) == 0) {
-    return CWK_BACK;
+  size_t i, j;
+
+  // This is a simple insertion sort for small ranges, where the partitioning
+  // overhead would be larger than the benefit. All paths in this range share
+  // the first characters up to the depth, so we don't compare them again.
+  for (i = 1; i < count; ++i) {
+    for (j = i;
+         j > 0 && cwk_path_compare_keys(paths[j - 1], paths[j], depth) > 0;
+         --j) {
+      cwk_path_swap(paths, j - 1, j);
+    }
   }
-
-  return CWK_NORMAL;
 }
 
-bool cwk_path_is_separator(const char *str)
+static int cwk_path_partition(const char **paths, size_t count, size_t depth,
+  size_t *lt, size_t *gt)
 {
-  const char *c;
+  size_t i;
+  int pivot, key, a, b, c;
+
+  // We pick the median of three keys as the pivot, which avoids the worst case
+  // for inputs which are already sorted.
+  a = cwk_path_get_sort_key(paths[0], paths[0] + depth, NULL);
+  b = cwk_path_get_sort_key(paths[count / 2], paths[count / 2] + depth, NULL);
+  c = cwk_path_get_sort_key(paths[count - 1], paths[count - 1] + depth, NULL);
+  if ((a <= b && b <= c) || (c <= b && b <= a)) {
+    pivot = b;
+  } else if ((b <= a && a <= c) || (c <= a && a <= b)) {
+    pivot = a;
+  } else {
+    pivot = c;
+  }
 
-  // We loop over all characters in the read symbols.
-  c = separators[path_style];
-  while (*c) {
-    if (*c == *str) {
-      return true;
+  // Now we move all smaller keys to the beginning and all larger keys to the
+  // end of the range.
+  *lt = 0;
+  *gt = count;
+  i = 0;
+  while (i < *gt) {
+    key = cwk_path_get_sort_key(paths[i], paths[i] + depth, NULL);
+    if (key < pivot) {
+      cwk_path_swap(paths, (*lt)++, i++);
+    } else if (key > pivot) {
+      cwk_path_swap(paths, i, --*gt);
+    } else {
+      ++i;
     }
-
-    ++c;
   }
 
-  return false;
+  return pivot;
 }
 
-size_t cwk_path_change_segment(struct cwk_segment *segment, const char *value,
-  char *buffer, size_t buffer_size)
+static void cwk_path_sort_range(const char **paths, size_t count, size_t depth)
 {
-  size_t pos, value_size, tail_size;
+  size_t lt, gt, size_lt, size_eq, size_gt;
+  int pivot;
+
+  // This is a multikey quicksort, which partitions the paths by the key of a
+  // single character into three ranges: Smaller, equal and larger keys. Only
+  // the range with equal keys moves on to the next character, so a common
+  // prefix is never compared twice. We recurse into the smaller ranges and
+  // continue the loop with the largest one to limit the recursion depth.
+  while (count > 1) {
+    if (count < 16) {
+      cwk_path_sort_small(paths, count, depth);
+      return;
+    }
 
-  // First we have to output the head, which is the whole string up to the
-  // beginning of the segment. This part of the path will just stay the same.
-  pos = cwk_path_output_sized(buffer, buffer_size, 0, segment->path,
-    (size_t)(segment->begin - segment->path));
+    pivot = cwk_path_partition(paths, count, depth, &lt, &gt);
+    size_lt = lt;
+    size_eq = gt - lt;
+    size_gt = count - gt;
 
-  // In order to trip the submitted value, we will skip any separator at the
-  // beginning of it and behave as if it was never there.
-  while (cwk_path_is_separator(value)) {
-    ++value;
+    // If the pivot is the end of the string, all paths in the equal range are
+    // identical and there is nothing left to sort in there.
+    if (pivot == 0) {
+      size_eq = 0;
+    }
+
+    if (size_eq >= size_lt && size_eq >= size_gt) {
+      cwk_path_sort_range(paths, size_lt, depth);
+      cwk_path_sort_range(paths + gt, size_gt, depth);
+      paths += lt;
+      count = size_eq;
+      ++depth;
+    } else if (size_lt >= size_gt) {
+      cwk_path_sort_range(paths + lt, size_eq, depth + 1);
+      cwk_path_sort_range(paths + gt, size_gt, depth);
+      count = size_lt;
+    } else {
+      cwk_path_sort_range(paths, size_lt, depth);
+      cwk_path_sort_range(paths + lt, size_eq, depth + 1);
+      paths += gt;
+      count = size_gt;
+    }
+  }
+}
+
+#ifdef CWK_THREADS
+/**
+ * The parallel sort splits the array with the same partitions as the
+ * sequential one. Ranges which are smaller than the grain are sorted by a
+ * single thread, and larger ones are partitioned once more, with the smaller
+ * parts being shared with the other threads. The tasks are kept in a fixed
+ * stack, and a thread which can't share a part simply sorts it itself.
+ */
+#define CWK_SORT_MAX_THREADS 64
+#define CWK_SORT_MAX_TASKS 256
+#define CWK_SORT_GRAIN 16384
+
+struct cwk_sort_task
+{
+  const char **paths;
+  size_t count;
+  size_t depth;
+};
+
+struct cwk_sort_job
+{
+  pthread_mutex_t mutex;
+  pthread_cond_t condition;
+  size_t task_count;
+  size_t busy;
+  struct cwk_sort_task tasks[CWK_SORT_MAX_TASKS];
+};
+
+static void cwk_sort_share(struct cwk_sort_job *job, const char **paths,
+  size_t count, size_t depth)
+{
+  bool shared;
+
+  // Small parts are not worth the handover, and if the stack of tasks is full,
+  // the other threads are busy enough anyway.
+  shared = false;
+  if (count >= CWK_SORT_GRAIN) {
+    pthread_mutex_lock(&job->mutex);
+    if (job->task_count < CWK_SORT_MAX_TASKS) {
+      job->tasks[job->task_count].paths = paths;
+      job->tasks[job->task_count].count = count;
+      job->tasks[job->task_count].depth = depth;
+      ++job->task_count;
+      pthread_cond_signal(&job->condition);
+      shared = true;
+    }
+    pthread_mutex_unlock(&job->mutex);
+  }
+
+  if (!shared) {
+    cwk_path_sort_range(paths, count, depth);
+  }
+}
+
+static void cwk_sort_run(struct cwk_sort_job *job, struct cwk_sort_task task)
+{
+  size_t lt, gt, size_lt, size_eq, size_gt;
+  int pivot;
+
+  // This is the same loop as in cwk_path_sort_range, except that the smaller
+  // ranges are offered to the other threads instead of recursing into them.
+  while (task.count >= CWK_SORT_GRAIN) {
+    pivot = cwk_path_partition(task.paths, task.count, task.depth, &lt, &gt);
+    size_lt = lt;
+    size_eq = pivot == 0 ? 0 : gt - lt;
+    size_gt = task.count - gt;
+    if (size_eq >= size_lt && size_eq >= size_gt) {
+      cwk_sort_share(job, task.paths, size_lt, task.depth);
+      cwk_sort_share(job, task.paths + gt, size_gt, task.depth);
+      task.paths += lt;
+      task.count = size_eq;
+      ++task.depth;
+    } else if (size_lt >= size_gt) {
+      cwk_sort_share(job, task.paths + lt, size_eq, task.depth + 1);
+      cwk_sort_share(job, task.paths + gt, size_gt, task.depth);
+      task.count = size_lt;
+    } else {
+      cwk_sort_share(job, task.paths, size_lt, task.depth);
+      cwk_sort_share(job, task.paths + lt, size_eq, task.depth + 1);
+      task.paths += gt;
+      task.count = size_gt;
+    }
+  }
+
+  cwk_path_sort_range(task.paths, task.count, task.depth);
+}
+
+static void *cwk_sort_work(void *argument)
+{
+  struct cwk_sort_job *job;
+  struct cwk_sort_task task;
+
+  // Every thread takes tasks until there are none left and no other thread is
+  // busy anymore, since a busy thread might still share new tasks.
+  job = argument;
+  pthread_mutex_lock(&job->mutex);
+  for (;;) {
+    while (job->task_count == 0 && job->busy > 0) {
+      pthread_cond_wait(&job->condition, &job->mutex);
+    }
+
+    if (job->task_count == 0) {
+      pthread_cond_broadcast(&job->condition);
+      pthread_mutex_unlock(&job->mutex);
+      return NULL;
+    }
+
+    task = job->tasks[--job->task_count];
+    ++job->busy;
+    pthread_mutex_unlock(&job->mutex);
+    cwk_sort_run(job, task);
+    pthread_mutex_lock(&job->mutex);
+    --job->busy;
+    if (job->task_count == 0 && job->busy == 0) {
+      pthread_cond_broadcast(&job->condition);
+    }
+  }
+}
+
+void cwk_path_sort_parallel(const char **paths, size_t count,
+  size_t thread_count)
+{
+  size_t i;
+  long processors;
+  pthread_t threads[CWK_SORT_MAX_THREADS];
+  struct cwk_sort_job job;
+
+  // By default there is one thread for every processor. There is no point in
+  // having more threads than there are ranges of the grain size.
+  if (thread_count == 0) {
+    processors = sysconf(_SC_NPROCESSORS_ONLN);
+    thread_count = processors > 0 ? (size_t)processors : 1;
+  }
+  if (thread_count > count / CWK_SORT_GRAIN) {
+    thread_count = count / CWK_SORT_GRAIN;
+  }
+  if (thread_count > CWK_SORT_MAX_THREADS) {
+    thread_count = CWK_SORT_MAX_THREADS;
+  }
+
+  if (thread_count <= 1) {
+    cwk_path_sort_range(paths, count, 0);
+    return;
+  }
+
+  job.task_count = 1;
+  job.busy = 0;
+  job.tasks[0].paths = paths;
+  job.tasks[0].count = count;
+  job.tasks[0].depth = 0;
+  pthread_mutex_init(&job.mutex, NULL);
+  pthread_cond_init(&job.condition, NULL);
+
+  // If a thread can't be created, the remaining threads simply take more of
+  // the work. The calling thread is one of them.
+  for (i = 1; i < thread_count; ++i) {
+    if (pthread_create(&threads[i], NULL, cwk_sort_work, &job) != 0) {
+      break;
+    }
+  }
+
+  thread_count = i;
+  cwk_sort_work(&job);
+  for (i = 1; i < thread_count; ++i) {
+    pthread_join(threads[i], NULL);
+  }
+
+  pthread_cond_destroy(&job.condition);
+  pthread_mutex_destroy(&job.mutex);
+}
+#endif
+
+int cwk_path_compare(const char *path_a, const char *path_b)
+{
+  int result;
+
+  // We compare the keys of both paths and reduce the result to the sign, so
+  // the caller doesn't rely on the magnitude.
+  result = cwk_path_compare_keys(path_a, path_b, 0);
+  if (result < 0) {
+    return -1;
+  } else if (result > 0) {
+    return 1;
+  }
+
+  return 0;
+}
+
+void cwk_path_sort(const char **paths, size_t count)
+{
+  // The sort is done in place on the array of pointers, starting with the first
+  // character of all paths.
+  cwk_path_sort_range(paths, count, 0);
+}
+
+static uint64_t cwk_path_hash_string(uint64_t hash, const char *str,
+  size_t size)
+{
+  bool ascii;
+  size_t i;
+  unsigned char c;
+
+  // This is a FNV-1a hash, which is fed with the characters the way they would
+  // be compared. All separators are hashed as the same character and windows
+  // paths are hashed case insensitively. Most paths are ASCII only, which
+  // doesn't require the unicode case folding.
+  ascii = path_style == CWK_STYLE_UNIX || cwk_path_is_ascii(str, size);
+  for (i = 0; i < size; ++i) {
+    if (cwk_path_is_separator(&str[i])) {
+      c = '/';
+    } else if (path_style == CWK_STYLE_UNIX) {
+      c = (unsigned char)str[i];
+    } else if (ascii) {
+      c = cwk_path_fold_ascii((unsigned char)str[i]);
+    } else {
+      c = cwk_path_fold_char(str, &str[i], str + size);
+    }
+
+    hash ^= c;
+    hash *= 0x100000001b3;
+  }
+
+  return hash;
+}
+
+static uint64_t cwk_path_hash_normalized(const char *path)
+{
+  bool absolute;
+  size_t root_length;
+  uint64_t hash;
+  const char *paths[2];
+  struct cwk_segment_joined sj;
+
+  // We hash the root first, which is kept as it is during normalization.
+  cwk_path_get_root(path, &root_length);
+  absolute = cwk_path_is_root_absolute(path, root_length);
+  hash = cwk_path_hash_string(0xcbf29ce484222325, path, root_length);
+
+  paths[0] = path;
+  paths[1] = NULL;
+  if (!cwk_path_get_first_segment_joined(paths, NULL, &sj)) {
+    return hash;
+  }
+
+  // A path without a root which has segments is never normalized to an empty
+  // string. If all of them are removed, it becomes ".", which is different from
+  // an empty path.
+  if (root_length == 0) {
+    hash = cwk_path_hash_string(hash, ".", 1);
+  }
+
+  // Now we hash all the segments which are visible after normalization, without
+  // ever writing the normalized path anywhere. Every segment is preceded by a
+  // separator, so the segment boundaries are part of the hash.
+  while (cwk_path_segment_joined_skip_invisible(&sj, absolute)) {
+    hash = cwk_path_hash_string(hash, "/", 1);
+    hash = cwk_path_hash_string(hash, sj.segment.begin, sj.segment.size);
+    if (!cwk_path_get_next_segment_joined(&sj)) {
+      break;
+    }
+  }
+
+  return hash;
+}
+
+static bool cwk_path_is_normalized_equal(const char *path_a,
+  const char *path_b)
+{
+  bool absolute, has_segments_a, has_segments_b, available_a, available_b;
+  size_t root_length_a, root_length_b;
+  const char *paths_a[2], *paths_b[2];
+  struct cwk_segment_joined sja, sjb;
+
+  // The roots are kept during normalization, so they must be equal.
+  cwk_path_get_root(path_a, &root_length_a);
+  cwk_path_get_root(path_b, &root_length_b);
+  if (!cwk_path_is_string_equal(path_a, path_b, root_length_a,
+        root_length_b)) {
+    return false;
+  }
+
+  // Both roots are equal, so both paths are either absolute or relative.
+  absolute = cwk_path_is_root_absolute(path_a, root_length_a);
+
+  paths_a[0] = path_a;
+  paths_a[1] = NULL;
+  paths_b[0] = path_b;
+  paths_b[1] = NULL;
+  has_segments_a = cwk_path_get_first_segment_joined(paths_a, NULL, &sja);
+  has_segments_b = cwk_path_get_first_segment_joined(paths_b, NULL, &sjb);
+
+  // Without a root, a path which has segments is normalized to at least ".",
+  // while a path without any segments is normalized to an empty string.
+  if (root_length_a == 0 && has_segments_a != has_segments_b) {
+    return false;
+  }
+
+  // Now we walk over the visible segments of both paths at the same time, and
+  // compare them one by one.
+  available_a = has_segments_a &&
+                cwk_path_segment_joined_skip_invisible(&sja, absolute);
+  available_b = has_segments_b &&
+                cwk_path_segment_joined_skip_invisible(&sjb, absolute);
+  while (available_a && available_b) {
+    if (!cwk_path_is_string_equal(sja.segment.begin, sjb.segment.begin,
+          sja.segment.size, sjb.segment.size)) {
+      return false;
+    }
+
+    available_a = cwk_path_get_next_segment_joined(&sja) &&
+                  cwk_path_segment_joined_skip_invisible(&sja, absolute);
+    available_b = cwk_path_get_next_segment_joined(&sjb) &&
+                  cwk_path_segment_joined_skip_invisible(&sjb, absolute);
+  }
+
+  // Both paths must run out of segments at the same time.
+  return available_a == available_b;
+}
+
+size_t cwk_path_dedup(const char **paths, size_t count, size_t *ids,
+  size_t *table, size_t table_size)
+{
+  size_t i, slot, unique;
+
+  // The table must be able to hold every path, otherwise we might not find a
+  // free slot.
+  if (table_size < count) {
+    return 0;
+  }
+
+  // The table stores the index of the first path of every unique path plus
+  // one, so zero marks a free slot.
+  memset(table, 0, table_size * sizeof(*table));
+
+  unique = 0;
+  for (i = 0; i < count; ++i) {
+    // We look for an equal path using linear probing, starting at the slot of
+    // the hash. Only paths which are in the same probe sequence are compared.
+    slot = (size_t)(cwk_path_hash_normalized(paths[i]) % table_size);
+    while (table[slot] != 0 &&
+           !cwk_path_is_normalized_equal(paths[table[slot] - 1], paths[i])) {
+      if (++slot == table_size) {
+        slot = 0;
+      }
+    }
+
+    // If we found a free slot this is the first time we see this path, so it
+    // gets a new id. Otherwise it gets the id of the path we found.
+    if (table[slot] == 0) {
+      table[slot] = i + 1;
+      ids[i] = unique++;
+    } else {
+      ids[i] = ids[table[slot] - 1];
+    }
+  }
+
+  return unique;
+}
+
+size_t cwk_path_hash(const char *path)
+{
+  // The hash is reduced to the size of a size_t, which is what most hash
+  // tables of the caller work with.
+  return (size_t)cwk_path_hash_normalized(path);
+}
+
+bool cwk_path_get_first_segment(const char *path, struct cwk_segment *segment)
+{
+  // The path is null-terminated, so we don't need to limit it.
+  return cwk_path_get_first_segment_bounded(path, NULL, segment);
+}
+
+bool cwk_path_get_last_segment(const char *path, struct cwk_segment *segment)
+{
+  return cwk_path_get_last_segment_bounded(path, NULL, segment);
+}
+
+bool cwk_path_get_next_segment(struct cwk_segment *segment)
+{
+  return cwk_path_get_next_segment_bounded(segment, NULL);
+}
+
+bool cwk_path_get_previous_segment(struct cwk_segment *segment)
+{
+  const char *c;
+
+  // The current position might point to the first character of the path, which
+  // means there are no previous segments available.
+  c = segment->begin;
+  if (c <= segment->segments) {
+    return false;
+  }
+
+  // We move towards the beginning of the path until we either reached the
+  // beginning or the character is no separator anymore.
+  do {
+    --c;
+    if (c < segment->segments) {
+      // So we reached the beginning here and there is no segment. So we return
+      // false and don't change the segment structure submitted by the caller.
+      return false;
+    }
+  } while (cwk_path_is_separator(c));
+
+  // We are guaranteed now that there is another segment, since we moved before
+  // the previous separator and did not reach the segment path beginning.
+  segment->end = c + 1;
+  segment->begin = cwk_path_find_previous_stop(segment->segments, c);
+  segment->size = (size_t)(segment->end - segment->begin);
+
+  return true;
+}
+
+enum cwk_segment_type cwk_path_get_segment_type(
+  const struct cwk_segment *segment)
+{
+  // We just make a string comparison with the segment contents and return the
+  // appropriate type.
+  if (strncmp(segment->begin, ".", segment->size) == 0) {
+    return CWK_CURRENT;
+  } else if (strncmp(segment->begin, "..", segment->size) == 0) {
+    return CWK_BACK;
+  }
+
+  return CWK_NORMAL;
+}
+
+static uint64_t cwk_path_match_block(uint64_t block, unsigned char c)
+{
+  uint64_t x;
+
+  // The highest bit of every byte is set if the byte is equal to the
+  // character. Unlike the usual trick to find zero bytes, this doesn't carry
+  // into the next byte, so all bits are exact.
+  x = block ^ (0x0101010101010101 * c);
+  return ~(((x & 0x7f7f7f7f7f7f7f7f) + 0x7f7f7f7f7f7f7f7f) | x |
+           0x7f7f7f7f7f7f7f7f);
+}
+
+static size_t cwk_path_get_first_match(uint64_t matches)
+{
+#if defined(__GNUC__) || defined(__clang__)
+  // The first character of the block is stored in the lowest byte on little
+  // endian machines and in the highest byte on big endian machines.
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+  return (size_t)__builtin_clzll(matches) / 8;
+#else
+  return (size_t)__builtin_ctzll(matches) / 8;
+#endif
+#else
+  unsigned char bytes[sizeof(matches)];
+  size_t i;
+
+  // Without the builtins, we simply look at the bytes in memory order, which
+  // works no matter how the machine stores its integers.
+  memcpy(bytes, &matches, sizeof(matches));
+  for (i = 0; bytes[i] == 0; ++i) {
+  }
+
+  return i;
+#endif
+}
+
+static const char *cwk_path_find_separator(const char *c, const char *end)
+{
+  uint64_t block, matches;
+
+  // We check eight characters at once, so the long names of most segments are
+  // skipped quickly. The matches contain the highest bit of every byte which is
+  // a separator, and the first of them is the end of the segment.
+  while (end - c >= (ptrdiff_t)sizeof(block)) {
+    memcpy(&block, c, sizeof(block));
+    matches = cwk_path_match_block(block, '/');
+    if (path_style == CWK_STYLE_WINDOWS) {
+      matches |= cwk_path_match_block(block, '\\');
+    }
+
+    if (matches != 0) {
+      return c + cwk_path_get_first_match(matches);
+    }
+
+    c += sizeof(block);
+  }
+
+  while (c < end && !cwk_path_is_separator(c)) {
+    ++c;
+  }
+
+  return c;
+}
+
+static bool cwk_path_fill_span(const char *path, const char *c,
+  const char *end, struct cwk_span *span)
+{
+  const char *begin;
+
+  // There might be multiple separators between two segments, which is why we
+  // skip all of them first.
+  while (c < end && cwk_path_is_separator(c)) {
+    ++c;
+  }
+
+  if (c == end) {
+    return false;
+  }
+
+  begin = c;
+  c = cwk_path_find_separator(c, end);
+  span->offset = (size_t)(begin - path);
+  span->length = (size_t)(c - begin);
+  if (begin[0] == '.' && span->length == 1) {
+    span->type = CWK_CURRENT;
+  } else if (begin[0] == '.' && begin[1] == '.' && span->length == 2) {
+    span->type = CWK_BACK;
+  } else {
+    span->type = CWK_NORMAL;
+  }
+
+  return true;
+}
+
+bool cwk_path_get_first_span(const char *path, size_t path_size,
+  struct cwk_span *span)
+{
+  size_t root_length;
+
+  // The root is never part of a segment, so we start right after it.
+  cwk_path_get_root_sized(path, path_size, &root_length);
+  return cwk_path_fill_span(path, path + root_length, path + path_size, span);
+}
+
+bool cwk_path_get_next_span(const char *path, size_t path_size,
+  struct cwk_span *span)
+{
+  struct cwk_span next;
+
+  // The span is only modified if there is another segment, just like
+  // cwk_path_get_next_segment does it.
+  if (!cwk_path_fill_span(path, path + span->offset + span->length,
+        path + path_size, &next)) {
+    return false;
+  }
+
+  *span = next;
+  return true;
+}
+
+bool cwk_path_get_last_span(const char *path, size_t path_size,
+  struct cwk_span *span)
+{
+  size_t root_length;
+  const char *begin, *end;
+
+  // We search the last segment backwards, so we don't have to look at any of
+  // the other segments.
+  cwk_path_get_root_sized(path, path_size, &root_length);
+  end = path + path_size;
+  begin = cwk_path_find_last_segment(path, root_length, &end);
+  if (begin == end) {
+    return false;
+  }
+
+  return cwk_path_fill_span(path, begin, end, span);
+}
+
+size_t cwk_path_split_sized(const char *path, size_t path_size,
+  struct cwk_span *spans, size_t max)
+{
+  struct cwk_span span;
+  size_t count;
+  bool found;
+
+  // We only write the span if there is enough room for it, but we keep
+  // counting the segments so the caller knows how many spans are required.
+  count = 0;
+  for (found = cwk_path_get_first_span(path, path_size, &span); found;
+       found = cwk_path_get_next_span(path, path_size, &span)) {
+    if (count < max) {
+      spans[count] = span;
+    }
+
+    ++count;
+  }
+
+  return count;
+}
+
+size_t cwk_path_split(const char *path, struct cwk_span *spans, size_t max)
+{
+  return cwk_path_split_sized(path, strlen(path), spans, max);
+}
+
+bool cwk_path_is_separator(const char *str)
+{
+  const char *c;
+
+  // We loop over all characters in the read symbols.
+  c = separators[path_style];
+  while (*c) {
+    if (*c == *str) {
+      return true;
+    }
+
+    ++c;
+  }
+
+  return false;
+}
+
+size_t cwk_path_change_segment(struct cwk_segment *segment, const char *value,
+  char *buffer, size_t buffer_size)
+{
+  // The segment belongs to a null-terminated path, so the tail ends at the
+  // null-terminating character.
+  return cwk_path_change_segment_bounded(segment, NULL, value, strlen(value),
+    buffer, buffer_size);
+}
+
+enum cwk_path_style cwk_path_guess_style(const char *path)
+{
+  const char *c;
+  size_t root_length;
+  struct cwk_segment segment;
+
+  // First we determine the root. Only windows roots can be longer than a single
+  // slash, so if we can determine that it starts with something like "C:", we
+  // know that this is a windows path.
+  cwk_path_get_root_windows(path, SIZE_MAX, &root_length);
+  if (root_length > 1) {
+    return CWK_STYLE_WINDOWS;
+  }
+
+  // Next we check for slashes. Windows uses backslashes, while unix uses
+  // forward slashes. Windows actually supports both, but our best guess is to
+  // assume windows with backslashes and unix with forward slashes.
+  for (c = path; *c; ++c) {
+    if (*c == *separators[CWK_STYLE_UNIX]) {
+      return CWK_STYLE_UNIX;
+    } else if (*c == *separators[CWK_STYLE_WINDOWS]) {
+      return CWK_STYLE_WINDOWS;
+    }
+  }
+
+  // This path does not have any slashes. We grab the last segment (which
+  // actually must be the first one), and determine whether the segment starts
+  // with a dot. A dot is a hidden folder or file in the UNIX world, in that
+  // case we assume the path to have UNIX style.
+  if (!cwk_path_get_last_segment(path, &segment)) {
+    // We couldn't find any segments, so we default to a UNIX path style since
+    // there is no way to make any assumptions.
+    return CWK_STYLE_UNIX;
+  }
+
+  if (*segment.begin == '.') {
+    return CWK_STYLE_UNIX;
+  }
+
+  // And finally we check whether the last segment contains a dot. If it
+  // contains a dot, that might be an extension. Windows is more likely to have
+  // file names with extensions, so our guess would be windows.
+  for (c = segment.begin; *c; ++c) {
+    if (*c == '.') {
+      return CWK_STYLE_WINDOWS;
+    }
+  }
+
+  // All our checks failed, so we will return a default value which is currently
+  // UNIX.
+  return CWK_STYLE_UNIX;
+}
+
+static bool cwk_path_is_any_separator(char c)
+{
+  return c == '/' || c == '\\';
+}
+
+static unsigned char cwk_path_classify_windows_root(const char *path)
+{
+  const char *c;
+
+  // This follows the rules of cwk_path_get_root_windows, but it accepts both
+  // separators no matter which style is configured.
+  if (cwk_path_is_any_separator(path[0])) {
+    if (!cwk_path_is_any_separator(path[1])) {
+      return CWK_CLASS_SEPARATOR | CWK_CLASS_ABSOLUTE;
+    } else if ((path[2] == '?' || path[2] == '.') &&
+               cwk_path_is_any_separator(path[3])) {
+      return CWK_CLASS_DEVICE | CWK_CLASS_ABSOLUTE;
+    }
+
+    // A network path is absolute if there is a separator after the name of
+    // the share.
+    c = path + 2;
+    while (*c != '\0' && !cwk_path_is_any_separator(*c)) {
+      ++c;
+    }
+    while (cwk_path_is_any_separator(*c)) {
+      ++c;
+    }
+    while (*c != '\0' && !cwk_path_is_any_separator(*c)) {
+      ++c;
+    }
+    if (cwk_path_is_any_separator(*c) || cwk_path_is_any_separator(c[-1])) {
+      return CWK_CLASS_UNC | CWK_CLASS_ABSOLUTE;
+    }
+
+    return CWK_CLASS_UNC;
+  } else if (path[0] != '\0' && path[1] == ':') {
+    return cwk_path_is_any_separator(path[2])
+             ? CWK_CLASS_DRIVE | CWK_CLASS_ABSOLUTE
+             : CWK_CLASS_DRIVE;
+  }
+
+  return CWK_CLASS_RELATIVE;
+}
+
+static unsigned char cwk_path_classify_single(const char *path)
+{
+  size_t length, i, separator;
+  uint64_t block, separators_found, dots, high;
+  unsigned char result;
+  bool has_dot;
+
+  // The length is determined first, since the standard library is usually
+  // very fast at that. Afterwards we check eight characters at once for
+  // separators, dots and non-ASCII characters. We only need the first
+  // separator, but we have to look at all characters for the ASCII check.
+  length = strlen(path);
+  separator = length;
+  has_dot = false;
+  high = 0;
+  for (i = 0; i + sizeof(block) <= length; i += sizeof(block)) {
+    memcpy(&block, path + i, sizeof(block));
+    high |= block & 0x8080808080808080;
+    if (separator != length) {
+      continue;
+    }
+
+    separators_found = cwk_path_match_block(block, '/') |
+                       cwk_path_match_block(block, '\\');
+    dots = cwk_path_match_block(block, '.');
+    has_dot = has_dot || dots != 0;
+    if (separators_found != 0) {
+      separator = i;
+      while (!cwk_path_is_any_separator(path[separator])) {
+        ++separator;
+      }
+    }
+  }
+
+  for (; i < length; ++i) {
+    high |= (unsigned char)path[i] & 0x80;
+    if (separator == length) {
+      has_dot = has_dot || path[i] == '.';
+      if (cwk_path_is_any_separator(path[i])) {
+        separator = i;
+      }
+    }
+  }
+
+  result = high == 0 ? CWK_CLASS_ASCII : 0;
+
+  // Now we guess the style using the same rules as cwk_path_guess_style. A
+  // root which is longer than one character must be a windows root, and the
+  // way this root is detected depends on the configured style. Otherwise the
+  // first separator decides. Without any separators, a dot at the beginning
+  // marks a hidden unix file and any other dot an extension, which is more
+  // common on windows.
+  if ((cwk_path_is_separator(path) && cwk_path_is_separator(path + 1)) ||
+      (length > 1 && !cwk_path_is_separator(path) && path[1] == ':')) {
+    result |= CWK_CLASS_WINDOWS;
+  } else if (separator != length) {
+    if (path[separator] == '\\') {
+      result |= CWK_CLASS_WINDOWS;
+    }
+  } else if (length > 0 && path[0] != '.' && has_dot) {
+    result |= CWK_CLASS_WINDOWS;
+  }
+
+  // The root is determined using the guessed style.
+  if (result & CWK_CLASS_WINDOWS) {
+    result |= cwk_path_classify_windows_root(path);
+  } else if (path[0] == '/') {
+    result |= CWK_CLASS_SEPARATOR | CWK_CLASS_ABSOLUTE;
+  }
+
+  return result;
+}
+
+void cwk_path_classify(const char **paths, size_t count,
+  unsigned char *classes)
+{
+  size_t i;
+
+  // Every path is classified on its own, so the classes can be used to route
+  // the paths to functions which are specialized for a style.
+  for (i = 0; i < count; ++i) {
+    classes[i] = cwk_path_classify_single(paths[i]);
+  }
+}
+
+void cwk_path_set_style(enum cwk_path_style style)
+{
+  // We can just set the global path style variable and then the behaviour for
+  // all functions will change accordingly.
+  assert(style == CWK_STYLE_UNIX || style == CWK_STYLE_WINDOWS);
+  path_style = style;
+}
+
+enum cwk_path_style cwk_path_get_style(void)
+{
+  // Simply return the path style which we store in a global variable.
+  return path_style;
+}
+
+/**
+ * The header of a prefix trie, which is stored at the very beginning of the
+ * trie memory. All offsets in the trie are relative to the beginning of the
+ * header, so the trie can be moved or mapped to any address. The header is
+ * followed by all nodes, starting with the top node, and the labels of all
+ * nodes. All values are stored in the byte order of the machine which built
+ * the trie, and a trie with a foreign byte order has an invalid version.
+ */
+struct cwk_ptrie_header
+{
+  char magic[4];
+  uint32_t version;
+  uint32_t style;
+  uint32_t node_count;
+  uint32_t entry_count;
+  uint32_t size;
+};
+
+/**
+ * A node of the prefix trie. Every node represents a root or a segment, and the
+ * children of a node are stored next to each other, sorted by their label. The
+ * entries are numbered in sorted order, so every subtree covers a continuous
+ * range of entries.
+ */
+struct cwk_ptrie_node
+{
+  uint32_t label;
+  uint32_t label_size;
+  uint32_t children;
+  uint32_t child_count;
+  uint32_t entry;
+  uint32_t first;
+  uint32_t count;
+};
+
+/**
+ * The builder keeps track of the used nodes, labels and entries while the trie
+ * is generated. If there is no buffer, the builder only measures the trie.
+ */
+struct cwk_ptrie_builder
+{
+  char *buffer;
+  size_t node_count;
+  size_t label_base;
+  size_t label_size;
+  size_t entry_count;
+};
+
+static const char cwk_ptrie_magic[4] = {'C', 'W', 'K', 'T'};
+static const uint32_t cwk_ptrie_version = 1;
+
+static int cwk_path_compare_sized(const char *first, size_t first_size,
+  const char *second, size_t second_size)
+{
+  size_t i;
+  int first_key, second_key;
+
+  // This compares two strings which are not null-terminated, using the same
+  // order as cwk_path_compare. A shorter string sorts before a longer one if
+  // it is a prefix of it.
+  for (i = 0; i < first_size && i < second_size; ++i) {
+    first_key = cwk_path_get_sort_key(first, &first[i], first + first_size);
+    second_key = cwk_path_get_sort_key(second, &second[i],
+      second + second_size);
+    if (first_key != second_key) {
+      return first_key - second_key;
+    }
+  }
+
+  if (first_size < second_size) {
+    return -1;
+  } else if (first_size > second_size) {
+    return 1;
+  }
+
+  return 0;
+}
+
+static bool cwk_path_get_first_component(const char *path,
+  struct cwk_span *span)
+{
+  size_t root_length;
+  struct cwk_segment segment;
+
+  // The type CWK_CURRENT marks the end, since such a segment is never visible.
+  // The empty path is the only one without any components, which keeps it
+  // apart from the current directory, just like cwk_path_normalize does.
+  span->offset = 0;
+  span->length = 0;
+  if (*path == '\0') {
+    span->type = CWK_CURRENT;
+    return false;
+  }
+
+  // The first component is always the root, even if it is empty. All other
+  // components are the segments which are still visible after normalization.
+  cwk_path_get_root(path, &root_length);
+  span->length = root_length;
+
+  // A segment can only be removed by a back segment which follows it, so we
+  // check once whether there is any. Otherwise we can skip the invisible
+  // segments without looking ahead.
+  span->type = CWK_NORMAL;
+  if (cwk_path_get_first_segment(path, &segment)) {
+    do {
+      if (cwk_path_get_segment_type(&segment) == CWK_BACK) {
+        span->type = CWK_BACK;
+        break;
+      }
+    } while (cwk_path_get_next_segment(&segment));
+  }
+
+  return true;
+}
+
+static bool cwk_path_get_next_component(const char *path,
+  struct cwk_span *span)
+{
+  bool available;
+  size_t root_length;
+  const char *paths[2];
+  struct cwk_segment_joined sj;
+
+  if (span->type == CWK_CURRENT) {
+    return false;
+  }
+
+  // We continue right after the current component. The root is the only
+  // component which may be empty, and segments never begin at the root.
+  cwk_path_get_root(path, &root_length);
+  paths[0] = path;
+  paths[1] = NULL;
+  if (span->offset == 0 && span->length == root_length) {
+    available = cwk_path_get_first_segment_joined(paths, NULL, &sj);
+  } else {
+    sj.paths = paths;
+    sj.sizes = NULL;
+    sj.path_index = 0;
+    sj.segment.path = path;
+    sj.segment.segments = path + root_length;
+    sj.segment.begin = path + span->offset;
+    sj.segment.end = sj.segment.begin + span->length;
+    sj.segment.size = span->length;
+    available = cwk_path_get_next_segment_joined(&sj);
+  }
+
+  if (span->type == CWK_BACK) {
+    available = available &&
+                cwk_path_segment_joined_skip_invisible(&sj,
+                  cwk_path_is_root_absolute(path, root_length));
+  } else {
+    while (available &&
+           cwk_path_get_segment_type(&sj.segment) == CWK_CURRENT) {
+      available = cwk_path_get_next_segment(&sj.segment);
+    }
+  }
+
+  if (!available) {
+    span->type = CWK_CURRENT;
+    return false;
+  }
+
+  span->offset = (size_t)(sj.segment.begin - path);
+  span->length = sj.segment.size;
+  return true;
+}
+
+static int cwk_path_compare_components(const char *path_a,
+  const struct cwk_span *span_a, const char *path_b,
+  const struct cwk_span *span_b)
+{
+  // A path which has run out of components is a prefix of the other one, so
+  // it comes first.
+  if (span_a->type == CWK_CURRENT || span_b->type == CWK_CURRENT) {
+    return (int)(span_b->type == CWK_CURRENT) -
+           (int)(span_a->type == CWK_CURRENT);
+  }
+
+  return cwk_path_compare_sized(path_a + span_a->offset, span_a->length,
+    path_b + span_b->offset, span_b->length);
+}
+
+static int cwk_path_compare_normalized(const char *path_a, const char *path_b)
+{
+  int result;
+  struct cwk_span span_a, span_b;
+
+  // We compare the roots first, and then all the visible segments one by one.
+  // This is the same order in which the components are stored in the trie.
+  cwk_path_get_first_component(path_a, &span_a);
+  cwk_path_get_first_component(path_b, &span_b);
+  while ((result = cwk_path_compare_components(path_a, &span_a, path_b,
+            &span_b)) == 0 &&
+         span_a.type != CWK_CURRENT) {
+    cwk_path_get_next_component(path_a, &span_a);
+    cwk_path_get_next_component(path_b, &span_b);
+  }
+
+  return result;
+}
+
+static void cwk_path_swap_components(const char **paths,
+  struct cwk_span *spans, size_t a, size_t b)
+{
+  const char *path;
+  struct cwk_span span;
+
+  path = paths[a];
+  paths[a] = paths[b];
+  paths[b] = path;
+  span = spans[a];
+  spans[a] = spans[b];
+  spans[b] = span;
+}
+
+static void cwk_path_reset_components(const char **paths,
+  struct cwk_span *spans, size_t count)
+{
+  size_t i;
+
+  for (i = 0; i < count; ++i) {
+    cwk_path_get_first_component(paths[i], &spans[i]);
+  }
+}
+
+static void cwk_path_advance_components(const char **paths,
+  struct cwk_span *spans, size_t count)
+{
+  size_t i;
+
+  for (i = 0; i < count; ++i) {
+    cwk_path_get_next_component(paths[i], &spans[i]);
+  }
+}
+
+static void cwk_path_sort_components(const char **paths,
+  struct cwk_span *spans, size_t count)
+{
+  size_t i, lt, gt, size_lt, size_eq, size_gt;
+  int result;
+
+  // This is the same multikey quicksort as cwk_path_sort_range, but the keys
+  // are whole components. Every span points to the component of its path which
+  // is compared next, and only the paths with equal components move on to the
+  // next one. So every path is normalized just once while it is sorted.
+  while (count > 1) {
+    // The pivot is taken from the middle, and it always stays at the beginning
+    // of the equal range while we move the smaller and larger components out.
+    cwk_path_swap_components(paths, spans, 0, count / 2);
+    lt = 0;
+    gt = count;
+    i = 1;
+    while (i < gt) {
+      result = cwk_path_compare_components(paths[i], &spans[i], paths[lt],
+        &spans[lt]);
+      if (result < 0) {
+        cwk_path_swap_components(paths, spans, lt++, i++);
+      } else if (result > 0) {
+        cwk_path_swap_components(paths, spans, i, --gt);
+      } else {
+        ++i;
+      }
+    }
+
+    // If the paths of the equal range have run out of components, they are
+    // all equal. Otherwise they move on to their next component.
+    size_lt = lt;
+    size_eq = gt - lt;
+    size_gt = count - gt;
+    if (spans[lt].type == CWK_CURRENT) {
+      size_eq = 0;
+    }
+
+    cwk_path_advance_components(paths + lt, spans + lt, size_eq);
+    if (size_eq >= size_lt && size_eq >= size_gt) {
+      cwk_path_sort_components(paths, spans, size_lt);
+      cwk_path_sort_components(paths + gt, spans + gt, size_gt);
+      paths += lt;
+      spans += lt;
+      count = size_eq;
+    } else if (size_lt >= size_gt) {
+      cwk_path_sort_components(paths + lt, spans + lt, size_eq);
+      cwk_path_sort_components(paths + gt, spans + gt, size_gt);
+      count = size_lt;
+    } else {
+      cwk_path_sort_components(paths, spans, size_lt);
+      cwk_path_sort_components(paths + lt, spans + lt, size_eq);
+      paths += gt;
+      spans += gt;
+      count = size_gt;
+    }
+  }
+}
+
+static void cwk_ptrie_build_node(struct cwk_ptrie_builder *builder,
+  const char **paths, struct cwk_span *spans, size_t count, size_t depth,
+  size_t index, size_t label, size_t label_size)
+{
+  size_t i, end, group_count, children, child, first, entry, size;
+  const char *begin;
+  struct cwk_ptrie_node *node;
+
+  // All paths in this range share the first components up to the depth, and
+  // their spans point to the component at the depth. Paths which don't have
+  // any more components end right at this node, and since they are sorted
+  // they all come first.
+  first = builder->entry_count;
+  entry = 0;
+  i = 0;
+  while (i < count && spans[i].type == CWK_CURRENT) {
+    ++i;
+  }
+
+  if (i > 0) {
+    entry = ++builder->entry_count;
+  }
+
+  // Now we count the groups of paths which share the next component. Every
+  // group becomes a child, and all children are reserved at once so they are
+  // stored next to each other.
+  group_count = 0;
+  for (end = i; end < count; ++group_count) {
+    do {
+      ++end;
+    } while (end < count && cwk_path_compare_components(paths[end - 1],
+                              &spans[end - 1], paths[end], &spans[end]) == 0);
+  }
+
+  children = builder->node_count;
+  builder->node_count += group_count;
+
+  // Now we can generate all children, one group after another. The label of
+  // the child is copied from the first path of the group. Roots are copied
+  // the way they look after normalization. The spans of the group move on to
+  // the next component before we continue with the child.
+  for (child = children; i < count; ++child, i = end) {
+    begin = paths[i] + spans[i].offset;
+    size = spans[i].length;
+    end = i + 1;
+    while (end < count && cwk_path_compare_components(paths[i], &spans[i],
+                            paths[end], &spans[end]) == 0) {
+      ++end;
+    }
+
+    if (builder->buffer) {
+      memcpy(builder->buffer + builder->label_base + builder->label_size,
+        begin, size);
+      if (depth == 0) {
+        cwk_path_fix_root(builder->buffer + builder->label_base +
+                            builder->label_size,
+          size, size);
+      }
+    }
+
+    builder->label_size += size;
+    cwk_path_advance_components(paths + i, spans + i, end - i);
+    cwk_ptrie_build_node(builder, paths + i, spans + i, end - i, depth + 1,
+      child, builder->label_base + builder->label_size - size, size);
+  }
+
+  // Finally we can write the node itself, since we now know how many entries
+  // are within the subtree.
+  if (builder->buffer) {
+    node = (struct cwk_ptrie_node *)(builder->buffer +
+                                     sizeof(struct cwk_ptrie_header)) +
+           index;
+    node->label = (uint32_t)label;
+    node->label_size = (uint32_t)label_size;
+    node->children = (uint32_t)children;
+    node->child_count = (uint32_t)group_count;
+    node->entry = (uint32_t)entry;
+    node->first = (uint32_t)first;
+    node->count = (uint32_t)(builder->entry_count - first);
+  }
+}
+
+static const struct cwk_ptrie_node *cwk_ptrie_get_node(const void *trie,
+  size_t index)
+{
+  return (const struct cwk_ptrie_node *)((const char *)trie +
+                                         sizeof(struct cwk_ptrie_header)) +
+         index;
+}
+
+static const struct cwk_ptrie_node *
+cwk_ptrie_find_child(const void *trie, const struct cwk_ptrie_node *node,
+  const char *begin, size_t size)
+{
+  size_t low, high, middle;
+  int result;
+  const struct cwk_ptrie_node *child;
+
+  // The children are sorted by their labels, so we can use a binary search to
+  // find the one which is equal to the submitted component.
+  low = node->children;
+  high = (size_t)node->children + node->child_count;
+  while (low < high) {
+    middle = low + (high - low) / 2;
+    child = cwk_ptrie_get_node(trie, middle);
+    result = cwk_path_compare_sized((const char *)trie + child->label,
+      child->label_size, begin, size);
+    if (result == 0) {
+      return child;
+    } else if (result < 0) {
+      low = middle + 1;
+    } else {
+      high = middle;
+    }
+  }
+
+  return NULL;
+}
+
+static const struct cwk_ptrie_node *cwk_ptrie_find_node(const void *trie,
+  const char *path)
+{
+  const struct cwk_ptrie_node *node;
+  struct cwk_span span;
+
+  // The trie can only be used with the style it has been built with, since the
+  // labels have been compared using that style.
+  if (((const struct cwk_ptrie_header *)trie)->style != (uint32_t)path_style) {
+    return NULL;
+  }
+
+  // We walk down the trie, starting with the root and then one visible segment
+  // at a time, until we either run out of components or there is no matching
+  // child. The empty path is stored at the top node.
+  node = cwk_ptrie_get_node(trie, 0);
+  if (!cwk_path_get_first_component(path, &span)) {
+    return node;
+  }
+
+  do {
+    node = cwk_ptrie_find_child(trie, node, path + span.offset, span.length);
+  } while (node != NULL && cwk_path_get_next_component(path, &span));
+
+  return node;
+}
+
+size_t cwk_ptrie_build(const char **paths, size_t count,
+  struct cwk_span *spans, void *buffer, size_t buffer_size)
+{
+  size_t size;
+  struct cwk_ptrie_header *header;
+  struct cwk_ptrie_builder builder;
+
+  // The paths are sorted by their normalized components, so that all paths
+  // which share a prefix are next to each other.
+  cwk_path_reset_components(paths, spans, count);
+  cwk_path_sort_components(paths, spans, count);
+
+  // First we just measure the trie, so we know where the labels begin and how
+  // much memory is required. The first node is the top of the trie, which has
+  // the roots as children.
+  builder.buffer = NULL;
+  builder.node_count = 1;
+  builder.label_base = 0;
+  builder.label_size = 0;
+  builder.entry_count = 0;
+  cwk_path_reset_components(paths, spans, count);
+  cwk_ptrie_build_node(&builder, paths, spans, count, 0, 0, 0, 0);
+
+  // The offsets are stored as 32 bit values, so the trie can't be larger.
+  size = sizeof(struct cwk_ptrie_header) +
+         builder.node_count * sizeof(struct cwk_ptrie_node) +
+         builder.label_size;
+  if (size > UINT32_MAX) {
+    return 0;
+  }
+
+  // We only generate the trie if it fits into the buffer.
+  if (size > buffer_size) {
+    return size;
+  }
+
+  header = buffer;
+  memcpy(header->magic, cwk_ptrie_magic, sizeof(header->magic));
+  header->version = cwk_ptrie_version;
+  header->style = (uint32_t)path_style;
+  header->node_count = (uint32_t)builder.node_count;
+  header->entry_count = (uint32_t)builder.entry_count;
+  header->size = (uint32_t)size;
+
+  builder.buffer = buffer;
+  builder.label_base = sizeof(struct cwk_ptrie_header) +
+                       builder.node_count * sizeof(struct cwk_ptrie_node);
+  builder.node_count = 1;
+  builder.label_size = 0;
+  builder.entry_count = 0;
+  cwk_path_reset_components(paths, spans, count);
+  cwk_ptrie_build_node(&builder, paths, spans, count, 0, 0, 0, 0);
+
+  return size;
+}
+
+size_t cwk_ptrie_get_entry_count(const void *trie)
+{
+  return ((const struct cwk_ptrie_header *)trie)->entry_count;
+}
+
+bool cwk_ptrie_find_longest(const void *trie, const char *path, size_t *entry,
+  size_t *length)
+{
+  bool found;
+  const struct cwk_ptrie_node *node;
+  struct cwk_span span;
+
+  // The trie can only be used with the style it has been built with, since the
+  // labels have been compared using that style.
+  if (((const struct cwk_ptrie_header *)trie)->style != (uint32_t)path_style) {
+    return false;
+  }
+
+  // We start at the top node, which is only an entry for the empty path. Then
+  // we walk down the trie, one component at a time, and remember the last node
+  // which is an entry. This is the longest entry containing the path.
+  found = false;
+  node = cwk_ptrie_get_node(trie, 0);
+  if (node->entry != 0) {
+    *entry = node->entry - 1;
+    *length = 0;
+    found = true;
+  }
+
+  if (!cwk_path_get_first_component(path, &span)) {
+    return found;
+  }
+
+  do {
+    node = cwk_ptrie_find_child(trie, node, path + span.offset, span.length);
+    if (node == NULL) {
+      break;
+    }
+
+    if (node->entry != 0) {
+      *entry = node->entry - 1;
+      *length = span.offset + span.length;
+      found = true;
+    }
+  } while (cwk_path_get_next_component(path, &span));
+
+  return found;
+}
+
+bool cwk_ptrie_find(const void *trie, const char *path, size_t *entry)
+{
+  const struct cwk_ptrie_node *node;
+
+  // The path is only an entry if we reach a node for all of its components, and
+  // the node is an entry itself.
+  node = cwk_ptrie_find_node(trie, path);
+  if (node == NULL || node->entry == 0) {
+    return false;
+  }
+
+  *entry = node->entry - 1;
+  return true;
+}
+
+bool cwk_ptrie_find_prefix(const void *trie, const char *path, size_t *first,
+  size_t *count)
+{
+  const struct cwk_ptrie_node *node;
+
+  // All entries below a node are numbered continuously, so the entries starting
+  // with the path are just the entries of the subtree.
+  node = cwk_ptrie_find_node(trie, path);
+  if (node == NULL || node->count == 0) {
+    return false;
+  }
+
+  *first = node->first;
+  *count = node->count;
+  return true;
+}
+
+size_t cwk_ptrie_get_path(const void *trie, size_t entry, char *buffer,
+  size_t buffer_size)
+{
+  size_t pos, depth, low, high, middle;
+  const struct cwk_ptrie_node *node, *child;
+
+  // An entry which does not exist results in an empty path.
+  pos = 0;
+  if (entry >= cwk_ptrie_get_entry_count(trie)) {
+    cwk_path_terminate_output(buffer, buffer_size, pos);
+    return pos;
+  }
+
+  // We walk down from the top until we find the node of the entry. Every child
+  // covers a continuous range of entries, so we can search the child which
+  // contains the entry.
+  node = cwk_ptrie_get_node(trie, 0);
+  for (depth = 0; node->entry != entry + 1; ++depth) {
+    low = node->children;
+    high = (size_t)node->children + node->child_count - 1;
+    while (low < high) {
+      middle = low + (high - low + 1) / 2;
+      if (cwk_ptrie_get_node(trie, middle)->first <= entry) {
+        low = middle;
+      } else {
+        high = middle - 1;
+      }
+    }
+
+    // The root is already stored the way it looks after normalization. All
+    // segments are separated by a separator, but the root brings its own.
+    child = cwk_ptrie_get_node(trie, low);
+    if (depth > 1) {
+      pos += cwk_path_output_separator(buffer, buffer_size, pos);
+    }
+
+    pos += cwk_path_output_sized(buffer, buffer_size, pos,
+      (const char *)trie + child->label, child->label_size);
+    node = child;
+  }
+
+  // A relative path without any segments is the current directory. Only the
+  // empty path is stored at the top node itself.
+  if (pos == 0 && depth > 0) {
+    pos += cwk_path_output_current(buffer, buffer_size, pos);
+  }
+
+  cwk_path_terminate_output(buffer, buffer_size, pos);
+  return pos;
+}
+
+bool cwk_ptrie_is_valid(const void *buffer, size_t buffer_size)
+{
+  size_t i, j, label_base, entry;
+  const struct cwk_ptrie_header *header;
+  const struct cwk_ptrie_node *node, *child;
+
+  // The header must be complete, and it must describe a trie of this version
+  // which fits into the buffer. A trie with a foreign byte order will fail
+  // here as well, since its version looks different.
+  header = buffer;
+  if (buffer_size < sizeof(*header) ||
+      memcmp(header->magic, cwk_ptrie_magic, sizeof(header->magic)) != 0 ||
+      header->version != cwk_ptrie_version ||
+      (header->style != CWK_STYLE_WINDOWS &&
+        header->style != CWK_STYLE_UNIX) ||
+      header->size > buffer_size || header->size < sizeof(*header) ||
+      header->node_count == 0 ||
+      header->node_count > (header->size - sizeof(*header)) /
+                             sizeof(struct cwk_ptrie_node)) {
+    return false;
+  }
+
+  label_base = sizeof(*header) +
+               header->node_count * sizeof(struct cwk_ptrie_node);
+
+  // The top node must cover all entries, and it can only be the entry of the
+  // empty path, which comes first.
+  node = cwk_ptrie_get_node(buffer, 0);
+  if (node->entry > 1 || node->first != 0 ||
+      node->count != header->entry_count) {
+    return false;
+  }
+
+  // Now we verify every single node. The children of a node must be stored
+  // after the node itself, which makes sure that every walk through the trie
+  // ends. The labels must be within the label area, and the entries of the
+  // children must exactly cover the entries of the node.
+  for (i = 0; i < header->node_count; ++i) {
+    node = cwk_ptrie_get_node(buffer, i);
+    if ((node->label_size > 0 && node->label < label_base) ||
+        node->label > header->size ||
+        node->label_size > header->size - node->label ||
+        node->first > header->entry_count ||
+        node->count > header->entry_count - node->first) {
+      return false;
+    }
+
+    entry = node->first;
+    if (node->entry != 0) {
+      if (node->entry != entry + 1 || node->count == 0) {
+        return false;
+      }
+      ++entry;
+    }
+
+    if (node->child_count > 0 &&
+        (node->children <= i || node->children > header->node_count ||
+          node->child_count > header->node_count - node->children)) {
+      return false;
+    }
+
+    for (j = 0; j < node->child_count; ++j) {
+      child = cwk_ptrie_get_node(buffer, node->children + j);
+      if (child->first != entry || child->count == 0) {
+        return false;
+      }
+      entry += child->count;
+    }
+
+    if (entry != (size_t)node->first + node->count) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+/**
+ * The header of a front-coded path list. It is followed by the offsets of all
+ * blocks and the encoded entries. The first entry of every block is a restart
+ * entry, which is stored in full and null-terminated. All other entries only
+ * store the length of the prefix they share with the previous entry and the
+ * rest of the path. The length of the root is stored whenever it is not
+ * shared, since a normalized windows path might be parsed with a different
+ * root (".\\C:" becomes "C:").
+ */
+struct cwk_plist_header
+{
+  char magic[4];
+  uint32_t version;
+  uint32_t style;
+  uint32_t block_size;
+  uint64_t count;
+  uint64_t block_count;
+  uint64_t max_length;
+  uint64_t size;
+};
+
+/**
+ * The builder keeps track of the entries and the position while the list is
+ * generated. If there is no buffer, the builder only measures the list.
+ */
+struct cwk_plist_builder
+{
+  char *buffer;
+  uint64_t *offsets;
+  size_t block_size;
+  size_t position;
+  size_t count;
+  size_t max_length;
+};
+
+static const char cwk_plist_magic[4] = {'C', 'W', 'K', 'L'};
+static const uint32_t cwk_plist_version = 1;
+
+static size_t cwk_plist_write_varint(char *buffer, size_t position,
+  size_t value)
+{
+  size_t length;
+
+  // The value is written in groups of seven bits, starting with the lowest
+  // ones. The highest bit of every byte determines whether more bytes follow.
+  length = 0;
+  do {
+    if (buffer) {
+      buffer[position + length] = (char)((value & 0x7f) |
+                                         (value > 0x7f ? 0x80 : 0));
+    }
+    value >>= 7;
+    ++length;
+  } while (value > 0);
+
+  return length;
+}
+
+static const char *cwk_plist_read_varint(const char *c, size_t *value)
+{
+  unsigned int shift;
+
+  *value = 0;
+  shift = 0;
+  do {
+    *value |= (size_t)(*c & 0x7f) << shift;
+    shift += 7;
+  } while ((*c++ & 0x80) != 0);
+
+  return c;
+}
+
+static bool cwk_plist_is_component_equal(const char *first, size_t first_size,
+  const char *second, size_t second_size)
+{
+  size_t i;
+
+  // Components can only be shared if their bytes are exactly equal, otherwise
+  // a decoded path might look different than the normalized path. The only
+  // exception are separators, since they are replaced in the root anyway.
+  if (first_size != second_size) {
+    return false;
+  }
+
+  for (i = 0; i < first_size; ++i) {
+    if (first[i] != second[i] &&
+        !(cwk_path_is_separator(&first[i]) &&
+          cwk_path_is_separator(&second[i]))) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+static size_t cwk_plist_get_shared(const char *previous, const char *path,
+  size_t *components)
+{
+  size_t length;
+  struct cwk_span previous_span, span;
+
+  // We count the components which are exactly equal in both paths, and sum up
+  // the amount of characters they take up in the normalized path. The root has
+  // no separator, and the first segment follows the root directly.
+  *components = 0;
+  length = 0;
+  cwk_path_get_first_component(previous, &previous_span);
+  cwk_path_get_first_component(path, &span);
+  while (previous_span.type != CWK_CURRENT && span.type != CWK_CURRENT &&
+         cwk_plist_is_component_equal(previous + previous_span.offset,
+           previous_span.length, path + span.offset, span.length)) {
+    length += span.length + (*components > 1 ? 1 : 0);
+    ++*components;
+    cwk_path_get_next_component(previous, &previous_span);
+    cwk_path_get_next_component(path, &span);
+  }
+
+  return length;
+}
+
+static size_t cwk_plist_write_path(char *buffer, size_t position,
+  const char *path, size_t skip)
+{
+  size_t index, length;
+  struct cwk_span span;
+
+  // We write the normalized path, but skip the components which are shared
+  // with the previous path. If there is no buffer, we just measure the length.
+  length = 0;
+  if (!cwk_path_get_first_component(path, &span)) {
+    return length;
+  }
+
+  for (index = 0; span.type != CWK_CURRENT; ++index) {
+    if (index >= skip) {
+      if (index > 1) {
+        if (buffer) {
+          buffer[position + length] = separators[path_style][0];
+        }
+        ++length;
+      }
+
+      if (buffer) {
+        memcpy(buffer + position + length, path + span.offset, span.length);
+        if (index == 0) {
+          cwk_path_fix_root(buffer + position, span.length, span.length);
+        }
+      }
+
+      length += span.length;
+    }
+
+    cwk_path_get_next_component(path, &span);
+  }
+
+  // A relative path without any segments is the current directory, just like
+  // cwk_path_normalize would output it.
+  if (length == 0 && skip == 0) {
+    if (buffer) {
+      buffer[position] = '.';
+    }
+    length = 1;
+  }
+
+  return length;
+}
+
+static void cwk_plist_build_entries(struct cwk_plist_builder *builder,
+  const char **paths, size_t count)
+{
+  size_t i, shared, components, length, root_length;
+  const char *previous;
+
+  previous = NULL;
+  for (i = 0; i < count; ++i) {
+    // The paths are sorted, so equal paths are next to each other. We only
+    // keep the first one.
+    if (previous && cwk_path_compare_normalized(previous, paths[i]) == 0) {
+      continue;
+    }
+
+    if (builder->count % builder->block_size == 0) {
+      // This is a restart entry, which is stored in full. We remember where the
+      // block begins and terminate the path so it can be compared in place.
+      if (builder->buffer) {
+        builder->offsets[builder->count / builder->block_size] =
+          builder->position;
+      }
+
+      shared = 0;
+      cwk_path_get_root(paths[i], &root_length);
+      length = cwk_plist_write_path(NULL, 0, paths[i], 0);
+      builder->position += cwk_plist_write_varint(builder->buffer,
+        builder->position, root_length);
+      builder->position += cwk_plist_write_varint(builder->buffer,
+        builder->position, length);
+      cwk_plist_write_path(builder->buffer, builder->position, paths[i], 0);
+      builder->position += length;
+      if (builder->buffer) {
+        builder->buffer[builder->position] = '\0';
+      }
+      ++builder->position;
+    } else {
+      // All other entries only store the characters after the segments they
+      // share with the previous entry. The lowest bit tells whether the root
+      // is shared as well, otherwise its length follows.
+      shared = cwk_plist_get_shared(previous, paths[i], &components);
+      length = cwk_plist_write_path(NULL, 0, paths[i], components);
+      builder->position += cwk_plist_write_varint(builder->buffer,
+        builder->position, shared << 1 | (components == 0 ? 1 : 0));
+      if (components == 0) {
+        cwk_path_get_root(paths[i], &root_length);
+        builder->position += cwk_plist_write_varint(builder->buffer,
+          builder->position, root_length);
+      }
+      builder->position += cwk_plist_write_varint(builder->buffer,
+        builder->position, length);
+      cwk_plist_write_path(builder->buffer, builder->position, paths[i],
+        components);
+      builder->position += length;
+    }
+
+    if (shared + length > builder->max_length) {
+      builder->max_length = shared + length;
+    }
+
+    previous = paths[i];
+    ++builder->count;
+  }
+}
+
+static const struct cwk_plist_header *cwk_plist_get_header(const void *list)
+{
+  return (const struct cwk_plist_header *)list;
+}
+
+static const uint64_t *cwk_plist_get_offsets(const void *list)
+{
+  return (const uint64_t *)((const char *)list +
+                            sizeof(struct cwk_plist_header));
+}
+
+static bool cwk_plist_decode_restart(struct cwk_plist_cursor *cursor,
+  size_t block)
+{
+  size_t length;
+  const char *c;
+
+  // The restart entry is stored in full, so we just copy it including the
+  // null-terminating character.
+  c = (const char *)cursor->list + cwk_plist_get_offsets(cursor->list)[block];
+  c = cwk_plist_read_varint(c, &cursor->root_length);
+  c = cwk_plist_read_varint(c, &length);
+  if (length >= cursor->path_size) {
+    return false;
+  }
+
+  memcpy(cursor->path, c, length + 1);
+  cursor->length = length;
+  cursor->index = block * cwk_plist_get_header(cursor->list)->block_size;
+  cursor->position = (size_t)(c + length + 1 - (const char *)cursor->list);
+  return true;
+}
+
+static int cwk_plist_compare(const char *entry, size_t entry_root_length,
+  const char *path)
+{
+  bool entry_available, available;
+  int result;
+  struct cwk_segment entry_segment;
+  struct cwk_span span;
+
+  // This compares a decoded entry with a path, using the same order as the
+  // entries have been sorted with. The empty path comes before all others,
+  // since it has no components at all.
+  available = cwk_path_get_first_component(path, &span);
+  if (*entry == '\0' || !available) {
+    return (int)(*entry != '\0') - (int)available;
+  }
+
+  // We don't parse the root of the entry again, since it might look different
+  // after normalization.
+  result = cwk_path_compare_sized(entry, entry_root_length, path, span.length);
+  if (result != 0) {
+    return result;
+  }
+
+  // The entry is already normalized, so all of its segments are visible. The
+  // only exception is the current directory, which has no segments at all.
+  entry_available = !(entry_root_length == 0 && strcmp(entry, ".") == 0) &&
+                    cwk_path_get_first_segment_without_root(entry,
+                      entry + entry_root_length, NULL, &entry_segment);
+  available = cwk_path_get_next_component(path, &span);
+  while (entry_available && available) {
+    result = cwk_path_compare_sized(entry_segment.begin, entry_segment.size,
+      path + span.offset, span.length);
+    if (result != 0) {
+      return result;
+    }
+
+    entry_available = cwk_path_get_next_segment(&entry_segment);
+    available = cwk_path_get_next_component(path, &span);
+  }
+
+  return (int)entry_available - (int)available;
+}
+
+size_t cwk_plist_build(const char **paths, size_t count, size_t block_size,
+  struct cwk_span *spans, void *buffer, size_t buffer_size)
+{
+  size_t offsets_size, size;
+  struct cwk_plist_header *header;
+  struct cwk_plist_builder builder;
+
+  // A block must contain at least the restart entry.
+  if (block_size == 0 || block_size > UINT32_MAX) {
+    return 0;
+  }
+
+  // The paths are sorted by their normalized components, so that paths which
+  // share segments are next to each other.
+  cwk_path_reset_components(paths, spans, count);
+  cwk_path_sort_components(paths, spans, count);
+
+  // First we just measure the list, so we know how many blocks there are and
+  // how much memory is required.
+  builder.buffer = NULL;
+  builder.offsets = NULL;
+  builder.block_size = block_size;
+  builder.position = 0;
+  builder.count = 0;
+  builder.max_length = 0;
+  cwk_plist_build_entries(&builder, paths, count);
+
+  offsets_size = (builder.count + block_size - 1) / block_size *
+                 sizeof(uint64_t);
+  size = sizeof(struct cwk_plist_header) + offsets_size + builder.position;
+  if (size > buffer_size) {
+    return size;
+  }
+
+  header = buffer;
+  memcpy(header->magic, cwk_plist_magic, sizeof(header->magic));
+  header->version = cwk_plist_version;
+  header->style = (uint32_t)path_style;
+  header->block_size = (uint32_t)block_size;
+  header->count = builder.count;
+  header->block_count = offsets_size / sizeof(uint64_t);
+  header->max_length = builder.max_length;
+  header->size = size;
+
+  builder.buffer = buffer;
+  builder.offsets = (uint64_t *)(builder.buffer +
+                                 sizeof(struct cwk_plist_header));
+  builder.position = sizeof(struct cwk_plist_header) + offsets_size;
+  builder.count = 0;
+  builder.max_length = 0;
+  cwk_plist_build_entries(&builder, paths, count);
+
+  return size;
+}
+
+size_t cwk_plist_get_count(const void *list)
+{
+  return (size_t)cwk_plist_get_header(list)->count;
+}
+
+size_t cwk_plist_get_max_length(const void *list)
+{
+  return (size_t)cwk_plist_get_header(list)->max_length;
+}
+
+bool cwk_plist_seek(const void *list, size_t index,
+  struct cwk_plist_cursor *cursor, char *buffer, size_t buffer_size)
+{
+  size_t block_size;
+
+  // The buffer must be large enough for any entry of the list, so we never
+  // have to check whether we can decode an entry.
+  if (index >= cwk_plist_get_count(list) ||
+      buffer_size <= cwk_plist_get_max_length(list)) {
+    return false;
+  }
+
+  cursor->list = list;
+  cursor->path = buffer;
+  cursor->path_size = buffer_size;
+
+  // We jump to the restart entry of the block and decode all entries until we
+  // reach the one we want.
+  block_size = cwk_plist_get_header(list)->block_size;
+  if (!cwk_plist_decode_restart(cursor, index / block_size)) {
+    return false;
+  }
+
+  while (cursor->index < index) {
+    if (!cwk_plist_next(cursor)) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+bool cwk_plist_next(struct cwk_plist_cursor *cursor)
+{
+  size_t shared, length, block_size;
+  const char *c;
+
+  if (cursor->index + 1 >= cwk_plist_get_count(cursor->list)) {
+    return false;
+  }
+
+  // The first entry of every block is a restart entry.
+  block_size = cwk_plist_get_header(cursor->list)->block_size;
+  if ((cursor->index + 1) % block_size == 0) {
+    return cwk_plist_decode_restart(cursor, (cursor->index + 1) / block_size);
+  }
+
+  // Otherwise we keep the shared part of the previous entry in the buffer and
+  // just copy the rest of the path behind it.
+  c = (const char *)cursor->list + cursor->position;
+  c = cwk_plist_read_varint(c, &shared);
+  if (shared & 1) {
+    c = cwk_plist_read_varint(c, &cursor->root_length);
+  }
+  shared >>= 1;
+  c = cwk_plist_read_varint(c, &length);
+  if (shared > cursor->length || shared + length >= cursor->path_size) {
+    return false;
+  }
+
+  memcpy(cursor->path + shared, c, length);
+  cursor->path[shared + length] = '\0';
+  cursor->length = shared + length;
+  cursor->position = (size_t)(c + length - (const char *)cursor->list);
+  ++cursor->index;
+  return true;
+}
+
+bool cwk_plist_find(const void *list, const char *path,
+  struct cwk_plist_cursor *cursor, char *buffer, size_t buffer_size)
+{
+  size_t low, high, middle, length, root_length;
+  int result;
+  const char *restart;
+  const struct cwk_plist_header *header;
+
+  header = cwk_plist_get_header(list);
+  if (header->style != (uint32_t)path_style || header->count == 0 ||
+      buffer_size <= header->max_length) {
+    return false;
+  }
+
+  // We search for the last block which begins with an entry that is not
+  // larger than the path. The restart entries are stored in full, so they can
+  // be compared in place.
+  low = 0;
+  high = (size_t)header->block_count;
+  while (low < high) {
+    middle = low + (high - low) / 2;
+    restart = cwk_plist_read_varint((const char *)list +
+                                      cwk_plist_get_offsets(list)[middle],
+      &root_length);
+    restart = cwk_plist_read_varint(restart, &length);
+    if (cwk_plist_compare(restart, root_length, path) <= 0) {
+      low = middle + 1;
+    } else {
+      high = middle;
+    }
+  }
+
+  if (low == 0) {
+    return false;
+  }
+
+  // Now we decode the entries of that block one after another, until we find
+  // the path or an entry which is larger.
+  cursor->list = list;
+  cursor->path = buffer;
+  cursor->path_size = buffer_size;
+  if (!cwk_plist_decode_restart(cursor, low - 1)) {
+    return false;
+  }
+
+  do {
+    result = cwk_plist_compare(cursor->path, cursor->root_length, path);
+    if (result == 0) {
+      return true;
+    } else if (result > 0) {
+      break;
+    }
+  } while ((cursor->index + 1) % header->block_size != 0 &&
+           cwk_plist_next(cursor));
+
+  return false;
+}
+
+/**
+ * The header of a compiled extension set. It is followed by the displacements
+ * of all buckets, the slots of the hash table, the entries and finally the
+ * extensions themselves. Every extension is stored without its leading dot
+ * and folded if the set ignores the case. The slot of an extension is
+ * determined by its hash and the displacement of its bucket, which is chosen
+ * while building the set so that no two extensions share a slot. This way a
+ * lookup never has to probe more than one slot.
+ */
+struct cwk_extset_header
+{
+  char magic[4];
+  uint32_t version;
+  uint32_t ignore_case;
+  uint32_t count;
+  uint32_t bucket_count;
+  uint32_t slot_count;
+  uint32_t max_dots;
+  uint32_t size;
+};
+
+/**
+ * An entry of an extension set. The bucket and its size are only used while
+ * building the set, so that the largest buckets can be placed first.
+ */
+struct cwk_extset_entry
+{
+  uint64_t hash;
+  uint32_t offset;
+  uint32_t length;
+  uint32_t id;
+  uint32_t bucket;
+  uint32_t bucket_size;
+  uint32_t reserved;
+};
+
+static const char cwk_extset_magic[4] = {'C', 'W', 'K', 'X'};
+static const uint32_t cwk_extset_version = 1;
+
+/**
+ * The maximum displacement we try for a bucket before we give up. This is
+ * never reached in practice, since the table is at most half full.
+ */
+#define CWK_EXTSET_MAX_DISPLACEMENT 0x100000
+
+static unsigned char cwk_extset_fold(const char *begin, const char *c,
+  const char *end, bool ignore_case)
+{
+  if (!ignore_case) {
+    return (unsigned char)*c;
+  }
+
+  return cwk_path_fold_char(begin, c, end);
+}
+
+static uint64_t cwk_extset_hash(const char *begin, const char *end,
+  bool ignore_case)
+{
+  uint64_t hash;
+  const char *c;
+
+  // This is a FNV-1a hash of the folded characters. Since extensions are
+  // short, we mix the bits afterwards so that the bucket and the slot, which
+  // use different parts of the hash, are independent.
+  hash = 0xcbf29ce484222325;
+  for (c = begin; c < end; ++c) {
+    hash ^= cwk_extset_fold(begin, c, end, ignore_case);
+    hash *= 0x100000001b3;
+  }
+
+  hash ^= hash >> 33;
+  hash *= 0xff51afd7ed558ccd;
+  hash ^= hash >> 33;
+  hash *= 0xc4ceb9fe1a85ec53;
+  hash ^= hash >> 33;
+  return hash;
+}
+
+static uint32_t cwk_extset_get_slot(uint64_t hash, uint64_t displacement,
+  uint32_t slot_count)
+{
+  // The displacement is mixed with the whole hash, so that two extensions which
+  // collide for one displacement are independent of each other for the next.
+  hash ^= displacement * 0x9e3779b97f4a7c15;
+  hash ^= hash >> 32;
+  hash *= 0xd6e8feb86659fd93;
+  hash ^= hash >> 32;
+  return (uint32_t)hash & (slot_count - 1);
+}
+
+static const uint32_t *cwk_extset_get_displacements(const void *set)
+{
+  return (const uint32_t *)((const struct cwk_extset_header *)set + 1);
+}
+
+static const uint32_t *cwk_extset_get_slots(const void *set)
+{
+  const struct cwk_extset_header *header;
+
+  header = set;
+  return cwk_extset_get_displacements(set) + header->bucket_count;
+}
+
+static size_t cwk_extset_get_entries_offset(uint32_t bucket_count,
+  uint32_t slot_count)
+{
+  // The entries contain 64 bit values, which is why they are aligned to eight
+  // bytes.
+  return (sizeof(struct cwk_extset_header) +
+           sizeof(uint32_t) * (bucket_count + slot_count) + 7) &
+         ~(size_t)7;
+}
+
+static const struct cwk_extset_entry *cwk_extset_get_entries(const void *set)
+{
+  const struct cwk_extset_header *header;
+
+  header = set;
+  return (const struct cwk_extset_entry *)((const char *)set +
+                                           cwk_extset_get_entries_offset(
+                                             header->bucket_count,
+                                             header->slot_count));
+}
+
+static bool cwk_extset_lookup(const void *set, const char *begin,
+  const char *end, size_t *id)
+{
+  size_t i;
+  uint64_t hash;
+  uint32_t slot;
+  const char *key;
+  const struct cwk_extset_header *header;
+  const struct cwk_extset_entry *entry;
+
+  header = set;
+  hash = cwk_extset_hash(begin, end, header->ignore_case != 0);
+  slot = cwk_extset_get_slot(hash,
+    cwk_extset_get_displacements(
+      set)[(uint32_t)(hash >> 32) % header->bucket_count],
+    header->slot_count);
+  slot = cwk_extset_get_slots(set)[slot];
+  if (slot == 0) {
+    return false;
+  }
+
+  // The slot might belong to another extension, so we have to compare the
+  // extension as well.
+  entry = &cwk_extset_get_entries(set)[slot - 1];
+  if (entry->hash != hash || entry->length != (size_t)(end - begin)) {
+    return false;
+  }
+
+  key = (const char *)set + entry->offset;
+  for (i = 0; i < entry->length; ++i) {
+    if ((unsigned char)key[i] !=
+        cwk_extset_fold(begin, begin + i, end, header->ignore_case != 0)) {
+      return false;
+    }
+  }
+
+  *id = entry->id;
+  return true;
+}
+
+static int cwk_extset_compare_entries(const void *a, const void *b)
+{
+  const struct cwk_extset_entry *first, *second;
+
+  // The largest buckets are placed first, since they are the hardest to place.
+  // Entries with the same hash are sorted by their id, so that the first one
+  // of equal extensions wins.
+  first = a;
+  second = b;
+  if (first->bucket_size != second->bucket_size) {
+    return first->bucket_size > second->bucket_size ? -1 : 1;
+  } else if (first->bucket != second->bucket) {
+    return first->bucket < second->bucket ? -1 : 1;
+  } else if (first->hash != second->hash) {
+    return first->hash < second->hash ? -1 : 1;
+  }
+
+  return first->id < second->id ? -1 : first->id > second->id;
+}
+
+static bool cwk_extset_place_bucket(char *buffer,
+  struct cwk_extset_entry *entries, size_t count)
+{
+  size_t i, j;
+  uint32_t displacement, slot;
+  uint32_t *slots;
+  struct cwk_extset_header *header;
+
+  // We try one displacement after another, until all extensions of the bucket
+  // land in empty slots. Extensions which are equal to a previous one of the
+  // bucket are skipped, they keep their entry but never get a slot.
+  header = (struct cwk_extset_header *)buffer;
+  slots = (uint32_t *)cwk_extset_get_slots(buffer);
+  for (displacement = 0; displacement < CWK_EXTSET_MAX_DISPLACEMENT;
+       ++displacement) {
+    for (i = 0; i < count; ++i) {
+      if (entries[i].bucket_size == 0) {
+        continue;
+      }
+
+      slot = cwk_extset_get_slot(entries[i].hash, displacement,
+        header->slot_count);
+      if (slots[slot] != 0) {
+        break;
+      }
+
+      for (j = 0; j < i; ++j) {
+        if (entries[j].bucket_size != 0 &&
+            cwk_extset_get_slot(entries[j].hash, displacement,
+              header->slot_count) == slot) {
+          break;
+        }
+      }
+
+      if (j < i) {
+        break;
+      }
+    }
+
+    if (i == count) {
+      break;
+    }
+  }
+
+  if (displacement == CWK_EXTSET_MAX_DISPLACEMENT) {
+    return false;
+  }
+
+  ((uint32_t *)cwk_extset_get_displacements(buffer))[entries[0].bucket] =
+    displacement;
+  for (i = 0; i < count; ++i) {
+    if (entries[i].bucket_size != 0) {
+      slot = cwk_extset_get_slot(entries[i].hash, displacement,
+        header->slot_count);
+      slots[slot] = (uint32_t)(&entries[i] -
+                               cwk_extset_get_entries(buffer)) +
+                    1;
+    }
+  }
+
+  return true;
+}
+
+size_t cwk_extset_build(const char **extensions, size_t count,
+  bool ignore_case, void *buffer, size_t buffer_size)
+{
+  size_t i, j, size, entries_offset, key_offset, length, dots, max_dots;
+  uint32_t bucket_count, slot_count;
+  const char *extension;
+  char *key;
+  uint32_t *counts;
+  struct cwk_extset_header *header;
+  struct cwk_extset_entry *entries;
+
+  if (count > UINT32_MAX / 4) {
+    return 0;
+  }
+
+  // We use a bucket for about four extensions and keep the table at most half
+  // full, which makes it easy to find a displacement for every bucket.
+  bucket_count = count / 4 + 1;
+  slot_count = 1;
+  while (slot_count < count * 2) {
+    slot_count *= 2;
+  }
+
+  entries_offset = cwk_extset_get_entries_offset(bucket_count, slot_count);
+  key_offset = entries_offset + sizeof(*entries) * count;
+  size = key_offset;
+  max_dots = 0;
+  for (i = 0; i < count; ++i) {
+    // The leading dot is optional. Since we match suffixes of the last
+    // segment, we have to know how many dots the longest extension contains.
+    extension = extensions[i];
+    if (*extension == '.') {
+      ++extension;
+    }
+
+    length = strlen(extension);
+    if (length == 0) {
+      return 0;
+    }
+
+    dots = 1;
+    for (j = 0; j < length; ++j) {
+      if (extension[j] == '.') {
+        ++dots;
+      }
+    }
+
+    max_dots = dots > max_dots ? dots : max_dots;
+    size += length + 1;
+  }
+
+  size = (size + 7) & ~(size_t)7;
+  if (size > UINT32_MAX) {
+    return 0;
+  } else if (buffer == NULL || buffer_size < size) {
+    return size;
+  }
+
+  header = buffer;
+  memset(buffer, 0, size);
+  memcpy(header->magic, cwk_extset_magic, sizeof(header->magic));
+  header->version = cwk_extset_version;
+  header->ignore_case = ignore_case;
+  header->count = (uint32_t)count;
+  header->bucket_count = bucket_count;
+  header->slot_count = slot_count;
+  header->max_dots = (uint32_t)max_dots;
+  header->size = (uint32_t)size;
+
+  // Now the extensions are copied and folded, and we count the size of all
+  // buckets. The displacements are used for counting, since they are not
+  // needed yet.
+  entries = (struct cwk_extset_entry *)((char *)buffer + entries_offset);
+  counts = (uint32_t *)cwk_extset_get_displacements(buffer);
+  for (i = 0; i < count; ++i) {
+    extension = extensions[i];
+    if (*extension == '.') {
+      ++extension;
+    }
+
+    length = strlen(extension);
+    key = (char *)buffer + key_offset;
+    for (j = 0; j < length; ++j) {
+      key[j] = (char)cwk_extset_fold(extension, extension + j,
+        extension + length, ignore_case);
+    }
+
+    entries[i].hash = cwk_extset_hash(extension, extension + length,
+      ignore_case);
+    entries[i].offset = (uint32_t)key_offset;
+    entries[i].length = (uint32_t)length;
+    entries[i].id = (uint32_t)i;
+    entries[i].bucket = (uint32_t)(entries[i].hash >> 32) % bucket_count;
+    ++counts[entries[i].bucket];
+    key_offset += length + 1;
+  }
+
+  for (i = 0; i < count; ++i) {
+    entries[i].bucket_size = counts[entries[i].bucket];
+  }
+
+  memset(counts, 0, sizeof(*counts) * bucket_count);
+  qsort(entries, count, sizeof(*entries), cwk_extset_compare_entries);
+
+  // Equal extensions are next to each other now, and only the first one of
+  // them gets a slot. We mark the others by clearing their bucket size.
+  for (i = 1; i < count; ++i) {
+    for (j = i; j > 0 && entries[j - 1].hash == entries[i].hash; --j) {
+      if (entries[j - 1].bucket_size != 0 &&
+          entries[j - 1].length == entries[i].length &&
+          memcmp((char *)buffer + entries[j - 1].offset,
+            (char *)buffer + entries[i].offset, entries[i].length) == 0) {
+        entries[i].bucket_size = 0;
+        break;
+      }
+    }
+  }
+
+  // Finally, all buckets are placed one after another.
+  for (i = 0; i < count; i = j) {
+    for (j = i + 1; j < count && entries[j].bucket == entries[i].bucket; ++j) {
+    }
+
+    if (!cwk_extset_place_bucket(buffer, &entries[i], j - i)) {
+      return 0;
+    }
+  }
+
+  return size;
+}
+
+bool cwk_extset_find(const void *set, const char *extension, size_t *id)
+{
+  // The leading dot is optional, just like when building the set.
+  if (*extension == '.') {
+    ++extension;
+  }
+
+  return cwk_extset_lookup(set, extension, extension + strlen(extension), id);
+}
+
+bool cwk_extset_match(const void *set, const char *path, size_t *id)
+{
+  size_t root_length, dots;
+  const char *begin, *end, *c;
+  const struct cwk_extset_header *header;
+  bool found;
+
+  // The root never contains an extension, so we only have to search the last
+  // segment.
+  cwk_path_get_root(path, &root_length);
+  end = path + strlen(path);
+  begin = cwk_path_find_last_segment(path, root_length, &end);
+
+  // Every dot starts a longer extension, and we only have to look at as many
+  // dots as the longest extension in the set contains. The longest extension
+  // which is in the set wins, so ".tar.gz" is preferred over ".gz".
+  header = set;
+  found = false;
+  dots = 0;
+  for (c = end; c > begin && dots < header->max_dots;) {
+    --c;
+    if (*c != '.') {
+      continue;
+    }
+
+    ++dots;
+    if (c + 1 < end && cwk_extset_lookup(set, c + 1, end, id)) {
+      found = true;
+    }
+  }
+
+  return found;
+}
+
+/**
+ * The map of paths is stored at the beginning of the buffer of the caller. It
+ * is followed by one control byte for every slot, the slots themselves and the
+ * entries which are referenced by the slots. Just like in a swiss table, the
+ * control byte of a used slot contains the lowest seven bits of the hash,
+ * while the highest bit marks an empty slot. So a whole group of eight slots
+ * can be probed at once, and only the entries of matching slots are compared.
+ */
+struct cwk_pathmap
+{
+  size_t size;
+  size_t slot_count;
+  size_t count;
+  size_t used;
+};
+
+/**
+ * An entry of the map, which is followed by the normalized path. The path is
+ * null-terminated.
+ */
+struct cwk_pathmap_entry
+{
+  uint64_t hash;
+  size_t value;
+  size_t length;
+};
+
+#define CWK_PATHMAP_MAX_DEPTH 64
+
+/**
+ * The segments of a path which remain after normalization, which are
+ * determined once for every insertion or lookup. Every segment is stored
+ * together with the hash of the normalized path up to that segment, so a back
+ * segment can simply return to the hash before the segment it removes. Paths
+ * with more remaining segments than fit in here use the slower functions of
+ * the deduplication instead.
+ */
+struct cwk_pathmap_lookup
+{
+  const char *path;
+  size_t root_length;
+  size_t count;
+  bool has_segments;
+  bool overflow;
+  uint64_t hash;
+  const char *begins[CWK_PATHMAP_MAX_DEPTH];
+  size_t sizes[CWK_PATHMAP_MAX_DEPTH];
+  uint64_t hashes[CWK_PATHMAP_MAX_DEPTH];
+};
+
+#define CWK_PATHMAP_GROUP 8
+#define CWK_PATHMAP_EMPTY 0x80
+
+static unsigned char *cwk_pathmap_get_control(const struct cwk_pathmap *map)
+{
+  return (unsigned char *)(map + 1);
+}
+
+static size_t *cwk_pathmap_get_slots(const struct cwk_pathmap *map)
+{
+  // The control bytes are a multiple of the group size, so the slots are
+  // aligned just like the map itself.
+  return (size_t *)(cwk_pathmap_get_control(map) + map->slot_count);
+}
+
+static struct cwk_pathmap_entry *cwk_pathmap_get_entry(
+  const struct cwk_pathmap *map, size_t offset)
+{
+  return (struct cwk_pathmap_entry *)((char *)map + offset);
+}
+
+static uint64_t cwk_pathmap_clear_match(uint64_t matches, size_t index)
+{
+  unsigned char bytes[sizeof(matches)];
+  uint64_t match;
+
+  // The match is cleared in memory order, just like it has been found, so
+  // this works no matter how the machine stores its integers.
+  memset(bytes, 0, sizeof(bytes));
+  bytes[index] = 0x80;
+  memcpy(&match, bytes, sizeof(match));
+  return matches & ~match;
+}
+
+static void cwk_pathmap_prepare(struct cwk_pathmap_lookup *lookup,
+  const char *path)
+{
+  bool absolute;
+  size_t kept, size;
+  uint64_t base, hash;
+  const char *c, *begin;
+
+  // The root and the "." of an empty relative path are hashed first, exactly
+  // like cwk_path_hash_normalized does.
+  lookup->path = path;
+  lookup->count = 0;
+  lookup->overflow = false;
+  cwk_path_get_root(path, &lookup->root_length);
+  absolute = cwk_path_is_root_absolute(path, lookup->root_length);
+  base = cwk_path_hash_string(0xcbf29ce484222325, path, lookup->root_length);
+  c = path + lookup->root_length;
+  while (cwk_path_is_separator(c)) {
+    ++c;
+  }
+
+  lookup->has_segments = *c != '\0';
+  if (lookup->root_length == 0 && lookup->has_segments) {
+    base = cwk_path_hash_string(base, ".", 1);
+  }
+
+  // Back segments which are kept are always at the bottom of the stack, so a
+  // back segment removes the top of the stack as long as there are more
+  // segments than kept back segments.
+  kept = 0;
+  while (*c != '\0') {
+    begin = c;
+    c = cwk_path_find_next_stop(c, NULL);
+    size = (size_t)(c - begin);
+    while (cwk_path_is_separator(c)) {
+      ++c;
+    }
+
+    if (size == 1 && begin[0] == '.') {
+      continue;
+    } else if (size == 2 && begin[0] == '.' && begin[1] == '.') {
+      if (lookup->count > kept) {
+        --lookup->count;
+        continue;
+      } else if (absolute) {
+        continue;
+      }
+      ++kept;
+    }
+
+    if (lookup->count == CWK_PATHMAP_MAX_DEPTH) {
+      lookup->overflow = true;
+      lookup->hash = cwk_path_hash_normalized(path);
+      return;
+    }
+
+    hash = lookup->count > 0 ? lookup->hashes[lookup->count - 1] : base;
+    hash = cwk_path_hash_string(hash, "/", 1);
+    lookup->begins[lookup->count] = begin;
+    lookup->sizes[lookup->count] = size;
+    lookup->hashes[lookup->count] = cwk_path_hash_string(hash, begin, size);
+    ++lookup->count;
+  }
+
+  lookup->hash = lookup->count > 0 ? lookup->hashes[lookup->count - 1] : base;
+}
+
+static bool cwk_pathmap_is_equal(const struct cwk_pathmap_lookup *lookup,
+  const char *key, size_t key_length)
+{
+  size_t i, position, root_length;
+
+  // Keys which kept a "." in front, because they would get a new root
+  // otherwise, are compared with the slower function as well.
+  if (lookup->overflow || (key[0] == '.' && cwk_path_is_separator(&key[1]))) {
+    return cwk_path_is_normalized_equal(key, lookup->path);
+  }
+
+  cwk_path_get_root(key, &root_length);
+  if (!cwk_path_is_string_equal(key, lookup->path, root_length,
+        lookup->root_length)) {
+    return false;
+  }
+
+  // The key is normalized, so it must consist of exactly the remaining
+  // segments with a single separator between them.
+  position = root_length;
+  if (lookup->count == 0) {
+    if (lookup->root_length == 0 && lookup->has_segments) {
+      return key_length == position + 1 && key[position] == '.';
+    }
+
+    return key_length == position;
+  }
+
+  for (i = 0; i < lookup->count; ++i) {
+    if (i > 0) {
+      if (position >= key_length || !cwk_path_is_separator(&key[position])) {
+        return false;
+      }
+      ++position;
+    }
+
+    if (key_length - position < lookup->sizes[i] ||
+        !cwk_path_is_string_equal(&key[position], lookup->begins[i],
+          lookup->sizes[i], lookup->sizes[i])) {
+      return false;
+    }
+
+    position += lookup->sizes[i];
+  }
+
+  return position == key_length;
+}
+
+static bool cwk_pathmap_find_slot(const struct cwk_pathmap *map,
+  const struct cwk_pathmap_lookup *lookup, size_t *slot)
+{
+  size_t i, group, group_count, step;
+  uint64_t hash, block, matches;
+  const unsigned char *control;
+  const size_t *slots;
+  const struct cwk_pathmap_entry *entry;
+
+  // The groups are probed with growing steps, which visits every group once
+  // since the number of groups is a power of two. The highest bits of the hash
+  // select the first group, the lowest seven bits are in the control bytes.
+  hash = lookup->hash;
+  control = cwk_pathmap_get_control(map);
+  slots = cwk_pathmap_get_slots(map);
+  group_count = map->slot_count / CWK_PATHMAP_GROUP;
+  group = (size_t)(hash >> 7) & (group_count - 1);
+  for (step = 1; step <= group_count; ++step) {
+    memcpy(&block, control + group * CWK_PATHMAP_GROUP, sizeof(block));
+
+    // Only the entries of slots with the same seven bits of the hash are
+    // compared, which rules out almost all other paths without touching them.
+    matches = cwk_path_match_block(block, (unsigned char)(hash & 0x7f));
+    while (matches != 0) {
+      i = cwk_path_get_first_match(matches);
+      entry = cwk_pathmap_get_entry(map, slots[group * CWK_PATHMAP_GROUP + i]);
+      if (entry->hash == hash &&
+          cwk_pathmap_is_equal(lookup, (const char *)(entry + 1),
+            entry->length)) {
+        *slot = group * CWK_PATHMAP_GROUP + i;
+        return true;
+      }
+
+      matches = cwk_pathmap_clear_match(matches, i);
+    }
+
+    // Paths are never removed, so the path can't be in the map if the group
+    // has an empty slot. That slot is where the path would be inserted.
+    matches = block & 0x8080808080808080;
+    if (matches != 0) {
+      *slot = group * CWK_PATHMAP_GROUP + cwk_path_get_first_match(matches);
+      return false;
+    }
+
+    group = (group + step) & (group_count - 1);
+  }
+
+  *slot = map->slot_count;
+  return false;
+}
+
+struct cwk_pathmap *cwk_pathmap_init(void *buffer, size_t buffer_size)
+{
+  size_t slot_count;
+  struct cwk_pathmap *map;
+
+  // We use one slot for every 64 bytes of the buffer, just like the cache of
+  // resolved paths. The number of slots must be a power of two and at least
+  // one group.
+  if (buffer_size < sizeof(*map) + 1024) {
+    return NULL;
+  }
+
+  slot_count = CWK_PATHMAP_GROUP;
+  while (slot_count * 2 <= (buffer_size - sizeof(*map)) / 64) {
+    slot_count *= 2;
+  }
+
+  map = buffer;
+  map->size = buffer_size;
+  map->slot_count = slot_count;
+  map->count = 0;
+  map->used = sizeof(*map) + slot_count + slot_count * sizeof(size_t);
+  memset(cwk_pathmap_get_control(map), CWK_PATHMAP_EMPTY, slot_count);
+
+  return map;
+}
+
+bool cwk_pathmap_insert(struct cwk_pathmap *map, const char *path,
+  size_t value)
+{
+  size_t slot, length, size, root_length, key_root_length;
+  char *key;
+  struct cwk_pathmap_entry *entry;
+  struct cwk_pathmap_lookup lookup;
+
+  // An equal path only gets its value replaced, it keeps the key which was
+  // inserted first.
+  cwk_pathmap_prepare(&lookup, path);
+  if (cwk_pathmap_find_slot(map, &lookup, &slot)) {
+    entry = cwk_pathmap_get_entry(map, cwk_pathmap_get_slots(map)[slot]);
+    entry->value = value;
+    return true;
+  }
+
+  // We don't fill more than seven eighths of the slots, so there is always an
+  // empty slot which ends the probing.
+  if (slot == map->slot_count || map->count >= map->slot_count / 8 * 7) {
+    return false;
+  }
+
+  // The normalized path is measured first, so we know whether the entry fits
+  // into the rest of the buffer. We reserve two more characters for the rare
+  // case handled below.
+  length = cwk_path_normalize(path, NULL, 0);
+  size = (sizeof(*entry) + length + 3 + 7) & ~(size_t)7;
+  if (map->size - map->used < size) {
+    return false;
+  }
+
+  entry = cwk_pathmap_get_entry(map, map->used);
+  key = (char *)(entry + 1);
+  cwk_path_normalize(path, key, length + 1);
+
+  // On windows, a relative path which loses its first segments might start
+  // with something that looks like a drive afterwards, like ".\\C:" which
+  // becomes "C:". The key must have the same root as the path, otherwise it
+  // isn't equal to the path anymore. So we keep a "." segment in front of it.
+  cwk_path_get_root(path, &root_length);
+  cwk_path_get_root(key, &key_root_length);
+  if (root_length != key_root_length) {
+    memmove(key + 2, key, length + 1);
+    cwk_path_output_current(key, 1, 0);
+    cwk_path_output_separator(key, 2, 1);
+    length += 2;
+  }
+
+  entry->hash = lookup.hash;
+  entry->value = value;
+  entry->length = length;
+
+  cwk_pathmap_get_slots(map)[slot] = map->used;
+  cwk_pathmap_get_control(map)[slot] = (unsigned char)(lookup.hash & 0x7f);
+  map->used += size;
+  ++map->count;
+
+  return true;
+}
+
+bool cwk_pathmap_find(const struct cwk_pathmap *map, const char *path,
+  size_t *value)
+{
+  size_t slot;
+  struct cwk_pathmap_lookup lookup;
+
+  cwk_pathmap_prepare(&lookup, path);
+  if (!cwk_pathmap_find_slot(map, &lookup, &slot)) {
+    return false;
+  }
+
+  *value = cwk_pathmap_get_entry(map, cwk_pathmap_get_slots(map)[slot])->value;
+  return true;
+}
+
+size_t cwk_pathmap_get_count(const struct cwk_pathmap *map)
+{
+  return map->count;
+}
+
+#ifdef CWK_FILESYSTEM
+/**
+ * The cache of resolved paths is stored at the beginning of the buffer of the
+ * caller. It is followed by the slots of an open addressing hash table, and
+ * the entries which are referenced by the slots. Entries are never removed or
+ * modified once they are published in a slot, so multiple threads can look up
+ * and insert entries without any locks.
+ */
+struct cwk_resolve_cache
+{
+  atomic_size_t used;
+  atomic_size_t count;
+  size_t size;
+  size_t slot_count;
+  size_t entries;
+};
+
+/**
+ * An entry of the cache, which is followed by the resolved path and the target
+ * of the symbolic link. Both are null-terminated.
+ */
+struct cwk_resolve_entry
+{
+  uint64_t hash;
+  uint32_t type;
+  uint32_t length;
+  uint32_t target_length;
+};
+
+enum cwk_resolve_type
+{
+  CWK_RESOLVE_MISSING,
+  CWK_RESOLVE_DIRECTORY,
+  CWK_RESOLVE_LINK,
+  CWK_RESOLVE_OTHER
+};
+
+/**
+ * The maximum number of symbolic links which are followed while a single path
+ * is resolved, which is the same limit linux uses.
+ */
+#define CWK_RESOLVE_MAX_LINKS 40
+
+static atomic_size_t *cwk_resolve_cache_get_slots(
+  struct cwk_resolve_cache *cache)
+{
+  return (atomic_size_t *)(cache + 1);
+}
+
+static const struct cwk_resolve_entry *cwk_resolve_cache_find(
+  struct cwk_resolve_cache *cache, uint64_t hash, const char *path,
+  size_t length)
+{
+  size_t i, offset;
+  atomic_size_t *slots;
+  const struct cwk_resolve_entry *entry;
+
+  // The slots are probed until we find an empty one. The acquire ordering
+  // makes sure we see the entry which has been written before it was
+  // published in the slot.
+  slots = cwk_resolve_cache_get_slots(cache);
+  for (i = 0; i < cache->slot_count; ++i) {
+    offset = atomic_load_explicit(
+      &slots[(hash + i) & (cache->slot_count - 1)], memory_order_acquire);
+    if (offset == 0) {
+      break;
+    }
+
+    entry = (const struct cwk_resolve_entry *)((const char *)cache + offset);
+    if (entry->hash == hash && entry->length == length &&
+        memcmp(entry + 1, path, length) == 0) {
+      return entry;
+    }
+  }
+
+  return NULL;
+}
+
+static void cwk_resolve_cache_insert(struct cwk_resolve_cache *cache,
+  uint64_t hash, const char *path, size_t length, enum cwk_resolve_type type,
+  const char *target, size_t target_length)
+{
+  size_t i, size, offset, expected;
+  atomic_size_t *slots;
+  struct cwk_resolve_entry *entry;
+  const struct cwk_resolve_entry *other;
+
+  // We don't fill the table completely, so that probing stays short. Two
+  // threads might both pass this check, which is why the limit is not exact.
+  if (atomic_load_explicit(&cache->count, memory_order_relaxed) >=
+      cache->slot_count / 4 * 3) {
+    return;
+  }
+
+  // The space for the entry is reserved first, so no other thread writes to
+  // it. If another thread inserts the same path at the same time, the space is
+  // simply wasted.
+  size = (sizeof(*entry) + length + target_length + 2 + 7) & ~(size_t)7;
+  offset = atomic_fetch_add_explicit(&cache->used, size, memory_order_relaxed);
+  if (offset > cache->size || cache->size - offset < size) {
+    return;
+  }
+
+  entry = (struct cwk_resolve_entry *)((char *)cache + offset);
+  entry->hash = hash;
+  entry->type = (uint32_t)type;
+  entry->length = (uint32_t)length;
+  entry->target_length = (uint32_t)target_length;
+  memcpy(entry + 1, path, length);
+  ((char *)(entry + 1))[length] = '\0';
+  memcpy((char *)(entry + 1) + length + 1, target, target_length);
+  ((char *)(entry + 1))[length + 1 + target_length] = '\0';
+
+  // Now the entry is published in the first empty slot. If a slot is taken
+  // by the same path in the meantime, we can stop.
+  slots = cwk_resolve_cache_get_slots(cache);
+  for (i = 0; i < cache->slot_count; ++i) {
+    expected = 0;
+    if (atomic_compare_exchange_strong_explicit(
+          &slots[(hash + i) & (cache->slot_count - 1)], &expected, offset,
+          memory_order_release, memory_order_acquire)) {
+      atomic_fetch_add_explicit(&cache->count, 1, memory_order_relaxed);
+      return;
+    }
+
+    other = (const struct cwk_resolve_entry *)((const char *)cache + expected);
+    if (other->hash == hash && other->length == length &&
+        memcmp(other + 1, path, length) == 0) {
+      return;
+    }
+  }
+}
+
+static enum cwk_resolve_type cwk_path_resolve_lookup(
+  struct cwk_resolve_cache *cache, const char *path, size_t length,
+  char *target, size_t *target_length)
+{
+  uint64_t hash;
+  ssize_t size;
+  struct stat info;
+  const struct cwk_resolve_entry *entry;
+
+  hash = 0;
+
+  // We first check whether this path has been looked up before. Only
+  // directories and links are cached, since there are usually a lot more
+  // files than directories and a file is only the last segment of a path.
+  if (cache) {
+    hash = cwk_path_hash_string(0xcbf29ce484222325, path, length);
+    entry = cwk_resolve_cache_find(cache, hash, path, length);
+    if (entry) {
+      *target_length = entry->target_length;
+      memcpy(target, (const char *)(entry + 1) + length + 1,
+        entry->target_length + 1);
+      return (enum cwk_resolve_type)entry->type;
+    }
+  }
+
+  if (lstat(path, &info) != 0) {
+    return CWK_RESOLVE_MISSING;
+  }
+
+  *target_length = 0;
+  target[0] = '\0';
+  if (S_ISDIR(info.st_mode)) {
+    if (cache) {
+      cwk_resolve_cache_insert(cache, hash, path, length,
+        CWK_RESOLVE_DIRECTORY, target, 0);
+    }
+    return CWK_RESOLVE_DIRECTORY;
+  } else if (!S_ISLNK(info.st_mode)) {
+    return CWK_RESOLVE_OTHER;
+  }
+
+  // The target of the link is not terminated by readlink, and we can't tell
+  // whether it has been truncated if it fills the whole buffer.
+  size = readlink(path, target, PATH_MAX);
+  if (size < 0) {
+    return CWK_RESOLVE_MISSING;
+  } else if (size == 0 || size >= PATH_MAX) {
+    errno = size == 0 ? ENOENT : ENAMETOOLONG;
+    return CWK_RESOLVE_MISSING;
+  }
+
+  target[size] = '\0';
+  *target_length = (size_t)size;
+  if (cache) {
+    cwk_resolve_cache_insert(cache, hash, path, length, CWK_RESOLVE_LINK,
+      target, *target_length);
+  }
+
+  return CWK_RESOLVE_LINK;
+}
+
+struct cwk_resolve_cache *cwk_resolve_cache_init(void *buffer,
+  size_t buffer_size)
+{
+  size_t slot_count;
+  struct cwk_resolve_cache *cache;
+
+  // We use one slot for every 64 bytes of the buffer, which is a bit less than
+  // an average entry needs. The number of slots must be a power of two.
+  if (buffer_size < sizeof(*cache) + 1024) {
+    return NULL;
+  }
+
+  slot_count = 1;
+  while (slot_count * 2 <= (buffer_size - sizeof(*cache)) / 64) {
+    slot_count *= 2;
+  }
+
+  cache = buffer;
+  cache->size = buffer_size;
+  cache->slot_count = slot_count;
+  cache->entries = sizeof(*cache) + slot_count * sizeof(atomic_size_t);
+  atomic_init(&cache->used, cache->entries);
+  atomic_init(&cache->count, 0);
+  memset(cwk_resolve_cache_get_slots(cache), 0,
+    slot_count * sizeof(atomic_size_t));
+
+  return cache;
+}
+
+size_t cwk_resolve_cache_get_count(const struct cwk_resolve_cache *cache)
+{
+  return atomic_load_explicit(&((struct cwk_resolve_cache *)cache)->count,
+    memory_order_relaxed);
+}
+
+size_t cwk_path_resolve(const char *path, struct cwk_resolve_cache *cache,
+  char *buffer, size_t buffer_size)
+{
+  bool more;
+  int links;
+  size_t length, next_length, target_length, rest_length;
+  char *pending;
+  char resolved[PATH_MAX], target[PATH_MAX], remaining[2][PATH_MAX];
+  struct cwk_segment segment;
+  enum cwk_resolve_type type;
+
+  if (path_style != CWK_STYLE_UNIX) {
+    errno = EINVAL;
+    return 0;
+  } else if (*path == '\0') {
+    errno = ENOENT;
+    return 0;
+  }
+
+  // Relative paths are resolved from the current working directory, which is
+  // always canonical already. The resolved part never contains any links, so
+  // a back segment can simply remove the last segment of it.
+  if (cwk_path_is_absolute(path)) {
+    strcpy(resolved, "/");
+    length = 1;
+  } else if (getcwd(resolved, sizeof(resolved)) != NULL) {
+    length = strlen(resolved);
+  } else {
+    return 0;
+  }
+
+  links = 0;
+  pending = remaining[0];
+  more = cwk_path_get_first_segment(path, &segment);
+  while (more) {
+    type = CWK_RESOLVE_DIRECTORY;
+    switch (cwk_path_get_segment_type(&segment)) {
+    case CWK_CURRENT:
+      break;
+    case CWK_BACK:
+      while (length > 1 && resolved[length - 1] != '/') {
+        --length;
+      }
+      if (length > 1) {
+        --length;
+      }
+      resolved[length] = '\0';
+      break;
+    case CWK_NORMAL:
+      next_length = length + (length > 1) + segment.size;
+      if (next_length >= PATH_MAX) {
+        errno = ENAMETOOLONG;
+        return 0;
+      }
+
+      if (length > 1) {
+        resolved[length] = '/';
+      }
+      memcpy(&resolved[next_length - segment.size], segment.begin,
+        segment.size);
+      resolved[next_length] = '\0';
+
+      type = cwk_path_resolve_lookup(cache, resolved, next_length, target,
+        &target_length);
+      if (type == CWK_RESOLVE_MISSING) {
+        return 0;
+      } else if (type == CWK_RESOLVE_OTHER && *segment.end != '\0') {
+        // Only the last segment may be something else than a directory, and
+        // there must not be a trailing separator after it.
+        errno = ENOTDIR;
+        return 0;
+      } else if (type != CWK_RESOLVE_LINK) {
+        length = next_length;
+      } else {
+        resolved[length] = '\0';
+      }
+      break;
+    }
+
+    if (type != CWK_RESOLVE_LINK) {
+      more = cwk_path_get_next_segment(&segment);
+      continue;
+    }
+
+    // This is a symbolic link, so the target replaces the segment and we start
+    // over with the new remaining path. The rest of the old path might be
+    // stored in the pending buffer, which is why we alternate between two
+    // buffers.
+    if (++links > CWK_RESOLVE_MAX_LINKS) {
+      errno = ELOOP;
+      return 0;
+    }
+
+    rest_length = strlen(segment.end);
+    if (target_length + rest_length >= PATH_MAX) {
+      errno = ENAMETOOLONG;
+      return 0;
+    }
+
+    pending = pending == remaining[0] ? remaining[1] : remaining[0];
+    memcpy(pending, target, target_length);
+    memcpy(pending + target_length, segment.end, rest_length + 1);
+    if (cwk_path_is_absolute(pending)) {
+      strcpy(resolved, "/");
+      length = 1;
+    }
+
+    more = cwk_path_get_first_segment(pending, &segment);
+  }
+
+  cwk_path_output_sized(buffer, buffer_size, 0, resolved, length);
+  cwk_path_terminate_output(buffer, buffer_size, length);
+
+  return length;
+}
+
+/**
+ * The cache of open directories is stored at the beginning of the buffer of
+ * the caller, followed by the buckets of a hash table and the entries. Just
+ * like the dentries of the kernel, an entry is identified by its parent entry
+ * and its name, so a directory needs the same amount of memory no matter how
+ * deep it is. The entries which are in use are kept in a list, which is
+ * ordered by the time they have been used last. The cache also remembers the
+ * parent directory of the previous path as it was written, since consecutive
+ * paths often share the same parent and don't have to be walked at all.
+ */
+struct cwk_dircache
+{
+  size_t capacity;
+  size_t count;
+  size_t bucket_count;
+  size_t previous_length;
+  uint32_t previous;
+  uint32_t previous_generation;
+  uint32_t head;
+  uint32_t tail;
+  int root;
+  char previous_path[1024];
+};
+
+struct cwk_dircache_entry
+{
+  uint64_t hash;
+  uint32_t parent;
+  uint32_t parent_generation;
+  uint32_t generation;
+  uint32_t previous;
+  uint32_t next;
+  uint32_t chain;
+  int fd;
+  unsigned char length;
+  char name[255];
+};
+
+/**
+ * These are the parents of the top entries, which are not stored in the cache
+ * themselves. They are also used to terminate the lists.
+ */
+#define CWK_DIRCACHE_NONE UINT32_MAX
+#define CWK_DIRCACHE_ROOT (UINT32_MAX - 1)
+#define CWK_DIRCACHE_CWD (UINT32_MAX - 2)
+
+/**
+ * The directories are opened with O_PATH if possible, since they are only used
+ * to look up other files and don't have to be readable for that.
+ */
+#ifdef O_PATH
+#define CWK_DIRCACHE_FLAGS (O_PATH | O_DIRECTORY | O_CLOEXEC)
+#else
+#define CWK_DIRCACHE_FLAGS (O_RDONLY | O_DIRECTORY | O_CLOEXEC)
+#endif
+
+static uint32_t *cwk_dircache_get_buckets(struct cwk_dircache *cache)
+{
+  return (uint32_t *)(cache + 1);
+}
+
+static struct cwk_dircache_entry *cwk_dircache_get_entries(
+  struct cwk_dircache *cache)
+{
+  size_t offset;
+
+  // The entries start at the next multiple of eight after the buckets.
+  offset = (cache->bucket_count * sizeof(uint32_t) + 7) & ~(size_t)7;
+  return (struct cwk_dircache_entry *)((char *)(cache + 1) + offset);
+}
+
+static void cwk_dircache_unlink(struct cwk_dircache *cache,
+  struct cwk_dircache_entry *entries, uint32_t index)
+{
+  struct cwk_dircache_entry *entry;
+
+  entry = &entries[index];
+  if (entry->previous != CWK_DIRCACHE_NONE) {
+    entries[entry->previous].next = entry->next;
+  } else {
+    cache->head = entry->next;
+  }
+
+  if (entry->next != CWK_DIRCACHE_NONE) {
+    entries[entry->next].previous = entry->previous;
+  } else {
+    cache->tail = entry->previous;
+  }
+}
+
+static void cwk_dircache_link(struct cwk_dircache *cache,
+  struct cwk_dircache_entry *entries, uint32_t index)
+{
+  // The entry becomes the most recently used one at the head of the list.
+  entries[index].previous = CWK_DIRCACHE_NONE;
+  entries[index].next = cache->head;
+  if (cache->head != CWK_DIRCACHE_NONE) {
+    entries[cache->head].previous = index;
+  } else {
+    cache->tail = index;
+  }
+  cache->head = index;
+}
+
+static uint32_t cwk_dircache_evict(struct cwk_dircache *cache,
+  struct cwk_dircache_entry *entries)
+{
+  uint32_t index, *link;
+  struct cwk_dircache_entry *entry;
+
+  // While the cache is not full yet, we simply take the next unused entry. Its
+  // memory comes straight from the buffer of the caller, so the generation
+  // has to be initialized before it is handed to the children.
+  if (cache->count < cache->capacity) {
+    entries[cache->count].generation = 0;
+    return (uint32_t)cache->count++;
+  }
+
+  // Otherwise the least recently used entry is removed from the list and from
+  // its bucket. Its generation changes, so the entries below it can't be found
+  // anymore and will be evicted eventually as well.
+  index = cache->tail;
+  entry = &entries[index];
+  cwk_dircache_unlink(cache, entries, index);
+  link = cwk_dircache_get_buckets(cache);
+  link += entry->hash & (cache->bucket_count - 1);
+  while (*link != index) {
+    link = &entries[*link].chain;
+  }
+  *link = entry->chain;
+  close(entry->fd);
+  ++entry->generation;
+
+  return index;
+}
+
+static int cwk_dircache_get_child(struct cwk_dircache *cache, uint32_t *parent,
+  uint32_t *generation, int fd, const char *name, size_t size)
+{
+  int child;
+  char buffer[256];
+  uint32_t index, *bucket;
+  uint64_t hash;
+  struct cwk_dircache_entry *entries, *entry;
+
+  if (size > sizeof(entry->name)) {
+    errno = ENAMETOOLONG;
+    return -1;
+  }
+
+  // The hash contains the parent as well, so the same name in another
+  // directory ends up somewhere else.
+  hash = ((uint64_t)*parent << 32 | *generation) * 0x100000001b3;
+  hash = cwk_path_hash_string(hash ^ 0xcbf29ce484222325, name, size);
+  entries = cwk_dircache_get_entries(cache);
+  bucket = &cwk_dircache_get_buckets(cache)[hash & (cache->bucket_count - 1)];
+  for (index = *bucket; index != CWK_DIRCACHE_NONE;
+       index = entries[index].chain) {
+    entry = &entries[index];
+    if (entry->hash == hash && entry->parent == *parent &&
+        entry->parent_generation == *generation && entry->length == size &&
+        memcmp(entry->name, name, size) == 0) {
+      cwk_dircache_unlink(cache, entries, index);
+      cwk_dircache_link(cache, entries, index);
+      *parent = index;
+      *generation = entry->generation;
+      return entry->fd;
+    }
+  }
+
+  // The directory is not cached yet, so we open it relative to its parent. The
+  // parent is the most recently used entry, so it is never the one which is
+  // evicted to make room for the new directory.
+  memcpy(buffer, name, size);
+  buffer[size] = '\0';
+  child = openat(fd, buffer, CWK_DIRCACHE_FLAGS);
+  if (child < 0) {
+    return -1;
+  }
+
+  index = cwk_dircache_evict(cache, entries);
+  entry = &entries[index];
+  entry->hash = hash;
+  entry->parent = *parent;
+  entry->parent_generation = *generation;
+  entry->fd = child;
+  entry->length = (unsigned char)size;
+  memcpy(entry->name, name, size);
+  entry->chain = *bucket;
+  *bucket = index;
+  cwk_dircache_link(cache, entries, index);
+
+  *parent = index;
+  *generation = entry->generation;
+  return child;
+}
+
+static int cwk_dircache_get_parent(struct cwk_dircache *cache,
+  const char *path, const char **name)
+{
+  int fd;
+  size_t root_length, length;
+  uint32_t parent, generation;
+  struct cwk_segment segment, last;
+  struct cwk_dircache_entry *entries;
+
+  if (path_style != CWK_STYLE_UNIX) {
+    errno = EINVAL;
+    return -1;
+  } else if (*path == '\0') {
+    errno = ENOENT;
+    return -1;
+  }
+
+  // If the path is written with the same parent as the previous one, we can
+  // take the parent directly, as long as it hasn't been evicted in between.
+  if (cwk_path_get_last_segment(path, &last)) {
+    length = (size_t)(last.begin - path);
+    if (length > 0 && length == cache->previous_length &&
+        memcmp(path, cache->previous_path, length) == 0) {
+      *name = last.begin;
+      if (cache->previous == CWK_DIRCACHE_ROOT) {
+        return cache->root;
+      }
+
+      entries = cwk_dircache_get_entries(cache);
+      if (entries[cache->previous].generation == cache->previous_generation) {
+        cwk_dircache_unlink(cache, entries, cache->previous);
+        cwk_dircache_link(cache, entries, cache->previous);
+        return entries[cache->previous].fd;
+      }
+    }
+  }
+
+  // Absolute paths start at the root directory, which is opened once and kept
+  // open until the cache is cleared. Relative paths start at the current
+  // working directory.
+  cwk_path_get_root(path, &root_length);
+  if (root_length > 0) {
+    if (cache->root < 0) {
+      cache->root = open("/", CWK_DIRCACHE_FLAGS);
+      if (cache->root < 0) {
+        return -1;
+      }
+    }
+    fd = cache->root;
+    parent = CWK_DIRCACHE_ROOT;
+  } else {
+    fd = AT_FDCWD;
+    parent = CWK_DIRCACHE_CWD;
+  }
+
+  generation = 0;
+  if (!cwk_path_get_first_segment(path, &segment)) {
+    *name = ".";
+    return fd;
+  }
+
+  // Every segment except the last one is a directory, which is taken from the
+  // cache. The last segment is passed to the kernel together with the trailing
+  // separators, so they are checked the same way open checks them.
+  last = segment;
+  while (cwk_path_get_next_segment(&segment)) {
+    if (cwk_path_get_segment_type(&last) != CWK_CURRENT) {
+      fd = cwk_dircache_get_child(cache, &parent, &generation, fd, last.begin,
+        last.size);
+      if (fd < 0) {
+        return -1;
+      }
+    }
+    last = segment;
+  }
+
+  // The parent is remembered for the next path. Relative paths which only
+  // consist of a single segment are cheap anyway, since there is nothing to
+  // walk.
+  length = (size_t)(last.begin - path);
+  cache->previous_length = 0;
+  if (length > 0 && length <= sizeof(cache->previous_path) &&
+      parent != CWK_DIRCACHE_CWD) {
+    memcpy(cache->previous_path, path, length);
+    cache->previous_length = length;
+    cache->previous = parent;
+    cache->previous_generation = generation;
+  }
+
+  *name = last.begin;
+  return fd;
+}
+
+struct cwk_dircache *cwk_dircache_init(void *buffer, size_t buffer_size)
+{
+  size_t i, capacity, bucket_count, buckets_size;
+  uint32_t *buckets;
+  struct cwk_dircache *cache;
+
+  if (buffer_size < sizeof(*cache)) {
+    return NULL;
+  }
+
+  // We use about one bucket for every entry, and the number of buckets must be
+  // a power of two.
+  capacity = (buffer_size - sizeof(*cache)) /
+             (sizeof(struct cwk_dircache_entry) + sizeof(uint32_t));
+  bucket_count = 1;
+  while (bucket_count * 2 <= capacity) {
+    bucket_count *= 2;
+  }
+
+  buckets_size = (bucket_count * sizeof(uint32_t) + 7) & ~(size_t)7;
+  if (buffer_size - sizeof(*cache) < buckets_size) {
+    return NULL;
+  }
+
+  capacity = (buffer_size - sizeof(*cache) - buckets_size) /
+             sizeof(struct cwk_dircache_entry);
+  if (capacity < 8) {
+    return NULL;
+  } else if (capacity > CWK_DIRCACHE_CWD) {
+    capacity = CWK_DIRCACHE_CWD;
+  }
+
+  cache = buffer;
+  cache->capacity = capacity;
+  cache->count = 0;
+  cache->bucket_count = bucket_count;
+  cache->previous_length = 0;
+  cache->head = CWK_DIRCACHE_NONE;
+  cache->tail = CWK_DIRCACHE_NONE;
+  cache->root = -1;
+  buckets = cwk_dircache_get_buckets(cache);
+  for (i = 0; i < bucket_count; ++i) {
+    buckets[i] = CWK_DIRCACHE_NONE;
+  }
+
+  return cache;
+}
+
+void cwk_dircache_clear(struct cwk_dircache *cache)
+{
+  size_t i;
+  uint32_t *buckets;
+  struct cwk_dircache_entry *entries;
+
+  entries = cwk_dircache_get_entries(cache);
+  for (i = 0; i < cache->count; ++i) {
+    close(entries[i].fd);
+  }
+
+  if (cache->root >= 0) {
+    close(cache->root);
+  }
+
+  cache->count = 0;
+  cache->previous_length = 0;
+  cache->head = CWK_DIRCACHE_NONE;
+  cache->tail = CWK_DIRCACHE_NONE;
+  cache->root = -1;
+  buckets = cwk_dircache_get_buckets(cache);
+  for (i = 0; i < cache->bucket_count; ++i) {
+    buckets[i] = CWK_DIRCACHE_NONE;
+  }
+}
+
+size_t cwk_dircache_get_count(const struct cwk_dircache *cache)
+{
+  return cache->count;
+}
+
+int cwk_dircache_open(struct cwk_dircache *cache, const char *path, int flags,
+  mode_t mode)
+{
+  int fd;
+  const char *name;
+
+  fd = cwk_dircache_get_parent(cache, path, &name);
+  if (fd < 0 && fd != AT_FDCWD) {
+    return -1;
+  }
+
+  return openat(fd, name, flags, mode);
+}
+
+int cwk_dircache_stat(struct cwk_dircache *cache, const char *path,
+  struct stat *info, int flags)
+{
+  int fd;
+  const char *name;
+
+  fd = cwk_dircache_get_parent(cache, path, &name);
+  if (fd < 0 && fd != AT_FDCWD) {
+    return -1;
+  }
+
+  return fstatat(fd, name, info, flags);
+}
+
+size_t cwk_dircache_stat_batch(struct cwk_dircache *cache, const char **paths,
+  size_t count, struct stat *infos, int *errors, int flags)
+{
+  size_t i, result;
+
+  // After sorting, all files of a directory are next to each other and the
+  // directories of a tree follow each other in depth first order. So the
+  // parent directory of a file is usually the most recently used entry of the
+  // cache, and the cache only has to be as large as the depth of the tree.
+  cwk_path_sort(paths, count);
+
+  result = 0;
+  for (i = 0; i < count; ++i) {
+    if (cwk_dircache_stat(cache, paths[i], &infos[i], flags) == 0) {
+      errors[i] = 0;
+      ++result;
+    } else {
+      errors[i] = errno;
+    }
+  }
+
+  return result;
+}
+
+/**
+ * The number of paths a thread takes at once, so that neighbouring paths of
+ * the sorted array are inspected by the same thread.
+ */
+#define CWK_STAT_CHUNK 64
+#define CWK_STAT_MAX_THREADS 64
+#define CWK_STAT_MAX_DEPTH 4096
+
+struct cwk_stat_job
+{
+  const char **paths;
+  size_t count;
+  int flags;
+  struct cwk_stat_results *results;
+  atomic_size_t next;
+  atomic_size_t success;
+};
+
+static void cwk_stat_store(struct cwk_stat_results *results, size_t index,
+  uint32_t mode, uint64_t size, uint64_t inode, int64_t seconds,
+  int64_t nanoseconds)
+{
+  if (results->errors) {
+    results->errors[index] = 0;
+  }
+
+  if (results->modes) {
+    results->modes[index] = mode;
+  }
+
+  if (results->sizes) {
+    results->sizes[index] = size;
+  }
+
+  if (results->inodes) {
+    results->inodes[index] = inode;
+  }
+
+  if (results->mtimes) {
+    results->mtimes[index] = seconds * 1000000000 + nanoseconds;
+  }
+}
+
+static void cwk_stat_fail(struct cwk_stat_results *results, size_t index,
+  int error)
+{
+  if (results->errors) {
+    results->errors[index] = error;
+  }
+}
+
+static void *cwk_stat_work(void *argument)
+{
+  size_t i, begin, end, success;
+  struct stat info;
+  struct cwk_stat_job *job;
+
+  // Every thread takes the next chunk of paths until all paths are taken. The
+  // successful ones are only counted once per chunk to keep the contention low.
+  job = argument;
+  for (;;) {
+    begin = atomic_fetch_add_explicit(&job->next, CWK_STAT_CHUNK,
+      memory_order_relaxed);
+    if (begin >= job->count) {
+      return NULL;
+    }
+
+    end = begin + CWK_STAT_CHUNK < job->count ? begin + CWK_STAT_CHUNK
+                                              : job->count;
+    success = 0;
+    for (i = begin; i < end; ++i) {
+      if (fstatat(AT_FDCWD, job->paths[i], &info, job->flags) != 0) {
+        cwk_stat_fail(job->results, i, errno);
+        continue;
+      }
+
+#ifdef __APPLE__
+      cwk_stat_store(job->results, i, (uint32_t)info.st_mode,
+        (uint64_t)info.st_size, (uint64_t)info.st_ino,
+        (int64_t)info.st_mtimespec.tv_sec, (int64_t)info.st_mtimespec.tv_nsec);
+#else
+      cwk_stat_store(job->results, i, (uint32_t)info.st_mode,
+        (uint64_t)info.st_size, (uint64_t)info.st_ino,
+        (int64_t)info.st_mtim.tv_sec, (int64_t)info.st_mtim.tv_nsec);
+#endif
+      ++success;
+    }
+
+    atomic_fetch_add_explicit(&job->success, success, memory_order_relaxed);
+  }
+}
+
+static size_t cwk_stat_batch_threads(const char **paths, size_t count,
+  struct cwk_stat_results *results, size_t queue_depth, int flags)
+{
+  size_t i, thread_count;
+  pthread_t threads[CWK_STAT_MAX_THREADS];
+  struct cwk_stat_job job;
+
+  job.paths = paths;
+  job.count = count;
+  job.flags = flags;
+  job.results = results;
+  atomic_init(&job.next, 0);
+  atomic_init(&job.success, 0);
+
+  // Every thread keeps one request in flight, and the calling thread is one of
+  // them. There is no point in having more threads than chunks.
+  thread_count = (count + CWK_STAT_CHUNK - 1) / CWK_STAT_CHUNK;
+  if (thread_count > queue_depth) {
+    thread_count = queue_depth;
+  }
+  if (thread_count > CWK_STAT_MAX_THREADS) {
+    thread_count = CWK_STAT_MAX_THREADS;
+  }
+
+  // If a thread can't be created, the remaining threads simply take more of
+  // the work.
+  for (i = 1; i < thread_count; ++i) {
+    if (pthread_create(&threads[i], NULL, cwk_stat_work, &job) != 0) {
+      break;
+    }
+  }
+
+  thread_count = i;
+  cwk_stat_work(&job);
+  for (i = 1; i < thread_count; ++i) {
+    pthread_join(threads[i], NULL);
+  }
+
+  return atomic_load_explicit(&job.success, memory_order_relaxed);
+}
+
+#ifdef CWK_IO_URING
+/**
+ * The rings which are shared with the kernel. The submission queue entries
+ * are used in the same order as the ring, so the array of the submission ring
+ * simply maps every position to the entry with the same index.
+ */
+struct cwk_uring
+{
+  int fd;
+  unsigned int entries;
+  void *sq_ring;
+  void *cq_ring;
+  struct io_uring_sqe *sqes;
+  size_t sq_ring_size;
+  size_t cq_ring_size;
+  atomic_uint *sq_tail;
+  unsigned int sq_mask;
+  atomic_uint *cq_head;
+  atomic_uint *cq_tail;
+  unsigned int cq_mask;
+  struct io_uring_cqe *cqes;
+};
+
+static void cwk_uring_exit(struct cwk_uring *ring)
+{
+  if (ring->sqes != MAP_FAILED) {
+    munmap(ring->sqes, ring->entries * sizeof(struct io_uring_sqe));
+  }
+
+  if (ring->cq_ring != MAP_FAILED) {
+    munmap(ring->cq_ring, ring->cq_ring_size);
+  }
+
+  if (ring->sq_ring != MAP_FAILED) {
+    munmap(ring->sq_ring, ring->sq_ring_size);
+  }
+
+  close(ring->fd);
+}
+
+static bool cwk_uring_is_supported(int fd)
+{
+  bool result;
+  struct io_uring_probe *probe;
+  char buffer[sizeof(*probe) + 256 * sizeof(struct io_uring_probe_op)];
+
+  // Old kernels might support io_uring, but not statx operations, so we have
+  // to ask the kernel first.
+  memset(buffer, 0, sizeof(buffer));
+  probe = (struct io_uring_probe *)buffer;
+  if (syscall(__NR_io_uring_register, fd, IORING_REGISTER_PROBE, probe, 256) <
+        0 ||
+      probe->last_op < IORING_OP_STATX) {
+    return false;
+  }
+
+  result = (probe->ops[IORING_OP_STATX].flags & IO_URING_OP_SUPPORTED) != 0;
+  return result;
+}
+
+static bool cwk_uring_init(struct cwk_uring *ring, unsigned int entries)
+{
+  unsigned int *array, i;
+  struct io_uring_params params;
+
+  memset(&params, 0, sizeof(params));
+  ring->sq_ring = MAP_FAILED;
+  ring->cq_ring = MAP_FAILED;
+  ring->sqes = MAP_FAILED;
+  ring->fd = (int)syscall(__NR_io_uring_setup, entries, &params);
+  if (ring->fd < 0) {
+    return false;
+  }
+
+  // The kernel might round up the number of entries, so we use what it tells
+  // us. Both rings are mapped on their own, which works on all kernels.
+  ring->entries = params.sq_entries;
+  ring->sq_ring_size = params.sq_off.array +
+                       params.sq_entries * sizeof(unsigned int);
+  ring->cq_ring_size = params.cq_off.cqes +
+                       params.cq_entries * sizeof(struct io_uring_cqe);
+  ring->sq_ring = mmap(NULL, ring->sq_ring_size, PROT_READ | PROT_WRITE,
+    MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_SQ_RING);
+  ring->cq_ring = mmap(NULL, ring->cq_ring_size, PROT_READ | PROT_WRITE,
+    MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_CQ_RING);
+  ring->sqes = mmap(NULL, params.sq_entries * sizeof(struct io_uring_sqe),
+    PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring->fd,
+    IORING_OFF_SQES);
+  if (ring->sq_ring == MAP_FAILED || ring->cq_ring == MAP_FAILED ||
+      ring->sqes == MAP_FAILED || !cwk_uring_is_supported(ring->fd)) {
+    cwk_uring_exit(ring);
+    return false;
+  }
+
+  ring->sq_tail = (atomic_uint *)((char *)ring->sq_ring + params.sq_off.tail);
+  ring->sq_mask = *(unsigned int *)((char *)ring->sq_ring +
+                                    params.sq_off.ring_mask);
+  ring->cq_head = (atomic_uint *)((char *)ring->cq_ring + params.cq_off.head);
+  ring->cq_tail = (atomic_uint *)((char *)ring->cq_ring + params.cq_off.tail);
+  ring->cq_mask = *(unsigned int *)((char *)ring->cq_ring +
+                                    params.cq_off.ring_mask);
+  ring->cqes = (struct io_uring_cqe *)((char *)ring->cq_ring +
+                                       params.cq_off.cqes);
+  array = (unsigned int *)((char *)ring->sq_ring + params.sq_off.array);
+  for (i = 0; i < params.sq_entries; ++i) {
+    array[i] = i;
+  }
+
+  return true;
+}
+
+static unsigned int cwk_stat_reap(struct cwk_uring *ring,
+  struct cwk_stat_results *results, const struct statx *buffers,
+  const size_t *slot_paths, unsigned int *free_slots,
+  unsigned int *free_count, size_t *success)
+{
+  unsigned int head, slot, reaped;
+  size_t index;
+  struct io_uring_cqe *cqe;
+
+  // Every completion hands its slot back to the stack of free slots, after its
+  // result has been copied out of the statx buffer.
+  reaped = 0;
+  head = atomic_load_explicit(ring->cq_head, memory_order_relaxed);
+  while (head != atomic_load_explicit(ring->cq_tail, memory_order_acquire)) {
+    cqe = &ring->cqes[head & ring->cq_mask];
+    slot = (unsigned int)cqe->user_data;
+    index = slot_paths[slot];
+    if (cqe->res < 0) {
+      cwk_stat_fail(results, index, -cqe->res);
+    } else {
+      cwk_stat_store(results, index, buffers[slot].stx_mode,
+        buffers[slot].stx_size, buffers[slot].stx_ino,
+        buffers[slot].stx_mtime.tv_sec, buffers[slot].stx_mtime.tv_nsec);
+      ++*success;
+    }
+
+    free_slots[(*free_count)++] = slot;
+    ++reaped;
+    ++head;
+  }
+  atomic_store_explicit(ring->cq_head, head, memory_order_release);
+
+  return reaped;
+}
+
+static bool cwk_stat_batch_uring(const char **paths, size_t count,
+  struct cwk_stat_results *results, size_t queue_depth, int flags,
+  size_t *success)
+{
+  int submitted, error;
+  unsigned int tail, pending, in_flight, slot, free_count;
+  size_t next, done, index;
+  unsigned char in_use[CWK_STAT_MAX_DEPTH];
+  unsigned int *free_slots;
+  size_t *slot_paths;
+  struct statx *buffers;
+  struct io_uring_sqe *sqe;
+  struct cwk_uring ring;
+  struct timespec backoff;
+  size_t memory_size;
+  void *memory;
+
+  if (!cwk_uring_init(&ring, (unsigned int)queue_depth)) {
+    return false;
+  }
+
+  // Every request in flight needs its own statx buffer, which is identified
+  // by a slot. The slots which are not in use are kept on a stack.
+  queue_depth = ring.entries;
+  memory_size = queue_depth * (sizeof(*buffers) + sizeof(*slot_paths) +
+                                sizeof(*free_slots));
+  memory = mmap(NULL, memory_size, PROT_READ | PROT_WRITE,
+    MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  if (memory == MAP_FAILED) {
+    cwk_uring_exit(&ring);
+    return false;
+  }
+
+  buffers = memory;
+  slot_paths = (size_t *)(buffers + queue_depth);
+  free_slots = (unsigned int *)(slot_paths + queue_depth);
+  for (free_count = 0; free_count < queue_depth; ++free_count) {
+    free_slots[free_count] = free_count;
+  }
+
+  next = 0;
+  done = 0;
+  pending = 0;
+  error = 0;
+  *success = 0;
+  backoff.tv_sec = 0;
+  backoff.tv_nsec = 1000;
+  tail = atomic_load_explicit(ring.sq_tail, memory_order_relaxed);
+  while (done < count) {
+    // We fill the submission ring with as many requests as there are free
+    // slots. The paths are sorted, so the requests of a directory are
+    // submitted together.
+    while (next < count && free_count > 0) {
+      slot = free_slots[--free_count];
+      slot_paths[slot] = next;
+      sqe = &ring.sqes[tail & ring.sq_mask];
+      memset(sqe, 0, sizeof(*sqe));
+      sqe->opcode = IORING_OP_STATX;
+      sqe->fd = AT_FDCWD;
+      sqe->addr = (uint64_t)(uintptr_t)paths[next];
+      sqe->len = STATX_BASIC_STATS;
+      sqe->off = (uint64_t)(uintptr_t)&buffers[slot];
+      sqe->statx_flags = (uint32_t)flags;
+      sqe->user_data = slot;
+      ++tail;
+      ++pending;
+      ++next;
+    }
+
+    // The new tail is published to the kernel, which submits the pending
+    // requests and waits for at least one of them to complete.
+    atomic_store_explicit(ring.sq_tail, tail, memory_order_release);
+    in_flight = (unsigned int)queue_depth - free_count - pending;
+    submitted = (int)syscall(__NR_io_uring_enter, ring.fd, pending, 1,
+      IORING_ENTER_GETEVENTS, NULL, 0);
+    if (submitted >= 0) {
+      pending -= (unsigned int)submitted;
+      backoff.tv_nsec = 1000;
+    } else if (errno == EAGAIN || errno == EBUSY) {
+      // The kernel is short on resources. Requests which complete give them
+      // back, so we wait for one if there are any in flight. Otherwise we
+      // back off a little longer every time, so we don't spin on the ring.
+      if (in_flight > 0) {
+        syscall(__NR_io_uring_enter, ring.fd, 0, 1, IORING_ENTER_GETEVENTS,
+          NULL, 0);
+      } else {
+        nanosleep(&backoff, NULL);
+        if (backoff.tv_nsec < 1000000) {
+          backoff.tv_nsec *= 2;
+        }
+      }
+    } else if (errno != EINTR) {
+      error = errno;
+      break;
+    }
+
+    done += cwk_stat_reap(&ring, results, buffers, slot_paths, free_slots,
+      &free_count, success);
+  }
+
+  // If the ring failed, the requests which the kernel accepted are still in
+  // flight and write to their statx buffers, so we have to wait for all of
+  // them before the buffers can be unmapped. If we can't even wait anymore,
+  // the buffers are leaked instead, since the kernel may still write to them.
+  if (done < count) {
+    in_flight = (unsigned int)queue_depth - free_count - pending;
+    while (in_flight > 0) {
+      if (syscall(__NR_io_uring_enter, ring.fd, 0, 1, IORING_ENTER_GETEVENTS,
+            NULL, 0) < 0 &&
+          errno != EINTR && errno != EAGAIN && errno != EBUSY) {
+        memory = MAP_FAILED;
+        break;
+      }
+      in_flight -= cwk_stat_reap(&ring, results, buffers, slot_paths,
+        free_slots, &free_count, success);
+    }
+
+    // All paths which have not been completed get the error of the ring.
+    // Those are the paths which have never been submitted and the ones whose
+    // slots are still in use.
+    for (index = next; index < count; ++index) {
+      cwk_stat_fail(results, index, error);
+    }
+
+    memset(in_use, 1, queue_depth);
+    for (slot = 0; slot < free_count; ++slot) {
+      in_use[free_slots[slot]] = 0;
+    }
+    for (slot = 0; slot < queue_depth; ++slot) {
+      if (in_use[slot]) {
+        cwk_stat_fail(results, slot_paths[slot], error);
+      }
+    }
+  }
+
+  cwk_uring_exit(&ring);
+  if (memory != MAP_FAILED) {
+    munmap(memory, memory_size);
+  }
+
+  return true;
+}
+#endif
+
+size_t cwk_path_stat_batch(const char **paths, size_t count,
+  struct cwk_stat_results *results, size_t queue_depth, int flags,
+  enum cwk_stat_method method)
+{
+  size_t i, success;
+
+  // After sorting, all files of a directory are next to each other, so the
+  // kernel finds the directory in its caches for all of them.
+  cwk_path_sort(paths, count);
+  if (queue_depth == 0) {
+    queue_depth = 1;
+  } else if (queue_depth > CWK_STAT_MAX_DEPTH) {
+    queue_depth = CWK_STAT_MAX_DEPTH;
+  }
+
+#ifdef CWK_IO_URING
+  if (method != CWK_STAT_THREADS &&
+      cwk_stat_batch_uring(paths, count, results, queue_depth, flags,
+        &success)) {
+    return success;
+  }
+#endif
+
+  if (method == CWK_STAT_IO_URING) {
+    for (i = 0; i < count; ++i) {
+      cwk_stat_fail(results, i, ENOSYS);
+    }
+    return 0;
+  }
+
+  return cwk_stat_batch_threads(paths, count, results, queue_depth, flags);
+}
+
+/**
+ * A usage tree is stored at the beginning of the buffer of the caller. It is
+ * followed by the offsets of all entries, which are indexed by the number of
+ * the entry, and the entries themselves. Every entry is followed by the name
+ * of its directory. An entry is always created by the thread which reads the
+ * parent directory, so parents always have a lower index than their children.
+ */
+struct cwk_usage
+{
+  size_t size;
+  size_t slot_count;
+  size_t entries;
+  atomic_size_t count;
+  atomic_size_t used;
+};
+
+struct cwk_usage_entry
+{
+  struct cwk_usage_totals totals;
+  uint32_t parent;
+  uint32_t first_child;
+  uint32_t next_sibling;
+  uint32_t length;
+};
+
+#define CWK_USAGE_NONE UINT32_MAX
+
+/**
+ * The maximum number of directories which are waiting to be read. Every one of
+ * them has an open file descriptor, so only half of the file descriptors the
+ * process may open are used by the scan. Half of those are for the queue, and
+ * the rest is shared by the threads to keep directories open while they read
+ * below them.
+ */
+#define CWK_USAGE_QUEUE 1024
+#define CWK_USAGE_MAX_THREADS 64
+
+struct cwk_usage_task
+{
+  uint32_t entry;
+  uint32_t depth;
+  bool own;
+  int fd;
+};
+
+struct cwk_usage_job
+{
+  struct cwk_usage *usage;
+  size_t max_depth;
+  pthread_mutex_t mutex;
+  pthread_cond_t condition;
+  size_t capacity;
+  size_t hold;
+  size_t queued;
+  size_t busy;
+  struct cwk_usage_task queue[CWK_USAGE_QUEUE];
+};
+
+static size_t *cwk_usage_get_slots(const struct cwk_usage *usage)
+{
+  return (size_t *)(usage + 1);
+}
+
+static struct cwk_usage_entry *cwk_usage_get_entry(
+  const struct cwk_usage *usage, size_t index)
+{
+  return (struct cwk_usage_entry *)((char *)usage +
+                                    cwk_usage_get_slots(usage)[index]);
+}
+
+static uint32_t cwk_usage_create(struct cwk_usage *usage, uint32_t parent,
+  const char *name, size_t length)
+{
+  size_t index, size, offset;
+  struct cwk_usage_entry *entry;
+
+  // The space of the entry is reserved first, so there is never an index
+  // without an entry. If there is space but no index left, the space is
+  // wasted, but then the tree is full anyway.
+  size = (sizeof(*entry) + length + 1 + 7) & ~(size_t)7;
+  offset = atomic_fetch_add_explicit(&usage->used, size, memory_order_relaxed);
+  if (offset > usage->size || usage->size - offset < size) {
+    return CWK_USAGE_NONE;
+  }
+
+  index = atomic_fetch_add_explicit(&usage->count, 1, memory_order_relaxed);
+  if (index >= usage->slot_count) {
+    return CWK_USAGE_NONE;
+  }
+
+  entry = (struct cwk_usage_entry *)((char *)usage + offset);
+  memset(&entry->totals, 0, sizeof(entry->totals));
+  entry->parent = parent;
+  entry->first_child = CWK_USAGE_NONE;
+  entry->next_sibling = CWK_USAGE_NONE;
+  entry->length = (uint32_t)length;
+  memcpy(entry + 1, name, length);
+  ((char *)(entry + 1))[length] = '\0';
+  cwk_usage_get_slots(usage)[index] = offset;
+
+  return (uint32_t)index;
+}
+
+static bool cwk_usage_push(struct cwk_usage_job *job, uint32_t entry,
+  bool own, uint32_t depth, int fd)
+{
+  bool result;
+
+  pthread_mutex_lock(&job->mutex);
+  result = job->queued < job->capacity;
+  if (result) {
+    job->queue[job->queued].entry = entry;
+    job->queue[job->queued].depth = depth;
+    job->queue[job->queued].own = own;
+    job->queue[job->queued].fd = fd;
+    ++job->queued;
+    pthread_cond_signal(&job->condition);
+  }
+  pthread_mutex_unlock(&job->mutex);
+
+  return result;
+}
+
+static void cwk_usage_add(struct cwk_usage_totals *totals,
+  const struct cwk_usage_totals *other)
+{
+  totals->size += other->size;
+  totals->blocks += other->blocks;
+  totals->files += other->files;
+  totals->directories += other->directories;
+  totals->errors += other->errors;
+}
+
+// Directories without an entry of their own are counted in the entry of a
+// parent, which other threads may add to at the same time. The totals are
+// therefore merged under the mutex, but only once per directory.
+static void cwk_usage_merge(struct cwk_usage_job *job, uint32_t entry,
+  const struct cwk_usage_totals *totals)
+{
+  pthread_mutex_lock(&job->mutex);
+  cwk_usage_add(&cwk_usage_get_entry(job->usage, entry)->totals, totals);
+  pthread_mutex_unlock(&job->mutex);
+}
+
+static int cwk_usage_read(struct cwk_usage_job *job, size_t *held,
+  uint32_t index, bool own, size_t depth, int fd,
+  struct cwk_usage_totals *totals, bool keep)
+{
+  int child_fd;
+  bool directory, child_own;
+  size_t length, position, handled;
+  uint32_t child;
+  dev_t device;
+  ino_t inode;
+  DIR *dir;
+  struct dirent *item;
+  struct stat info;
+  struct cwk_usage_entry *entry, *child_entry;
+  struct cwk_usage_totals child_totals;
+
+  // The directory itself is counted as well, just like du does it. We also
+  // remember which directory it is, in case we have to return to it.
+  if (fstat(fd, &info) != 0) {
+    ++totals->errors;
+    close(fd);
+    return -1;
+  }
+
+  totals->size += (uint64_t)info.st_size;
+  totals->blocks += (uint64_t)info.st_blocks;
+  device = info.st_dev;
+  inode = info.st_ino;
+
+  dir = fdopendir(fd);
+  if (dir == NULL) {
+    ++totals->errors;
+    close(fd);
+    return -1;
+  }
+
+  // The position counts the entries of the current pass, and the handled ones
+  // are skipped if the directory has to be read again. Every entry is handled
+  // exactly once this way, no matter where the directory has been left.
+  entry = own ? cwk_usage_get_entry(job->usage, index) : NULL;
+  position = 0;
+  handled = 0;
+  while ((item = readdir(dir)) != NULL) {
+    if (item->d_name[0] == '.' &&
+        (item->d_name[1] == '\0' ||
+          (item->d_name[1] == '.' && item->d_name[2] == '\0'))) {
+      continue;
+    }
+
+    if (position++ < handled) {
+      continue;
+    }
+
+    // Directories don't have to be inspected here, since they are counted
+    // when they are read. We only need to know that they are directories,
+    // which readdir usually tells us. Everything else is a file.
+    ++handled;
+    directory = false;
+#ifdef DT_DIR
+    directory = item->d_type == DT_DIR;
+#endif
+    if (!directory) {
+      if (fstatat(dirfd(dir), item->d_name, &info, AT_SYMLINK_NOFOLLOW) != 0) {
+        ++totals->errors;
+        continue;
+      } else if (!S_ISDIR(info.st_mode)) {
+        ++totals->files;
+        totals->size += (uint64_t)info.st_size;
+        totals->blocks += (uint64_t)info.st_blocks;
+        continue;
+      }
+    }
+
+    ++totals->directories;
+    child_fd = openat(dirfd(dir), item->d_name,
+      O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+    if (child_fd < 0) {
+      ++totals->errors;
+      continue;
+    }
+
+    // Directories which are not too deep get their own entry if it still
+    // fits into the tree. Otherwise their totals go to the entry of this
+    // directory, or to the one this directory is counted in.
+    child = CWK_USAGE_NONE;
+    if (entry != NULL && depth < job->max_depth) {
+      length = strlen(item->d_name);
+      child = cwk_usage_create(job->usage, index, item->d_name, length);
+    }
+
+    child_own = child != CWK_USAGE_NONE;
+    if (child_own) {
+      child_entry = cwk_usage_get_entry(job->usage, child);
+      child_entry->next_sibling = entry->first_child;
+      entry->first_child = child;
+    } else {
+      child = index;
+    }
+
+    // Every directory is queued no matter how deep it is, so all threads have
+    // something to do. Only if the queue is full, we read the directory
+    // ourselves.
+    if (cwk_usage_push(job, child, child_own, (uint32_t)(depth + 1),
+          child_fd)) {
+      continue;
+    }
+
+    memset(&child_totals, 0, sizeof(child_totals));
+    if (*held < job->hold) {
+      ++*held;
+      cwk_usage_read(job, held, child, child_own, depth + 1, child_fd,
+        child_own ? &child_totals : totals, false);
+      --*held;
+      if (child_own) {
+        cwk_usage_merge(job, child, &child_totals);
+      }
+      continue;
+    }
+
+    // We may not keep any more directories open, so this one is closed before
+    // we descend, and we return to it through the parent of the child
+    // afterwards, just like fts does it. The depth of the tree is therefore
+    // not limited by the number of file descriptors. The directory is read
+    // again from the start, skipping everything which is already handled.
+    closedir(dir);
+    child_fd = cwk_usage_read(job, held, child, child_own, depth + 1,
+      child_fd, child_own ? &child_totals : totals, true);
+    if (child_own) {
+      cwk_usage_merge(job, child, &child_totals);
+    }
+
+    if (child_fd < 0) {
+      ++totals->errors;
+      return -1;
+    }
+
+    fd = openat(child_fd, "..", O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    close(child_fd);
+    if (fd >= 0 && (fstat(fd, &info) != 0 || info.st_dev != device ||
+                     info.st_ino != inode)) {
+      close(fd);
+      fd = -1;
+    }
+
+    dir = fd >= 0 ? fdopendir(fd) : NULL;
+    if (dir == NULL) {
+      ++totals->errors;
+      if (fd >= 0) {
+        close(fd);
+      }
+      return -1;
+    }
+
+    position = 0;
+  }
+
+  // This also closes the file descriptor of the directory, which is why the
+  // caller gets a copy if it has to return from here.
+  fd = keep ? fcntl(dirfd(dir), F_DUPFD_CLOEXEC, 0) : -1;
+  closedir(dir);
+  return fd;
+}
+
+static void *cwk_usage_work(void *argument)
+{
+  size_t held;
+  struct cwk_usage_task task;
+  struct cwk_usage_job *job;
+  struct cwk_usage_totals totals;
+
+  // The threads take directories from the queue until the queue is empty and
+  // no other thread is busy anymore, since a busy thread might still add
+  // directories to the queue. The totals of a directory are added to its
+  // entry once it is read, since other threads might add the totals of
+  // directories without an entry to the same entry.
+  job = argument;
+  held = 0;
+  pthread_mutex_lock(&job->mutex);
+  for (;;) {
+    while (job->queued == 0 && job->busy > 0) {
+      pthread_cond_wait(&job->condition, &job->mutex);
+    }
+
+    if (job->queued == 0) {
+      pthread_cond_broadcast(&job->condition);
+      break;
+    }
+
+    task = job->queue[--job->queued];
+    ++job->busy;
+    pthread_mutex_unlock(&job->mutex);
+
+    memset(&totals, 0, sizeof(totals));
+    cwk_usage_read(job, &held, task.entry, task.own, task.depth, task.fd,
+      &totals, false);
+
+    pthread_mutex_lock(&job->mutex);
+    cwk_usage_add(&cwk_usage_get_entry(job->usage, task.entry)->totals,
+      &totals);
+    --job->busy;
+  }
+  pthread_mutex_unlock(&job->mutex);
+
+  return NULL;
+}
+
+size_t cwk_usage_scan(const char *path, void *buffer, size_t buffer_size,
+  size_t max_depth, size_t thread_count)
+{
+  int fd;
+  long processors;
+  size_t i, count, slot_count, files;
+  struct rlimit limit;
+  pthread_t threads[CWK_USAGE_MAX_THREADS];
+  struct cwk_usage *usage;
+  struct cwk_usage_entry *entry;
+  struct cwk_usage_job job;
+
+  // We use one slot for every 64 bytes of the buffer, which is about what an
+  // entry with a short name needs.
+  if (buffer_size < sizeof(*usage) + 1024) {
+    errno = ENOBUFS;
+    return 0;
+  }
+
+  slot_count = (buffer_size - sizeof(*usage)) / 64;
+  if (slot_count > CWK_USAGE_NONE) {
+    slot_count = CWK_USAGE_NONE;
+  }
+
+  usage = buffer;
+  usage->size = buffer_size;
+  usage->slot_count = slot_count;
+  usage->entries = sizeof(*usage) + slot_count * sizeof(size_t);
+  atomic_init(&usage->count, 0);
+  atomic_init(&usage->used, usage->entries);
+
+  fd = open(path, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+  if (fd < 0) {
+    return 0;
+  }
+
+  if (thread_count == 0) {
+    processors = sysconf(_SC_NPROCESSORS_ONLN);
+    thread_count = processors > 0 ? (size_t)processors : 1;
+  }
+  if (thread_count > CWK_USAGE_MAX_THREADS) {
+    thread_count = CWK_USAGE_MAX_THREADS;
+  }
+
+  files = CWK_USAGE_QUEUE * 2;
+  if (getrlimit(RLIMIT_NOFILE, &limit) == 0 &&
+      limit.rlim_cur != RLIM_INFINITY && limit.rlim_cur / 2 < files) {
+    files = (size_t)(limit.rlim_cur / 2);
+  }
+
+  job.usage = usage;
+  job.max_depth = max_depth;
+  job.capacity = files / 2 > 0 ? files / 2 : 1;
+  job.hold = files / 2 / thread_count;
+  job.queued = 0;
+  job.busy = 0;
+  pthread_mutex_init(&job.mutex, NULL);
+  pthread_cond_init(&job.condition, NULL);
+  cwk_usage_create(usage, CWK_USAGE_NONE, "", 0);
+  cwk_usage_push(&job, 0, true, 0, fd);
+
+  // If a thread can't be created, the other threads simply do more of the
+  // work. The calling thread is one of the threads.
+  for (i = 1; i < thread_count; ++i) {
+    if (pthread_create(&threads[i], NULL, cwk_usage_work, &job) != 0) {
+      break;
+    }
+  }
+
+  thread_count = i;
+  cwk_usage_work(&job);
+  for (i = 1; i < thread_count; ++i) {
+    pthread_join(threads[i], NULL);
+  }
+
+  pthread_cond_destroy(&job.condition);
+  pthread_mutex_destroy(&job.mutex);
+
+  // Now every entry only contains its own files and the directories without
+  // an entry. Since children always come after their parents, we can add the
+  // totals of every entry to its parent in reverse order.
+  count = atomic_load_explicit(&usage->count, memory_order_relaxed);
+  if (count > slot_count) {
+    count = slot_count;
+    atomic_store_explicit(&usage->count, count, memory_order_relaxed);
+  }
+
+  for (i = count - 1; i > 0; --i) {
+    entry = cwk_usage_get_entry(usage, i);
+    cwk_usage_add(&cwk_usage_get_entry(usage, entry->parent)->totals,
+      &entry->totals);
+  }
+
+  return count;
+}
+
+size_t cwk_usage_get_count(const void *usage)
+{
+  return atomic_load_explicit(&((struct cwk_usage *)usage)->count,
+    memory_order_relaxed);
+}
+
+bool cwk_usage_get_totals(const void *usage, size_t entry,
+  struct cwk_usage_totals *totals)
+{
+  if (entry >= cwk_usage_get_count(usage)) {
+    return false;
+  }
+
+  *totals = cwk_usage_get_entry(usage, entry)->totals;
+  return true;
+}
+
+bool cwk_usage_find(const void *usage, const char *path, size_t *entry)
+{
+  size_t root_length;
+  uint32_t index, child;
+  struct cwk_segment segment;
+  const struct cwk_usage_entry *current;
+
+  // The path is relative to the walked directory, so it must not have a root.
+  cwk_path_get_root(path, &root_length);
+  if (root_length > 0) {
+    return false;
+  }
+
+  index = 0;
+  if (!cwk_path_get_first_segment(path, &segment)) {
+    *entry = 0;
+    return true;
+  }
+
+  do {
+    current = cwk_usage_get_entry(usage, index);
+    switch (cwk_path_get_segment_type(&segment)) {
+    case CWK_CURRENT:
+      break;
+    case CWK_BACK:
+      if (current->parent == CWK_USAGE_NONE) {
+        return false;
+      }
+      index = current->parent;
+      break;
+    case CWK_NORMAL:
+      for (child = current->first_child; child != CWK_USAGE_NONE;
+           child = cwk_usage_get_entry(usage, child)->next_sibling) {
+        current = cwk_usage_get_entry(usage, child);
+        if (current->length == segment.size &&
+            memcmp(current + 1, segment.begin, segment.size) == 0) {
+          break;
+        }
+      }
+      if (child == CWK_USAGE_NONE) {
+        return false;
+      }
+      index = child;
+      break;
+    }
+  } while (cwk_path_get_next_segment(&segment));
+
+  *entry = index;
+  return true;
+}
+
+size_t cwk_usage_get_path(const void *usage, size_t entry, char *buffer,
+  size_t buffer_size)
+{
+  size_t length, position;
+  uint32_t index;
+  const struct cwk_usage_entry *current;
+
+  if (entry >= cwk_usage_get_count(usage)) {
+    return 0;
+  } else if (entry == 0) {
+    cwk_path_output_current(buffer, buffer_size, 0);
+    cwk_path_terminate_output(buffer, buffer_size, 1);
+    return 1;
+  }
+
+  // We measure the path first, and then write the names from the end of the
+  // path towards its beginning.
+  length = 0;
+  for (index = (uint32_t)entry; index != 0; index = current->parent) {
+    current = cwk_usage_get_entry(usage, index);
+    length += current->length + (length > 0);
+  }
+
+  position = length;
+  for (index = (uint32_t)entry; index != 0; index = current->parent) {
+    current = cwk_usage_get_entry(usage, index);
+    if (position < length) {
+      cwk_path_output_separator(buffer, buffer_size, position);
+    }
+    position -= current->length;
+    cwk_path_output_sized(buffer, buffer_size, position,
+      (const char *)(current + 1), current->length);
+    if (position > 0) {
+      --position;
+    }
+  }
+
+  cwk_path_terminate_output(buffer, buffer_size, length);
+  return length;
+}
+
+static bool cwk_usage_is_larger(const void *usage, size_t a, size_t b)
+{
+  uint64_t blocks_a, blocks_b;
+
+  // Entries with the same number of blocks are ordered by their index, so the
+  // result doesn't depend on the order of the heap.
+  blocks_a = cwk_usage_get_entry(usage, a)->totals.blocks;
+  blocks_b = cwk_usage_get_entry(usage, b)->totals.blocks;
+  return blocks_a > blocks_b || (blocks_a == blocks_b && a < b);
+}
+
+static void cwk_usage_sift(const void *usage, size_t *heap, size_t count,
+  size_t i)
+{
+  size_t smallest, child, temp;
+
+  // This is a min heap, so the smallest of the largest entries is at the top
+  // and can be replaced by a larger one.
+  for (;;) {
+    smallest = i;
+    child = 2 * i + 1;
+    if (child < count &&
+        cwk_usage_is_larger(usage, heap[smallest], heap[child])) {
+      smallest = child;
+    }
+    ++child;
+    if (child < count &&
+        cwk_usage_is_larger(usage, heap[smallest], heap[child])) {
+      smallest = child;
+    }
+    if (smallest == i) {
+      return;
+    }
+
+    temp = heap[i];
+    heap[i] = heap[smallest];
+    heap[smallest] = temp;
+    i = smallest;
+  }
+}
+
+size_t cwk_usage_get_largest(const void *usage, size_t *entries, size_t count)
+{
+  size_t i, size, total, temp;
+
+  total = cwk_usage_get_count(usage);
+  size = 0;
+  if (count == 0) {
+    return 0;
+  }
+
+  // The array of the caller is used as a heap, which keeps the largest entries
+  // seen so far.
+  for (i = 1; i < total; ++i) {
+    if (size < count) {
+      entries[size++] = i;
+      if (size == count) {
+        temp = count;
+        while (temp-- > 0) {
+          cwk_usage_sift(usage, entries, size, temp);
+        }
+      }
+    } else if (cwk_usage_is_larger(usage, i, entries[0])) {
+      entries[0] = i;
+      cwk_usage_sift(usage, entries, size, 0);
+    }
+  }
+
+  if (size < count) {
+    temp = size;
+    while (temp-- > 0) {
+      cwk_usage_sift(usage, entries, size, temp);
+    }
+  }
+
+  // Removing the top of the heap one by one sorts the entries, with the
+  // largest one at the beginning.
+  for (i = size; i > 1; --i) {
+    temp = entries[0];
+    entries[0] = entries[i - 1];
+    entries[i - 1] = temp;
+    cwk_usage_sift(usage, entries, i - 1, 0);
+  }
+
+  return size;
+}
+
+/**
+ * A snapshot starts with this header, which is followed by the entries in the
+ * order of a depth-first walk. Every entry is followed by its name and padded
+ * to eight bytes, and an entry is identified by its offset from the start of
+ * the snapshot. The end of an entry is the offset after all the entries below
+ * it, which is where a diff continues if a directory is skipped.
+ */
+struct cwk_snapshot
+{
+  uint32_t magic;
+  uint32_t version;
+  uint32_t size;
+  uint32_t count;
+};
+
+struct cwk_snapshot_entry
+{
+  uint64_t size;
+  int64_t mtime;
+  uint64_t inode;
+  uint64_t digest;
+  uint32_t parent;
+  uint32_t end;
+  uint32_t mode;
+  uint32_t depth;
+  uint32_t length;
+};
+
+#define CWK_SNAPSHOT_MAGIC 0x534b5743
+#define CWK_SNAPSHOT_VERSION 1
+
+/**
+ * The entries are written to the beginning of the buffer, while the names of
+ * the directories which are being read are kept at the end of the buffer
+ * until they are sorted and written.
+ */
+struct cwk_snapshot_builder
+{
+  char *buffer;
+  size_t used;
+  size_t scratch;
+  uint32_t count;
+};
+
+static struct cwk_snapshot_entry *cwk_snapshot_get_entry(const void *snapshot,
+  size_t entry)
+{
+  return (struct cwk_snapshot_entry *)((char *)snapshot + entry);
+}
+
+static const char *cwk_snapshot_get_name(
+  const struct cwk_snapshot_entry *entry)
+{
+  return (const char *)(entry + 1);
+}
+
+static size_t cwk_snapshot_get_entry_size(size_t length)
+{
+  return (sizeof(struct cwk_snapshot_entry) + length + 1 + 7) & ~(size_t)7;
+}
+
+static uint64_t cwk_snapshot_mix(uint64_t value)
+{
+  // This is the finalizer of splitmix64, which spreads every bit of the value
+  // over the whole result.
+  value ^= value >> 30;
+  value *= 0xbf58476d1ce4e5b9;
+  value ^= value >> 27;
+  value *= 0x94d049bb133111eb;
+  value ^= value >> 31;
+  return value;
+}
+
+static int cwk_snapshot_compare_names(const void *a, const void *b)
+{
+  return strcmp(*(const char *const *)a, *(const char *const *)b);
+}
+
+static bool cwk_snapshot_add(struct cwk_snapshot_builder *builder,
+  size_t parent, uint32_t depth, const char *name, size_t length,
+  const struct stat *info, size_t *offset)
+{
+  size_t i, size;
+  uint64_t hash;
+  struct cwk_snapshot_entry *entry;
+
+  size = cwk_snapshot_get_entry_size(length);
+  if (builder->scratch - builder->used < size) {
+    errno = ENOBUFS;
+    return false;
+  }
+
+  // The padding is cleared as well, so the same tree always results in the
+  // same bytes.
+  entry = cwk_snapshot_get_entry(builder->buffer, builder->used);
+  memset(entry, 0, size);
+  entry->size = (uint64_t)info->st_size;
+#ifdef __APPLE__
+  entry->mtime = (int64_t)info->st_mtimespec.tv_sec * 1000000000 +
+                 (int64_t)info->st_mtimespec.tv_nsec;
+#else
+  entry->mtime = (int64_t)info->st_mtim.tv_sec * 1000000000 +
+                 (int64_t)info->st_mtim.tv_nsec;
+#endif
+  entry->inode = (uint64_t)info->st_ino;
+  entry->parent = (uint32_t)parent;
+  entry->end = (uint32_t)(builder->used + size);
+  entry->mode = (uint32_t)info->st_mode;
+  entry->depth = depth;
+  entry->length = (uint32_t)length;
+  memcpy(entry + 1, name, length);
+
+  // The digest starts with a FNV-1a hash of the name and the information of
+  // the entry itself. The digests of the entries below it are added once they
+  // are complete.
+  hash = 0xcbf29ce484222325;
+  for (i = 0; i < length; ++i) {
+    hash ^= (unsigned char)name[i];
+    hash *= 0x100000001b3;
+  }
+  hash = cwk_snapshot_mix(hash ^ entry->mode);
+  hash = cwk_snapshot_mix(hash ^ entry->size);
+  hash = cwk_snapshot_mix(hash ^ (uint64_t)entry->mtime);
+  entry->digest = cwk_snapshot_mix(hash ^ entry->inode);
+
+  *offset = builder->used;
+  builder->used += size;
+  ++builder->count;
+  return true;
+}
+
+static bool cwk_snapshot_read(struct cwk_snapshot_builder *builder,
+  size_t offset, int fd)
+{
+  int child_fd, error;
+  bool result;
+  size_t i, count, length, top, child;
+  char *name;
+  const char **names;
+  DIR *dir;
+  struct dirent *item;
+  struct stat info;
+  struct cwk_snapshot_entry *entry, *child_entry;
+
+  dir = fdopendir(fd);
+  if (dir == NULL) {
+    close(fd);
+    return false;
+  }
+
+  // The names are copied to the end of the buffer first, so they can be
+  // sorted before their entries are written. The space is released once the
+  // directory is complete, and the directories below it use the space after
+  // the names in the meantime.
+  top = builder->scratch;
+  count = 0;
+  result = true;
+  while ((item = readdir(dir)) != NULL) {
+    if (item->d_name[0] == '.' &&
+        (item->d_name[1] == '\0' ||
+          (item->d_name[1] == '.' && item->d_name[2] == '\0'))) {
+      continue;
+    }
+
+    length = strlen(item->d_name) + 1;
+    if (builder->scratch - builder->used < length) {
+      errno = ENOBUFS;
+      result = false;
+      break;
+    }
+
+    builder->scratch -= length;
+    memcpy(builder->buffer + builder->scratch, item->d_name, length);
+    ++count;
+  }
+
+  if (result && builder->scratch - builder->used <
+                  (count + 1) * sizeof(*names)) {
+    errno = ENOBUFS;
+    result = false;
+  }
+
+  if (result) {
+    name = builder->buffer + builder->scratch;
+    builder->scratch = (builder->scratch - count * sizeof(*names)) &
+                       ~(sizeof(*names) - 1);
+    names = (const char **)(void *)(builder->buffer + builder->scratch);
+    for (i = 0; i < count; ++i) {
+      names[i] = name;
+      name += strlen(name) + 1;
+    }
+    qsort(names, count, sizeof(*names), cwk_snapshot_compare_names);
+  }
+
+  for (i = 0; result && i < count; ++i) {
+    // A file which has been removed since the directory has been read is
+    // simply left out.
+    if (fstatat(fd, names[i], &info, AT_SYMLINK_NOFOLLOW) != 0) {
+      result = errno == ENOENT;
+      continue;
+    }
+
+    entry = cwk_snapshot_get_entry(builder->buffer, offset);
+    if (!cwk_snapshot_add(builder, offset, entry->depth + 1, names[i],
+          strlen(names[i]), &info, &child)) {
+      result = false;
+      break;
+    }
+
+    // Directories which we are not allowed to read don't have any entries.
+    if (S_ISDIR(info.st_mode)) {
+      child_fd = openat(fd, names[i],
+        O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+      if (child_fd >= 0) {
+        result = cwk_snapshot_read(builder, child, child_fd);
+      } else {
+        result = errno == EACCES || errno == ENOENT;
+      }
+    }
+
+    child_entry = cwk_snapshot_get_entry(builder->buffer, child);
+    child_entry->end = (uint32_t)builder->used;
+    entry->digest += cwk_snapshot_mix(child_entry->digest);
+  }
+
+  // This also closes the file descriptor of the directory.
+  error = errno;
+  closedir(dir);
+  errno = error;
+  builder->scratch = top;
+  return result;
+}
+
+size_t cwk_snapshot_create(const char *path, void *buffer, size_t buffer_size)
+{
+  int fd;
+  size_t root;
+  struct stat info;
+  struct cwk_snapshot *snapshot;
+  struct cwk_snapshot_builder builder;
+
+  // The offsets are stored with 32 bits, so larger buffers are not used
+  // completely.
+  if (buffer_size > UINT32_MAX) {
+    buffer_size = UINT32_MAX;
+  }
+
+  if (buffer_size < sizeof(*snapshot)) {
+    errno = ENOBUFS;
+    return 0;
+  }
+
+  fd = open(path, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+  if (fd < 0) {
+    return 0;
+  }
+
+  builder.buffer = buffer;
+  builder.used = sizeof(*snapshot);
+  builder.scratch = buffer_size & ~(size_t)7;
+  builder.count = 0;
+  if (fstat(fd, &info) != 0 ||
+      !cwk_snapshot_add(&builder, 0, 0, "", 0, &info, &root)) {
+    close(fd);
+    return 0;
+  }
+
+  if (!cwk_snapshot_read(&builder, root, fd)) {
+    return 0;
+  }
+
+  cwk_snapshot_get_entry(buffer, root)->end = (uint32_t)builder.used;
+  snapshot = buffer;
+  snapshot->magic = CWK_SNAPSHOT_MAGIC;
+  snapshot->version = CWK_SNAPSHOT_VERSION;
+  snapshot->size = (uint32_t)builder.used;
+  snapshot->count = builder.count;
+  return builder.used;
+}
+
+bool cwk_snapshot_is_valid(const void *snapshot, size_t size)
+{
+  size_t position, open, count, end;
+  const struct cwk_snapshot *header;
+  const struct cwk_snapshot_entry *entry, *parent;
+
+  header = snapshot;
+  if (size < sizeof(*header) || header->magic != CWK_SNAPSHOT_MAGIC ||
+      header->version != CWK_SNAPSHOT_VERSION || header->size != size ||
+      size < sizeof(*header) + cwk_snapshot_get_entry_size(0)) {
+    return false;
+  }
+
+  // The entries are checked in order, while we keep track of the innermost
+  // directory which still contains the current entry. Directories are left
+  // once we reach their end, so every parent and every end which is checked
+  // here is known to point to the beginning of an entry.
+  open = 0;
+  count = 0;
+  for (position = sizeof(*header); position < size; position = end) {
+    entry = cwk_snapshot_get_entry(snapshot, position);
+    if (size - position < sizeof(*entry) ||
+        size - position - sizeof(*entry) <= entry->length ||
+        memchr(entry + 1, '\0', entry->length + 1) !=
+          (const char *)(entry + 1) + entry->length) {
+      return false;
+    }
+
+    end = position + cwk_snapshot_get_entry_size(entry->length);
+    if (end > size || entry->end < end || entry->end > size ||
+        entry->end % 8 != 0) {
+      return false;
+    }
+
+    while (open != 0 &&
+           cwk_snapshot_get_entry(snapshot, open)->end == position) {
+      open = cwk_snapshot_get_entry(snapshot, open)->parent;
+    }
+
+    if (open == 0) {
+      // Only the first entry is the root, and everything else is below it.
+      if (position != sizeof(*header) || entry->parent != 0 ||
+          entry->depth != 0 || entry->length != 0 || entry->end != size) {
+        return false;
+      }
+    } else {
+      parent = cwk_snapshot_get_entry(snapshot, open);
+      if (parent->end < position || entry->parent != open ||
+          entry->depth != parent->depth + 1 || entry->end > parent->end) {
+        return false;
+      }
+    }
+
+    open = position;
+    ++count;
+  }
+
+  return count == header->count;
+}
+
+size_t cwk_snapshot_get_count(const void *snapshot)
+{
+  return ((const struct cwk_snapshot *)snapshot)->count;
+}
+
+void cwk_snapshot_get_info(const void *snapshot, size_t entry,
+  struct cwk_snapshot_info *info)
+{
+  const struct cwk_snapshot_entry *current;
+
+  current = cwk_snapshot_get_entry(snapshot, entry);
+  info->mode = current->mode;
+  info->size = current->size;
+  info->mtime = current->mtime;
+  info->inode = current->inode;
+  info->digest = current->digest;
+}
+
+size_t cwk_snapshot_get_path(const void *snapshot, size_t entry, char *buffer,
+  size_t buffer_size)
+{
+  size_t length, position;
+  const struct cwk_snapshot_entry *current;
+
+  current = cwk_snapshot_get_entry(snapshot, entry);
+  if (current->depth == 0) {
+    cwk_path_output_current(buffer, buffer_size, 0);
+    cwk_path_terminate_output(buffer, buffer_size, 1);
+    return 1;
+  }
+
+  // We measure the path first, and then write the names from the end of the
+  // path towards its beginning.
+  length = 0;
+  while (current->depth > 0) {
+    length += current->length + (length > 0);
+    current = cwk_snapshot_get_entry(snapshot, current->parent);
+  }
+
+  position = length;
+  current = cwk_snapshot_get_entry(snapshot, entry);
+  while (current->depth > 0) {
+    if (position < length) {
+      cwk_path_output_separator(buffer, buffer_size, position);
+    }
+    position -= current->length;
+    cwk_path_output_sized(buffer, buffer_size, position,
+      cwk_snapshot_get_name(current), current->length);
+    if (position > 0) {
+      --position;
+    }
+    current = cwk_snapshot_get_entry(snapshot, current->parent);
+  }
+
+  cwk_path_terminate_output(buffer, buffer_size, length);
+  return length;
+}
+
+static bool cwk_snapshot_diff_step(struct cwk_snapshot_diff *diff)
+{
+  int order;
+  uint32_t old_depth, new_depth;
+  const struct cwk_snapshot *old_header, *new_header;
+  const struct cwk_snapshot_entry *old_entry, *new_entry;
+
+  old_header = diff->old_snapshot;
+  new_header = diff->new_snapshot;
+  for (;;) {
+    // Both snapshots are walked in the same order. The end of a snapshot is
+    // treated like an entry above the root, so it is always sorted after the
+    // remaining entries of the other snapshot.
+    old_entry = NULL;
+    old_depth = 0;
+    if (diff->old_position < old_header->size) {
+      old_entry = cwk_snapshot_get_entry(old_header, diff->old_position);
+      old_depth = old_entry->depth + 1;
+    }
+
+    new_entry = NULL;
+    new_depth = 0;
+    if (diff->new_position < new_header->size) {
+      new_entry = cwk_snapshot_get_entry(new_header, diff->new_position);
+      new_depth = new_entry->depth + 1;
+    }
+
+    if (old_entry == NULL && new_entry == NULL) {
+      return false;
+    }
+
+    // If one of the entries is deeper than the other one, the directory of
+    // the other one has no entries left, so the deeper entry only exists in
+    // its snapshot. Otherwise both entries are in the same directory, and
+    // the entries of a directory are sorted by name.
+    if (old_depth != new_depth) {
+      order = old_depth > new_depth ? -1 : 1;
+    } else {
+      order = strcmp(cwk_snapshot_get_name(old_entry),
+        cwk_snapshot_get_name(new_entry));
+    }
+
+    if (order < 0) {
+      diff->change = CWK_SNAPSHOT_REMOVED;
+      diff->old_entry = diff->old_position;
+      diff->old_position += cwk_snapshot_get_entry_size(old_entry->length);
+      return true;
+    } else if (order > 0) {
+      diff->change = CWK_SNAPSHOT_ADDED;
+      diff->new_entry = diff->new_position;
+      diff->new_position += cwk_snapshot_get_entry_size(new_entry->length);
+      return true;
+    }
+
+    // The same digest means that nothing below the entry has changed, so we
+    // can skip everything below it.
+    if (old_entry->digest == new_entry->digest) {
+      diff->old_position = old_entry->end;
+      diff->new_position = new_entry->end;
+      continue;
+    }
+
+    diff->old_entry = diff->old_position;
+    diff->new_entry = diff->new_position;
+    diff->old_position += cwk_snapshot_get_entry_size(old_entry->length);
+    diff->new_position += cwk_snapshot_get_entry_size(new_entry->length);
+    if (old_entry->mode != new_entry->mode ||
+        old_entry->size != new_entry->size ||
+        old_entry->mtime != new_entry->mtime ||
+        old_entry->inode != new_entry->inode) {
+      diff->change = CWK_SNAPSHOT_MODIFIED;
+      return true;
+    }
+  }
+}
+
+bool cwk_snapshot_diff_first(struct cwk_snapshot_diff *diff,
+  const void *old_snapshot, const void *new_snapshot)
+{
+  diff->old_snapshot = old_snapshot;
+  diff->new_snapshot = new_snapshot;
+  diff->old_position = sizeof(struct cwk_snapshot);
+  diff->new_position = sizeof(struct cwk_snapshot);
+  diff->old_entry = 0;
+  diff->new_entry = 0;
+  return cwk_snapshot_diff_step(diff);
+}
+
+bool cwk_snapshot_diff_next(struct cwk_snapshot_diff *diff)
+{
+  return cwk_snapshot_diff_step(diff);
+}
+
+#ifdef CWK_INOTIFY
+/**
+ * A live index starts with this header, which is followed by the buckets of
+ * the names, the buckets of the watch descriptors, the entries and an arena
+ * for the names. Every entry only stores its own name and is linked to its
+ * parent, so the paths are interned as a trie. The entries which changed are
+ * kept in a list which is ordered by generation, from the oldest to the
+ * newest one. Removed entries stay in that list until they are forgotten, so
+ * they can be reported as well.
+ */
+struct cwk_watch
+{
+  int fd;
+  uint32_t node_count;
+  uint32_t bucket_count;
+  uint32_t count;
+  uint32_t free;
+  uint32_t oldest;
+  uint32_t newest;
+  uint32_t moved;
+  uint32_t cookie;
+  size_t root;
+  size_t names;
+  size_t names_used;
+  size_t names_size;
+  uint64_t generation;
+  uint64_t horizon;
+};
+
+struct cwk_watch_node
+{
+  uint64_t created;
+  uint64_t generation;
+  uint32_t parent;
+  uint32_t first_child;
+  uint32_t next_sibling;
+  uint32_t previous_sibling;
+  uint32_t chain;
+  uint32_t wd_chain;
+  uint32_t older;
+  uint32_t newer;
+  uint32_t name;
+  uint32_t length;
+  int wd;
+  uint32_t flags;
+};
+
+/**
+ * Every name in the arena starts with its owner, so the arena can be
+ * compacted by sliding all names which are still used to the front. The
+ * owner of the path of the watched directory is CWK_WATCH_ROOT.
+ */
+struct cwk_watch_block
+{
+  uint32_t owner;
+  uint32_t length;
+};
+
+#define CWK_WATCH_NONE UINT32_MAX
+#define CWK_WATCH_ROOT (UINT32_MAX - 1)
+#define CWK_WATCH_FLAG_DIRECTORY 0x01
+#define CWK_WATCH_FLAG_REMOVED 0x02
+#define CWK_WATCH_FLAG_LISTED 0x04
+#define CWK_WATCH_MASK                                                         \
+  (IN_CREATE | IN_DELETE | IN_MODIFY | IN_ATTRIB | IN_MOVED_FROM |             \
+    IN_MOVED_TO | IN_DELETE_SELF | IN_MOVE_SELF | IN_DONT_FOLLOW |             \
+    IN_EXCL_UNLINK | IN_ONLYDIR)
+
+static uint32_t *cwk_watch_get_buckets(const struct cwk_watch *watch)
+{
+  return (uint32_t *)(void *)(watch + 1);
+}
+
+static uint32_t *cwk_watch_get_wd_buckets(const struct cwk_watch *watch)
+{
+  return cwk_watch_get_buckets(watch) + watch->bucket_count;
+}
+
+static struct cwk_watch_node *cwk_watch_get_nodes(
+  const struct cwk_watch *watch)
+{
+  return (struct cwk_watch_node *)(void *)((char *)watch + sizeof(*watch) +
+                                           ((watch->bucket_count * 2 *
+                                              sizeof(uint32_t) + 7) &
+                                             ~(size_t)7));
+}
+
+static struct cwk_watch_block *cwk_watch_get_block(
+  const struct cwk_watch *watch, size_t offset)
+{
+  return (struct cwk_watch_block *)(void *)((char *)watch + watch->names +
+                                            offset);
+}
+
+static const char *cwk_watch_get_name(const struct cwk_watch *watch,
+  const struct cwk_watch_node *node)
+{
+  return (const char *)(cwk_watch_get_block(watch, node->name) + 1);
+}
+
+static size_t cwk_watch_get_block_size(size_t length)
+{
+  return sizeof(struct cwk_watch_block) + ((length + 1 + 7) & ~(size_t)7);
+}
+
+static uint32_t cwk_watch_hash(uint32_t parent, const char *name,
+  size_t length)
+{
+  size_t i;
+  uint64_t hash;
+
+  // This is a FNV-1a hash of the name, which contains the parent as well, so
+  // the same name in another directory ends up somewhere else.
+  hash = ((uint64_t)parent + 1) * 0x100000001b3 ^ 0xcbf29ce484222325;
+  for (i = 0; i < length; ++i) {
+    hash ^= (unsigned char)name[i];
+    hash *= 0x100000001b3;
+  }
+
+  return (uint32_t)(hash ^ hash >> 32);
+}
+
+static void cwk_watch_compact(struct cwk_watch *watch)
+{
+  size_t position, target, size;
+  struct cwk_watch_block *block;
+
+  // The names of removed entries are marked as free, so we slide all other
+  // names to the front and update their owners.
+  target = 0;
+  for (position = 0; position < watch->names_used; position += size) {
+    block = cwk_watch_get_block(watch, position);
+    size = cwk_watch_get_block_size(block->length);
+    if (block->owner == CWK_WATCH_NONE) {
+      continue;
+    } else if (block->owner == CWK_WATCH_ROOT) {
+      watch->root = target;
+    } else {
+      cwk_watch_get_nodes(watch)[block->owner].name = (uint32_t)target;
+    }
+
+    memmove(cwk_watch_get_block(watch, target), block, size);
+    target += size;
+  }
+
+  watch->names_used = target;
+}
+
+static bool cwk_watch_store(struct cwk_watch *watch, uint32_t owner,
+  const char *name, size_t length, size_t *offset)
+{
+  size_t size;
+  struct cwk_watch_block *block;
+
+  size = cwk_watch_get_block_size(length);
+  if (watch->names_size - watch->names_used < size) {
+    cwk_watch_compact(watch);
+    if (watch->names_size - watch->names_used < size) {
+      errno = ENOBUFS;
+      return false;
+    }
+  }
+
+  block = cwk_watch_get_block(watch, watch->names_used);
+  block->owner = owner;
+  block->length = (uint32_t)length;
+  memcpy(block + 1, name, length);
+  ((char *)(block + 1))[length] = '\0';
+  *offset = watch->names_used;
+  watch->names_used += size;
+  return true;
+}
+
+static uint32_t cwk_watch_lookup(const struct cwk_watch *watch,
+  uint32_t parent, const char *name, size_t length)
+{
+  uint32_t index;
+  struct cwk_watch_node *nodes;
+
+  nodes = cwk_watch_get_nodes(watch);
+  index = cwk_watch_get_buckets(
+    watch)[cwk_watch_hash(parent, name, length) & (watch->bucket_count - 1)];
+  while (index != CWK_WATCH_NONE) {
+    if (nodes[index].parent == parent && nodes[index].length == length &&
+        memcmp(cwk_watch_get_name(watch, &nodes[index]), name, length) == 0) {
+      return index;
+    }
+    index = nodes[index].chain;
+  }
+
+  return CWK_WATCH_NONE;
+}
+
+static uint32_t cwk_watch_lookup_wd(const struct cwk_watch *watch, int wd)
+{
+  uint32_t index;
+  struct cwk_watch_node *nodes;
+
+  nodes = cwk_watch_get_nodes(watch);
+  index = cwk_watch_get_wd_buckets(
+    watch)[(uint32_t)wd & (watch->bucket_count - 1)];
+  while (index != CWK_WATCH_NONE && nodes[index].wd != wd) {
+    index = nodes[index].wd_chain;
+  }
+
+  return index;
+}
+
+static void cwk_watch_unchain(uint32_t *bucket, struct cwk_watch_node *nodes,
+  uint32_t index, bool wd)
+{
+  uint32_t *link;
+
+  // The chains are singly linked, so we search the link which points to the
+  // entry. The chains are short, since there is a bucket for every entry.
+  link = bucket;
+  while (*link != index) {
+    link = wd ? &nodes[*link].wd_chain : &nodes[*link].chain;
+  }
+
+  *link = wd ? nodes[index].wd_chain : nodes[index].chain;
+}
+
+static void cwk_watch_map(struct cwk_watch *watch, uint32_t index, int wd)
+{
+  uint32_t *bucket;
+  struct cwk_watch_node *nodes;
+
+  nodes = cwk_watch_get_nodes(watch);
+  bucket = &cwk_watch_get_wd_buckets(
+    watch)[(uint32_t)wd & (watch->bucket_count - 1)];
+  nodes[index].wd = wd;
+  nodes[index].wd_chain = *bucket;
+  *bucket = index;
+}
+
+static void cwk_watch_unmap(struct cwk_watch *watch, uint32_t index)
+{
+  struct cwk_watch_node *nodes;
+
+  nodes = cwk_watch_get_nodes(watch);
+  cwk_watch_unchain(&cwk_watch_get_wd_buckets(
+                      watch)[(uint32_t)nodes[index].wd &
+                             (watch->bucket_count - 1)],
+    nodes, index, true);
+  nodes[index].wd = -1;
+}
+
+static void cwk_watch_link(struct cwk_watch *watch, uint32_t index)
+{
+  uint32_t *bucket;
+  struct cwk_watch_node *nodes, *node;
+
+  nodes = cwk_watch_get_nodes(watch);
+  node = &nodes[index];
+  bucket = &cwk_watch_get_buckets(watch)[cwk_watch_hash(node->parent,
+                                           cwk_watch_get_name(watch, node),
+                                           node->length) &
+                                         (watch->bucket_count - 1)];
+  node->chain = *bucket;
+  *bucket = index;
+
+  node->previous_sibling = CWK_WATCH_NONE;
+  node->next_sibling = nodes[node->parent].first_child;
+  if (node->next_sibling != CWK_WATCH_NONE) {
+    nodes[node->next_sibling].previous_sibling = index;
+  }
+  nodes[node->parent].first_child = index;
+}
+
+static void cwk_watch_unlink(struct cwk_watch *watch, uint32_t index)
+{
+  struct cwk_watch_node *nodes, *node;
+
+  nodes = cwk_watch_get_nodes(watch);
+  node = &nodes[index];
+  cwk_watch_unchain(&cwk_watch_get_buckets(
+                      watch)[cwk_watch_hash(node->parent,
+                               cwk_watch_get_name(watch, node), node->length) &
+                             (watch->bucket_count - 1)],
+    nodes, index, false);
+
+  if (node->previous_sibling != CWK_WATCH_NONE) {
+    nodes[node->previous_sibling].next_sibling = node->next_sibling;
+  } else {
+    nodes[node->parent].first_child = node->next_sibling;
+  }
+  if (node->next_sibling != CWK_WATCH_NONE) {
+    nodes[node->next_sibling].previous_sibling = node->previous_sibling;
+  }
+}
+
+static void cwk_watch_unlist(struct cwk_watch *watch, uint32_t index)
+{
+  struct cwk_watch_node *nodes, *node;
+
+  nodes = cwk_watch_get_nodes(watch);
+  node = &nodes[index];
+  if (node->older != CWK_WATCH_NONE) {
+    nodes[node->older].newer = node->newer;
+  } else {
+    watch->oldest = node->newer;
+  }
+  if (node->newer != CWK_WATCH_NONE) {
+    nodes[node->newer].older = node->older;
+  } else {
+    watch->newest = node->older;
+  }
+  node->flags &= ~(uint32_t)CWK_WATCH_FLAG_LISTED;
+}
+
+static void cwk_watch_touch(struct cwk_watch *watch, uint32_t index,
+  uint64_t generation)
+{
+  struct cwk_watch_node *nodes, *node;
+
+  // The entry moves to the newest end of the list, so every entry is only
+  // listed once with its latest change.
+  nodes = cwk_watch_get_nodes(watch);
+  node = &nodes[index];
+  if (node->flags & CWK_WATCH_FLAG_LISTED) {
+    cwk_watch_unlist(watch, index);
+  }
+
+  node->generation = generation;
+  node->flags |= CWK_WATCH_FLAG_LISTED;
+  node->newer = CWK_WATCH_NONE;
+  node->older = watch->newest;
+  if (watch->newest != CWK_WATCH_NONE) {
+    nodes[watch->newest].newer = index;
+  } else {
+    watch->oldest = index;
+  }
+  watch->newest = index;
+}
+
+static void cwk_watch_release(struct cwk_watch *watch, uint32_t index)
+{
+  struct cwk_watch_node *node;
+
+  node = &cwk_watch_get_nodes(watch)[index];
+  cwk_watch_get_block(watch, node->name)->owner = CWK_WATCH_NONE;
+  node->flags = 0;
+  node->chain = watch->free;
+  watch->free = index;
+}
+
+static uint32_t cwk_watch_allocate(struct cwk_watch *watch)
+{
+  uint32_t index;
+  struct cwk_watch_node *node;
+
+  // If there are no free entries left, we forget the oldest changes until we
+  // find a removed entry which can be reused. The changes before the
+  // forgotten ones are not complete anymore.
+  while (watch->free == CWK_WATCH_NONE && watch->oldest != CWK_WATCH_NONE) {
+    index = watch->oldest;
+    node = &cwk_watch_get_nodes(watch)[index];
+    cwk_watch_unlist(watch, index);
+    if (node->generation > watch->horizon) {
+      watch->horizon = node->generation;
+    }
+    if (node->flags & CWK_WATCH_FLAG_REMOVED) {
+      cwk_watch_release(watch, index);
+    }
   }
 
-  // Now we determine the length of the value. In order to do that we first
-  // locate the '\0'.
-  value_size = 0;
-  while (value[value_size]) {
-    ++value_size;
+  index = watch->free;
+  if (index == CWK_WATCH_NONE) {
+    errno = ENOBUFS;
+    return CWK_WATCH_NONE;
   }
 
-  // Since we trim separators at the beginning and in the end of the value we
-  // have to subtract from the size until there are either no more characters
-  // left or the last character is no separator.
-  while (value_size > 0 && cwk_path_is_separator(&value[value_size - 1])) {
-    --value_size;
+  watch->free = cwk_watch_get_nodes(watch)[index].chain;
+  return index;
+}
+
+static uint32_t cwk_watch_create(struct cwk_watch *watch, uint32_t parent,
+  const char *name, size_t length, uint64_t generation, bool directory)
+{
+  size_t offset;
+  uint32_t index;
+  struct cwk_watch_node *node;
+
+  index = cwk_watch_allocate(watch);
+  if (index == CWK_WATCH_NONE) {
+    return CWK_WATCH_NONE;
   }
 
-  // We also have to determine the tail size, which is the part of the string
-  // following the current segment. This part will not change.
-  tail_size = strlen(segment->end);
+  node = &cwk_watch_get_nodes(watch)[index];
+  if (!cwk_watch_store(watch, index, name, length, &offset)) {
+    node->chain = watch->free;
+    watch->free = index;
+    return CWK_WATCH_NONE;
+  }
 
-  // Now we output the tail. We have to do that, because if the buffer and the
-  // source are overlapping we would override the tail if the value is
-  // increasing in length.
-  cwk_path_output_sized(buffer, buffer_size, pos + value_size, segment->end,
-    tail_size);
+  node->created = generation;
+  node->generation = generation;
+  node->parent = parent;
+  node->first_child = CWK_WATCH_NONE;
+  node->name = (uint32_t)offset;
+  node->length = (uint32_t)length;
+  node->wd = -1;
+  node->flags = directory ? CWK_WATCH_FLAG_DIRECTORY : 0;
+  if (parent != CWK_WATCH_NONE) {
+    cwk_watch_link(watch, index);
+  }
+  ++watch->count;
 
-  // Finally we can output the value in the middle of the head and the tail,
-  // where we have enough space to fit the whole trimmed value.
-  pos += cwk_path_output_sized(buffer, buffer_size, pos, value, value_size);
+  // The entries of the first walk are not changes, so they are not listed.
+  if (generation > 0) {
+    cwk_watch_touch(watch, index, generation);
+  }
 
-  // Now we add the tail size to the current position and terminate the output -
-  // basically, ensure that there is a '\0' at the end of the buffer.
-  pos += tail_size;
-  cwk_path_terminate_output(buffer, buffer_size, pos);
+  return index;
+}
 
-  // And now tell the caller how long the whole path would be.
-  return pos;
+static void cwk_watch_remove(struct cwk_watch *watch, uint32_t index,
+  uint64_t generation)
+{
+  struct cwk_watch_node *nodes, *node;
+
+  // The entries below a directory are removed first, so they are older than
+  // their parent in the list and are reused before it.
+  nodes = cwk_watch_get_nodes(watch);
+  node = &nodes[index];
+  while (node->first_child != CWK_WATCH_NONE) {
+    cwk_watch_remove(watch, node->first_child, generation);
+  }
+
+  if (node->wd >= 0) {
+    inotify_rm_watch(watch->fd, node->wd);
+    cwk_watch_unmap(watch, index);
+  }
+
+  cwk_watch_unlink(watch, index);
+  --watch->count;
+
+  // An entry which has been added in the same update has never been seen by
+  // anyone, so it can be reused right away.
+  if (node->created == generation) {
+    if (node->flags & CWK_WATCH_FLAG_LISTED) {
+      cwk_watch_unlist(watch, index);
+    }
+    cwk_watch_release(watch, index);
+  } else {
+    node->flags |= CWK_WATCH_FLAG_REMOVED;
+    cwk_watch_touch(watch, index, generation);
+  }
 }
 
-enum cwk_path_style cwk_path_guess_style(const char *path)
+static size_t cwk_watch_build(const struct cwk_watch *watch, uint32_t index,
+  char *buffer, size_t buffer_size)
 {
-  const char *c;
-  size_t root_length;
+  size_t length;
+  const struct cwk_watch_block *root;
+
+  // The absolute path is the path of the watched directory followed by the
+  // path of the entry.
+  root = cwk_watch_get_block(watch, watch->root);
+  if (index == 0) {
+    if (root->length >= buffer_size) {
+      return 0;
+    }
+    memcpy(buffer, root + 1, root->length + 1);
+    return root->length;
+  }
+
+  length = cwk_watch_get_path(watch, index, buffer + root->length + 1,
+    buffer_size - root->length - 1);
+  if (root->length + 1 + length >= buffer_size) {
+    return 0;
+  }
+
+  memcpy(buffer, root + 1, root->length);
+  buffer[root->length] = '/';
+  return root->length + 1 + length;
+}
+
+static bool cwk_watch_scan(struct cwk_watch *watch, uint32_t index,
+  char *path, size_t length, uint64_t generation)
+{
+  int wd, error;
+  bool directory, result;
+  size_t name_length;
+  uint32_t child;
+  DIR *dir;
+  struct dirent *item;
+  struct stat info;
+
+  // The watch is added before the directory is read, so no file can be
+  // created in between without an event. Directories which vanish or which
+  // we may not read are skipped, except for the watched directory itself.
+  wd = inotify_add_watch(watch->fd, path, CWK_WATCH_MASK);
+  if (wd < 0) {
+    return index != 0 &&
+           (errno == ENOENT || errno == EACCES || errno == ENOTDIR);
+  } else if (cwk_watch_lookup_wd(watch, wd) != CWK_WATCH_NONE) {
+    return true;
+  }
+
+  cwk_watch_map(watch, index, wd);
+  dir = opendir(path);
+  if (dir == NULL) {
+    return index != 0 && (errno == ENOENT || errno == EACCES);
+  }
+
+  result = true;
+  while (result && (item = readdir(dir)) != NULL) {
+    if (item->d_name[0] == '.' &&
+        (item->d_name[1] == '\0' ||
+          (item->d_name[1] == '.' && item->d_name[2] == '\0'))) {
+      continue;
+    }
+
+    directory = false;
+#ifdef DT_DIR
+    directory = item->d_type == DT_DIR;
+    if (item->d_type == DT_UNKNOWN)
+#endif
+    {
+      directory = fstatat(dirfd(dir), item->d_name, &info,
+                    AT_SYMLINK_NOFOLLOW) == 0 &&
+                  S_ISDIR(info.st_mode);
+    }
+
+    name_length = strlen(item->d_name);
+    child = cwk_watch_lookup(watch, index, item->d_name, name_length);
+    if (child == CWK_WATCH_NONE) {
+      child = cwk_watch_create(watch, index, item->d_name, name_length,
+        generation, directory);
+      if (child == CWK_WATCH_NONE) {
+        result = false;
+        break;
+      }
+    }
+
+    if (directory && length + 1 + name_length < PATH_MAX) {
+      path[length] = '/';
+      memcpy(path + length + 1, item->d_name, name_length + 1);
+      result = cwk_watch_scan(watch, child, path, length + 1 + name_length,
+        generation);
+      path[length] = '\0';
+    }
+  }
+
+  error = errno;
+  closedir(dir);
+  errno = error;
+  return result;
+}
+
+static bool cwk_watch_move(struct cwk_watch *watch, uint32_t index,
+  uint32_t parent, const char *name, size_t length, uint64_t generation)
+{
+  size_t offset;
+  uint32_t target, removed;
+  char previous[256];
+  struct cwk_watch_node *nodes, *node;
+
+  // The entry keeps all entries below it and their watches, which follow
+  // the directory to its new place. The old path is recorded as a removed
+  // entry, unless nobody has seen it there yet.
+  nodes = cwk_watch_get_nodes(watch);
+  node = &nodes[index];
+  target = cwk_watch_lookup(watch, parent, name, length);
+  if (target != CWK_WATCH_NONE) {
+    cwk_watch_remove(watch, target, generation);
+  }
+
+  if (node->created != generation) {
+    memcpy(previous, cwk_watch_get_name(watch, node), node->length);
+    removed = cwk_watch_allocate(watch);
+    if (removed == CWK_WATCH_NONE ||
+        !cwk_watch_store(watch, removed, previous, node->length, &offset)) {
+      return false;
+    }
+
+    nodes[removed].created = node->created;
+    nodes[removed].parent = node->parent;
+    nodes[removed].first_child = CWK_WATCH_NONE;
+    nodes[removed].name = (uint32_t)offset;
+    nodes[removed].length = node->length;
+    nodes[removed].wd = -1;
+    nodes[removed].flags = CWK_WATCH_FLAG_REMOVED |
+                           (node->flags & CWK_WATCH_FLAG_DIRECTORY);
+    cwk_watch_touch(watch, removed, generation);
+  }
+
+  cwk_watch_unlink(watch, index);
+  cwk_watch_get_block(watch, node->name)->owner = CWK_WATCH_NONE;
+  if (!cwk_watch_store(watch, index, name, length, &offset)) {
+    return false;
+  }
+
+  node->parent = parent;
+  node->name = (uint32_t)offset;
+  node->length = (uint32_t)length;
+  node->created = generation;
+  cwk_watch_link(watch, index);
+  cwk_watch_touch(watch, index, generation);
+  return true;
+}
+
+static bool cwk_watch_apply(struct cwk_watch *watch,
+  const struct inotify_event *event, uint64_t generation)
+{
+  bool directory;
+  size_t length;
+  uint32_t parent, child;
+  char path[PATH_MAX];
+  struct cwk_watch_node *nodes;
+
+  nodes = cwk_watch_get_nodes(watch);
+  if (event->mask & IN_Q_OVERFLOW) {
+    errno = EOVERFLOW;
+    return false;
+  }
+
+  // Events of directories which have been removed already are ignored.
+  parent = cwk_watch_lookup_wd(watch, event->wd);
+  if (parent == CWK_WATCH_NONE) {
+    return true;
+  }
+
+  if (event->mask & (IN_IGNORED | IN_DELETE_SELF | IN_MOVE_SELF)) {
+    if (parent == 0) {
+      errno = ENOENT;
+      return false;
+    } else if (event->mask & IN_IGNORED) {
+      cwk_watch_unmap(watch, parent);
+    }
+    return true;
+  }
+
+  // A move which isn't followed by its other half right away has left the
+  // watched tree, so everything below it is gone.
+  if (watch->moved != CWK_WATCH_NONE &&
+      (!(event->mask & IN_MOVED_TO) || event->cookie != watch->cookie)) {
+    cwk_watch_remove(watch, watch->moved, generation);
+    watch->moved = CWK_WATCH_NONE;
+  }
+
+  length = event->len > 0 ? strnlen(event->name, event->len) : 0;
+  if (length == 0) {
+    cwk_watch_touch(watch, parent, generation);
+    return true;
+  }
+
+  child = cwk_watch_lookup(watch, parent, event->name, length);
+  directory = (event->mask & IN_ISDIR) != 0;
+  if (event->mask & IN_MOVED_FROM) {
+    if (child != CWK_WATCH_NONE) {
+      watch->moved = child;
+      watch->cookie = event->cookie;
+    }
+    return true;
+  } else if ((event->mask & IN_MOVED_TO) && watch->moved != CWK_WATCH_NONE) {
+    child = watch->moved;
+    watch->moved = CWK_WATCH_NONE;
+    return cwk_watch_move(watch, child, parent, event->name, length,
+      generation);
+  } else if (event->mask & IN_DELETE) {
+    if (child != CWK_WATCH_NONE) {
+      cwk_watch_remove(watch, child, generation);
+    }
+    return true;
+  } else if (!(event->mask & (IN_CREATE | IN_MOVED_TO))) {
+    if (child != CWK_WATCH_NONE) {
+      cwk_watch_touch(watch, child, generation);
+    }
+    return true;
+  }
+
+  // Something has been created or moved into the tree. If there already is
+  // an entry of the same type, it simply has been modified.
+  if (child != CWK_WATCH_NONE) {
+    if (!(event->mask & IN_MOVED_TO) &&
+        directory == ((nodes[child].flags & CWK_WATCH_FLAG_DIRECTORY) != 0)) {
+      cwk_watch_touch(watch, child, generation);
+      return true;
+    }
+    cwk_watch_remove(watch, child, generation);
+  }
+
+  child = cwk_watch_create(watch, parent, event->name, length, generation,
+    directory);
+  if (child == CWK_WATCH_NONE) {
+    return false;
+  } else if (!directory) {
+    return true;
+  }
+
+  length = cwk_watch_build(watch, child, path, sizeof(path));
+  return length == 0 || cwk_watch_scan(watch, child, path, length, generation);
+}
+
+struct cwk_watch *cwk_watch_init(void *buffer, size_t buffer_size,
+  const char *path)
+{
+  size_t i, length, offset;
+  char cwd[PATH_MAX], normalized[PATH_MAX];
+  struct cwk_watch *watch;
+  struct cwk_watch_node *nodes;
+
+  // The path is made absolute, so new directories can still be found if the
+  // working directory changes.
+  if (cwk_path_is_absolute(path)) {
+    length = cwk_path_normalize(path, normalized, sizeof(normalized));
+  } else if (getcwd(cwd, sizeof(cwd)) != NULL) {
+    length = cwk_path_get_absolute(cwd, path, normalized, sizeof(normalized));
+  } else {
+    return NULL;
+  }
+
+  if (length >= sizeof(normalized)) {
+    errno = ENAMETOOLONG;
+    return NULL;
+  }
+
+  // The offsets of the names are stored with 32 bits, so larger buffers are
+  // not used completely.
+  if (buffer_size > UINT32_MAX) {
+    buffer_size = UINT32_MAX;
+  }
+
+  if (buffer_size < sizeof(*watch) + 4096) {
+    errno = ENOBUFS;
+    return NULL;
+  }
+
+  // We use about 96 bytes for every entry, which includes its buckets and a
+  // short name.
+  watch = buffer;
+  watch->node_count = (uint32_t)((buffer_size - sizeof(*watch)) / 96);
+  watch->bucket_count = 1;
+  while (watch->bucket_count * 2 <= watch->node_count) {
+    watch->bucket_count *= 2;
+  }
+
+  nodes = cwk_watch_get_nodes(watch);
+  watch->names = (size_t)((char *)(nodes + watch->node_count) -
+                          (char *)watch);
+  watch->names_size = (buffer_size - watch->names) & ~(size_t)7;
+  watch->names_used = 0;
+  watch->count = 0;
+  watch->oldest = CWK_WATCH_NONE;
+  watch->newest = CWK_WATCH_NONE;
+  watch->moved = CWK_WATCH_NONE;
+  watch->cookie = 0;
+  watch->generation = 0;
+  watch->horizon = 0;
+  memset(cwk_watch_get_buckets(watch), 0xff,
+    watch->bucket_count * 2 * sizeof(uint32_t));
+
+  // All entries start in the list of free entries, with the first entry at
+  // its beginning, which becomes the root.
+  for (i = 0; i < watch->node_count; ++i) {
+    nodes[i].chain = i + 1 < watch->node_count ? (uint32_t)(i + 1)
+                                               : CWK_WATCH_NONE;
+  }
+  watch->free = 0;
+
+  watch->fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+  if (watch->fd < 0) {
+    return NULL;
+  }
+
+  if (!cwk_watch_store(watch, CWK_WATCH_ROOT, normalized, length, &offset) ||
+      cwk_watch_create(watch, CWK_WATCH_NONE, "", 0, 0, true) !=
+        0 ||
+      !cwk_watch_scan(watch, 0, normalized, length, 0)) {
+    cwk_watch_close(watch);
+    return NULL;
+  }
+
+  watch->root = offset;
+  return watch;
+}
+
+void cwk_watch_close(struct cwk_watch *watch)
+{
+  int error;
+
+  error = errno;
+  close(watch->fd);
+  errno = error;
+}
+
+int cwk_watch_get_fd(const struct cwk_watch *watch)
+{
+  return watch->fd;
+}
+
+int cwk_watch_update(struct cwk_watch *watch)
+{
+  ssize_t size, position;
+  uint64_t generation;
+  const struct inotify_event *event;
+  union
+  {
+    struct inotify_event event;
+    char buffer[4096];
+  } events;
+
+  // All events which are pending right now share the same generation, which
+  // only becomes the current one if anything visible has changed.
+  generation = watch->generation + 1;
+  for (;;) {
+    size = read(watch->fd, events.buffer, sizeof(events.buffer));
+    if (size < 0) {
+      if (errno == EINTR) {
+        continue;
+      } else if (errno != EAGAIN) {
+        return -1;
+      }
+      break;
+    }
+
+    for (position = 0; position < size;
+         position += (ssize_t)(sizeof(*event) + event->len)) {
+      event = (const struct inotify_event *)(void *)(events.buffer + position);
+      if (!cwk_watch_apply(watch, event, generation)) {
+        return -1;
+      }
+    }
+  }
+
+  if (watch->moved != CWK_WATCH_NONE) {
+    cwk_watch_remove(watch, watch->moved, generation);
+    watch->moved = CWK_WATCH_NONE;
+  }
+
+  if (watch->newest != CWK_WATCH_NONE &&
+      cwk_watch_get_nodes(watch)[watch->newest].generation == generation) {
+    watch->generation = generation;
+  }
+
+  return 0;
+}
+
+uint64_t cwk_watch_get_generation(const struct cwk_watch *watch)
+{
+  return watch->generation;
+}
+
+uint64_t cwk_watch_get_oldest_generation(const struct cwk_watch *watch)
+{
+  return watch->horizon;
+}
+
+size_t cwk_watch_get_count(const struct cwk_watch *watch)
+{
+  return watch->count;
+}
+
+bool cwk_watch_find(const struct cwk_watch *watch, const char *path,
+  size_t *entry)
+{
+  uint32_t index;
+  char relative[PATH_MAX];
   struct cwk_segment segment;
 
-  // First we determine the root. Only windows roots can be longer than a single
-  // slash, so if we can determine that it starts with something like "C:", we
-  // know that this is a windows path.
-  cwk_path_get_root_windows(path, &root_length);
-  if (root_length > 1) {
-    return CWK_STYLE_WINDOWS;
+  // Absolute paths are made relative to the watched directory first, which
+  // also normalizes them.
+  if (cwk_path_is_absolute(path)) {
+    if (cwk_path_get_relative(
+          (const char *)(cwk_watch_get_block(watch, watch->root) + 1), path,
+          relative, sizeof(relative)) >= sizeof(relative)) {
+      return false;
+    }
+    path = relative;
   }
 
-  // Next we check for slashes. Windows uses backslashes, while unix uses
-  // forward slashes. Windows actually supports both, but our best guess is to
-  // assume windows with backslashes and unix with forward slashes.
-  for (c = path; *c; ++c) {
-    if (*c == *separators[CWK_STYLE_UNIX]) {
-      return CWK_STYLE_UNIX;
-    } else if (*c == *separators[CWK_STYLE_WINDOWS]) {
-      return CWK_STYLE_WINDOWS;
+  index = 0;
+  if (!cwk_path_get_first_segment(path, &segment)) {
+    *entry = 0;
+    return true;
+  }
+
+  do {
+    switch (cwk_path_get_segment_type(&segment)) {
+    case CWK_CURRENT:
+      break;
+    case CWK_BACK:
+      if (index == 0) {
+        return false;
+      }
+      index = cwk_watch_get_nodes(watch)[index].parent;
+      break;
+    case CWK_NORMAL:
+      index = cwk_watch_lookup(watch, index, segment.begin, segment.size);
+      if (index == CWK_WATCH_NONE) {
+        return false;
+      }
+      break;
     }
+  } while (cwk_path_get_next_segment(&segment));
+
+  *entry = index;
+  return true;
+}
+
+size_t cwk_watch_get_path(const struct cwk_watch *watch, size_t entry,
+  char *buffer, size_t buffer_size)
+{
+  size_t length, position;
+  uint32_t index;
+  const struct cwk_watch_node *nodes, *current;
+
+  if (entry == 0) {
+    cwk_path_output_current(buffer, buffer_size, 0);
+    cwk_path_terminate_output(buffer, buffer_size, 1);
+    return 1;
   }
 
-  // This path does not have any slashes. We grab the last segment (which
-  // actually must be the first one), and determine whether the segment starts
-  // with a dot. A dot is a hidden folder or file in the UNIX world, in that
-  // case we assume the path to have UNIX style.
-  if (!cwk_path_get_last_segment(path, &segment)) {
-    // We couldn't find any segments, so we default to a UNIX path style since
-    // there is no way to make any assumptions.
-    return CWK_STYLE_UNIX;
+  // We measure the path first, and then write the names from the end of the
+  // path towards its beginning.
+  nodes = cwk_watch_get_nodes(watch);
+  length = 0;
+  for (index = (uint32_t)entry; index != 0; index = current->parent) {
+    current = &nodes[index];
+    length += current->length + (length > 0);
   }
 
-  if (*segment.begin == '.') {
-    return CWK_STYLE_UNIX;
+  position = length;
+  for (index = (uint32_t)entry; index != 0; index = current->parent) {
+    current = &nodes[index];
+    if (position < length) {
+      cwk_path_output_separator(buffer, buffer_size, position);
+    }
+    position -= current->length;
+    cwk_path_output_sized(buffer, buffer_size, position,
+      cwk_watch_get_name(watch, current), current->length);
+    if (position > 0) {
+      --position;
+    }
   }
 
-  // And finally we check whether the last segment contains a dot. If it
-  // contains a dot, that might be an extension. Windows is more likely to have
-  // file names with extensions, so our guess would be windows.
-  for (c = segment.begin; *c; ++c) {
-    if (*c == '.') {
-      return CWK_STYLE_WINDOWS;
+  cwk_path_terminate_output(buffer, buffer_size, length);
+  return length;
+}
+
+static bool cwk_watch_changes_step(struct cwk_watch_changes *changes)
+{
+  uint32_t index;
+  const struct cwk_watch_node *node;
+
+  // The list is ordered by generation, so we can stop at the first entry
+  // which is not newer than the submitted generation.
+  while (changes->position != CWK_WATCH_NONE) {
+    index = changes->position;
+    node = &cwk_watch_get_nodes(changes->watch)[index];
+    if (node->generation <= changes->generation) {
+      changes->position = CWK_WATCH_NONE;
+      return false;
+    }
+
+    changes->position = node->older;
+    if (node->created > changes->generation) {
+      if (node->flags & CWK_WATCH_FLAG_REMOVED) {
+        continue;
+      }
+      changes->change = CWK_WATCH_ADDED;
+    } else if (node->flags & CWK_WATCH_FLAG_REMOVED) {
+      changes->change = CWK_WATCH_REMOVED;
+    } else {
+      changes->change = CWK_WATCH_MODIFIED;
     }
+
+    changes->entry = index;
+    return true;
   }
 
-  // All our checks failed, so we will return a default value which is currently
-  // UNIX.
-  return CWK_STYLE_UNIX;
+  return false;
 }
 
-void cwk_path_set_style(enum cwk_path_style style)
+bool cwk_watch_changes_first(struct cwk_watch_changes *changes,
+  const struct cwk_watch *watch, uint64_t generation)
 {
-  // We can just set the global path style variable and then the behaviour for
-  // all functions will change accordingly.
-  assert(style == CWK_STYLE_UNIX || style == CWK_STYLE_WINDOWS);
-  path_style = style;
+  changes->watch = watch;
+  changes->generation = generation;
+  changes->position = watch->newest;
+  changes->entry = 0;
+  return cwk_watch_changes_step(changes);
 }
 
-enum cwk_path_style cwk_path_get_style(void)
+bool cwk_watch_changes_next(struct cwk_watch_changes *changes)
 {
-  // Simply return the path style which we store in a global variable.
-  return path_style;
+  return cwk_watch_changes_step(changes);
 }
+#endif
+#endif
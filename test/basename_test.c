@@ -311,3 +311,80 @@ int basename_simple(void)
 
   return EXIT_SUCCESS;
 }
+
+int basename_change_batch(void)
+{
+  const char *paths[] = {"/src/main.c", "lib/", "/", "", "a//b//"};
+  char buffer[FILENAME_MAX], expected[FILENAME_MAX];
+  size_t offsets[5], i, size, length;
+
+  cwk_path_set_style(CWK_STYLE_UNIX);
+  size = cwk_path_change_basename_batch(paths, 5, "/index.html/", buffer,
+    sizeof(buffer), offsets);
+
+  length = 0;
+  for (i = 0; i < 5; ++i) {
+    length += cwk_path_change_basename(paths[i], "/index.html/", expected,
+                sizeof(expected)) +
+              1;
+    if (strcmp(buffer + offsets[i], expected) != 0) {
+      return EXIT_FAILURE;
+    }
+  }
+
+  if (size != length || strcmp(buffer + offsets[0], "/src/index.html") != 0 ||
+      strcmp(buffer + offsets[4], "a//index.html//") != 0) {
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
+
+int basename_change_sized(void)
+{
+  size_t i, size_a, size_b, length;
+  char *a, *b, prefix_a[FILENAME_MAX], prefix_b[FILENAME_MAX],
+    expected[FILENAME_MAX], result[FILENAME_MAX];
+  const struct
+  {
+    enum cwk_path_style style;
+    const char *a;
+    const char *b;
+  } cases[] = {{CWK_STYLE_UNIX, "/a/b.txt//", "/c.md"},
+    {CWK_STYLE_UNIX, "rel", "x//"},
+    {CWK_STYLE_WINDOWS, "C:\\a\\b", "c\\"},
+    {CWK_STYLE_WINDOWS, "//server/share/a", "b"}};
+
+  // Every combination of prefixes is copied to memory of exactly its size,
+  // which has no null-terminating character. The result must be the same as
+  // the one of the terminated prefixes.
+  for (i = 0; i < sizeof(cases) / sizeof(cases[0]); ++i) {
+    cwk_path_set_style(cases[i].style);
+    for (size_a = 0; size_a <= strlen(cases[i].a); ++size_a) {
+      for (size_b = 0; size_b <= strlen(cases[i].b); ++size_b) {
+        memcpy(prefix_a, cases[i].a, size_a);
+        prefix_a[size_a] = '\0';
+        memcpy(prefix_b, cases[i].b, size_b);
+        prefix_b[size_b] = '\0';
+        length = cwk_path_change_basename(prefix_a, prefix_b, expected,
+          sizeof(expected));
+
+        a = malloc(size_a);
+        b = malloc(size_b);
+        memcpy(a, cases[i].a, size_a);
+        memcpy(b, cases[i].b, size_b);
+        if (cwk_path_change_basename_sized(a, size_a, b, size_b, result,
+              sizeof(result)) != length ||
+            strcmp(result, expected) != 0) {
+          free(a);
+          free(b);
+          return EXIT_FAILURE;
+        }
+        free(a);
+        free(b);
+      }
+    }
+  }
+
+  return EXIT_SUCCESS;
+}
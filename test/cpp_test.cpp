@@ -0,0 +1,652 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cwalk.hpp>
+#include <iterator>
+#include <string>
+#include <string_view>
+#include <unordered_set>
+#include <utility>
+
+extern "C" int cpp_root(void)
+{
+  cwk::set_style(CWK_STYLE_WINDOWS);
+  if (cwk::root("C:\\folder\\file") != "C:\\" ||
+      cwk::root("\\\\server\\share\\file") != "\\\\server\\share\\" ||
+      cwk::root("folder") != "" || cwk::root("") != "" ||
+      !cwk::is_absolute("C:\\folder") || !cwk::is_relative("C:folder")) {
+    return EXIT_FAILURE;
+  }
+
+  cwk::set_style(CWK_STYLE_UNIX);
+  if (cwk::root("/var") != "/" || cwk::root("var") != "" ||
+      !cwk::is_absolute("/var") || !cwk::is_relative("var") ||
+      cwk::get_style() != CWK_STYLE_UNIX) {
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
+
+extern "C" int cpp_root_unterminated(void)
+{
+  std::string_view path;
+
+  // The view ends in the middle of the share name, so the rest of the string
+  // must not be part of the root.
+  cwk::set_style(CWK_STYLE_WINDOWS);
+  path = std::string_view("\\\\server\\share\\file").substr(0, 11);
+  if (cwk::root(path) != "\\\\server\\sh" || cwk::is_absolute(path)) {
+    return EXIT_FAILURE;
+  }
+
+  path = std::string_view("C:\\folder").substr(0, 2);
+  if (cwk::root(path) != "C:" || cwk::is_absolute(path)) {
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
+
+extern "C" int cpp_basename(void)
+{
+  cwk::set_style(CWK_STYLE_UNIX);
+  if (cwk::basename("/var/log/syslog") != "syslog" ||
+      cwk::basename("/var/log/") != "log" || cwk::basename("/") != "" ||
+      cwk::basename("") != "" || cwk::dirname("/var/log/syslog") != "/var/log/" ||
+      cwk::dirname("syslog") != "" || cwk::dirname("/") != "") {
+    return EXIT_FAILURE;
+  }
+
+  // The view ends within the last segment.
+  if (cwk::basename(std::string_view("/var/log/syslog").substr(0, 12)) !=
+      "sys") {
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
+
+extern "C" int cpp_extension(void)
+{
+  std::string_view path;
+
+  cwk::set_style(CWK_STYLE_UNIX);
+  if (cwk::extension("/a/file.tar.gz") != ".gz" ||
+      cwk::extension("/a.b/file") != "" || !cwk::has_extension("file.txt/") ||
+      cwk::has_extension("file") || cwk::extension(".hidden") != ".hidden") {
+    return EXIT_FAILURE;
+  }
+
+  path = std::string_view("/a/file.txt.bak").substr(0, 11);
+  if (cwk::extension(path) != ".txt") {
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
+
+extern "C" int cpp_segments(void)
+{
+  const char *expected[] = {"var", ".", "log", "..", "lib"};
+  cwk_segment_type types[] = {CWK_NORMAL, CWK_CURRENT, CWK_NORMAL, CWK_BACK,
+    CWK_NORMAL};
+  std::size_t i;
+
+  cwk::set_style(CWK_STYLE_UNIX);
+  i = 0;
+  for (const cwk::segment &segment : cwk::segments("/var/./log//../lib/")) {
+    if (i >= 5 || segment.value != expected[i] || segment.type != types[i]) {
+      return EXIT_FAILURE;
+    }
+    ++i;
+  }
+
+  if (i != 5) {
+    return EXIT_FAILURE;
+  }
+
+  // Paths without segments don't iterate at all.
+  for (const cwk::segment &segment : cwk::segments("/")) {
+    (void)segment;
+    return EXIT_FAILURE;
+  }
+
+  for (const cwk::segment &segment : cwk::segments("")) {
+    (void)segment;
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
+
+extern "C" int cpp_segments_unterminated(void)
+{
+  std::string_view path;
+  std::size_t i;
+
+  // The view ends in the middle of a segment, which must be cut off.
+  cwk::set_style(CWK_STYLE_UNIX);
+  path = std::string_view("alpha/beta/gamma").substr(0, 8);
+  i = 0;
+  for (const cwk::segment &segment : cwk::segments(path)) {
+    if ((i == 0 && (segment.value != "alpha" || segment.offset != 0)) ||
+        (i == 1 && (segment.value != "be" || segment.offset != 6)) || i > 1) {
+      return EXIT_FAILURE;
+    }
+    ++i;
+  }
+
+  return i == 2 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+extern "C" int cpp_split(void)
+{
+  cwk_span spans[4];
+
+  cwk::set_style(CWK_STYLE_WINDOWS);
+  if (cwk::split("C:\\a\\bb/ccc", spans, 4) != 3 || spans[1].offset != 5 ||
+      spans[1].length != 2 || spans[2].length != 3 ||
+      cwk::split("", spans, 4) != 0) {
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
+
+extern "C" int cpp_output_buffer(void)
+{
+  char buffer[16];
+
+  cwk::set_style(CWK_STYLE_UNIX);
+  if (cwk::normalize("/a/./b/../c", buffer, sizeof(buffer)) != 4 ||
+      std::strcmp(buffer, "/a/c") != 0) {
+    return EXIT_FAILURE;
+  }
+
+  // The output is truncated just like the one of the C functions.
+  if (cwk::join("/a/long", "path/to/a/file", buffer, 8) != 22 ||
+      std::strcmp(buffer, "/a/long") != 0) {
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
+
+extern "C" int cpp_output_string(void)
+{
+  std::string result, base;
+
+  cwk::set_style(CWK_STYLE_UNIX);
+  base = "/home/user";
+  if (cwk::normalize("/a/./b/../c", result) != "/a/c" || result.size() != 4 ||
+      cwk::join(base, "docs", result) != "/home/user/docs" ||
+      cwk::absolute(base, "../other", result) != "/home/other" ||
+      cwk::relative(base, "/home/other/x", result) != "../other/x" ||
+      cwk::change_root("/a/b", "c/", result) != "c/a/b" ||
+      cwk::change_basename("/a/b.txt", "c.md", result) != "/a/c.md" ||
+      cwk::change_extension("/a/b.txt", "md", result) != "/a/b.md") {
+    return EXIT_FAILURE;
+  }
+
+  // An empty result leaves an empty string behind.
+  if (!cwk::normalize("", result).empty() || result.c_str()[0] != '\0') {
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
+
+extern "C" int cpp_output_view(void)
+{
+  std::string_view text;
+  std::string result;
+  cwk::path base;
+
+  // The views are cut from longer strings, so the functions must not read
+  // beyond their end.
+  cwk::set_style(CWK_STYLE_UNIX);
+  text = "/home/user/docs/file.txt.bak";
+  if (cwk::normalize(text.substr(0, 10), result) != "/home/user" ||
+      cwk::join(text.substr(0, 5), text.substr(6, 4), result) !=
+        "/home/user" ||
+      cwk::absolute(text.substr(0, 5), text.substr(6, 9), result) !=
+        "/home/user/docs" ||
+      cwk::relative(text.substr(0, 5), text.substr(0, 15), result) !=
+        "user/docs" ||
+      cwk::change_root(text.substr(0, 10), "x/", result) != "x/home/user" ||
+      cwk::change_basename(text.substr(0, 15), text.substr(16, 4), result) !=
+        "/home/user/file" ||
+      cwk::change_extension(text.substr(0, 24), text.substr(25, 3), result) !=
+        "/home/user/docs/file.bak") {
+    return EXIT_FAILURE;
+  }
+
+  // An empty view might not point anywhere at all.
+  if (cwk::join(std::string_view(), "a", result) != "a" ||
+      cwk::normalize(std::string_view(), result) != "") {
+    return EXIT_FAILURE;
+  }
+
+  base = "/home";
+  if (base.join(text.substr(6, 4)) != "/home/user" ||
+      base / text.substr(0, 5) != "/home/home") {
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
+
+// These are evaluated while compiling, so the test fails to build if the
+// functions can't be used in a constant expression.
+static_assert(cwk::literal::normalize("/a/./b/../c", CWK_STYLE_UNIX) == "/a/c");
+static_assert(cwk::literal::join("C:/a", "../b", CWK_STYLE_WINDOWS) ==
+              "C:\\b");
+static_assert(cwk::literal::basename("/a/b.txt/", CWK_STYLE_UNIX) == "b.txt");
+static_assert(cwk::literal::extension("/a/b.tar.gz", CWK_STYLE_UNIX) == ".gz");
+
+template <std::size_t N>
+static bool literal_normalize_equal(cwk_path_style style, const char (&path)[N])
+{
+  char buffer[FILENAME_MAX];
+  std::size_t length;
+
+  cwk::set_style(style);
+  length = cwk_path_normalize(path, buffer, sizeof(buffer));
+  return cwk::literal::normalize(path, style) == buffer &&
+         cwk::literal::normalize(path, style).size() == length;
+}
+
+template <std::size_t N, std::size_t M>
+static bool literal_join_equal(cwk_path_style style, const char (&path_a)[N],
+  const char (&path_b)[M])
+{
+  char buffer[FILENAME_MAX];
+  std::size_t length;
+
+  cwk::set_style(style);
+  length = cwk_path_join(path_a, path_b, buffer, sizeof(buffer));
+  return cwk::literal::join(path_a, path_b, style) == buffer &&
+         cwk::literal::join(path_a, path_b, style).size() == length;
+}
+
+static bool literal_basename_equal(cwk_path_style style, const char *path)
+{
+  const char *basename;
+  std::size_t length;
+
+  cwk::set_style(style);
+  cwk_path_get_basename(path, &basename, &length);
+  if (basename == nullptr) {
+    return cwk::literal::basename(path, style).empty();
+  }
+
+  return cwk::literal::basename(path, style) ==
+         std::string_view(basename, length);
+}
+
+static bool literal_extension_equal(cwk_path_style style, const char *path)
+{
+  const char *extension;
+  std::size_t length;
+
+  cwk::set_style(style);
+  if (!cwk_path_get_extension(path, &extension, &length)) {
+    return cwk::literal::extension(path, style).empty();
+  }
+
+  return cwk::literal::extension(path, style) ==
+         std::string_view(extension, length);
+}
+
+extern "C" int cpp_literal_normalize(void)
+{
+  // These are the paths of the C tests of the normalize function, together
+  // with a few which have dots in normal segments.
+  if (!literal_normalize_equal(CWK_STYLE_WINDOWS, "C:/this/is/a/test/path") ||
+      !literal_normalize_equal(CWK_STYLE_WINDOWS,
+        "C:\\..\\this\\is\\a\\test\\path") ||
+      !literal_normalize_equal(CWK_STYLE_UNIX, "////") ||
+      !literal_normalize_equal(CWK_STYLE_UNIX, "test/..") ||
+      !literal_normalize_equal(CWK_STYLE_UNIX,
+        "/var/./logs/.//test/..//..//////") ||
+      !literal_normalize_equal(CWK_STYLE_UNIX, "/var/././././") ||
+      !literal_normalize_equal(CWK_STYLE_UNIX, "/var////logs//test/") ||
+      !literal_normalize_equal(CWK_STYLE_UNIX, "/var/logs/test/../../") ||
+      !literal_normalize_equal(CWK_STYLE_UNIX, "rel/../../") ||
+      !literal_normalize_equal(CWK_STYLE_UNIX,
+        "/var/logs/test/../../../../../../") ||
+      !literal_normalize_equal(CWK_STYLE_UNIX, "/var") ||
+      !literal_normalize_equal(CWK_STYLE_UNIX, "") ||
+      !literal_normalize_equal(CWK_STYLE_UNIX, "./") ||
+      !literal_normalize_equal(CWK_STYLE_UNIX, "../a/../../b") ||
+      !literal_normalize_equal(CWK_STYLE_UNIX, "a//b/./c/..") ||
+      !literal_normalize_equal(CWK_STYLE_UNIX, ".a/../..b/.../..") ||
+      !literal_normalize_equal(CWK_STYLE_UNIX, "a\\b/..") ||
+      !literal_normalize_equal(CWK_STYLE_WINDOWS, "C:..\\a\\.") ||
+      !literal_normalize_equal(CWK_STYLE_WINDOWS, "C:") ||
+      !literal_normalize_equal(CWK_STYLE_WINDOWS, "C:a\\..") ||
+      !literal_normalize_equal(CWK_STYLE_WINDOWS, "\\\\?\\C:\\a\\..") ||
+      !literal_normalize_equal(CWK_STYLE_WINDOWS, "//server") ||
+      !literal_normalize_equal(CWK_STYLE_WINDOWS, "//server/share//a/../b")) {
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
+
+extern "C" int cpp_literal_join(void)
+{
+  // These are the paths of the C tests of the join function, together with a
+  // few where the first path has no segment.
+  if (!literal_join_equal(CWK_STYLE_WINDOWS, "this\\",
+        "C:\\..\\..\\is\\a\\test\\") ||
+      !literal_join_equal(CWK_STYLE_WINDOWS, "C:\\this\\path",
+        "C:\\..\\is\\a\\test\\") ||
+      !literal_join_equal(CWK_STYLE_WINDOWS, "C:\\this\\path",
+        "C:\\is\\a\\test\\") ||
+      !literal_join_equal(CWK_STYLE_WINDOWS, "\\\\server\\unc\\path",
+        "\\\\server2\\unc\\path") ||
+      !literal_join_equal(CWK_STYLE_UNIX, "/first", "/second") ||
+      !literal_join_equal(CWK_STYLE_UNIX, "hello", "..") ||
+      !literal_join_equal(CWK_STYLE_UNIX, "hello/there", "..") ||
+      !literal_join_equal(CWK_STYLE_UNIX, "hello", "there") ||
+      !literal_join_equal(CWK_STYLE_UNIX, "", "") ||
+      !literal_join_equal(CWK_STYLE_UNIX, "/", "../a") ||
+      !literal_join_equal(CWK_STYLE_UNIX, "..", "../a/./") ||
+      !literal_join_equal(CWK_STYLE_WINDOWS, "", "C:\\a\\..\\..") ||
+      !literal_join_equal(CWK_STYLE_WINDOWS, "C:\\", "D:\\a")) {
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
+
+extern "C" int cpp_literal_basename(void)
+{
+  if (!literal_basename_equal(CWK_STYLE_WINDOWS, "C:\\path\\test.txt") ||
+      !literal_basename_equal(CWK_STYLE_WINDOWS, "C:\\") ||
+      !literal_basename_equal(CWK_STYLE_WINDOWS, "\\\\server\\share\\a\\") ||
+      !literal_basename_equal(CWK_STYLE_UNIX, "/") ||
+      !literal_basename_equal(CWK_STYLE_UNIX, "..") ||
+      !literal_basename_equal(CWK_STYLE_UNIX, ".") ||
+      !literal_basename_equal(CWK_STYLE_UNIX, "file_name") ||
+      !literal_basename_equal(CWK_STYLE_UNIX, "/my/path.txt////") ||
+      !literal_basename_equal(CWK_STYLE_UNIX, "/my/path.txt/") ||
+      !literal_basename_equal(CWK_STYLE_UNIX, "") ||
+      !literal_basename_equal(CWK_STYLE_UNIX, "/my/path.txt")) {
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
+
+extern "C" int cpp_literal_extension(void)
+{
+  if (!literal_extension_equal(CWK_STYLE_UNIX, "/my/path.abc.txt.tests") ||
+      !literal_extension_equal(CWK_STYLE_UNIX, "/my/path.") ||
+      !literal_extension_equal(CWK_STYLE_UNIX, "/my/.path") ||
+      !literal_extension_equal(CWK_STYLE_UNIX, "/my/path") ||
+      !literal_extension_equal(CWK_STYLE_UNIX, "/my/path.txt") ||
+      !literal_extension_equal(CWK_STYLE_UNIX, "/my.dir/path/") ||
+      !literal_extension_equal(CWK_STYLE_UNIX, "") ||
+      !literal_extension_equal(CWK_STYLE_WINDOWS, "C:\\a.b\\c.txt\\")) {
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
+
+static bool path_is_inline(const cwk::path &path)
+{
+  const char *begin;
+
+  begin = reinterpret_cast<const char *>(&path);
+  return path.data() >= begin && path.data() < begin + sizeof(path);
+}
+
+extern "C" int cpp_path_inline(void)
+{
+  cwk::path path, copy, moved;
+
+  static_assert(sizeof(cwk::path) == 256);
+
+  cwk::set_style(CWK_STYLE_UNIX);
+  path = "/var/./log//../lib/";
+  if (path.view() != "/var/lib" || path.root() != "/" ||
+      path.segment_count() != 2 || !path.is_absolute() ||
+      path.basename() != "lib" || !path_is_inline(path)) {
+    return EXIT_FAILURE;
+  }
+
+  copy = path;
+  moved = std::move(copy);
+  if (moved != path || !path_is_inline(moved) || !copy.empty() ||
+      copy.c_str()[0] != '\0' || copy.segment_count() != 0) {
+    return EXIT_FAILURE;
+  }
+
+  if (!cwk::path().empty() || cwk::path("a/..").view() != "." ||
+      cwk::path("a/..").segment_count() != 1 || !cwk::path("a").is_relative()) {
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
+
+extern "C" int cpp_path_heap(void)
+{
+  std::string long_path, short_path;
+  const char *data;
+
+  cwk::set_style(CWK_STYLE_UNIX);
+  long_path = "/" + std::string(300, 'a') + "/file.txt";
+  cwk::path path(long_path);
+  if (path.size() != long_path.size() || path_is_inline(path) ||
+      path.view() != long_path || path.segment_count() != 2 ||
+      path.extension() != ".txt") {
+    return EXIT_FAILURE;
+  }
+
+  // A copy allocates its own memory, but a move just takes the buffer over.
+  cwk::path copy(path);
+  if (copy.data() == path.data() || copy != path) {
+    return EXIT_FAILURE;
+  }
+
+  data = path.data();
+  cwk::path moved(std::move(path));
+  if (moved.data() != data || !path.empty() || moved != copy) {
+    return EXIT_FAILURE;
+  }
+
+  // A long path which becomes short after normalization is stored inline.
+  short_path = "/" + std::string(300, 'a') + "/../b";
+  cwk::path normalized(short_path);
+  if (normalized.view() != "/b" || !path_is_inline(normalized)) {
+    return EXIT_FAILURE;
+  }
+
+  swap(moved, normalized);
+  if (moved.view() != "/b" || normalized != copy) {
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
+
+extern "C" int cpp_path_join(void)
+{
+  cwk::path base, result;
+  std::string segment;
+
+  cwk::set_style(CWK_STYLE_UNIX);
+  base = "/home/user";
+  result = base / "../other/./docs";
+  if (result.view() != "/home/other/docs" || result.segment_count() != 3 ||
+      (base / cwk::path("x")).view() != "/home/user/x") {
+    return EXIT_FAILURE;
+  }
+
+  // The joined path may not fit inline anymore.
+  segment = std::string(200, 'b');
+  result = (base / segment) / segment;
+  if (result.size() != 10 + 2 * 201 || path_is_inline(result) ||
+      result.segment_count() != 4) {
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
+
+extern "C" int cpp_path_compare(void)
+{
+  std::unordered_set<cwk::path> set;
+
+  // Windows paths are equal regardless of case and separators, and they must
+  // get the same hash as well.
+  cwk::set_style(CWK_STYLE_WINDOWS);
+  if (cwk::path("C:/Folder/File") != cwk::path("c:\\folder\\.\\FILE") ||
+      std::hash<cwk::path>()(cwk::path("C:/Folder/File")) !=
+        std::hash<cwk::path>()(cwk::path("c:\\folder\\FILE")) ||
+      !(cwk::path("C:\\a\\b") < cwk::path("C:\\a-b")) ||
+      !(cwk::path("C:\\b") > cwk::path("c:\\A"))) {
+    return EXIT_FAILURE;
+  }
+
+  set.insert("C:\\Windows\\System32");
+  set.insert("c:/windows/system32/");
+  set.insert("C:\\Windows\\System32\\..\\Temp");
+  if (set.size() != 2 || set.count("C:/WINDOWS/Temp") != 1) {
+    return EXIT_FAILURE;
+  }
+
+  cwk::set_style(CWK_STYLE_UNIX);
+  if (cwk::path("/a/B") == cwk::path("/a/b") ||
+      cwk::path("/a/b") != cwk::path("/a//b/") ||
+      !(cwk::path("/a") <= cwk::path("/a")) ||
+      !(cwk::path("/a") >= cwk::path("/a"))) {
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
+
+extern "C" int cpp_pathmap(void)
+{
+  cwk::path key;
+
+  cwk::set_style(CWK_STYLE_UNIX);
+  cwk::pathmap map(16);
+  key = "/srv/api/v1";
+  if (!map.insert("/srv/./www/", 1) || !map.insert(key, 2) ||
+      !map.insert(std::string("relative/path"), 3) || map.size() != 3) {
+    return EXIT_FAILURE;
+  }
+
+  if (map.find("/srv/x/../www") != 1u || map.find("//srv/api/v1/") != 2u ||
+      map.find("./relative//path") != 3u || map.find("/srv").has_value() ||
+      !map.contains(key) || map.contains("relative")) {
+    return EXIT_FAILURE;
+  }
+
+  // The map can be moved without moving its memory.
+  cwk::pathmap moved(std::move(map));
+  if (moved.find("/srv/www") != 1u || moved.size() != 3) {
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
+
+#if defined(__cpp_lib_ranges)
+static bool normalized_segments_equal(cwk_path_style style, const char *path)
+{
+  char buffer[FILENAME_MAX];
+  std::string expected, result;
+  std::size_t root_length;
+
+  // The remaining segments together with the root must produce the same path
+  // as the normalize function, except for the "." of an empty relative path.
+  cwk::set_style(style);
+  cwk_path_normalize(path, buffer, sizeof(buffer));
+  expected = buffer;
+  if (expected == ".") {
+    expected.clear();
+  }
+
+  // The root is copied as it is, only its separators might be replaced.
+  cwk_path_get_root(path, &root_length);
+  result.assign(buffer, root_length);
+  for (const cwk::segment &segment : cwk::normalized_segments(path)) {
+    if (result.size() > root_length) {
+      result += style == CWK_STYLE_WINDOWS ? '\\' : '/';
+    }
+    result += segment.value;
+  }
+
+  return result == expected;
+}
+#endif
+
+extern "C" int cpp_normalized_segments(void)
+{
+#if defined(__cpp_lib_ranges)
+  static_assert(std::ranges::forward_range<cwk::normalized_segment_view>);
+  static_assert(std::ranges::view<cwk::normalized_segment_view>);
+
+  if (!normalized_segments_equal(CWK_STYLE_UNIX, "/var/./logs/.//test/../") ||
+      !normalized_segments_equal(CWK_STYLE_UNIX, "rel/../../") ||
+      !normalized_segments_equal(CWK_STYLE_UNIX, "/var/logs/../../../a") ||
+      !normalized_segments_equal(CWK_STYLE_UNIX, "../a/../../b") ||
+      !normalized_segments_equal(CWK_STYLE_UNIX, "a//b/./c/..") ||
+      !normalized_segments_equal(CWK_STYLE_UNIX, "a/b/../../c/d/e/../..") ||
+      !normalized_segments_equal(CWK_STYLE_UNIX, "test/..") ||
+      !normalized_segments_equal(CWK_STYLE_UNIX, "////") ||
+      !normalized_segments_equal(CWK_STYLE_UNIX, "") ||
+      !normalized_segments_equal(CWK_STYLE_WINDOWS, "C:\\..\\this\\is") ||
+      !normalized_segments_equal(CWK_STYLE_WINDOWS, "C:..\\a\\.") ||
+      !normalized_segments_equal(CWK_STYLE_WINDOWS,
+        "//server/share//a/../b")) {
+    return EXIT_FAILURE;
+  }
+
+  // The segments point into the original path.
+  cwk::set_style(CWK_STYLE_UNIX);
+  for (const cwk::segment &segment : cwk::normalized_segments("/a/../b")) {
+    if (segment.offset != 6 || segment.type != CWK_NORMAL) {
+      return EXIT_FAILURE;
+    }
+  }
+#endif
+
+  return EXIT_SUCCESS;
+}
+
+extern "C" int cpp_normalized_segments_take(void)
+{
+#if defined(__cpp_lib_ranges)
+  const char *expected[] = {"srv", "api"};
+  std::size_t i;
+
+  // Only the first two remaining segments are taken, the "users" segment is
+  // removed by a later back segment and must not show up.
+  cwk::set_style(CWK_STYLE_UNIX);
+  i = 0;
+  for (const cwk::segment &segment :
+    cwk::normalized_segments("/./srv/users/../api/v1/x/../y") |
+      std::views::take(2)) {
+    if (i >= 2 || segment.value != expected[i]) {
+      return EXIT_FAILURE;
+    }
+    ++i;
+  }
+
+  if (i != 2 || std::ranges::distance(cwk::normalized_segments("a/b/c/..") |
+                                      std::views::drop(1)) != 1) {
+    return EXIT_FAILURE;
+  }
+#endif
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,180 @@
+#include <cwalk.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static int dedup_verify(const char **paths, const size_t *expected,
+  size_t count, size_t expected_unique)
+{
+  size_t i, unique;
+  size_t ids[16], table[32];
+
+  unique = cwk_path_dedup(paths, count, ids, table, 32);
+  if (unique != expected_unique) {
+    return EXIT_FAILURE;
+  }
+
+  for (i = 0; i < count; ++i) {
+    if (ids[i] != expected[i]) {
+      return EXIT_FAILURE;
+    }
+  }
+
+  return EXIT_SUCCESS;
+}
+
+int dedup_simple(void)
+{
+  const char *paths[] = {"a/./b", "a//b", "a/b/", "a/c", "x/../a/b", "a/c/."};
+  const size_t expected[] = {0, 0, 0, 1, 0, 1};
+
+  cwk_path_set_style(CWK_STYLE_UNIX);
+
+  return dedup_verify(paths, expected, 6, 2);
+}
+
+int dedup_absolute(void)
+{
+  const char *paths[] = {"/a/b", "a/b", "/../a/b", "/a/b/c/..", "//a/b"};
+  const size_t expected[] = {0, 1, 0, 0, 0};
+
+  cwk_path_set_style(CWK_STYLE_UNIX);
+
+  return dedup_verify(paths, expected, 5, 2);
+}
+
+int dedup_relative(void)
+{
+  const char *paths[] = {"../a", "a/../../a", "a", "./../a", "../../a"};
+  const size_t expected[] = {0, 0, 1, 0, 2};
+
+  cwk_path_set_style(CWK_STYLE_UNIX);
+
+  return dedup_verify(paths, expected, 5, 3);
+}
+
+int dedup_current(void)
+{
+  const char *paths[] = {"", ".", "a/..", "./", "/", "/.", "/a/.."};
+  const size_t expected[] = {0, 1, 1, 1, 2, 2, 2};
+
+  cwk_path_set_style(CWK_STYLE_UNIX);
+
+  return dedup_verify(paths, expected, 7, 3);
+}
+
+int dedup_windows(void)
+{
+  const char *paths[] = {"C:\\a\\b", "c:/A/B", "C:\\a\\.\\b\\", "D:\\a\\b",
+    "\\\\server\\share\\x", "//SERVER/share/y/../x"};
+  const size_t expected[] = {0, 0, 0, 1, 2, 2};
+
+  cwk_path_set_style(CWK_STYLE_WINDOWS);
+
+  return dedup_verify(paths, expected, 6, 3);
+}
+
+int dedup_unicode(void)
+{
+  const char *paths[] = {"C:\\\xc3\x84", "c:/\xc3\xa4", "C:\\\xc3\xb8",
+    "C:\\\xc5\xb8", "C:\\\xc3\xbf\\x\\.."};
+  const size_t expected[] = {0, 0, 1, 2, 2};
+
+  cwk_path_set_style(CWK_STYLE_WINDOWS);
+
+  return dedup_verify(paths, expected, 5, 3);
+}
+
+int dedup_case_sensitive(void)
+{
+  const char *paths[] = {"/a/b", "/A/B", "/a\\b"};
+  const size_t expected[] = {0, 1, 2};
+
+  cwk_path_set_style(CWK_STYLE_UNIX);
+
+  return dedup_verify(paths, expected, 3, 3);
+}
+
+int dedup_small_table(void)
+{
+  const char *paths[] = {"a", "b", "c"};
+  size_t ids[3], table[2];
+
+  cwk_path_set_style(CWK_STYLE_UNIX);
+
+  if (cwk_path_dedup(paths, 3, ids, table, 2) != 0) {
+    return EXIT_FAILURE;
+  }
+
+  if (cwk_path_dedup(paths, 0, ids, table, 0) != 0) {
+    return EXIT_FAILURE;
+  }
+
+  // A full table still works, since every path finds a free slot.
+  if (cwk_path_dedup(paths, 2, ids, table, 2) != 2) {
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
+
+int dedup_normalized(void)
+{
+  char storage[256][32], normalized[2][32];
+  const char *paths[256];
+  size_t ids[256], table[512];
+  size_t i, j, count;
+  unsigned int seed;
+  const char *segments[] = {"a", "b", ".", "..", ""};
+
+  cwk_path_set_style(CWK_STYLE_UNIX);
+
+  // We generate paths from a few segments, so that many of them are equal
+  // after normalization. The result must match a comparison of the normalized
+  // paths.
+  count = 256;
+  seed = 7;
+  for (i = 0; i < count; ++i) {
+    storage[i][0] = '\0';
+    for (j = 0; j < 5; ++j) {
+      seed = seed * 1103515245 + 12345;
+      strcat(storage[i], segments[(seed >> 16) % 5]);
+      strcat(storage[i], "/");
+    }
+    paths[i] = storage[i];
+  }
+
+  cwk_path_dedup(paths, count, ids, table, 512);
+  for (i = 0; i < count; ++i) {
+    cwk_path_normalize(paths[i], normalized[0], sizeof(normalized[0]));
+    for (j = 0; j < count; ++j) {
+      cwk_path_normalize(paths[j], normalized[1], sizeof(normalized[1]));
+      if ((strcmp(normalized[0], normalized[1]) == 0) != (ids[i] == ids[j])) {
+        return EXIT_FAILURE;
+      }
+    }
+  }
+
+  return EXIT_SUCCESS;
+}
+
+int dedup_hash(void)
+{
+  cwk_path_set_style(CWK_STYLE_UNIX);
+  if (cwk_path_hash("a/./b") != cwk_path_hash("x/../a/b/") ||
+      cwk_path_hash("/a/b") != cwk_path_hash("/../a//b") ||
+      cwk_path_hash(".") != cwk_path_hash("a/..") ||
+      cwk_path_hash("a/b") == cwk_path_hash("/a/b") ||
+      cwk_path_hash("a/b") == cwk_path_hash("a/B") ||
+      cwk_path_hash("") == cwk_path_hash(".")) {
+    return EXIT_FAILURE;
+  }
+
+  cwk_path_set_style(CWK_STYLE_WINDOWS);
+  if (cwk_path_hash("C:\\Folder\\File") != cwk_path_hash("c:/folder/./file") ||
+      cwk_path_hash("C:\\a") == cwk_path_hash("C:a")) {
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,316 @@
+#include "fixture.h"
+#include <cwalk.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static char base[256];
+static uint64_t memory[4096];
+
+static bool dircache_setup(void)
+{
+  // Every file holds its own path, so its content tells which file was read.
+  return cwk_fixture_setup(base, sizeof(base), "dircache") &&
+         cwk_fixture_create(base, "a", NULL) &&
+         cwk_fixture_create(base, "a/b", NULL) &&
+         cwk_fixture_create(base, "a/b/c", NULL) &&
+         cwk_fixture_create(base, "a/file", "a/file") &&
+         cwk_fixture_create(base, "a/b/file", "a/b/file") &&
+         cwk_fixture_create(base, "a/b/c/file", "a/b/c/file") &&
+         cwk_fixture_create(base, "a/b/c/other", "a/b/c/other") &&
+         cwk_fixture_link(base, "a/b", "rel");
+}
+
+static int dircache_verify(struct cwk_dircache *cache, const char *path)
+{
+  char input[PATH_MAX];
+  struct stat expected, info;
+
+  // The result must be the same file which stat finds.
+  snprintf(input, sizeof(input), "%s/%s", base, path);
+  if (stat(input, &expected) != 0 ||
+      cwk_dircache_stat(cache, input, &info, 0) != 0 ||
+      info.st_dev != expected.st_dev || info.st_ino != expected.st_ino) {
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
+
+static int dircache_verify_error(struct cwk_dircache *cache, const char *path,
+  int expected)
+{
+  char input[PATH_MAX];
+  struct stat info;
+
+  snprintf(input, sizeof(input), "%s/%s", base, path);
+  errno = 0;
+  if (cwk_dircache_stat(cache, input, &info, 0) != -1 || errno != expected) {
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
+
+int dircache_simple(void)
+{
+  int result;
+  size_t count;
+  struct cwk_dircache *cache;
+
+  cwk_path_set_style(CWK_STYLE_UNIX);
+  cache = cwk_dircache_init(memory, sizeof(memory));
+  if (cache == NULL || cwk_dircache_get_count(cache) != 0 ||
+      !dircache_setup()) {
+    return EXIT_FAILURE;
+  }
+
+  result = dircache_verify(cache, "a/b/c/file");
+  count = cwk_dircache_get_count(cache);
+  if (count == 0) {
+    result = EXIT_FAILURE;
+  }
+
+  // The parent directories are taken from the cache now, so the cache doesn't
+  // grow for files in the same directories.
+  result |= dircache_verify(cache, "a/b/c/other");
+  result |= dircache_verify(cache, "a/./b//c/file");
+  result |= dircache_verify(cache, "a/b/file");
+  result |= dircache_verify(cache, "a/b/c/");
+  result |= dircache_verify(cache, "a/b/c/.");
+  if (cwk_dircache_get_count(cache) != count) {
+    result = EXIT_FAILURE;
+  }
+
+  cwk_dircache_clear(cache);
+  if (cwk_dircache_get_count(cache) != 0) {
+    result = EXIT_FAILURE;
+  }
+
+  result |= dircache_verify(cache, "a/b/c/file");
+  result |= dircache_verify(cache, "");
+  cwk_dircache_clear(cache);
+
+  cwk_fixture_teardown(base);
+  return result;
+}
+
+int dircache_links(void)
+{
+  int result;
+  struct cwk_dircache *cache;
+
+  cwk_path_set_style(CWK_STYLE_UNIX);
+  cache = cwk_dircache_init(memory, sizeof(memory));
+  if (cache == NULL || !dircache_setup()) {
+    return EXIT_FAILURE;
+  }
+
+  // The back segment goes to the parent of the target of the link, just like
+  // it does with stat.
+  result = dircache_verify(cache, "rel/file");
+  result |= dircache_verify(cache, "rel/c/file");
+  result |= dircache_verify(cache, "rel/../file");
+  result |= dircache_verify(cache, "rel/c/../../file");
+  result |= dircache_verify_error(cache, "rel/../b/c/../../c", ENOENT);
+  cwk_dircache_clear(cache);
+
+  cwk_fixture_teardown(base);
+  return result;
+}
+
+int dircache_relative(void)
+{
+  int result;
+  char cwd[PATH_MAX];
+  struct stat info;
+  struct cwk_dircache *cache;
+
+  cwk_path_set_style(CWK_STYLE_UNIX);
+  cache = cwk_dircache_init(memory, sizeof(memory));
+  if (cache == NULL || !dircache_setup() || getcwd(cwd, sizeof(cwd)) == NULL) {
+    return EXIT_FAILURE;
+  }
+
+  result = EXIT_FAILURE;
+  if (chdir(base) == 0) {
+    if (cwk_dircache_stat(cache, "a/b/c/file", &info, 0) == 0 &&
+        S_ISREG(info.st_mode) &&
+        cwk_dircache_stat(cache, "rel", &info, 0) == 0 &&
+        S_ISDIR(info.st_mode) &&
+        cwk_dircache_stat(cache, "rel", &info, AT_SYMLINK_NOFOLLOW) == 0 &&
+        S_ISLNK(info.st_mode)) {
+      result = EXIT_SUCCESS;
+    }
+    if (chdir(cwd) != 0) {
+      result = EXIT_FAILURE;
+    }
+  }
+
+  cwk_dircache_clear(cache);
+  cwk_fixture_teardown(base);
+  return result;
+}
+
+int dircache_open(void)
+{
+  int fd, result;
+  char input[PATH_MAX], buffer[64];
+  ssize_t size;
+  struct cwk_dircache *cache;
+
+  cwk_path_set_style(CWK_STYLE_UNIX);
+  cache = cwk_dircache_init(memory, sizeof(memory));
+  if (cache == NULL || !dircache_setup()) {
+    return EXIT_FAILURE;
+  }
+
+  // The file is opened relative to its cached parent, so it must contain what
+  // was written to it by the setup.
+  result = EXIT_FAILURE;
+  snprintf(input, sizeof(input), "%s/a/b/c/file", base);
+  fd = cwk_dircache_open(cache, input, O_RDONLY, 0);
+  if (fd >= 0) {
+    size = read(fd, buffer, sizeof(buffer) - 1);
+    if (size == 10 && memcmp(buffer, "a/b/c/file", 10) == 0) {
+      result = EXIT_SUCCESS;
+    }
+    close(fd);
+  }
+
+  // Files can be created as well.
+  snprintf(input, sizeof(input), "%s/a/b/c/new", base);
+  fd = cwk_dircache_open(cache, input, O_WRONLY | O_CREAT | O_EXCL, 0600);
+  if (fd < 0) {
+    result = EXIT_FAILURE;
+  } else {
+    close(fd);
+    result |= dircache_verify(cache, "a/b/c/new");
+    cwk_fixture_remove(base, "a/b/c/new");
+  }
+
+  cwk_dircache_clear(cache);
+  cwk_fixture_teardown(base);
+  return result;
+}
+
+int dircache_errors(void)
+{
+  int result;
+  struct stat info;
+  struct cwk_dircache *cache;
+
+  cwk_path_set_style(CWK_STYLE_UNIX);
+  if (cwk_dircache_init(memory, 1024) != NULL) {
+    return EXIT_FAILURE;
+  }
+
+  cache = cwk_dircache_init(memory, sizeof(memory));
+  if (cache == NULL || !dircache_setup()) {
+    return EXIT_FAILURE;
+  }
+
+  result = dircache_verify_error(cache, "missing", ENOENT);
+  result |= dircache_verify_error(cache, "missing/file", ENOENT);
+  result |= dircache_verify_error(cache, "a/file/x", ENOTDIR);
+  result |= dircache_verify_error(cache, "a/file/", ENOTDIR);
+
+  errno = 0;
+  if (cwk_dircache_stat(cache, "", &info, 0) != -1 || errno != ENOENT) {
+    result = EXIT_FAILURE;
+  }
+
+  cwk_path_set_style(CWK_STYLE_WINDOWS);
+  errno = 0;
+  if (cwk_dircache_stat(cache, base, &info, 0) != -1 || errno != EINVAL) {
+    result = EXIT_FAILURE;
+  }
+
+  cwk_dircache_clear(cache);
+  cwk_fixture_teardown(base);
+  return result;
+}
+
+int dircache_evict(void)
+{
+  int result, i;
+  size_t capacity;
+  struct cwk_dircache *cache;
+
+  // This cache only fits a few directories, so they are closed and opened
+  // again all the time. The results must still be correct.
+  cwk_path_set_style(CWK_STYLE_UNIX);
+  cache = cwk_dircache_init(memory, 4096);
+  if (cache == NULL || !dircache_setup()) {
+    return EXIT_FAILURE;
+  }
+
+  result = EXIT_SUCCESS;
+  for (i = 0; i < 20; ++i) {
+    result |= dircache_verify(cache, "a/b/c/file");
+    result |= dircache_verify(cache, "rel/c/../file");
+    result |= dircache_verify(cache, "a/b/../b/c/../c/./other");
+  }
+
+  capacity = cwk_dircache_get_count(cache);
+  if (capacity < 8 || capacity > 4096 / 256) {
+    result = EXIT_FAILURE;
+  }
+
+  cwk_dircache_clear(cache);
+  cwk_fixture_teardown(base);
+  return result;
+}
+
+int dircache_batch(void)
+{
+  int result, errors[6];
+  size_t i, count;
+  char inputs[6][PATH_MAX];
+  const char *paths[6];
+  struct stat infos[6], expected;
+  struct cwk_dircache *cache;
+
+  cwk_path_set_style(CWK_STYLE_UNIX);
+  cache = cwk_dircache_init(memory, sizeof(memory));
+  if (cache == NULL || !dircache_setup()) {
+    return EXIT_FAILURE;
+  }
+
+  snprintf(inputs[0], PATH_MAX, "%s/a/b/c/other", base);
+  snprintf(inputs[1], PATH_MAX, "%s/a/file", base);
+  snprintf(inputs[2], PATH_MAX, "%s/a/b/c/missing", base);
+  snprintf(inputs[3], PATH_MAX, "%s/a/b/file", base);
+  snprintf(inputs[4], PATH_MAX, "%s/a/b/c/file", base);
+  snprintf(inputs[5], PATH_MAX, "%s/a/file/x", base);
+  for (i = 0; i < 6; ++i) {
+    paths[i] = inputs[i];
+  }
+
+  // The paths are sorted first, and the results follow the sorted paths.
+  count = cwk_dircache_stat_batch(cache, paths, 6, infos, errors, 0);
+  result = count == 4 ? EXIT_SUCCESS : EXIT_FAILURE;
+  for (i = 0; i < 6; ++i) {
+    if (i > 0 && cwk_path_compare(paths[i - 1], paths[i]) > 0) {
+      result = EXIT_FAILURE;
+    }
+
+    if (stat(paths[i], &expected) != 0) {
+      if (errors[i] != errno) {
+        result = EXIT_FAILURE;
+      }
+    } else if (errors[i] != 0 || infos[i].st_ino != expected.st_ino) {
+      result = EXIT_FAILURE;
+    }
+  }
+
+  cwk_dircache_clear(cache);
+  cwk_fixture_teardown(base);
+  return result;
+}
@@ -306,3 +306,146 @@ int extension_get_simple(void)
 
   return EXIT_SUCCESS;
 }
+
+int extension_change_batch(void)
+{
+  const char *paths[] = {"/src/main.c", "lib/util.h", "README", "/", "dir/",
+    ".hidden", "a.b/c.d.e"};
+  char buffer[FILENAME_MAX], expected[FILENAME_MAX];
+  size_t offsets[7], i, size, length;
+
+  cwk_path_set_style(CWK_STYLE_UNIX);
+  size = cwk_path_change_extension_batch(paths, 7, ".o", buffer,
+    sizeof(buffer), offsets);
+
+  // Every result must be the same as the one of the single function, and the
+  // results are stored one after another.
+  length = 0;
+  for (i = 0; i < 7; ++i) {
+    if (offsets[i] != length) {
+      return EXIT_FAILURE;
+    }
+
+    length += cwk_path_change_extension(paths[i], ".o", expected,
+                sizeof(expected)) +
+              1;
+    if (strcmp(buffer + offsets[i], expected) != 0) {
+      return EXIT_FAILURE;
+    }
+  }
+
+  if (size != length || strcmp(buffer + offsets[0], "/src/main.o") != 0 ||
+      strcmp(buffer + offsets[6], "a.b/c.d.o") != 0) {
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
+
+int extension_change_batch_truncated(void)
+{
+  const char *paths[] = {"a.c", "b.c", "c.c"};
+  char buffer[7];
+  size_t offsets[3];
+
+  // The first result fits, the second one is truncated and the third one is
+  // not written at all, but the offsets and the size are still calculated.
+  cwk_path_set_style(CWK_STYLE_UNIX);
+  memset(buffer, 'x', sizeof(buffer));
+  if (cwk_path_change_extension_batch(paths, 3, "txt", buffer, sizeof(buffer),
+        offsets) != 18) {
+    return EXIT_FAILURE;
+  }
+
+  if (offsets[0] != 0 || offsets[1] != 6 || offsets[2] != 12 ||
+      strcmp(buffer, "a.txt") != 0 || buffer[6] != '\0') {
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
+
+int extension_relocate_batch(void)
+{
+  const char *paths[] = {"/src/main.c", "util.c", "/", "C:\\src\\x.c",
+    "\\\\server\\share\\y.c"};
+  char buffer[FILENAME_MAX], expected[FILENAME_MAX], temp[FILENAME_MAX];
+  size_t offsets[5], i;
+
+  cwk_path_set_style(CWK_STYLE_UNIX);
+  cwk_path_relocate_batch(paths, 3, "build/", "o", buffer, sizeof(buffer),
+    offsets);
+  if (strcmp(buffer + offsets[0], "build/src/main.o") != 0 ||
+      strcmp(buffer + offsets[1], "build/util.o") != 0 ||
+      strcmp(buffer + offsets[2], "build/.o") != 0) {
+    return EXIT_FAILURE;
+  }
+
+  // The result must be the same as changing the extension first and the root
+  // afterwards.
+  cwk_path_set_style(CWK_STYLE_WINDOWS);
+  cwk_path_relocate_batch(paths, 5, "D:\\out\\", ".obj", buffer,
+    sizeof(buffer), offsets);
+  for (i = 0; i < 5; ++i) {
+    cwk_path_change_extension(paths[i], ".obj", temp, sizeof(temp));
+    cwk_path_change_root(temp, "D:\\out\\", expected, sizeof(expected));
+    if (strcmp(buffer + offsets[i], expected) != 0) {
+      return EXIT_FAILURE;
+    }
+  }
+
+  if (strcmp(buffer + offsets[3], "D:\\out\\src\\x.obj") != 0) {
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
+
+int extension_change_sized(void)
+{
+  size_t i, size_a, size_b, length;
+  char *a, *b, prefix_a[FILENAME_MAX], prefix_b[FILENAME_MAX],
+    expected[FILENAME_MAX], result[FILENAME_MAX];
+  const struct
+  {
+    enum cwk_path_style style;
+    const char *a;
+    const char *b;
+  } cases[] = {{CWK_STYLE_UNIX, "/a/b.txt/", ".md"},
+    {CWK_STYLE_UNIX, "/a/.hidden", "..x"},
+    {CWK_STYLE_UNIX, "rel.tar.gz", "zip"},
+    {CWK_STYLE_WINDOWS, "C:\\a\\b.c", "h"}};
+
+  // Every combination of prefixes is copied to memory of exactly its size,
+  // which has no null-terminating character. The result must be the same as
+  // the one of the terminated prefixes.
+  for (i = 0; i < sizeof(cases) / sizeof(cases[0]); ++i) {
+    cwk_path_set_style(cases[i].style);
+    for (size_a = 0; size_a <= strlen(cases[i].a); ++size_a) {
+      for (size_b = 0; size_b <= strlen(cases[i].b); ++size_b) {
+        memcpy(prefix_a, cases[i].a, size_a);
+        prefix_a[size_a] = '\0';
+        memcpy(prefix_b, cases[i].b, size_b);
+        prefix_b[size_b] = '\0';
+        length = cwk_path_change_extension(prefix_a, prefix_b, expected,
+          sizeof(expected));
+
+        a = malloc(size_a);
+        b = malloc(size_b);
+        memcpy(a, cases[i].a, size_a);
+        memcpy(b, cases[i].b, size_b);
+        if (cwk_path_change_extension_sized(a, size_a, b, size_b, result,
+              sizeof(result)) != length ||
+            strcmp(result, expected) != 0) {
+          free(a);
+          free(b);
+          return EXIT_FAILURE;
+        }
+        free(a);
+        free(b);
+      }
+    }
+  }
+
+  return EXIT_SUCCESS;
+}
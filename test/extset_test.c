@@ -0,0 +1,276 @@
+#include "fixture.h"
+#include <cwalk.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static uint64_t set[4096];
+
+static bool extset_build(const char **extensions, size_t count,
+  bool ignore_case)
+{
+  return CWK_FIXTURE_BUILD(cwk_extset_build, set, extensions, count,
+    ignore_case);
+}
+
+static bool extset_verify(const char *path, bool expected, size_t expected_id)
+{
+  size_t id;
+
+  id = (size_t)-1;
+  if (cwk_extset_match(set, path, &id) != expected) {
+    return false;
+  }
+
+  return !expected || id == expected_id;
+}
+
+int extset_find(void)
+{
+  const char *extensions[] = {".c", "h", ".cpp", "hpp", ".txt"};
+  size_t id;
+
+  if (!extset_build(extensions, 5, false)) {
+    return EXIT_FAILURE;
+  }
+
+  // The leading dot is optional for both building and finding.
+  if (!cwk_extset_find(set, "c", &id) || id != 0 ||
+      !cwk_extset_find(set, ".h", &id) || id != 1 ||
+      !cwk_extset_find(set, "cpp", &id) || id != 2 ||
+      !cwk_extset_find(set, ".hpp", &id) || id != 3 ||
+      !cwk_extset_find(set, "txt", &id) || id != 4) {
+    return EXIT_FAILURE;
+  }
+
+  if (cwk_extset_find(set, "cp", &id) || cwk_extset_find(set, "C", &id) ||
+      cwk_extset_find(set, "", &id) || cwk_extset_find(set, ".", &id) ||
+      cwk_extset_find(set, "txt.gz", &id)) {
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
+
+int extset_match_simple(void)
+{
+  const char *extensions[] = {"c", "h", "md"};
+
+  cwk_path_set_style(CWK_STYLE_UNIX);
+  if (!extset_build(extensions, 3, false)) {
+    return EXIT_FAILURE;
+  }
+
+  if (!extset_verify("src/cwalk.c", true, 0) ||
+      !extset_verify("/include/cwalk.h", true, 1) ||
+      !extset_verify("README.md/", true, 2) ||
+      !extset_verify("a.b/file.md//", true, 2) ||
+      !extset_verify("file.md.c", true, 0) ||
+      !extset_verify("file.cc", false, 0) ||
+      !extset_verify("file.c/other", false, 0) ||
+      !extset_verify("file.", false, 0) || !extset_verify("md", false, 0) ||
+      !extset_verify("/", false, 0) || !extset_verify("", false, 0)) {
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
+
+int extset_match_compound(void)
+{
+  const char *extensions[] = {"gz", "tar.gz", "tar", "a.b.c.d"};
+
+  cwk_path_set_style(CWK_STYLE_UNIX);
+  if (!extset_build(extensions, 4, false)) {
+    return EXIT_FAILURE;
+  }
+
+  // The longest extension wins, even if it is not the last one which was
+  // checked.
+  if (!extset_verify("archive.tar.gz", true, 1) ||
+      !extset_verify("archive.gz", true, 0) ||
+      !extset_verify("archive.tar", true, 2) ||
+      !extset_verify("x.tar.tar.gz", true, 1) ||
+      !extset_verify("x.a.b.c.d", true, 3) ||
+      !extset_verify("x.b.c.d", false, 0) ||
+      !extset_verify("dir.tar/file.x.gz", true, 0) ||
+      !extset_verify("tar.gz", true, 0) || !extset_verify(".tar.gz", true, 1)) {
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
+
+int extset_match_case(void)
+{
+  const char *extensions[] = {"JPG", "png", "Tar.Gz"};
+
+  cwk_path_set_style(CWK_STYLE_UNIX);
+  if (!extset_build(extensions, 3, true)) {
+    return EXIT_FAILURE;
+  }
+
+  if (!extset_verify("image.jpg", true, 0) ||
+      !extset_verify("image.JpG", true, 0) ||
+      !extset_verify("image.PNG", true, 1) ||
+      !extset_verify("a.TAR.gz", true, 2) || !extset_verify("a.GZ", false, 0)) {
+    return EXIT_FAILURE;
+  }
+
+  if (!extset_build(extensions, 3, false)) {
+    return EXIT_FAILURE;
+  }
+
+  if (!extset_verify("image.JPG", true, 0) ||
+      !extset_verify("image.jpg", false, 0) ||
+      !extset_verify("image.png", true, 1) ||
+      !extset_verify("image.PNG", false, 0)) {
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
+
+int extset_match_unicode(void)
+{
+  const char *extensions[] = {"ÄÖÜ", "δοκ"};
+
+  cwk_path_set_style(CWK_STYLE_UNIX);
+  if (!extset_build(extensions, 2, true)) {
+    return EXIT_FAILURE;
+  }
+
+  if (!extset_verify("datei.äöü", true, 0) ||
+      !extset_verify("datei.ÄöÜ", true, 0) ||
+      !extset_verify("file.ΔΟΚ", true, 1) ||
+      !extset_verify("file.δοκ", true, 1) ||
+      !extset_verify("file.aou", false, 0)) {
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
+
+int extset_match_hidden(void)
+{
+  const char *extensions[] = {"gitignore", "txt"};
+
+  cwk_path_set_style(CWK_STYLE_UNIX);
+  if (!extset_build(extensions, 2, false)) {
+    return EXIT_FAILURE;
+  }
+
+  // A dot at the beginning of the segment starts an extension, just like it
+  // does for cwk_path_get_extension.
+  if (!extset_verify(".gitignore", true, 0) ||
+      !extset_verify("repo/.gitignore", true, 0) ||
+      !extset_verify(".txt", true, 1) || !extset_verify("gitignore", false, 0) ||
+      !extset_verify(".", false, 0) || !extset_verify("..", false, 0)) {
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
+
+int extset_match_windows(void)
+{
+  const char *extensions[] = {"exe", "dll"};
+
+  cwk_path_set_style(CWK_STYLE_WINDOWS);
+  if (!extset_build(extensions, 2, true)) {
+    return EXIT_FAILURE;
+  }
+
+  if (!extset_verify("C:\\Windows\\notepad.EXE", true, 0) ||
+      !extset_verify("C:\\Windows\\System32\\kernel32.dll\\", true, 1) ||
+      !extset_verify("C:/tools.exe/x", false, 0) ||
+      !extset_verify("\\\\server.exe\\share.dll", false, 0) ||
+      !extset_verify("\\\\server\\share\\a.dll", true, 1)) {
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
+
+int extset_duplicates(void)
+{
+  const char *extensions[] = {"c", ".C", "h", ".c", "c"};
+  size_t id;
+
+  // The first of equal extensions wins, which depends on the case.
+  if (!extset_build(extensions, 5, true) || !cwk_extset_find(set, "c", &id) ||
+      id != 0 || !cwk_extset_find(set, "C", &id) || id != 0 ||
+      !cwk_extset_find(set, "h", &id) || id != 2) {
+    return EXIT_FAILURE;
+  }
+
+  if (!extset_build(extensions, 5, false) || !cwk_extset_find(set, "c", &id) ||
+      id != 0 || !cwk_extset_find(set, "C", &id) || id != 1 ||
+      !cwk_extset_find(set, "h", &id) || id != 2) {
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
+
+int extset_large(void)
+{
+  static char storage[600][16];
+  const char *extensions[600];
+  char path[32];
+  size_t i, id;
+
+  cwk_path_set_style(CWK_STYLE_UNIX);
+  for (i = 0; i < 600; ++i) {
+    snprintf(storage[i], sizeof(storage[i]), "e%zux", i * 7919 % 10007);
+    extensions[i] = storage[i];
+  }
+
+  if (!extset_build(extensions, 600, false)) {
+    return EXIT_FAILURE;
+  }
+
+  // Every extension must be found in its own slot, while similar extensions
+  // which are not in the set must not be found.
+  for (i = 0; i < 600; ++i) {
+    snprintf(path, sizeof(path), "dir/file.%s", storage[i]);
+    if (!cwk_extset_match(set, path, &id) || id != i) {
+      return EXIT_FAILURE;
+    }
+
+    snprintf(path, sizeof(path), "dir/file.%sx", storage[i]);
+    if (cwk_extset_match(set, path, &id)) {
+      return EXIT_FAILURE;
+    }
+  }
+
+  return EXIT_SUCCESS;
+}
+
+int extset_invalid(void)
+{
+  const char *empty[] = {"c", ""};
+  const char *dot[] = {"."};
+  size_t id;
+
+  // Empty extensions are rejected, even if they consist of a dot.
+  if (cwk_extset_build(empty, 2, false, NULL, 0) != 0 ||
+      cwk_extset_build(dot, 1, false, NULL, 0) != 0) {
+    return EXIT_FAILURE;
+  }
+
+  // An empty set is valid, but never matches anything.
+  if (cwk_extset_build(NULL, 0, false, set, sizeof(set)) == 0 ||
+      cwk_extset_find(set, "c", &id) || cwk_extset_match(set, "a.c", &id)) {
+    return EXIT_FAILURE;
+  }
+
+  // If the buffer is too small, nothing is written.
+  set[0] = 0;
+  if (cwk_extset_build(empty, 1, false, set, 8) == 0 || set[0] != 0) {
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
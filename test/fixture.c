@@ -0,0 +1,118 @@
+#include "fixture.h"
+#include <dirent.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static bool cwk_fixture_remove_path(const char *path)
+{
+  DIR *dir;
+  struct dirent *item;
+  struct stat info;
+  char buffer[PATH_MAX];
+
+  // We use lstat, so that a link to a directory is removed like a file instead
+  // of removing the content of its target.
+  if (lstat(path, &info) != 0) {
+    return false;
+  } else if (!S_ISDIR(info.st_mode)) {
+    return unlink(path) == 0;
+  }
+
+  dir = opendir(path);
+  if (dir != NULL) {
+    while ((item = readdir(dir)) != NULL) {
+      if (strcmp(item->d_name, ".") != 0 && strcmp(item->d_name, "..") != 0) {
+        snprintf(buffer, sizeof(buffer), "%s/%s", path, item->d_name);
+        cwk_fixture_remove_path(buffer);
+      }
+    }
+    closedir(dir);
+  }
+
+  return rmdir(path) == 0;
+}
+
+bool cwk_fixture_setup(char *base, size_t base_size, const char *name)
+{
+  const char *temporary;
+  char directory[PATH_MAX], buffer[PATH_MAX];
+
+  temporary = getenv("TMPDIR");
+  if (temporary == NULL || *temporary == '\0') {
+    temporary = "/tmp";
+  }
+
+  snprintf(directory, sizeof(directory), "%s/cwalk_%s_XXXXXX", temporary,
+    name);
+  if (mkdtemp(directory) == NULL) {
+    return false;
+  }
+
+  if (realpath(directory, buffer) == NULL || strlen(buffer) >= base_size) {
+    cwk_fixture_remove_path(directory);
+    return false;
+  }
+
+  strcpy(base, buffer);
+  return true;
+}
+
+bool cwk_fixture_create(const char *base, const char *path,
+  const char *content)
+{
+  FILE *file;
+  char buffer[PATH_MAX];
+
+  snprintf(buffer, sizeof(buffer), "%s/%s", base, path);
+  if (content == NULL) {
+    return mkdir(buffer, 0700) == 0;
+  }
+
+  file = fopen(buffer, "w");
+  if (file == NULL) {
+    return false;
+  }
+
+  fputs(content, file);
+  return fclose(file) == 0;
+}
+
+bool cwk_fixture_fill(const char *base, const char *path, size_t size)
+{
+  FILE *file;
+  char buffer[PATH_MAX];
+
+  snprintf(buffer, sizeof(buffer), "%s/%s", base, path);
+  file = fopen(buffer, "w");
+  if (file == NULL) {
+    return false;
+  }
+
+  fprintf(file, "%*s", (int)size, "");
+  return fclose(file) == 0;
+}
+
+bool cwk_fixture_link(const char *base, const char *target, const char *path)
+{
+  char buffer[PATH_MAX];
+
+  snprintf(buffer, sizeof(buffer), "%s/%s", base, path);
+  return symlink(target, buffer) == 0;
+}
+
+bool cwk_fixture_remove(const char *base, const char *path)
+{
+  char buffer[PATH_MAX];
+
+  snprintf(buffer, sizeof(buffer), "%s/%s", base, path);
+  return cwk_fixture_remove_path(buffer);
+}
+
+void cwk_fixture_teardown(const char *base)
+{
+  cwk_fixture_remove_path(base);
+}
@@ -0,0 +1,89 @@
+#pragma once
+
+#ifndef CWK_FIXTURE_H
+#define CWK_FIXTURE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/**
+ * Builds a structure with one of the build functions of the library, which take
+ * the buffer and its size as their last two arguments. The size is measured
+ * with an empty buffer first, and the structure must fit into the array and
+ * have exactly that size once it is built.
+ */
+#define CWK_FIXTURE_BUILD(function, array, ...)                                \
+  cwk_fixture_check_build(function(__VA_ARGS__, NULL, 0),                      \
+    function(__VA_ARGS__, array, sizeof(array)), sizeof(array))
+
+static inline bool cwk_fixture_check_build(size_t measured, size_t size,
+  size_t capacity)
+{
+  return measured != 0 && measured <= capacity && size == measured;
+}
+
+/**
+ * @brief Creates a new temporary directory.
+ *
+ * The directory is created in TMPDIR, or in /tmp if that is not set. The
+ * temporary directory might be a link itself, so the canonical path of the new
+ * directory is stored in base.
+ *
+ * @param base The buffer where the path of the directory will be stored.
+ * @param base_size The size of the buffer.
+ * @param name The name of the test, which is part of the directory name.
+ * @return Returns false if the directory could not be created.
+ */
+bool cwk_fixture_setup(char *base, size_t base_size, const char *name);
+
+/**
+ * @brief Creates a file or directory within the temporary directory.
+ *
+ * @param base The temporary directory.
+ * @param path The path of the new file, relative to the temporary directory.
+ * @param content The content of the file, or NULL to create a directory.
+ * @return Returns false if the file could not be created.
+ */
+bool cwk_fixture_create(const char *base, const char *path,
+  const char *content);
+
+/**
+ * @brief Creates a file of the submitted size within the temporary directory.
+ *
+ * @param base The temporary directory.
+ * @param path The path of the new file, relative to the temporary directory.
+ * @param size The number of spaces which will be written to the file.
+ * @return Returns false if the file could not be created.
+ */
+bool cwk_fixture_fill(const char *base, const char *path, size_t size);
+
+/**
+ * @brief Creates a symbolic link within the temporary directory.
+ *
+ * @param base The temporary directory.
+ * @param target The target of the link, which is stored as it is.
+ * @param path The path of the new link, relative to the temporary directory.
+ * @return Returns false if the link could not be created.
+ */
+bool cwk_fixture_link(const char *base, const char *target, const char *path);
+
+/**
+ * @brief Removes a file or a whole directory within the temporary directory.
+ *
+ * Links are removed themselves, the files they point to are never touched.
+ *
+ * @param base The temporary directory.
+ * @param path The path which will be removed, relative to the temporary
+ * directory.
+ * @return Returns false if the path could not be removed.
+ */
+bool cwk_fixture_remove(const char *base, const char *path);
+
+/**
+ * @brief Removes the temporary directory with everything in it.
+ *
+ * @param base The temporary directory.
+ */
+void cwk_fixture_teardown(const char *base);
+
+#endif
@@ -0,0 +1,51 @@
+#include "fuzz.h"
+#include <string.h>
+
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size)
+{
+  struct cwk_fuzz_input input;
+  struct cwk_segment segment;
+  size_t basename_length, length, truncated_length, size_hint;
+  const char *basename;
+  char *full, *truncated, *inplace;
+
+  if (!cwk_fuzz_decode(data, size, &input)) {
+    return 0;
+  }
+
+  // The basename is the last segment of the path.
+  cwk_path_get_basename(input.args[0], &basename, &basename_length);
+  if (cwk_path_get_last_segment(input.args[0], &segment)) {
+    CWK_FUZZ_CHECK(basename == segment.begin);
+    CWK_FUZZ_CHECK(basename_length == segment.size);
+  } else {
+    CWK_FUZZ_CHECK(basename == NULL && basename_length == 0);
+  }
+
+  length = cwk_path_change_basename(input.args[0], input.args[1], NULL, 0);
+  full = cwk_fuzz_buffer(length + 1);
+  CWK_FUZZ_CHECK(cwk_path_change_basename(input.args[0], input.args[1], full,
+                   length + 1) == length);
+
+  // A truncated output must be a prefix of the full output.
+  size_hint = input.hint % (length + 2);
+  truncated = cwk_fuzz_buffer(size_hint);
+  truncated_length = cwk_path_change_basename(input.args[0], input.args[1],
+    truncated, size_hint);
+  cwk_fuzz_check_truncation(full, length, truncated, size_hint,
+    truncated_length);
+
+  // The path may be the same memory as the buffer.
+  inplace = cwk_fuzz_buffer(
+    (length > input.lengths[0] ? length : input.lengths[0]) + 1);
+  memcpy(inplace, input.args[0], input.lengths[0] + 1);
+  CWK_FUZZ_CHECK(cwk_path_change_basename(inplace, input.args[1], inplace,
+                   length + 1) == length);
+  CWK_FUZZ_CHECK(strcmp(inplace, full) == 0);
+
+  free(inplace);
+  free(truncated);
+  free(full);
+  cwk_fuzz_free(&input);
+  return 0;
+}
@@ -0,0 +1,25 @@
+#include "fuzz.h"
+#include <string.h>
+
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size)
+{
+  struct cwk_fuzz_input input;
+  size_t length, basename_length;
+  const char *basename;
+
+  if (!cwk_fuzz_decode(data, size, &input)) {
+    return 0;
+  }
+
+  // The dirname ends right where the basename begins.
+  cwk_path_get_dirname(input.args[0], &length);
+  cwk_path_get_basename(input.args[0], &basename, &basename_length);
+  if (basename == NULL) {
+    CWK_FUZZ_CHECK(length == 0);
+  } else {
+    CWK_FUZZ_CHECK(input.args[0] + length == basename);
+  }
+
+  cwk_fuzz_free(&input);
+  return 0;
+}
@@ -0,0 +1,198 @@
+#include "fuzz.h"
+#include <string.h>
+
+static void cwk_fuzz_check_extset(const struct cwk_fuzz_input *input)
+{
+  struct cwk_segment segment;
+  const char *arguments[2], *extensions[2];
+  size_t i, count, size, id, length, expected_length, expected_id;
+  uint64_t *set;
+  bool found, ignore_case;
+
+  // The set is built from the other arguments, which must not be empty.
+  count = 0;
+  for (i = 1; i < 3; ++i) {
+    arguments[count] = input->args[i];
+    extensions[count] = input->args[i];
+    if (*extensions[count] == '.') {
+      ++extensions[count];
+    }
+
+    if (*extensions[count] != '\0') {
+      ++count;
+    }
+  }
+
+  ignore_case = (input->hint & 1) != 0;
+  size = cwk_extset_build(arguments, count, ignore_case, NULL, 0);
+  CWK_FUZZ_CHECK(size != 0);
+  set = (uint64_t *)cwk_fuzz_buffer(size);
+  CWK_FUZZ_CHECK(cwk_extset_build(arguments, count, ignore_case, set, size) ==
+                 size);
+
+  // Every extension must be found, either by itself or by an earlier one which
+  // is equal to it.
+  for (i = 0; i < count; ++i) {
+    CWK_FUZZ_CHECK(cwk_extset_find(set, arguments[i], &id));
+    CWK_FUZZ_CHECK(id <= i);
+    CWK_FUZZ_CHECK(ignore_case || strcmp(extensions[id], extensions[i]) == 0);
+  }
+
+  // Without ignoring the case, the longest extension at the end of the last
+  // segment must match, which we check by comparing all of them.
+  found = cwk_extset_match(set, input->args[0], &id);
+  if (!ignore_case) {
+    expected_length = 0;
+    expected_id = 0;
+    if (cwk_path_get_last_segment(input->args[0], &segment)) {
+      for (i = 0; i < count; ++i) {
+        length = strlen(extensions[i]);
+        if (length < segment.size && length > expected_length &&
+            segment.end[-(ptrdiff_t)length - 1] == '.' &&
+            memcmp(segment.end - length, extensions[i], length) == 0) {
+          expected_length = length;
+          expected_id = i;
+        }
+      }
+    }
+
+    CWK_FUZZ_CHECK(found == (expected_length != 0));
+    CWK_FUZZ_CHECK(!found || id == expected_id);
+  }
+
+  free(set);
+}
+
+static void cwk_fuzz_check_batch(const struct cwk_fuzz_input *input)
+{
+  const char *paths[3];
+  char *buffer, *expected, *temp;
+  size_t i, size, length, offsets[3], root_length, temp_root_length;
+
+  // The batch functions must produce the same results as the single ones, so
+  // we use every argument as a path and the second one as the new value.
+  for (i = 0; i < 3; ++i) {
+    paths[i] = input->args[i];
+  }
+
+  size = cwk_path_change_extension_batch(paths, 3, input->args[1], NULL, 0,
+    offsets);
+  buffer = cwk_fuzz_buffer(size);
+  CWK_FUZZ_CHECK(cwk_path_change_extension_batch(paths, 3, input->args[1],
+                   buffer, size, offsets) == size);
+  for (i = 0; i < 3; ++i) {
+    length = cwk_path_change_extension(paths[i], input->args[1], NULL, 0);
+    expected = cwk_fuzz_buffer(length + 1);
+    cwk_path_change_extension(paths[i], input->args[1], expected, length + 1);
+    CWK_FUZZ_CHECK(strcmp(buffer + offsets[i], expected) == 0);
+    free(expected);
+  }
+  free(buffer);
+
+  size = cwk_path_change_basename_batch(paths, 3, input->args[1], NULL, 0,
+    offsets);
+  buffer = cwk_fuzz_buffer(size);
+  CWK_FUZZ_CHECK(cwk_path_change_basename_batch(paths, 3, input->args[1],
+                   buffer, size, offsets) == size);
+  for (i = 0; i < 3; ++i) {
+    length = cwk_path_change_basename(paths[i], input->args[1], NULL, 0);
+    expected = cwk_fuzz_buffer(length + 1);
+    cwk_path_change_basename(paths[i], input->args[1], expected, length + 1);
+    CWK_FUZZ_CHECK(strcmp(buffer + offsets[i], expected) == 0);
+    free(expected);
+  }
+  free(buffer);
+
+  size = cwk_path_change_root_batch(paths, 3, input->args[1], NULL, 0,
+    offsets);
+  buffer = cwk_fuzz_buffer(size);
+  CWK_FUZZ_CHECK(cwk_path_change_root_batch(paths, 3, input->args[1], buffer,
+                   size, offsets) == size);
+  for (i = 0; i < 3; ++i) {
+    length = cwk_path_change_root(paths[i], input->args[1], NULL, 0);
+    expected = cwk_fuzz_buffer(length + 1);
+    cwk_path_change_root(paths[i], input->args[1], expected, length + 1);
+    CWK_FUZZ_CHECK(strcmp(buffer + offsets[i], expected) == 0);
+    free(expected);
+  }
+  free(buffer);
+
+  // Relocating is the same as changing the extension and then the root, as
+  // long as the root of the path stays the same when changing the extension.
+  size = cwk_path_relocate_batch(paths, 3, input->args[2], input->args[1], NULL,
+    0, offsets);
+  buffer = cwk_fuzz_buffer(size);
+  CWK_FUZZ_CHECK(cwk_path_relocate_batch(paths, 3, input->args[2],
+                   input->args[1], buffer, size, offsets) == size);
+  for (i = 0; i < 3; ++i) {
+    length = cwk_path_change_extension(paths[i], input->args[1], NULL, 0);
+    temp = cwk_fuzz_buffer(length + 1);
+    cwk_path_change_extension(paths[i], input->args[1], temp, length + 1);
+    cwk_path_get_root(paths[i], &root_length);
+    cwk_path_get_root(temp, &temp_root_length);
+    if (root_length == temp_root_length) {
+      length = cwk_path_change_root(temp, input->args[2], NULL, 0);
+      expected = cwk_fuzz_buffer(length + 1);
+      cwk_path_change_root(temp, input->args[2], expected, length + 1);
+      CWK_FUZZ_CHECK(strcmp(buffer + offsets[i], expected) == 0);
+      free(expected);
+    }
+    free(temp);
+  }
+  free(buffer);
+}
+
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size)
+{
+  struct cwk_fuzz_input input;
+  size_t extension_length, basename_length, length, truncated_length,
+    size_hint;
+  const char *extension, *basename;
+  char *full, *truncated, *inplace;
+  bool has_extension;
+
+  if (!cwk_fuzz_decode(data, size, &input)) {
+    return 0;
+  }
+
+  // The extension starts with a dot and must be within the basename.
+  has_extension = cwk_path_get_extension(input.args[0], &extension,
+    &extension_length);
+  CWK_FUZZ_CHECK(has_extension == cwk_path_has_extension(input.args[0]));
+  if (has_extension) {
+    cwk_path_get_basename(input.args[0], &basename, &basename_length);
+    CWK_FUZZ_CHECK(*extension == '.');
+    CWK_FUZZ_CHECK(extension >= basename);
+    CWK_FUZZ_CHECK(extension + extension_length == basename + basename_length);
+  }
+
+  length = cwk_path_change_extension(input.args[0], input.args[1], NULL, 0);
+  full = cwk_fuzz_buffer(length + 1);
+  CWK_FUZZ_CHECK(cwk_path_change_extension(input.args[0], input.args[1], full,
+                   length + 1) == length);
+
+  // A truncated output must be a prefix of the full output.
+  size_hint = input.hint % (length + 2);
+  truncated = cwk_fuzz_buffer(size_hint);
+  truncated_length = cwk_path_change_extension(input.args[0], input.args[1],
+    truncated, size_hint);
+  cwk_fuzz_check_truncation(full, length, truncated, size_hint,
+    truncated_length);
+
+  // The path may be the same memory as the buffer.
+  inplace = cwk_fuzz_buffer(
+    (length > input.lengths[0] ? length : input.lengths[0]) + 1);
+  memcpy(inplace, input.args[0], input.lengths[0] + 1);
+  CWK_FUZZ_CHECK(cwk_path_change_extension(inplace, input.args[1], inplace,
+                   length + 1) == length);
+  CWK_FUZZ_CHECK(strcmp(inplace, full) == 0);
+
+  cwk_fuzz_check_extset(&input);
+  cwk_fuzz_check_batch(&input);
+
+  free(inplace);
+  free(truncated);
+  free(full);
+  cwk_fuzz_free(&input);
+  return 0;
+}
@@ -0,0 +1,248 @@
+#include "fuzz.h"
+#include <string.h>
+
+/**
+ * Inputs larger than this are rejected. Some of the fuzz targets verify every
+ * possible buffer size, which would get very slow with huge inputs.
+ */
+#define CWK_FUZZ_MAX_SIZE 4096
+
+/**
+ * The reference implementation keeps track of the segments which survived so
+ * far using a simple stack.
+ */
+struct cwk_fuzz_stack
+{
+  const char *begins[CWK_FUZZ_MAX_SIZE];
+  size_t sizes[CWK_FUZZ_MAX_SIZE];
+  size_t count;
+};
+
+static bool cwk_fuzz_is_separator(char c)
+{
+  if (c == '/') {
+    return true;
+  }
+
+  return cwk_path_get_style() == CWK_STYLE_WINDOWS && c == '\\';
+}
+
+static char cwk_fuzz_preferred_separator(void)
+{
+  return cwk_path_get_style() == CWK_STYLE_WINDOWS ? '\\' : '/';
+}
+
+bool cwk_fuzz_decode(const uint8_t *data, size_t size,
+  struct cwk_fuzz_input *input)
+{
+  size_t i, begin, end;
+
+  if (size < 1 || size > CWK_FUZZ_MAX_SIZE) {
+    return false;
+  }
+
+  // The first byte is the control byte, which selects the style and gives us a
+  // hint for the size of truncated buffers.
+  input->style = (data[0] & 1) ? CWK_STYLE_UNIX : CWK_STYLE_WINDOWS;
+  input->hint = (size_t)(data[0] >> 1);
+  cwk_path_set_style(input->style);
+
+  // Now we split the remaining data at line breaks. Embedded '\0' characters
+  // are kept, they just end the string early.
+  begin = 1;
+  for (i = 0; i < CWK_FUZZ_MAX_ARGS; ++i) {
+    end = begin;
+    while (end < size && data[end] != '\n') {
+      ++end;
+    }
+
+    input->lengths[i] = end - begin;
+    input->args[i] = malloc(input->lengths[i] + 1);
+    if (input->lengths[i] > 0) {
+      memcpy(input->args[i], &data[begin], input->lengths[i]);
+    }
+    input->args[i][input->lengths[i]] = '\0';
+    input->lengths[i] = strlen(input->args[i]);
+
+    begin = end < size ? end + 1 : end;
+  }
+
+  return true;
+}
+
+void cwk_fuzz_free(struct cwk_fuzz_input *input)
+{
+  size_t i;
+
+  for (i = 0; i < CWK_FUZZ_MAX_ARGS; ++i) {
+    free(input->args[i]);
+  }
+}
+
+char *cwk_fuzz_strdup(const char *str)
+{
+  size_t length;
+  char *copy;
+
+  length = strlen(str);
+  copy = malloc(length + 1);
+  memcpy(copy, str, length + 1);
+  return copy;
+}
+
+char *cwk_fuzz_buffer(size_t size)
+{
+  if (size == 0) {
+    return NULL;
+  }
+
+  return malloc(size);
+}
+
+void cwk_fuzz_check_truncation(const char *full, size_t full_length,
+  const char *truncated, size_t truncated_size, size_t truncated_length)
+{
+  size_t written;
+
+  CWK_FUZZ_CHECK(full_length == truncated_length);
+  CWK_FUZZ_CHECK(strlen(full) == full_length);
+  if (truncated_size == 0) {
+    return;
+  }
+
+  // The truncated output must contain as many characters as fit into the
+  // buffer, followed by a '\0'.
+  written = truncated_size - 1;
+  if (written > full_length) {
+    written = full_length;
+  }
+
+  CWK_FUZZ_CHECK(truncated[written] == '\0');
+  CWK_FUZZ_CHECK(memcmp(full, truncated, written) == 0);
+}
+
+size_t cwk_fuzz_reference_root(const char *path)
+{
+  size_t i;
+
+  if (cwk_path_get_style() == CWK_STYLE_UNIX) {
+    return cwk_fuzz_is_separator(path[0]) ? 1 : 0;
+  }
+
+  // Drive letters like "C:" or "C:\". Any character is accepted as a drive
+  // letter, except for separators which would start a network path.
+  if (path[0] != '\0' && !cwk_fuzz_is_separator(path[0])) {
+    if (path[1] != ':') {
+      return 0;
+    }
+
+    return cwk_fuzz_is_separator(path[2]) ? 3 : 2;
+  }
+
+  // A single separator is the root of the current drive.
+  if (!cwk_fuzz_is_separator(path[0])) {
+    return 0;
+  } else if (!cwk_fuzz_is_separator(path[1])) {
+    return 1;
+  }
+
+  // Device paths like "\\.\" or "\\?\".
+  if ((path[2] == '.' || path[2] == '?') && cwk_fuzz_is_separator(path[3])) {
+    return 4;
+  }
+
+  // Network paths like "\\server\share\". The server name may be followed by
+  // multiple separators, the share name only includes a single one.
+  i = 2;
+  while (path[i] != '\0' && !cwk_fuzz_is_separator(path[i])) {
+    ++i;
+  }
+  while (cwk_fuzz_is_separator(path[i])) {
+    ++i;
+  }
+  while (path[i] != '\0' && !cwk_fuzz_is_separator(path[i])) {
+    ++i;
+  }
+  if (cwk_fuzz_is_separator(path[i])) {
+    ++i;
+  }
+
+  return i;
+}
+
+size_t cwk_fuzz_reference_normalize(const char *path, char *buffer)
+{
+  static struct cwk_fuzz_stack stack;
+  size_t i, pos, root_length, size;
+  const char *c, *begin;
+  bool absolute, has_segments;
+
+  // Copy the root, but always use the preferred separator within the root.
+  root_length = cwk_fuzz_reference_root(path);
+  for (i = 0; i < root_length; ++i) {
+    if (cwk_fuzz_is_separator(path[i])) {
+      buffer[i] = cwk_fuzz_preferred_separator();
+    } else {
+      buffer[i] = path[i];
+    }
+  }
+  absolute = root_length > 0 && cwk_fuzz_is_separator(path[root_length - 1]);
+
+  // Split the rest into segments, and push and pop them on the stack.
+  stack.count = 0;
+  has_segments = false;
+  c = path + root_length;
+  while (*c != '\0') {
+    while (cwk_fuzz_is_separator(*c)) {
+      ++c;
+    }
+    begin = c;
+    while (*c != '\0' && !cwk_fuzz_is_separator(*c)) {
+      ++c;
+    }
+    size = (size_t)(c - begin);
+
+    if (size == 0) {
+      continue;
+    }
+
+    has_segments = true;
+    if (size == 1 && begin[0] == '.') {
+      continue;
+    }
+
+    if (size == 2 && begin[0] == '.' && begin[1] == '.') {
+      if (stack.count > 0 &&
+          !(stack.sizes[stack.count - 1] == 2 &&
+            memcmp(stack.begins[stack.count - 1], "..", 2) == 0)) {
+        --stack.count;
+        continue;
+      } else if (absolute) {
+        continue;
+      }
+    }
+
+    stack.begins[stack.count] = begin;
+    stack.sizes[stack.count] = size;
+    ++stack.count;
+  }
+
+  // Write out all the surviving segments separated by the preferred separator.
+  pos = root_length;
+  for (i = 0; i < stack.count; ++i) {
+    if (i > 0) {
+      buffer[pos++] = cwk_fuzz_preferred_separator();
+    }
+    memcpy(&buffer[pos], stack.begins[i], stack.sizes[i]);
+    pos += stack.sizes[i];
+  }
+
+  // A relative path whose segments were all removed points to the current
+  // directory. A path without any segments at all stays empty though.
+  if (pos == 0 && has_segments) {
+    buffer[pos++] = '.';
+  }
+
+  buffer[pos] = '\0';
+  return pos;
+}
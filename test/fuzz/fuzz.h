@@ -0,0 +1,128 @@
+#pragma once
+
+#ifndef CWK_FUZZ_H
+#define CWK_FUZZ_H
+
+#include <cwalk.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+/**
+ * The amount of path arguments which can be encoded in a single fuzz input.
+ */
+#define CWK_FUZZ_MAX_ARGS 3
+
+/**
+ * Aborts the fuzz target if the condition does not hold. The fuzzer will
+ * record the input which caused the abort as a crash.
+ */
+#define CWK_FUZZ_CHECK(condition)                                              \
+  do {                                                                         \
+    if (!(condition)) {                                                        \
+      fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__,         \
+        #condition);                                                           \
+      abort();                                                                 \
+    }                                                                          \
+  } while (0)
+
+/**
+ * A decoded fuzz input. The first byte of the raw input selects the path style
+ * (lowest bit) and a truncation hint (remaining bits). The rest of the input is
+ * split at line breaks into up to CWK_FUZZ_MAX_ARGS null-terminated strings.
+ * Missing arguments are set to an empty string.
+ */
+struct cwk_fuzz_input
+{
+  enum cwk_path_style style;
+  size_t hint;
+  char *args[CWK_FUZZ_MAX_ARGS];
+  size_t lengths[CWK_FUZZ_MAX_ARGS];
+};
+
+/**
+ * @brief Decodes a raw fuzz input.
+ *
+ * The decoded arguments are stored in heap memory of exactly the required size,
+ * so that sanitizers can detect reads past the null-terminating character. The
+ * path style of the library is configured according to the input.
+ *
+ * @param data The raw fuzz input.
+ * @param size The size of the raw fuzz input.
+ * @param input The decoded input.
+ * @return Returns false if the input is too short or too long to be used.
+ */
+bool cwk_fuzz_decode(const uint8_t *data, size_t size,
+  struct cwk_fuzz_input *input);
+
+/**
+ * @brief Frees the memory of a decoded fuzz input.
+ *
+ * @param input The decoded input.
+ */
+void cwk_fuzz_free(struct cwk_fuzz_input *input);
+
+/**
+ * @brief Duplicates a string into heap memory of exactly the required size.
+ *
+ * @param str The string which will be duplicated.
+ * @return Returns the duplicated string.
+ */
+char *cwk_fuzz_strdup(const char *str);
+
+/**
+ * @brief Allocates an output buffer of exactly the submitted size.
+ *
+ * A zero sized buffer is represented by a NULL pointer, which the library must
+ * never touch.
+ *
+ * @param size The size of the buffer.
+ * @return Returns the buffer.
+ */
+char *cwk_fuzz_buffer(size_t size);
+
+/**
+ * @brief Verifies the truncation rules of a function writing to a buffer.
+ *
+ * The truncated output must be a null-terminated prefix of the full output,
+ * and both calls must have returned the same length.
+ *
+ * @param full The output which was written to a large enough buffer.
+ * @param full_length The length returned by the call with the large buffer.
+ * @param truncated The output which was written to the small buffer.
+ * @param truncated_size The size of the small buffer.
+ * @param truncated_length The length returned by the call with the small
+ * buffer.
+ */
+void cwk_fuzz_check_truncation(const char *full, size_t full_length,
+  const char *truncated, size_t truncated_size, size_t truncated_length);
+
+/**
+ * @brief Determines the root of a path using the reference implementation.
+ *
+ * This is a deliberately simple implementation of the root rules, which is
+ * used as an oracle for cwk_path_get_root. It uses the currently configured
+ * path style.
+ *
+ * @param path The path which will be inspected.
+ * @return Returns the length of the root.
+ */
+size_t cwk_fuzz_reference_root(const char *path);
+
+/**
+ * @brief Normalizes a path using the reference implementation.
+ *
+ * This is a deliberately simple implementation of the normalization rules,
+ * which uses a segment stack instead of the look-ahead and look-behind logic of
+ * the library. It is used as an oracle for cwk_path_normalize. The buffer must
+ * be at least one character larger than the submitted path.
+ *
+ * @param path The path which will be normalized.
+ * @param buffer The buffer where the normalized path will be written to.
+ * @return Returns the length of the normalized path.
+ */
+size_t cwk_fuzz_reference_normalize(const char *path, char *buffer);
+
+#endif
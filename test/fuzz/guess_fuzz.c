@@ -0,0 +1,37 @@
+#include "fuzz.h"
+
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size)
+{
+  struct cwk_fuzz_input input;
+  enum cwk_path_style style;
+  unsigned char classes;
+  size_t root_length;
+
+  if (!cwk_fuzz_decode(data, size, &input)) {
+    return 0;
+  }
+
+  // Guessing must always result in one of the known styles, and it must not
+  // modify the configured style.
+  style = cwk_path_guess_style(input.args[0]);
+  CWK_FUZZ_CHECK(style == CWK_STYLE_UNIX || style == CWK_STYLE_WINDOWS);
+  CWK_FUZZ_CHECK(cwk_path_get_style() == input.style);
+
+  // The classification must agree with the guessed style, and with the root
+  // which is determined using that style.
+  cwk_path_classify((const char **)input.args, 1, &classes);
+  CWK_FUZZ_CHECK(((classes & CWK_CLASS_WINDOWS) != 0) ==
+                 (style == CWK_STYLE_WINDOWS));
+  cwk_path_set_style(style);
+  cwk_path_get_root(input.args[0], &root_length);
+  CWK_FUZZ_CHECK(((classes & CWK_CLASS_ABSOLUTE) != 0) ==
+                 cwk_path_is_absolute(input.args[0]));
+  CWK_FUZZ_CHECK(((classes & CWK_CLASS_ROOT) == CWK_CLASS_RELATIVE) ==
+                 (root_length == 0));
+  CWK_FUZZ_CHECK(((classes & CWK_CLASS_ROOT) == CWK_CLASS_SEPARATOR) ==
+                 (root_length == 1));
+  cwk_path_set_style(input.style);
+
+  cwk_fuzz_free(&input);
+  return 0;
+}
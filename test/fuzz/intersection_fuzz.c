@@ -0,0 +1,42 @@
+#include "fuzz.h"
+#include <string.h>
+
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size)
+{
+  struct cwk_fuzz_input input;
+  size_t length, root_length, other_root_length, third_length;
+  const char *paths[CWK_FUZZ_MAX_ARGS];
+
+  if (!cwk_fuzz_decode(data, size, &input)) {
+    return 0;
+  }
+
+  // The intersection can never be longer than the base path, and it ends either
+  // after the root or at the end of a segment.
+  length = cwk_path_get_intersection(input.args[0], input.args[1]);
+  CWK_FUZZ_CHECK(length <= input.lengths[0]);
+  cwk_path_get_root(input.args[0], &root_length);
+  cwk_path_get_root(input.args[1], &other_root_length);
+  if (length > root_length) {
+    CWK_FUZZ_CHECK(input.args[0][length] == '\0' ||
+                   cwk_path_is_separator(&input.args[0][length]));
+  }
+
+  // Paths with different roots have nothing in common.
+  if (root_length != other_root_length) {
+    CWK_FUZZ_CHECK(length == 0);
+  }
+
+  // The intersection of multiple paths is the shortest of the intersections of
+  // the first path with every other path.
+  paths[0] = input.args[0];
+  paths[1] = input.args[1];
+  paths[2] = input.args[2];
+  CWK_FUZZ_CHECK(cwk_path_get_intersection_multiple(paths, 2) == length);
+  third_length = cwk_path_get_intersection(input.args[0], input.args[2]);
+  CWK_FUZZ_CHECK(cwk_path_get_intersection_multiple(paths, 3) ==
+                 (length < third_length ? length : third_length));
+
+  cwk_fuzz_free(&input);
+  return 0;
+}
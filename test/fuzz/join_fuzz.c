@@ -0,0 +1,66 @@
+#include "fuzz.h"
+#include <string.h>
+
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size)
+{
+  struct cwk_fuzz_input input;
+  size_t length, truncated_length, size_hint, multiple_length;
+  char *full, *truncated, *multiple, *normalized;
+  const char *paths[CWK_FUZZ_MAX_ARGS + 1];
+
+  if (!cwk_fuzz_decode(data, size, &input)) {
+    return 0;
+  }
+
+  length = cwk_path_join(input.args[0], input.args[1], NULL, 0);
+  full = cwk_fuzz_buffer(length + 1);
+  CWK_FUZZ_CHECK(
+    cwk_path_join(input.args[0], input.args[1], full, length + 1) == length);
+
+  // A truncated output must be a prefix of the full output.
+  size_hint = input.hint % (length + 2);
+  truncated = cwk_fuzz_buffer(size_hint);
+  truncated_length = cwk_path_join(input.args[0], input.args[1], truncated,
+    size_hint);
+  cwk_fuzz_check_truncation(full, length, truncated, size_hint,
+    truncated_length);
+
+  // Joining with an empty path is the same as normalizing the first path.
+  if (input.lengths[1] == 0) {
+    normalized = cwk_fuzz_buffer(length + 1);
+    CWK_FUZZ_CHECK(
+      cwk_path_normalize(input.args[0], normalized, length + 1) == length);
+    CWK_FUZZ_CHECK(strcmp(full, normalized) == 0);
+    free(normalized);
+  }
+
+  // Joining multiple paths must behave the same way as joining two paths, as
+  // long as we only submit two of them.
+  paths[0] = input.args[0];
+  paths[1] = input.args[1];
+  paths[2] = NULL;
+  multiple = cwk_fuzz_buffer(length + 1);
+  multiple_length = cwk_path_join_multiple(paths, multiple, length + 1);
+  CWK_FUZZ_CHECK(multiple_length == length);
+  CWK_FUZZ_CHECK(strcmp(full, multiple) == 0);
+  free(multiple);
+
+  // Now we join all three paths and verify the truncation once again.
+  paths[2] = input.args[2];
+  paths[3] = NULL;
+  free(full);
+  length = cwk_path_join_multiple(paths, NULL, 0);
+  full = cwk_fuzz_buffer(length + 1);
+  CWK_FUZZ_CHECK(cwk_path_join_multiple(paths, full, length + 1) == length);
+  free(truncated);
+  size_hint = input.hint % (length + 2);
+  truncated = cwk_fuzz_buffer(size_hint);
+  truncated_length = cwk_path_join_multiple(paths, truncated, size_hint);
+  cwk_fuzz_check_truncation(full, length, truncated, size_hint,
+    truncated_length);
+
+  free(truncated);
+  free(full);
+  cwk_fuzz_free(&input);
+  return 0;
+}
@@ -0,0 +1,133 @@
+#include "fuzz.h"
+#include <string.h>
+
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size)
+{
+  struct cwk_fuzz_input input;
+  size_t i, j, length, truncated_length, size_hint, again_length, root_length,
+    normalized_root_length, map_size, value;
+  size_t ids[CWK_FUZZ_MAX_ARGS], table[CWK_FUZZ_MAX_ARGS];
+  char *full, *truncated, *again, *reference, *map_memory;
+  struct cwk_pathmap *map;
+  char *normalized[CWK_FUZZ_MAX_ARGS];
+
+  if (!cwk_fuzz_decode(data, size, &input)) {
+    return 0;
+  }
+
+  // First we normalize into a buffer which is exactly large enough, so the
+  // sanitizer catches any write after the '\0'.
+  length = cwk_path_normalize(input.args[0], NULL, 0);
+  full = cwk_fuzz_buffer(length + 1);
+  CWK_FUZZ_CHECK(cwk_path_normalize(input.args[0], full, length + 1) == length);
+  CWK_FUZZ_CHECK(strlen(full) == length);
+
+  // The result must be equal to the one of the reference implementation.
+  reference = cwk_fuzz_buffer(input.lengths[0] + 2);
+  CWK_FUZZ_CHECK(cwk_fuzz_reference_normalize(input.args[0], reference) ==
+                 length);
+  CWK_FUZZ_CHECK(strcmp(full, reference) == 0);
+
+  // Normalization must be idempotent. There is one exception on windows: if a
+  // relative path loses its first segments, the new first segment might look
+  // like a drive (".\\C:" becomes "C:"), which is parsed as a root afterwards.
+  again = cwk_fuzz_buffer(length + 1);
+  again_length = cwk_path_normalize(full, again, length + 1);
+  cwk_path_get_root(input.args[0], &root_length);
+  cwk_path_get_root(full, &normalized_root_length);
+  if (root_length == normalized_root_length) {
+    CWK_FUZZ_CHECK(again_length == length);
+    CWK_FUZZ_CHECK(strcmp(full, again) == 0);
+  }
+
+  // Normalizing in place must give the same result as normalizing into a
+  // separate buffer.
+  memcpy(reference, input.args[0], input.lengths[0] + 1);
+  CWK_FUZZ_CHECK(cwk_path_normalize_inplace(reference) == length);
+  CWK_FUZZ_CHECK(strcmp(full, reference) == 0);
+
+  // A path is normalized exactly if normalizing doesn't change it, and in that
+  // case the path itself is returned without touching the buffer.
+  CWK_FUZZ_CHECK(cwk_path_is_normalized(input.args[0]) ==
+                 (strcmp(input.args[0], full) == 0));
+  CWK_FUZZ_CHECK(cwk_path_is_normalized(full) ||
+                 root_length != normalized_root_length);
+  CWK_FUZZ_CHECK(cwk_path_get_normalized(input.args[0], NULL, 0,
+                   &again_length) == input.args[0] ||
+                 !cwk_path_is_normalized(input.args[0]));
+  CWK_FUZZ_CHECK(again_length == length);
+
+  // A truncated output must be a prefix of the full output.
+  size_hint = input.hint % (length + 2);
+  truncated = cwk_fuzz_buffer(size_hint);
+  truncated_length = cwk_path_normalize(input.args[0], truncated, size_hint);
+  cwk_fuzz_check_truncation(full, length, truncated, size_hint,
+    truncated_length);
+
+  // Two paths must get the same id during deduplication exactly if their
+  // normalized paths are equal. We only check this for unix paths, since
+  // windows compares case insensitively and might re-parse a drive as a root.
+  cwk_path_dedup((const char **)input.args, CWK_FUZZ_MAX_ARGS, ids, table,
+    CWK_FUZZ_MAX_ARGS);
+  for (i = 0; i < CWK_FUZZ_MAX_ARGS; ++i) {
+    normalized[i] = cwk_fuzz_buffer(input.lengths[i] + 2);
+    cwk_path_normalize(input.args[i], normalized[i], input.lengths[i] + 2);
+  }
+
+  if (input.style == CWK_STYLE_UNIX) {
+    for (i = 0; i < CWK_FUZZ_MAX_ARGS; ++i) {
+      for (j = 0; j < CWK_FUZZ_MAX_ARGS; ++j) {
+        CWK_FUZZ_CHECK((strcmp(normalized[i], normalized[j]) == 0) ==
+                       (ids[i] == ids[j]));
+      }
+    }
+  }
+
+  // The map of paths uses the same rules as the deduplication, so a path must
+  // find the value of the last path which got the same id. The buffer is large
+  // enough for all paths, so no insertion may fail.
+  map_size = 2048;
+  for (i = 0; i < CWK_FUZZ_MAX_ARGS; ++i) {
+    map_size += input.lengths[i] + 64;
+  }
+
+  map_memory = cwk_fuzz_buffer(map_size);
+  map = cwk_pathmap_init(map_memory, map_size);
+  CWK_FUZZ_CHECK(map != NULL);
+  for (i = 0; i < CWK_FUZZ_MAX_ARGS; ++i) {
+    CWK_FUZZ_CHECK(cwk_pathmap_insert(map, input.args[i], i));
+  }
+
+  for (i = 0; i < CWK_FUZZ_MAX_ARGS; ++i) {
+    CWK_FUZZ_CHECK(cwk_pathmap_find(map, input.args[i], &value));
+    CWK_FUZZ_CHECK(ids[value] == ids[i]);
+    for (j = value + 1; j < CWK_FUZZ_MAX_ARGS; ++j) {
+      CWK_FUZZ_CHECK(ids[j] != ids[i]);
+    }
+
+    // The normalized path must be found as well, unless it got a new root.
+    cwk_path_get_root(input.args[i], &root_length);
+    cwk_path_get_root(normalized[i], &normalized_root_length);
+    CWK_FUZZ_CHECK(cwk_pathmap_find(map, normalized[i], &value) ||
+                   root_length != normalized_root_length);
+  }
+
+  // There is one path in the map for every unique path.
+  value = 0;
+  for (i = 0; i < CWK_FUZZ_MAX_ARGS; ++i) {
+    value += ids[i] == value ? 1 : 0;
+  }
+  CWK_FUZZ_CHECK(cwk_pathmap_get_count(map) == value);
+
+  free(map_memory);
+  for (i = 0; i < CWK_FUZZ_MAX_ARGS; ++i) {
+    free(normalized[i]);
+  }
+
+  free(truncated);
+  free(again);
+  free(reference);
+  free(full);
+  cwk_fuzz_free(&input);
+  return 0;
+}
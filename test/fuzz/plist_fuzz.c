@@ -0,0 +1,62 @@
+#include "fuzz.h"
+#include <string.h>
+
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size)
+{
+  struct cwk_fuzz_input input;
+  size_t i, list_size, block_size, max_length, normalized_length;
+  const char *paths[CWK_FUZZ_MAX_ARGS];
+  struct cwk_span spans[CWK_FUZZ_MAX_ARGS];
+  struct cwk_plist_cursor cursor;
+  uint64_t *list;
+  char *buffer, *normalized;
+
+  if (!cwk_fuzz_decode(data, size, &input)) {
+    return 0;
+  }
+
+  // The list is built into memory of exactly the required size, so the
+  // sanitizer catches any access beyond it.
+  for (i = 0; i < CWK_FUZZ_MAX_ARGS; ++i) {
+    paths[i] = input.args[i];
+  }
+
+  block_size = input.hint % 4 + 1;
+  list_size = cwk_plist_build(paths, CWK_FUZZ_MAX_ARGS, block_size, spans,
+    NULL, 0);
+  list = malloc(list_size);
+  CWK_FUZZ_CHECK(cwk_plist_build(paths, CWK_FUZZ_MAX_ARGS, block_size, spans,
+                   list, list_size) == list_size);
+  CWK_FUZZ_CHECK(cwk_plist_get_count(list) >= 1);
+
+  // A buffer of exactly the maximum length must be enough to decode every
+  // entry, and every entry must be decoded with the correct length.
+  max_length = cwk_plist_get_max_length(list);
+  buffer = malloc(max_length + 1);
+  CWK_FUZZ_CHECK(cwk_plist_seek(list, 0, &cursor, buffer, max_length + 1));
+  do {
+    CWK_FUZZ_CHECK(strlen(cursor.path) == cursor.length);
+    CWK_FUZZ_CHECK(cursor.length <= max_length);
+  } while (cwk_plist_next(&cursor));
+  CWK_FUZZ_CHECK(cursor.index + 1 == cwk_plist_get_count(list));
+
+  // Every path must be found, and the decoded path is the normalized path. We
+  // only compare the decoded path for unix, since windows keeps the case of one
+  // of the equal paths.
+  for (i = 0; i < CWK_FUZZ_MAX_ARGS; ++i) {
+    CWK_FUZZ_CHECK(cwk_plist_find(list, input.args[i], &cursor, buffer,
+      max_length + 1));
+    normalized_length = cwk_path_normalize(input.args[i], NULL, 0);
+    normalized = cwk_fuzz_buffer(normalized_length + 1);
+    cwk_path_normalize(input.args[i], normalized, normalized_length + 1);
+    if (input.style == CWK_STYLE_UNIX) {
+      CWK_FUZZ_CHECK(strcmp(cursor.path, normalized) == 0);
+    }
+    free(normalized);
+  }
+
+  free(buffer);
+  free(list);
+  cwk_fuzz_free(&input);
+  return 0;
+}
@@ -0,0 +1,85 @@
+#include "fuzz.h"
+#include <string.h>
+
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size)
+{
+  struct cwk_fuzz_input input;
+  size_t i, trie_size, entry, other_entry, length, first, count,
+    normalized_length;
+  const char *paths[CWK_FUZZ_MAX_ARGS];
+  struct cwk_span spans[CWK_FUZZ_MAX_ARGS];
+  uint32_t *trie, *copy;
+  char *normalized, *stored;
+
+  if (!cwk_fuzz_decode(data, size, &input)) {
+    return 0;
+  }
+
+  // The trie is built into memory of exactly the required size, so the
+  // sanitizer catches any access beyond it.
+  for (i = 0; i < CWK_FUZZ_MAX_ARGS; ++i) {
+    paths[i] = input.args[i];
+  }
+
+  trie_size = cwk_ptrie_build(paths, CWK_FUZZ_MAX_ARGS, spans, NULL, 0);
+  trie = malloc(trie_size);
+  CWK_FUZZ_CHECK(cwk_ptrie_build(paths, CWK_FUZZ_MAX_ARGS, spans, trie,
+                   trie_size) == trie_size);
+  CWK_FUZZ_CHECK(cwk_ptrie_is_valid(trie, trie_size));
+
+  // Every path must be an entry of the trie, and it must also be the longest
+  // entry containing itself.
+  for (i = 0; i < CWK_FUZZ_MAX_ARGS; ++i) {
+    CWK_FUZZ_CHECK(cwk_ptrie_find(trie, input.args[i], &entry));
+    CWK_FUZZ_CHECK(cwk_ptrie_find_longest(trie, input.args[i], &other_entry,
+      &length));
+    CWK_FUZZ_CHECK(entry == other_entry);
+    CWK_FUZZ_CHECK(cwk_ptrie_find_prefix(trie, input.args[i], &first, &count));
+    CWK_FUZZ_CHECK(first == entry && count >= 1);
+
+    // The stored path is the normalized path. We only check this for unix
+    // paths, since windows might re-parse a drive as a root and keeps the case
+    // of one of the equal paths.
+    length = cwk_ptrie_get_path(trie, entry, NULL, 0);
+    stored = cwk_fuzz_buffer(length + 1);
+    CWK_FUZZ_CHECK(cwk_ptrie_get_path(trie, entry, stored, length + 1) ==
+                   length);
+    normalized_length = cwk_path_normalize(input.args[i], NULL, 0);
+    normalized = cwk_fuzz_buffer(normalized_length + 1);
+    cwk_path_normalize(input.args[i], normalized, normalized_length + 1);
+    if (input.style == CWK_STYLE_UNIX) {
+      CWK_FUZZ_CHECK(strcmp(stored, normalized) == 0);
+    }
+
+    free(normalized);
+    free(stored);
+  }
+
+  // Now we break a single byte of the trie. If the trie is still considered to
+  // be valid, all functions must work without touching any memory outside of
+  // the trie.
+  copy = malloc(trie_size);
+  memcpy(copy, trie, trie_size);
+  ((uint8_t *)copy)[(input.hint * 7919) % trie_size] ^= (uint8_t)(input.hint |
+                                                                  1);
+  if (cwk_ptrie_is_valid(copy, trie_size)) {
+    for (i = 0; i < CWK_FUZZ_MAX_ARGS; ++i) {
+      cwk_ptrie_find(copy, input.args[i], &entry);
+      cwk_ptrie_find_longest(copy, input.args[i], &entry, &length);
+      cwk_ptrie_find_prefix(copy, input.args[i], &first, &count);
+    }
+
+    for (entry = 0; entry <= cwk_ptrie_get_entry_count(copy); ++entry) {
+      length = cwk_ptrie_get_path(copy, entry, NULL, 0);
+      stored = cwk_fuzz_buffer(length + 1);
+      CWK_FUZZ_CHECK(cwk_ptrie_get_path(copy, entry, stored, length + 1) ==
+                     length);
+      free(stored);
+    }
+  }
+
+  free(copy);
+  free(trie);
+  cwk_fuzz_free(&input);
+  return 0;
+}
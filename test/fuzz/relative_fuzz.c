@@ -0,0 +1,38 @@
+#include "fuzz.h"
+#include <string.h>
+
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size)
+{
+  struct cwk_fuzz_input input;
+  size_t length, truncated_length, size_hint;
+  char *full, *truncated;
+
+  if (!cwk_fuzz_decode(data, size, &input)) {
+    return 0;
+  }
+
+  length = cwk_path_get_relative(input.args[0], input.args[1], NULL, 0);
+  full = cwk_fuzz_buffer(length + 1);
+  CWK_FUZZ_CHECK(cwk_path_get_relative(input.args[0], input.args[1], full,
+                   length + 1) == length);
+
+  // The result is relative, unless there is no result at all because the roots
+  // are different. On windows this does not hold if the first segment looks
+  // like a drive, like the "a:" in "a:\b".
+  if (input.style == CWK_STYLE_UNIX) {
+    CWK_FUZZ_CHECK(length == 0 || cwk_path_is_relative(full));
+  }
+
+  // A truncated output must be a prefix of the full output.
+  size_hint = input.hint % (length + 2);
+  truncated = cwk_fuzz_buffer(size_hint);
+  truncated_length = cwk_path_get_relative(input.args[0], input.args[1],
+    truncated, size_hint);
+  cwk_fuzz_check_truncation(full, length, truncated, size_hint,
+    truncated_length);
+
+  free(truncated);
+  free(full);
+  cwk_fuzz_free(&input);
+  return 0;
+}
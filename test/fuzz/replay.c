@@ -0,0 +1,59 @@
+#include "fuzz.h"
+
+/**
+ * This is a replacement for the libFuzzer driver, which is used if the compiler
+ * does not support libFuzzer. It just runs the fuzz target once for every file
+ * which is passed on the command line. This way the seed corpus can be used as
+ * a regression test with any compiler.
+ */
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size);
+
+static int replay_file(const char *file_name)
+{
+  FILE *file;
+  long size;
+  uint8_t *data;
+
+  file = fopen(file_name, "rb");
+  if (file == NULL) {
+    fprintf(stderr, "Failed to open '%s'.\n", file_name);
+    return EXIT_FAILURE;
+  }
+
+  // Measure the file size, so that we can allocate a buffer which fits exactly.
+  // This way the sanitizers catch any read after the end of the input.
+  if (fseek(file, 0, SEEK_END) != 0 || (size = ftell(file)) < 0 ||
+      fseek(file, 0, SEEK_SET) != 0) {
+    fprintf(stderr, "Failed to measure '%s'.\n", file_name);
+    fclose(file);
+    return EXIT_FAILURE;
+  }
+
+  data = malloc(size > 0 ? (size_t)size : 1);
+  if (fread(data, 1, (size_t)size, file) != (size_t)size) {
+    fprintf(stderr, "Failed to read '%s'.\n", file_name);
+    free(data);
+    fclose(file);
+    return EXIT_FAILURE;
+  }
+
+  LLVMFuzzerTestOneInput(data, (size_t)size);
+
+  free(data);
+  fclose(file);
+  return EXIT_SUCCESS;
+}
+
+int main(int argc, char *argv[])
+{
+  int i;
+
+  for (i = 1; i < argc; ++i) {
+    if (replay_file(argv[i]) == EXIT_FAILURE) {
+      return EXIT_FAILURE;
+    }
+  }
+
+  printf("Replayed %d inputs.\n", argc - 1);
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,54 @@
+#include "fuzz.h"
+#include <string.h>
+
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size)
+{
+  struct cwk_fuzz_input input;
+  size_t length, root_length, truncated_length, size_hint;
+  char *full, *truncated, *root;
+
+  if (!cwk_fuzz_decode(data, size, &input)) {
+    return 0;
+  }
+
+  // The root must be equal to the one of the reference implementation, and an
+  // absolute path is a path whose root ends with a separator.
+  cwk_path_get_root(input.args[0], &root_length);
+  CWK_FUZZ_CHECK(root_length <= input.lengths[0]);
+  CWK_FUZZ_CHECK(root_length == cwk_fuzz_reference_root(input.args[0]));
+  CWK_FUZZ_CHECK(cwk_path_is_absolute(input.args[0]) ==
+                 (root_length > 0 &&
+                   cwk_path_is_separator(&input.args[0][root_length - 1])));
+  CWK_FUZZ_CHECK(
+    cwk_path_is_relative(input.args[0]) != cwk_path_is_absolute(input.args[0]));
+
+  length = cwk_path_change_root(input.args[0], input.args[1], NULL, 0);
+  full = cwk_fuzz_buffer(length + 1);
+  CWK_FUZZ_CHECK(cwk_path_change_root(input.args[0], input.args[1], full,
+                   length + 1) == length);
+  CWK_FUZZ_CHECK(length == input.lengths[0] - root_length + input.lengths[1]);
+
+  // A truncated output must be a prefix of the full output.
+  size_hint = input.hint % (length + 2);
+  truncated = cwk_fuzz_buffer(size_hint);
+  truncated_length = cwk_path_change_root(input.args[0], input.args[1],
+    truncated, size_hint);
+  cwk_fuzz_check_truncation(full, length, truncated, size_hint,
+    truncated_length);
+
+  // Replacing the root with itself must not change anything.
+  root = cwk_fuzz_buffer(root_length + 1);
+  memcpy(root, input.args[0], root_length);
+  root[root_length] = '\0';
+  free(full);
+  full = cwk_fuzz_buffer(input.lengths[0] + 1);
+  CWK_FUZZ_CHECK(cwk_path_change_root(input.args[0], root, full,
+                   input.lengths[0] + 1) == input.lengths[0]);
+  CWK_FUZZ_CHECK(strcmp(full, input.args[0]) == 0);
+
+  free(root);
+  free(truncated);
+  free(full);
+  cwk_fuzz_free(&input);
+  return 0;
+}
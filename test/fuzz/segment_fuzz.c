@@ -0,0 +1,155 @@
+#include "fuzz.h"
+#include <string.h>
+
+static void check_segment(const struct cwk_segment *segment, const char *path,
+  size_t path_length)
+{
+  const char *c;
+
+  // The segment must be within the path, must not be empty and must not
+  // contain any separators.
+  CWK_FUZZ_CHECK(segment->path == path);
+  CWK_FUZZ_CHECK(segment->begin >= segment->segments);
+  CWK_FUZZ_CHECK(segment->end <= path + path_length);
+  CWK_FUZZ_CHECK(segment->size > 0);
+  CWK_FUZZ_CHECK(segment->begin + segment->size == segment->end);
+  for (c = segment->begin; c < segment->end; ++c) {
+    CWK_FUZZ_CHECK(*c != '\0' && !cwk_path_is_separator(c));
+  }
+
+  switch (cwk_path_get_segment_type(segment)) {
+  case CWK_CURRENT:
+    CWK_FUZZ_CHECK(segment->size == 1 && segment->begin[0] == '.');
+    break;
+  case CWK_BACK:
+    CWK_FUZZ_CHECK(segment->size == 2 && memcmp(segment->begin, "..", 2) == 0);
+    break;
+  case CWK_NORMAL:
+    break;
+  }
+}
+
+static void check_split(const char *path)
+{
+  struct cwk_segment segment;
+  struct cwk_span spans[8];
+  size_t count, i;
+  bool found;
+
+  // The spans must be exactly the segments which are found by iterating over
+  // them, even if only the first few of them fit into the array.
+  count = cwk_path_split(path, spans, sizeof(spans) / sizeof(*spans));
+  i = 0;
+  for (found = cwk_path_get_first_segment(path, &segment); found;
+       found = cwk_path_get_next_segment(&segment)) {
+    if (i < sizeof(spans) / sizeof(*spans)) {
+      CWK_FUZZ_CHECK(spans[i].offset == (size_t)(segment.begin - path));
+      CWK_FUZZ_CHECK(spans[i].length == segment.size);
+      CWK_FUZZ_CHECK(spans[i].type == cwk_path_get_segment_type(&segment));
+    }
+    ++i;
+  }
+
+  CWK_FUZZ_CHECK(count == i);
+  CWK_FUZZ_CHECK(cwk_path_split(path, NULL, 0) == count);
+}
+
+static void check_sized(const char *path, size_t length, size_t hint)
+{
+  struct cwk_segment segment;
+  struct cwk_span span, spans[8], expected[8];
+  size_t size, count, root_length, expected_root_length, i;
+  char *prefix, *exact;
+
+  // A sized path must behave exactly like a null-terminated copy of it, and
+  // nothing beyond the size must be read.
+  size = hint % (length + 1);
+  prefix = cwk_fuzz_buffer(size + 1);
+  memcpy(prefix, path, size);
+  prefix[size] = '\0';
+  exact = cwk_fuzz_buffer(size);
+  if (size > 0) {
+    memcpy(exact, path, size);
+  }
+  path = exact;
+
+  cwk_path_get_root_sized(path, size, &root_length);
+  cwk_path_get_root(prefix, &expected_root_length);
+  CWK_FUZZ_CHECK(root_length == expected_root_length);
+
+  count = cwk_path_split_sized(path, size, spans, 8);
+  CWK_FUZZ_CHECK(count == cwk_path_split(prefix, expected, 8));
+  for (i = 0; i < count && i < 8; ++i) {
+    CWK_FUZZ_CHECK(spans[i].offset == expected[i].offset);
+    CWK_FUZZ_CHECK(spans[i].length == expected[i].length);
+    CWK_FUZZ_CHECK(spans[i].type == expected[i].type);
+  }
+
+  CWK_FUZZ_CHECK(cwk_path_get_last_span(path, size, &span) ==
+                 cwk_path_get_last_segment(prefix, &segment));
+  if (count > 0) {
+    CWK_FUZZ_CHECK(span.offset == (size_t)(segment.begin - prefix));
+    CWK_FUZZ_CHECK(span.length == segment.size);
+  }
+
+  free(exact);
+  free(prefix);
+}
+
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size)
+{
+  struct cwk_fuzz_input input;
+  struct cwk_segment segment, last;
+  size_t forward, backward, length, truncated_length, size_hint;
+  char *full, *truncated;
+  const char *path;
+
+  if (!cwk_fuzz_decode(data, size, &input)) {
+    return 0;
+  }
+
+  path = input.args[0];
+  check_split(path);
+  check_sized(path, input.lengths[0], input.hint);
+  if (!cwk_path_get_first_segment(path, &segment)) {
+    CWK_FUZZ_CHECK(!cwk_path_get_last_segment(path, &last));
+    cwk_fuzz_free(&input);
+    return 0;
+  }
+
+  // Walk forward until the end, and then backwards until the beginning. We
+  // must visit the same amount of segments in both directions.
+  forward = 1;
+  check_segment(&segment, path, input.lengths[0]);
+  while (cwk_path_get_next_segment(&segment)) {
+    check_segment(&segment, path, input.lengths[0]);
+    ++forward;
+  }
+
+  CWK_FUZZ_CHECK(cwk_path_get_last_segment(path, &last));
+  CWK_FUZZ_CHECK(last.begin == segment.begin && last.end == segment.end);
+
+  backward = 1;
+  while (cwk_path_get_previous_segment(&segment)) {
+    check_segment(&segment, path, input.lengths[0]);
+    ++backward;
+  }
+  CWK_FUZZ_CHECK(forward == backward);
+
+  // Change the last segment and verify the truncation rules.
+  length = cwk_path_change_segment(&last, input.args[1], NULL, 0);
+  full = cwk_fuzz_buffer(length + 1);
+  CWK_FUZZ_CHECK(
+    cwk_path_change_segment(&last, input.args[1], full, length + 1) == length);
+  size_hint = input.hint % (length + 2);
+  truncated = cwk_fuzz_buffer(size_hint);
+  truncated_length = cwk_path_change_segment(&last, input.args[1], truncated,
+    size_hint);
+  cwk_fuzz_check_truncation(full, length, truncated, size_hint,
+    truncated_length);
+
+  free(truncated);
+  free(full);
+  cwk_fuzz_free(&input);
+  return 0;
+}
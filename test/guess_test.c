@@ -103,3 +103,57 @@ int guess_windows_root(void)
 
   return EXIT_SUCCESS;
 }
+
+int guess_classify_root(void)
+{
+  size_t i;
+  unsigned char classes[9];
+  const char *paths[] = {"a/b", "/a/b", "\\a\\b", "C:\\a", "C:a",
+    "\\\\server\\share\\a", "\\\\server", "\\\\.\\COM1", "//?/C:/a"};
+  const unsigned char expected[] = {CWK_CLASS_RELATIVE,
+    CWK_CLASS_SEPARATOR | CWK_CLASS_ABSOLUTE,
+    CWK_CLASS_SEPARATOR | CWK_CLASS_ABSOLUTE | CWK_CLASS_WINDOWS,
+    CWK_CLASS_DRIVE | CWK_CLASS_ABSOLUTE | CWK_CLASS_WINDOWS,
+    CWK_CLASS_DRIVE | CWK_CLASS_WINDOWS,
+    CWK_CLASS_UNC | CWK_CLASS_ABSOLUTE | CWK_CLASS_WINDOWS,
+    CWK_CLASS_UNC | CWK_CLASS_WINDOWS,
+    CWK_CLASS_DEVICE | CWK_CLASS_ABSOLUTE | CWK_CLASS_WINDOWS,
+    CWK_CLASS_DEVICE | CWK_CLASS_ABSOLUTE | CWK_CLASS_WINDOWS};
+
+  cwk_path_set_style(CWK_STYLE_WINDOWS);
+  cwk_path_classify(paths, 9, classes);
+  for (i = 0; i < 9; ++i) {
+    if (classes[i] != (expected[i] | CWK_CLASS_ASCII)) {
+      return EXIT_FAILURE;
+    }
+  }
+
+  return EXIT_SUCCESS;
+}
+
+int guess_classify_style(void)
+{
+  size_t i;
+  unsigned char classes[8];
+  const char *paths[] = {"", "myfile", "myfile.txt", ".hidden",
+    "/a/directory/myfile.txt", "a\\b/c", "a/b\\c",
+    "/\xc3\xa4pfel/very/long/path/with/many/segments"};
+
+  cwk_path_set_style(CWK_STYLE_UNIX);
+  cwk_path_classify(paths, 8, classes);
+  for (i = 0; i < 8; ++i) {
+    if (((classes[i] & CWK_CLASS_WINDOWS) != 0) !=
+        (cwk_path_guess_style(paths[i]) == CWK_STYLE_WINDOWS)) {
+      return EXIT_FAILURE;
+    }
+  }
+
+  if (classes[2] != (CWK_CLASS_WINDOWS | CWK_CLASS_ASCII) ||
+      classes[5] != (CWK_CLASS_WINDOWS | CWK_CLASS_ASCII) ||
+      classes[6] != CWK_CLASS_ASCII ||
+      classes[7] != (CWK_CLASS_SEPARATOR | CWK_CLASS_ABSOLUTE)) {
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -130,3 +130,86 @@ int intersection_simple(void)
 
   return EXIT_SUCCESS;
 }
+
+int intersection_multiple_simple(void)
+{
+  const char *paths[3];
+
+  cwk_path_set_style(CWK_STYLE_UNIX);
+
+  paths[0] = "/this/is/a/test";
+  paths[1] = "/this/is/a/string";
+  paths[2] = "/this/is/another/test";
+  if (cwk_path_get_intersection_multiple(paths, 3) != 8) {
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
+
+int intersection_multiple_root_only(void)
+{
+  const char *paths[4];
+
+  cwk_path_set_style(CWK_STYLE_WINDOWS);
+
+  paths[0] = "C:\\this\\is\\a\\test";
+  paths[1] = "C:\\this\\is";
+  paths[2] = "c:/other";
+  paths[3] = "C:\\this\\is\\a";
+  if (cwk_path_get_intersection_multiple(paths, 4) != 3) {
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
+
+int intersection_multiple_unequal_roots(void)
+{
+  const char *paths[3];
+
+  cwk_path_set_style(CWK_STYLE_WINDOWS);
+
+  paths[0] = "C:\\this\\is\\a\\test";
+  paths[1] = "C:\\other";
+  paths[2] = "D:\\this\\is\\a\\test";
+  if (cwk_path_get_intersection_multiple(paths, 3) != 0) {
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
+
+int intersection_multiple_skipped(void)
+{
+  const char *paths[3];
+
+  cwk_path_set_style(CWK_STYLE_UNIX);
+
+  paths[0] = "/test/abc/../foo/bar";
+  paths[1] = "/test/foo/har";
+  paths[2] = "/test/./foo//baz/";
+  if (cwk_path_get_intersection_multiple(paths, 3) != 16) {
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
+
+int intersection_multiple_single(void)
+{
+  const char *paths[1];
+
+  cwk_path_set_style(CWK_STYLE_UNIX);
+
+  paths[0] = "/test/foo/har/..";
+  if (cwk_path_get_intersection_multiple(paths, 1) != 9) {
+    return EXIT_FAILURE;
+  }
+
+  if (cwk_path_get_intersection_multiple(paths, 0) != 0) {
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -259,3 +259,154 @@ int normalize_do_nothing(void)
 
   return EXIT_SUCCESS;
 }
+
+int normalize_is_normalized(void)
+{
+  size_t i;
+  const struct
+  {
+    enum cwk_path_style style;
+    const char *path;
+    bool expected;
+  } cases[] = {{CWK_STYLE_UNIX, "/var", true}, {CWK_STYLE_UNIX, "/", true},
+    {CWK_STYLE_UNIX, "", true}, {CWK_STYLE_UNIX, ".", true},
+    {CWK_STYLE_UNIX, "..", true}, {CWK_STYLE_UNIX, "../../a/b", true},
+    {CWK_STYLE_UNIX, "a/b.c/.d", true}, {CWK_STYLE_UNIX, "./a", false},
+    {CWK_STYLE_UNIX, "a/.", false}, {CWK_STYLE_UNIX, "a/..", false},
+    {CWK_STYLE_UNIX, "a/../b", false}, {CWK_STYLE_UNIX, "../a/..", false},
+    {CWK_STYLE_UNIX, "/..", false}, {CWK_STYLE_UNIX, "//var", false},
+    {CWK_STYLE_UNIX, "/var//logs", false}, {CWK_STYLE_UNIX, "/var/", false},
+    {CWK_STYLE_UNIX, "a\\b", true}, {CWK_STYLE_WINDOWS, "C:\\a\\b", true},
+    {CWK_STYLE_WINDOWS, "C:\\", true}, {CWK_STYLE_WINDOWS, "C:", true},
+    {CWK_STYLE_WINDOWS, "C:..\\a", true}, {CWK_STYLE_WINDOWS, "C:/a", false},
+    {CWK_STYLE_WINDOWS, "C:\\a/b", false}, {CWK_STYLE_WINDOWS, "C:.", false},
+    {CWK_STYLE_WINDOWS, "C:\\..", false},
+    {CWK_STYLE_WINDOWS, "\\\\server\\share\\a", true},
+    {CWK_STYLE_WINDOWS, "//server/share/a", false}};
+
+  for (i = 0; i < sizeof(cases) / sizeof(cases[0]); ++i) {
+    cwk_path_set_style(cases[i].style);
+    if (cwk_path_is_normalized(cases[i].path) != cases[i].expected) {
+      return EXIT_FAILURE;
+    }
+  }
+
+  return EXIT_SUCCESS;
+}
+
+int normalize_get_normalized(void)
+{
+  size_t length;
+  char result[FILENAME_MAX];
+  const char *input, *output;
+
+  cwk_path_set_style(CWK_STYLE_UNIX);
+
+  // A normalized path is returned as it is, and the buffer stays untouched.
+  memset(result, 1, sizeof(result));
+  input = "/var/logs/test";
+  output = cwk_path_get_normalized(input, result, sizeof(result), &length);
+  if (output != input || length != strlen(input) || result[0] != 1) {
+    return EXIT_FAILURE;
+  }
+
+  input = "/var/logs/../test/";
+  output = cwk_path_get_normalized(input, result, sizeof(result), &length);
+  if (output != result || length != 9 || strcmp(result, "/var/test") != 0) {
+    return EXIT_FAILURE;
+  }
+
+  // The buffer might be too small, in which case the total length is still
+  // returned.
+  output = cwk_path_get_normalized(input, result, 5, &length);
+  if (output != result || length != 9 || strcmp(result, "/var") != 0) {
+    return EXIT_FAILURE;
+  }
+
+  output = cwk_path_get_normalized(input, NULL, 0, &length);
+  if (output != NULL || length != 9) {
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
+
+int normalize_inplace(void)
+{
+  size_t i, length;
+  char result[FILENAME_MAX];
+  const struct
+  {
+    enum cwk_path_style style;
+    const char *input;
+    const char *expected;
+  } cases[] = {
+    {CWK_STYLE_WINDOWS, "C:/this/is/a/test/path", "C:\\this\\is\\a\\test\\path"},
+    {CWK_STYLE_WINDOWS, "C:\\..\\this\\is\\a\\test\\path",
+      "C:\\this\\is\\a\\test\\path"},
+    {CWK_STYLE_UNIX, "////", "/"}, {CWK_STYLE_UNIX, "test/..", "."},
+    {CWK_STYLE_UNIX, "/var/./logs/.//test/..//..//////", "/var"},
+    {CWK_STYLE_UNIX, "/var/././././", "/var"},
+    {CWK_STYLE_UNIX, "/var////logs//test/", "/var/logs/test"},
+    {CWK_STYLE_UNIX, "/var/logs/test/../../", "/var"},
+    {CWK_STYLE_UNIX, "rel/../../", ".."},
+    {CWK_STYLE_UNIX, "/var/logs/test/../../../../../../", "/"},
+    {CWK_STYLE_UNIX, "/var", "/var"}, {CWK_STYLE_UNIX, "", ""},
+    {CWK_STYLE_UNIX, "./", "."}, {CWK_STYLE_UNIX, "../a/../../b", "../../b"},
+    {CWK_STYLE_UNIX, "a//b/./c/..", "a/b"},
+    {CWK_STYLE_WINDOWS, "C:..\\a\\.", "C:..\\a"},
+    {CWK_STYLE_WINDOWS, "//server/share//a/../b", "\\\\server\\share\\b"}};
+
+  for (i = 0; i < sizeof(cases) / sizeof(cases[0]); ++i) {
+    cwk_path_set_style(cases[i].style);
+    strcpy(result, cases[i].input);
+    length = cwk_path_normalize_inplace(result);
+    if (length != strlen(cases[i].expected) ||
+        strcmp(result, cases[i].expected) != 0) {
+      return EXIT_FAILURE;
+    }
+  }
+
+  return EXIT_SUCCESS;
+}
+
+int normalize_sized(void)
+{
+  size_t i, size, length;
+  char *path, prefix[FILENAME_MAX], expected[FILENAME_MAX],
+    result[FILENAME_MAX];
+  const struct
+  {
+    enum cwk_path_style style;
+    const char *input;
+  } cases[] = {{CWK_STYLE_UNIX, "/var/./logs/.//test/..//..//////"},
+    {CWK_STYLE_UNIX, "../a/../../b"}, {CWK_STYLE_UNIX, "a//b/./c/.."},
+    {CWK_STYLE_UNIX, ".a/../..b/.../.."},
+    {CWK_STYLE_WINDOWS, "C:..\\a\\."},
+    {CWK_STYLE_WINDOWS, "//server/share//a/../b"},
+    {CWK_STYLE_WINDOWS, "\\\\?\\C:\\a\\.."}};
+
+  // Every prefix of the paths is copied to memory of exactly its size, which
+  // has no null-terminating character. The result must be the same as the one
+  // of the terminated prefix.
+  for (i = 0; i < sizeof(cases) / sizeof(cases[0]); ++i) {
+    cwk_path_set_style(cases[i].style);
+    for (size = 0; size <= strlen(cases[i].input); ++size) {
+      memcpy(prefix, cases[i].input, size);
+      prefix[size] = '\0';
+      length = cwk_path_normalize(prefix, expected, sizeof(expected));
+
+      path = malloc(size);
+      memcpy(path, cases[i].input, size);
+      if (cwk_path_normalize_sized(path, size, result, sizeof(result)) !=
+            length ||
+          strcmp(result, expected) != 0) {
+        free(path);
+        return EXIT_FAILURE;
+      }
+      free(path);
+    }
+  }
+
+  return EXIT_SUCCESS;
+}
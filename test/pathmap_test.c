@@ -0,0 +1,214 @@
+#include <cwalk.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static uint64_t memory[8192];
+
+static bool pathmap_verify(const struct cwk_pathmap *map, const char *path,
+  bool expected, size_t expected_value)
+{
+  size_t value;
+
+  value = (size_t)-1;
+  if (cwk_pathmap_find(map, path, &value) != expected) {
+    return false;
+  }
+
+  return !expected || value == expected_value;
+}
+
+int pathmap_simple(void)
+{
+  struct cwk_pathmap *map;
+
+  cwk_path_set_style(CWK_STYLE_UNIX);
+  map = cwk_pathmap_init(memory, sizeof(memory));
+  if (map == NULL || cwk_pathmap_get_count(map) != 0 ||
+      !cwk_pathmap_insert(map, "/var/log", 1) ||
+      !cwk_pathmap_insert(map, "a/b/../c", 2) ||
+      !cwk_pathmap_insert(map, "", 3) || !cwk_pathmap_insert(map, ".", 4) ||
+      cwk_pathmap_get_count(map) != 4) {
+    return EXIT_FAILURE;
+  }
+
+  // The paths are found no matter how they are written, as long as they are
+  // equal after normalization.
+  if (!pathmap_verify(map, "/var/log", true, 1) ||
+      !pathmap_verify(map, "/var/./log/", true, 1) ||
+      !pathmap_verify(map, "//var/tmp/../log", true, 1) ||
+      !pathmap_verify(map, "a/c", true, 2) ||
+      !pathmap_verify(map, "./a//c/", true, 2) ||
+      !pathmap_verify(map, "", true, 3) || !pathmap_verify(map, "a/..", true, 4) ||
+      !pathmap_verify(map, "var/log", false, 0) ||
+      !pathmap_verify(map, "/var/Log", false, 0) ||
+      !pathmap_verify(map, "a/b/c", false, 0) ||
+      !pathmap_verify(map, "/", false, 0)) {
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
+
+int pathmap_update(void)
+{
+  struct cwk_pathmap *map;
+
+  cwk_path_set_style(CWK_STYLE_UNIX);
+  map = cwk_pathmap_init(memory, sizeof(memory));
+  if (map == NULL || !cwk_pathmap_insert(map, "/a/b", 1) ||
+      !cwk_pathmap_insert(map, "/a/./b/", 2) ||
+      !cwk_pathmap_insert(map, "/x/../a/b", 3) ||
+      cwk_pathmap_get_count(map) != 1 || !pathmap_verify(map, "/a/b", true, 3)) {
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
+
+int pathmap_windows(void)
+{
+  struct cwk_pathmap *map;
+
+  cwk_path_set_style(CWK_STYLE_WINDOWS);
+  map = cwk_pathmap_init(memory, sizeof(memory));
+  if (map == NULL || !cwk_pathmap_insert(map, "C:\\Windows\\System32", 1) ||
+      !cwk_pathmap_insert(map, "\\\\server\\share\\folder", 2)) {
+    return EXIT_FAILURE;
+  }
+
+  if (!pathmap_verify(map, "c:/windows/system32/", true, 1) ||
+      !pathmap_verify(map, "C:\\WINDOWS\\Temp\\..\\SYSTEM32", true, 1) ||
+      !pathmap_verify(map, "//SERVER/share/folder", true, 2) ||
+      !pathmap_verify(map, "C:Windows\\System32", false, 0) ||
+      !pathmap_verify(map, "D:\\Windows\\System32", false, 0)) {
+    return EXIT_FAILURE;
+  }
+
+  // This relative path looks like a drive after normalization, but it must
+  // still be relative in the map.
+  if (!cwk_pathmap_insert(map, ".\\a:\\b", 3) ||
+      !pathmap_verify(map, "x\\..\\a:\\b", true, 3) ||
+      !pathmap_verify(map, "a:\\b", false, 0)) {
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
+
+int pathmap_many(void)
+{
+  size_t i;
+  char path[64];
+  struct cwk_pathmap *map;
+
+  cwk_path_set_style(CWK_STYLE_UNIX);
+  map = cwk_pathmap_init(memory, sizeof(memory));
+  if (map == NULL) {
+    return EXIT_FAILURE;
+  }
+
+  for (i = 0; i < 400; ++i) {
+    snprintf(path, sizeof(path), "/srv/%zu/./data/%zu", i % 7, i);
+    if (!cwk_pathmap_insert(map, path, i)) {
+      return EXIT_FAILURE;
+    }
+  }
+
+  if (cwk_pathmap_get_count(map) != 400) {
+    return EXIT_FAILURE;
+  }
+
+  for (i = 0; i < 500; ++i) {
+    snprintf(path, sizeof(path), "/srv/x/../%zu/data//%zu/", i % 7, i);
+    if (!pathmap_verify(map, path, i < 400, i)) {
+      return EXIT_FAILURE;
+    }
+  }
+
+  return EXIT_SUCCESS;
+}
+
+int pathmap_deep(void)
+{
+  size_t i;
+  char path[256], other[1024];
+  struct cwk_pathmap *map;
+
+  // Paths with many segments are compared differently, but they must still
+  // be found in the same way as short ones.
+  cwk_path_set_style(CWK_STYLE_UNIX);
+  map = cwk_pathmap_init(memory, sizeof(memory));
+  if (map == NULL) {
+    return EXIT_FAILURE;
+  }
+
+  strcpy(path, "/deep");
+  strcpy(other, "/deep");
+  for (i = 0; i < 100; ++i) {
+    strcat(path, "/a");
+    strcat(other, "/./a/x/..");
+  }
+
+  if (!cwk_pathmap_insert(map, path, 1) || !pathmap_verify(map, path, true, 1) ||
+      !pathmap_verify(map, other, true, 1) ||
+      !pathmap_verify(map, "/deep/a", false, 0)) {
+    return EXIT_FAILURE;
+  }
+
+  strcat(other, "/..");
+  if (!pathmap_verify(map, other, false, 0)) {
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
+
+int pathmap_full(void)
+{
+  size_t i, count;
+  char path[64];
+  struct cwk_pathmap *map;
+
+  // The map fills up either because of the slots or the stored paths. Once
+  // it is full, existing paths can still be found and updated.
+  cwk_path_set_style(CWK_STYLE_UNIX);
+  map = cwk_pathmap_init(memory, 2048);
+  if (map == NULL) {
+    return EXIT_FAILURE;
+  }
+
+  for (i = 0; i < 1000; ++i) {
+    snprintf(path, sizeof(path), "/path/%zu", i);
+    if (!cwk_pathmap_insert(map, path, i)) {
+      break;
+    }
+  }
+
+  count = cwk_pathmap_get_count(map);
+  if (i == 1000 || count != i || count == 0 ||
+      !cwk_pathmap_insert(map, "/path/0", 42) ||
+      !pathmap_verify(map, "/path/0", true, 42) ||
+      cwk_pathmap_get_count(map) != count) {
+    return EXIT_FAILURE;
+  }
+
+  for (i = 0; i < count; ++i) {
+    snprintf(path, sizeof(path), "/path/%zu", i);
+    if (!pathmap_verify(map, path, true, i == 0 ? 42 : i)) {
+      return EXIT_FAILURE;
+    }
+  }
+
+  return EXIT_SUCCESS;
+}
+
+int pathmap_invalid(void)
+{
+  if (cwk_pathmap_init(memory, 64) != NULL) {
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
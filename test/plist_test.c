@@ -0,0 +1,265 @@
+#include "fixture.h"
+#include <cwalk.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static uint64_t list[1024];
+static struct cwk_span spans[128];
+
+static bool plist_build(const char **paths, size_t count, size_t block_size)
+{
+  return CWK_FIXTURE_BUILD(cwk_plist_build, list, paths, count, block_size,
+    spans);
+}
+
+int plist_decode(void)
+{
+  const char *paths[] = {"/usr/lib/b", "/usr/./lib/a/", "/usr/lib",
+    "/usr/share/x/../doc", "/var", "/usr/lib-old", "rel/a", "/usr/lib/a"};
+  const char *expected[] = {"rel/a", "/usr/lib", "/usr/lib/a", "/usr/lib/b",
+    "/usr/lib-old", "/usr/share/doc", "/var"};
+  struct cwk_plist_cursor cursor;
+  char buffer[FILENAME_MAX];
+  size_t i, block_size;
+
+  cwk_path_set_style(CWK_STYLE_UNIX);
+
+  // The entries must be the same, no matter how large the blocks are.
+  for (block_size = 1; block_size <= 8; ++block_size) {
+    if (!plist_build(paths, 8, block_size) || cwk_plist_get_count(list) != 7 ||
+        cwk_plist_get_max_length(list) != 14) {
+      return EXIT_FAILURE;
+    }
+
+    if (!cwk_plist_seek(list, 0, &cursor, buffer, sizeof(buffer))) {
+      return EXIT_FAILURE;
+    }
+
+    for (i = 0; i < 7; ++i) {
+      if (strcmp(cursor.path, expected[i]) != 0 || cursor.index != i ||
+          cursor.length != strlen(expected[i])) {
+        return EXIT_FAILURE;
+      }
+
+      if (cwk_plist_next(&cursor) != (i < 6)) {
+        return EXIT_FAILURE;
+      }
+    }
+  }
+
+  return EXIT_SUCCESS;
+}
+
+int plist_seek(void)
+{
+  const char *paths[] = {"/a/b/c", "/a/b", "/a", "/a/b/d", "/a/c", "/b"};
+  const char *expected[] = {"/a", "/a/b", "/a/b/c", "/a/b/d", "/a/c", "/b"};
+  struct cwk_plist_cursor cursor;
+  char buffer[FILENAME_MAX];
+  size_t i;
+
+  cwk_path_set_style(CWK_STYLE_UNIX);
+
+  if (!plist_build(paths, 6, 4)) {
+    return EXIT_FAILURE;
+  }
+
+  for (i = 6; i > 0; --i) {
+    if (!cwk_plist_seek(list, i - 1, &cursor, buffer, sizeof(buffer)) ||
+        strcmp(cursor.path, expected[i - 1]) != 0) {
+      return EXIT_FAILURE;
+    }
+  }
+
+  // The index must exist and the buffer must be able to hold every entry.
+  if (cwk_plist_seek(list, 6, &cursor, buffer, sizeof(buffer)) ||
+      cwk_plist_seek(list, 0, &cursor, buffer, 6) ||
+      !cwk_plist_seek(list, 0, &cursor, buffer, 7)) {
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
+
+int plist_find(void)
+{
+  const char *paths[] = {"/usr/lib", "/usr/lib/a", "/usr/lib/b", "/usr/lib-old",
+    "/usr/share/doc", "/var", "rel/a", ".", "../up"};
+  struct cwk_plist_cursor cursor;
+  char buffer[FILENAME_MAX];
+  size_t block_size;
+
+  cwk_path_set_style(CWK_STYLE_UNIX);
+
+  for (block_size = 1; block_size <= 4; ++block_size) {
+    if (!plist_build(paths, 9, block_size)) {
+      return EXIT_FAILURE;
+    }
+
+    if (!cwk_plist_find(list, "/usr/./lib/b/", &cursor, buffer,
+          sizeof(buffer)) ||
+        strcmp(cursor.path, "/usr/lib/b") != 0 ||
+        !cwk_plist_find(list, "/usr/lib", &cursor, buffer, sizeof(buffer)) ||
+        !cwk_plist_find(list, "/var/x/..", &cursor, buffer, sizeof(buffer)) ||
+        !cwk_plist_find(list, "rel//a", &cursor, buffer, sizeof(buffer)) ||
+        !cwk_plist_find(list, "a/..", &cursor, buffer, sizeof(buffer)) ||
+        strcmp(cursor.path, ".") != 0 ||
+        !cwk_plist_find(list, "../up", &cursor, buffer, sizeof(buffer))) {
+      return EXIT_FAILURE;
+    }
+
+    if (cwk_plist_find(list, "/usr", &cursor, buffer, sizeof(buffer)) ||
+        cwk_plist_find(list, "/usr/lib/c", &cursor, buffer, sizeof(buffer)) ||
+        cwk_plist_find(list, "/a", &cursor, buffer, sizeof(buffer)) ||
+        cwk_plist_find(list, "/zzz", &cursor, buffer, sizeof(buffer)) ||
+        cwk_plist_find(list, "usr/lib", &cursor, buffer, sizeof(buffer))) {
+      return EXIT_FAILURE;
+    }
+  }
+
+  return EXIT_SUCCESS;
+}
+
+int plist_windows(void)
+{
+  const char *paths[] = {"C:/Windows/System32", "c:\\windows\\SYSTEM32",
+    "C:\\Windows\\Temp", "C:/Users"};
+  const char *expected[] = {"C:\\Users", "C:\\Windows\\System32",
+    "C:\\Windows\\Temp"};
+  struct cwk_plist_cursor cursor;
+  char buffer[FILENAME_MAX];
+  size_t i;
+
+  cwk_path_set_style(CWK_STYLE_WINDOWS);
+
+  // The paths are compared case insensitively, but the decoded paths keep
+  // their case.
+  if (!plist_build(paths, 4, 2) || cwk_plist_get_count(list) != 3) {
+    return EXIT_FAILURE;
+  }
+
+  cwk_plist_seek(list, 0, &cursor, buffer, sizeof(buffer));
+  for (i = 0; i < 3; ++i) {
+    if (cwk_path_get_intersection(cursor.path, expected[i]) !=
+          strlen(expected[i]) ||
+        cursor.length != strlen(expected[i])) {
+      return EXIT_FAILURE;
+    }
+    cwk_plist_next(&cursor);
+  }
+
+  if (!cwk_plist_find(list, "c:/users", &cursor, buffer, sizeof(buffer)) ||
+      strcmp(cursor.path, "C:\\Users") != 0) {
+    return EXIT_FAILURE;
+  }
+
+  // The list can only be searched with the style it was built with.
+  cwk_path_set_style(CWK_STYLE_UNIX);
+  if (cwk_plist_find(list, "C:\\Users", &cursor, buffer, sizeof(buffer))) {
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
+
+int plist_segments(void)
+{
+  const char *paths[] = {"/var/log/syslog", "/var/log/auth.log"};
+  struct cwk_plist_cursor cursor;
+  struct cwk_segment segment;
+  char buffer[FILENAME_MAX];
+
+  cwk_path_set_style(CWK_STYLE_UNIX);
+
+  if (!plist_build(paths, 2, 16)) {
+    return EXIT_FAILURE;
+  }
+
+  // The decoded path is a normal path, so the segments can be iterated.
+  cwk_plist_seek(list, 1, &cursor, buffer, sizeof(buffer));
+  if (!cwk_path_get_last_segment(cursor.path, &segment) ||
+      strncmp(segment.begin, "syslog", segment.size) != 0 ||
+      !cwk_path_get_previous_segment(&segment) ||
+      strncmp(segment.begin, "log", segment.size) != 0) {
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
+
+int plist_compact(void)
+{
+  char storage[128][32];
+  const char *paths[128];
+  size_t i, size, total;
+
+  cwk_path_set_style(CWK_STYLE_UNIX);
+
+  // Paths with long common prefixes take up a lot less memory than the plain
+  // strings.
+  total = 0;
+  for (i = 0; i < 128; ++i) {
+    snprintf(storage[i], sizeof(storage[i]), "/home/user/project/src/%03u.c",
+      (unsigned int)i);
+    paths[i] = storage[i];
+    total += strlen(storage[i]) + 1;
+  }
+
+  size = cwk_plist_build(paths, 128, 16, spans, NULL, 0);
+  if (size == 0 || size * 2 > total) {
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
+
+int plist_empty(void)
+{
+  const char *paths[] = {"/a"};
+  struct cwk_plist_cursor cursor;
+  char buffer[FILENAME_MAX];
+
+  cwk_path_set_style(CWK_STYLE_UNIX);
+
+  if (cwk_plist_build(paths, 1, 0, spans, NULL, 0) != 0 ||
+      !plist_build(NULL, 0, 16) || cwk_plist_get_count(list) != 0) {
+    return EXIT_FAILURE;
+  }
+
+  if (cwk_plist_seek(list, 0, &cursor, buffer, sizeof(buffer)) ||
+      cwk_plist_find(list, "/a", &cursor, buffer, sizeof(buffer))) {
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
+
+int plist_empty_path(void)
+{
+  const char *paths[] = {".", "b", "", "a/.."};
+  struct cwk_plist_cursor cursor;
+  char buffer[FILENAME_MAX];
+
+  cwk_path_set_style(CWK_STYLE_UNIX);
+
+  // The empty path is stored empty and comes first, so it is not mixed up with
+  // the current directory.
+  if (!plist_build(paths, 4, 2) || cwk_plist_get_count(list) != 3 ||
+      !cwk_plist_seek(list, 0, &cursor, buffer, sizeof(buffer)) ||
+      strcmp(cursor.path, "") != 0 || !cwk_plist_next(&cursor) ||
+      strcmp(cursor.path, ".") != 0 || !cwk_plist_next(&cursor) ||
+      strcmp(cursor.path, "b") != 0) {
+    return EXIT_FAILURE;
+  }
+
+  if (!cwk_plist_find(list, "", &cursor, buffer, sizeof(buffer)) ||
+      cursor.index != 0 ||
+      !cwk_plist_find(list, "./", &cursor, buffer, sizeof(buffer)) ||
+      cursor.index != 1) {
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
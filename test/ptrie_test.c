@@ -0,0 +1,424 @@
+#include "fixture.h"
+#include <cwalk.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static uint32_t trie[1024];
+static struct cwk_span spans[64];
+
+static bool ptrie_build(const char **paths, size_t count)
+{
+  return CWK_FIXTURE_BUILD(cwk_ptrie_build, trie, paths, count, spans);
+}
+
+static int ptrie_verify(const char *path, const char *expected,
+  size_t expected_length)
+{
+  size_t entry, length;
+  char buffer[FILENAME_MAX];
+
+  if (!cwk_ptrie_find_longest(trie, path, &entry, &length)) {
+    return expected == NULL ? EXIT_SUCCESS : EXIT_FAILURE;
+  }
+
+  if (expected == NULL || length != expected_length) {
+    return EXIT_FAILURE;
+  }
+
+  cwk_ptrie_get_path(trie, entry, buffer, sizeof(buffer));
+  if (strcmp(buffer, expected) != 0) {
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
+
+int ptrie_longest_simple(void)
+{
+  const char *paths[] = {"/var", "/var/log", "/home/user", "/home/other"};
+
+  cwk_path_set_style(CWK_STYLE_UNIX);
+
+  if (!ptrie_build(paths, 4)) {
+    return EXIT_FAILURE;
+  }
+
+  if (ptrie_verify("/var/log/syslog", "/var/log", 8) ||
+      ptrie_verify("/var/lib", "/var", 4) ||
+      ptrie_verify("/var", "/var", 4) || ptrie_verify("/home", NULL, 0) ||
+      ptrie_verify("/home/user/file", "/home/user", 10) ||
+      ptrie_verify("/home/users", NULL, 0) || ptrie_verify("/", NULL, 0) ||
+      ptrie_verify("var/log", NULL, 0)) {
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
+
+int ptrie_longest_normalized(void)
+{
+  const char *paths[] = {"/var/./log/", "/usr/lib/../share", "/../opt"};
+
+  cwk_path_set_style(CWK_STYLE_UNIX);
+
+  if (!ptrie_build(paths, 3)) {
+    return EXIT_FAILURE;
+  }
+
+  if (ptrie_verify("/var//log/syslog", "/var/log", 9) ||
+      ptrie_verify("/var/x/../log/syslog", "/var/log", 13) ||
+      ptrie_verify("/usr/share/doc", "/usr/share", 10) ||
+      ptrie_verify("/usr/lib", NULL, 0) ||
+      ptrie_verify("/opt/../opt/a", "/opt", 11) ||
+      ptrie_verify("/var/log/../lib", NULL, 0)) {
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
+
+int ptrie_longest_root(void)
+{
+  const char *paths[] = {"/", "/a/b"};
+
+  cwk_path_set_style(CWK_STYLE_UNIX);
+
+  if (!ptrie_build(paths, 2)) {
+    return EXIT_FAILURE;
+  }
+
+  if (ptrie_verify("/a/b/c", "/a/b", 4) || ptrie_verify("/a/c", "/", 1) ||
+      ptrie_verify("/", "/", 1) || ptrie_verify("a", NULL, 0)) {
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
+
+int ptrie_longest_relative(void)
+{
+  const char *paths[] = {"..", "src", "./"};
+
+  cwk_path_set_style(CWK_STYLE_UNIX);
+
+  if (!ptrie_build(paths, 3)) {
+    return EXIT_FAILURE;
+  }
+
+  if (ptrie_verify("src/main.c", "src", 3) ||
+      ptrie_verify("../other", "..", 2) ||
+      ptrie_verify("test/../../x", "..", 10) ||
+      ptrie_verify("include", ".", 0) || ptrie_verify("/src", NULL, 0)) {
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
+
+int ptrie_longest_windows(void)
+{
+  const char *paths[] = {"C:/Windows/System32", "C:\\users", "\\\\srv\\x\\a"};
+
+  cwk_path_set_style(CWK_STYLE_WINDOWS);
+
+  if (!ptrie_build(paths, 3)) {
+    return EXIT_FAILURE;
+  }
+
+  if (ptrie_verify("c:\\windows\\system32\\drivers",
+        "C:\\Windows\\System32", 19) ||
+      ptrie_verify("C:/Users/me", "C:\\users", 8) ||
+      ptrie_verify("//SRV/x/a/b", "\\\\srv\\x\\a", 9) ||
+      ptrie_verify("D:\\users", NULL, 0) ||
+      ptrie_verify("C:users", NULL, 0)) {
+    return EXIT_FAILURE;
+  }
+
+  // The trie can only be searched with the style it was built with.
+  cwk_path_set_style(CWK_STYLE_UNIX);
+  if (ptrie_verify("C:/Users/me", NULL, 0)) {
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
+
+int ptrie_entries(void)
+{
+  const char *paths[] = {"/b", "/a/c", "/a", "/a/./c", "/b/"};
+  const char *expected[] = {"/a", "/a/c", "/b"};
+  char buffer[FILENAME_MAX];
+  size_t i;
+
+  cwk_path_set_style(CWK_STYLE_UNIX);
+
+  if (!ptrie_build(paths, 5)) {
+    return EXIT_FAILURE;
+  }
+
+  if (cwk_ptrie_get_entry_count(trie) != 3) {
+    return EXIT_FAILURE;
+  }
+
+  // The entries are numbered in sorted order and duplicates are merged.
+  for (i = 0; i < 3; ++i) {
+    if (cwk_ptrie_get_path(trie, i, buffer, sizeof(buffer)) !=
+          strlen(expected[i]) ||
+        strcmp(buffer, expected[i]) != 0) {
+      return EXIT_FAILURE;
+    }
+  }
+
+  if (cwk_ptrie_get_path(trie, 3, buffer, sizeof(buffer)) != 0 ||
+      *buffer != '\0') {
+    return EXIT_FAILURE;
+  }
+
+  // The output is truncated like all other outputs.
+  if (cwk_ptrie_get_path(trie, 1, buffer, 3) != 4 ||
+      strcmp(buffer, "/a") != 0) {
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
+
+int ptrie_empty(void)
+{
+  size_t entry, length;
+
+  cwk_path_set_style(CWK_STYLE_UNIX);
+
+  if (!ptrie_build(NULL, 0)) {
+    return EXIT_FAILURE;
+  }
+
+  if (cwk_ptrie_get_entry_count(trie) != 0 ||
+      cwk_ptrie_find_longest(trie, "/a", &entry, &length)) {
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
+
+int ptrie_empty_path(void)
+{
+  const char *paths[] = {"src", "", "."};
+  char buffer[FILENAME_MAX];
+  size_t entry;
+
+  cwk_path_set_style(CWK_STYLE_UNIX);
+
+  // The empty path and the current directory are two different entries, just
+  // like they are after normalization. The empty path has no root at all.
+  if (!ptrie_build(paths, 3) || cwk_ptrie_get_entry_count(trie) != 3 ||
+      !cwk_ptrie_find(trie, "", &entry) || entry != 0 ||
+      cwk_ptrie_get_path(trie, entry, buffer, sizeof(buffer)) != 0 ||
+      !cwk_ptrie_find(trie, "a/..", &entry) || entry != 1 ||
+      cwk_ptrie_get_path(trie, entry, buffer, sizeof(buffer)) != 1 ||
+      strcmp(buffer, ".") != 0) {
+    return EXIT_FAILURE;
+  }
+
+  if (ptrie_verify("src/a", "src", 3) || ptrie_verify("include", ".", 0) ||
+      ptrie_verify("/usr", "", 0)) {
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
+
+int ptrie_intersection(void)
+{
+  char storage[64][32], buffer[FILENAME_MAX];
+  const char *paths[64], *roots[8];
+  size_t i, j, entry, length, best, best_length;
+  unsigned int seed;
+  const char *segments[] = {"a", "b", "c", ".."};
+
+  cwk_path_set_style(CWK_STYLE_UNIX);
+
+  // We generate random paths and verify the result against the intersection
+  // with every single root.
+  seed = 3;
+  for (i = 0; i < 64; ++i) {
+    strcpy(storage[i], "/");
+    for (j = (seed >> 16) % 5; j > 0; --j) {
+      seed = seed * 1103515245 + 12345;
+      strcat(storage[i], segments[(seed >> 16) % 4]);
+      strcat(storage[i], "/");
+    }
+    seed = seed * 1103515245 + 12345;
+    paths[i] = storage[i];
+  }
+
+  memcpy(roots, paths, sizeof(roots));
+  if (!ptrie_build(roots, 8)) {
+    return EXIT_FAILURE;
+  }
+
+  for (i = 0; i < 64; ++i) {
+    best = 0;
+    best_length = 0;
+    for (j = 0; j < cwk_ptrie_get_entry_count(trie); ++j) {
+      cwk_ptrie_get_path(trie, j, buffer, sizeof(buffer));
+      length = cwk_path_get_intersection(buffer, buffer);
+      if (cwk_path_get_intersection(buffer, paths[i]) == length &&
+          cwk_path_get_intersection(paths[i], buffer) >= best_length) {
+        best = j + 1;
+        best_length = cwk_path_get_intersection(paths[i], buffer);
+      }
+    }
+
+    if (cwk_ptrie_find_longest(trie, paths[i], &entry, &length)) {
+      if (best != entry + 1 || best_length != length) {
+        return EXIT_FAILURE;
+      }
+    } else if (best != 0) {
+      return EXIT_FAILURE;
+    }
+  }
+
+  return EXIT_SUCCESS;
+}
+
+int ptrie_find(void)
+{
+  const char *paths[] = {"/var/log", "/var/lib/", "C:\\a"};
+  size_t entry;
+
+  cwk_path_set_style(CWK_STYLE_UNIX);
+
+  if (!ptrie_build(paths, 3)) {
+    return EXIT_FAILURE;
+  }
+
+  if (!cwk_ptrie_find(trie, "/var/lib", &entry) || entry != 1 ||
+      !cwk_ptrie_find(trie, "/var/./log/", &entry) || entry != 2 ||
+      !cwk_ptrie_find(trie, "C:\\a", &entry) || entry != 0) {
+    return EXIT_FAILURE;
+  }
+
+  if (cwk_ptrie_find(trie, "/var", &entry) ||
+      cwk_ptrie_find(trie, "/var/log/x", &entry) ||
+      cwk_ptrie_find(trie, "/VAR/LOG", &entry) ||
+      cwk_ptrie_find(trie, "var/log", &entry)) {
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
+
+int ptrie_find_prefix(void)
+{
+  const char *paths[] = {"/usr/lib/a", "/usr/lib", "/usr/share/b", "/usr/lib/b",
+    "/var", "/usr/lib-old"};
+  size_t first, count;
+
+  cwk_path_set_style(CWK_STYLE_UNIX);
+
+  if (!ptrie_build(paths, 6)) {
+    return EXIT_FAILURE;
+  }
+
+  // The entries are "/usr/lib", "/usr/lib/a", "/usr/lib/b", "/usr/lib-old",
+  // "/usr/share/b" and "/var", in that order.
+  if (!cwk_ptrie_find_prefix(trie, "/usr/lib", &first, &count) || first != 0 ||
+      count != 3) {
+    return EXIT_FAILURE;
+  }
+
+  if (!cwk_ptrie_find_prefix(trie, "/usr/./share/", &first, &count) ||
+      first != 4 || count != 1) {
+    return EXIT_FAILURE;
+  }
+
+  if (!cwk_ptrie_find_prefix(trie, "/", &first, &count) || first != 0 ||
+      count != 6) {
+    return EXIT_FAILURE;
+  }
+
+  if (cwk_ptrie_find_prefix(trie, "/usr/li", &first, &count) ||
+      cwk_ptrie_find_prefix(trie, "usr", &first, &count)) {
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
+
+int ptrie_relocate(void)
+{
+  const char *paths[] = {"/var/log", "/var/lib", "/home/user"};
+  uint32_t copy[1024];
+  char buffer[FILENAME_MAX];
+  size_t size, entry, length;
+  FILE *file;
+
+  cwk_path_set_style(CWK_STYLE_UNIX);
+
+  // The trie does not contain any pointers, so it still works after it has
+  // been written to a file and read back to a different address.
+  size = cwk_ptrie_build(paths, 3, spans, trie, sizeof(trie));
+  file = tmpfile();
+  if (file == NULL) {
+    return EXIT_FAILURE;
+  }
+
+  fwrite(trie, 1, size, file);
+  memset(trie, 0, sizeof(trie));
+  rewind(file);
+  if (fread(copy, 1, sizeof(copy), file) != size) {
+    fclose(file);
+    return EXIT_FAILURE;
+  }
+
+  fclose(file);
+
+  if (!cwk_ptrie_is_valid(copy, size) ||
+      !cwk_ptrie_find_longest(copy, "/var/log/x", &entry, &length) ||
+      length != 8) {
+    return EXIT_FAILURE;
+  }
+
+  cwk_ptrie_get_path(copy, entry, buffer, sizeof(buffer));
+  if (strcmp(buffer, "/var/log") != 0) {
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
+
+int ptrie_invalid(void)
+{
+  const char *paths[] = {"/var/log", "/var/lib", "/home/user"};
+  uint32_t copy[1024];
+  size_t size, i;
+
+  cwk_path_set_style(CWK_STYLE_UNIX);
+
+  size = cwk_ptrie_build(paths, 3, spans, trie, sizeof(trie));
+  if (!cwk_ptrie_is_valid(trie, size)) {
+    return EXIT_FAILURE;
+  }
+
+  // A truncated trie is never valid.
+  for (i = 0; i < size; ++i) {
+    if (cwk_ptrie_is_valid(trie, i)) {
+      return EXIT_FAILURE;
+    }
+  }
+
+  // Neither is a trie with a broken header or broken nodes. The header has six
+  // values, and every node has seven values.
+  for (i = 0; i < 6 + 7 * 2; ++i) {
+    memcpy(copy, trie, size);
+    copy[i] ^= 0x10000;
+    if (cwk_ptrie_is_valid(copy, size)) {
+      return EXIT_FAILURE;
+    }
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -354,3 +354,52 @@ int relative_simple(void)
 
   return EXIT_SUCCESS;
 }
+
+int relative_sized(void)
+{
+  size_t i, size_a, size_b, length;
+  char *a, *b, prefix_a[FILENAME_MAX], prefix_b[FILENAME_MAX],
+    expected[FILENAME_MAX], result[FILENAME_MAX];
+  const struct
+  {
+    enum cwk_path_style style;
+    const char *a;
+    const char *b;
+  } cases[] = {{CWK_STYLE_UNIX, "/dev/./foo/bar", "/dev/foo/baz/qux"},
+    {CWK_STYLE_UNIX, "../a/b", "../a/c/.."},
+    {CWK_STYLE_WINDOWS, "C:\\path\\a", "c:/PATH/b"},
+    {CWK_STYLE_WINDOWS, "//server/share/a", "\\\\server\\share"}};
+
+  // Every combination of prefixes is copied to memory of exactly its size,
+  // which has no null-terminating character. The result must be the same as
+  // the one of the terminated prefixes.
+  for (i = 0; i < sizeof(cases) / sizeof(cases[0]); ++i) {
+    cwk_path_set_style(cases[i].style);
+    for (size_a = 0; size_a <= strlen(cases[i].a); ++size_a) {
+      for (size_b = 0; size_b <= strlen(cases[i].b); ++size_b) {
+        memcpy(prefix_a, cases[i].a, size_a);
+        prefix_a[size_a] = '\0';
+        memcpy(prefix_b, cases[i].b, size_b);
+        prefix_b[size_b] = '\0';
+        length = cwk_path_get_relative(prefix_a, prefix_b, expected,
+          sizeof(expected));
+
+        a = malloc(size_a);
+        b = malloc(size_b);
+        memcpy(a, cases[i].a, size_a);
+        memcpy(b, cases[i].b, size_b);
+        if (cwk_path_get_relative_sized(a, size_a, b, size_b, result,
+              sizeof(result)) != length ||
+            strcmp(result, expected) != 0) {
+          free(a);
+          free(b);
+          return EXIT_FAILURE;
+        }
+        free(a);
+        free(b);
+      }
+    }
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,241 @@
+#include "fixture.h"
+#include <cwalk.h>
+#include <errno.h>
+#include <limits.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+static char base[256];
+static uint64_t memory[4096];
+
+static bool resolve_setup(void)
+{
+  // The base is the canonical path of the temporary directory, which is the
+  // base of all expected results.
+  return cwk_fixture_setup(base, sizeof(base), "resolve") &&
+         cwk_fixture_create(base, "a", NULL) &&
+         cwk_fixture_create(base, "a/b", NULL) &&
+         cwk_fixture_create(base, "a/b/file", "") &&
+         cwk_fixture_create(base, "c", NULL) &&
+         cwk_fixture_create(base, "c/file", "") &&
+         cwk_fixture_link(base, "a/b", "rel") &&
+         cwk_fixture_link(base, base, "abs") &&
+         cwk_fixture_link(base, "rel/file", "chain") &&
+         cwk_fixture_link(base, "loop_b", "loop_a") &&
+         cwk_fixture_link(base, "loop_a", "loop_b") &&
+         cwk_fixture_link(base, "missing", "dangling");
+}
+
+static int resolve_verify(struct cwk_resolve_cache *cache, const char *path,
+  const char *expected)
+{
+  size_t length;
+  char input[PATH_MAX], result[PATH_MAX], buffer[PATH_MAX];
+
+  // The expected result is relative to the base, except for the base itself.
+  snprintf(input, sizeof(input), "%s/%s", base, path);
+  if (*expected == '\0') {
+    snprintf(result, sizeof(result), "%s", base);
+  } else {
+    snprintf(result, sizeof(result), "%s/%s", base, expected);
+  }
+
+  length = cwk_path_resolve(input, cache, buffer, sizeof(buffer));
+  if (length != strlen(result) || strcmp(buffer, result) != 0) {
+    return EXIT_FAILURE;
+  }
+
+  // The result must be the same as the one of realpath.
+  if (realpath(input, result) == NULL || strcmp(buffer, result) != 0) {
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
+
+static int resolve_verify_error(const char *path, int expected)
+{
+  char input[PATH_MAX], buffer[PATH_MAX];
+
+  snprintf(input, sizeof(input), "%s/%s", base, path);
+  errno = 0;
+  if (cwk_path_resolve(input, NULL, buffer, sizeof(buffer)) != 0 ||
+      errno != expected) {
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
+
+int resolve_simple(void)
+{
+  int result;
+
+  cwk_path_set_style(CWK_STYLE_UNIX);
+  if (!resolve_setup()) {
+    return EXIT_FAILURE;
+  }
+
+  result = resolve_verify(NULL, "a/./b/../b/file", "a/b/file");
+  result |= resolve_verify(NULL, "a//b///", "a/b");
+  result |= resolve_verify(NULL, "a/..", "");
+  result |= resolve_verify(NULL, "c/../a/./b/file", "a/b/file");
+
+  cwk_fixture_teardown(base);
+  return result;
+}
+
+int resolve_links(void)
+{
+  int result;
+
+  cwk_path_set_style(CWK_STYLE_UNIX);
+  if (!resolve_setup()) {
+    return EXIT_FAILURE;
+  }
+
+  result = resolve_verify(NULL, "rel/file", "a/b/file");
+  result |= resolve_verify(NULL, "rel", "a/b");
+  result |= resolve_verify(NULL, "abs/abs/c/file", "c/file");
+  result |= resolve_verify(NULL, "chain", "a/b/file");
+
+  // The back segment is applied after the link is resolved, so it goes back
+  // to the parent of the target of the link.
+  result |= resolve_verify(NULL, "rel/..", "a");
+  result |= resolve_verify(NULL, "rel/../../c/file", "c/file");
+
+  cwk_fixture_teardown(base);
+  return result;
+}
+
+int resolve_relative(void)
+{
+  int result;
+  char cwd[PATH_MAX], buffer[PATH_MAX];
+
+  cwk_path_set_style(CWK_STYLE_UNIX);
+  if (!resolve_setup() || getcwd(cwd, sizeof(cwd)) == NULL) {
+    return EXIT_FAILURE;
+  }
+
+  result = EXIT_FAILURE;
+  if (chdir(base) == 0) {
+    cwk_path_resolve("rel/file", NULL, buffer, sizeof(buffer));
+    result = strcmp(buffer + strlen(base), "/a/b/file") == 0 &&
+                 strncmp(buffer, base, strlen(base)) == 0
+               ? EXIT_SUCCESS
+               : EXIT_FAILURE;
+    if (cwk_path_resolve(".", NULL, buffer, sizeof(buffer)) != strlen(base) ||
+        strcmp(buffer, base) != 0) {
+      result = EXIT_FAILURE;
+    }
+    if (chdir(cwd) != 0) {
+      result = EXIT_FAILURE;
+    }
+  }
+
+  cwk_fixture_teardown(base);
+  return result;
+}
+
+int resolve_errors(void)
+{
+  int result;
+  char buffer[PATH_MAX];
+
+  cwk_path_set_style(CWK_STYLE_UNIX);
+  if (!resolve_setup()) {
+    return EXIT_FAILURE;
+  }
+
+  result = resolve_verify_error("missing", ENOENT);
+  result |= resolve_verify_error("dangling", ENOENT);
+  result |= resolve_verify_error("a/b/file/x", ENOTDIR);
+  result |= resolve_verify_error("a/b/file/", ENOTDIR);
+  result |= resolve_verify_error("loop_a", ELOOP);
+
+  errno = 0;
+  if (cwk_path_resolve("", NULL, buffer, sizeof(buffer)) != 0 ||
+      errno != ENOENT) {
+    result = EXIT_FAILURE;
+  }
+
+  cwk_path_set_style(CWK_STYLE_WINDOWS);
+  errno = 0;
+  if (cwk_path_resolve(base, NULL, buffer, sizeof(buffer)) != 0 ||
+      errno != EINVAL) {
+    result = EXIT_FAILURE;
+  }
+
+  cwk_fixture_teardown(base);
+  return result;
+}
+
+int resolve_truncation(void)
+{
+  int result;
+  size_t length;
+  char input[PATH_MAX], buffer[8];
+
+  cwk_path_set_style(CWK_STYLE_UNIX);
+  if (!resolve_setup()) {
+    return EXIT_FAILURE;
+  }
+
+  snprintf(input, sizeof(input), "%s/rel/file", base);
+  length = cwk_path_resolve(input, NULL, buffer, sizeof(buffer));
+  result = length == strlen(base) + 9 && strlen(buffer) == 7 &&
+               strncmp(buffer, base, 7) == 0
+             ? EXIT_SUCCESS
+             : EXIT_FAILURE;
+
+  cwk_fixture_teardown(base);
+  return result;
+}
+
+int resolve_cache(void)
+{
+  int result;
+  size_t count;
+  struct cwk_resolve_cache *cache;
+
+  cwk_path_set_style(CWK_STYLE_UNIX);
+  if (cwk_resolve_cache_init(memory, 16) != NULL) {
+    return EXIT_FAILURE;
+  }
+
+  cache = cwk_resolve_cache_init(memory, sizeof(memory));
+  if (cache == NULL || cwk_resolve_cache_get_count(cache) != 0 ||
+      !resolve_setup()) {
+    return EXIT_FAILURE;
+  }
+
+  // The first lookup fills the cache with the directories and links, while
+  // the files themselves are not cached.
+  result = resolve_verify(cache, "rel/file", "a/b/file");
+  count = cwk_resolve_cache_get_count(cache);
+  if (count == 0) {
+    result = EXIT_FAILURE;
+  }
+
+  // Now the same directories are taken from the cache, so the cache doesn't
+  // grow anymore.
+  result |= resolve_verify(cache, "rel/file", "a/b/file");
+  result |= resolve_verify(cache, "a/b/file", "a/b/file");
+  result |= resolve_verify(cache, "rel/../b/file", "a/b/file");
+  if (cwk_resolve_cache_get_count(cache) != count) {
+    result = EXIT_FAILURE;
+  }
+
+  result |= resolve_verify(cache, "abs/chain", "a/b/file");
+  result |= resolve_verify(cache, "c/file", "c/file");
+  if (cwk_resolve_cache_get_count(cache) != count + 3) {
+    result = EXIT_FAILURE;
+  }
+
+  cwk_fixture_teardown(base);
+  return result;
+}
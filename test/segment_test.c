@@ -688,3 +688,71 @@ int segment_first(void)
 
   return EXIT_SUCCESS;
 }
+
+int segment_split_simple(void)
+{
+  struct cwk_span spans[8];
+  const char *path;
+
+  cwk_path_set_style(CWK_STYLE_UNIX);
+  path = "/var//log/./../a-very-long-segment-name.txt/";
+  if (cwk_path_split(path, spans, 8) != 5) {
+    return EXIT_FAILURE;
+  }
+
+  if (spans[0].offset != 1 || spans[0].length != 3 ||
+      spans[0].type != CWK_NORMAL || spans[1].offset != 6 ||
+      spans[1].length != 3 || spans[2].offset != 10 || spans[2].length != 1 ||
+      spans[2].type != CWK_CURRENT || spans[3].offset != 12 ||
+      spans[3].length != 2 || spans[3].type != CWK_BACK ||
+      spans[4].offset != 15 || spans[4].length != 28 ||
+      spans[4].type != CWK_NORMAL) {
+    return EXIT_FAILURE;
+  }
+
+  if (cwk_path_split("/", spans, 8) != 0 || cwk_path_split("", spans, 8) != 0 ||
+      cwk_path_split("...", spans, 8) != 1 || spans[0].type != CWK_NORMAL) {
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
+
+int segment_split_windows(void)
+{
+  struct cwk_span spans[8];
+  const char *path;
+
+  // The root is never part of a segment, and both separators are accepted.
+  cwk_path_set_style(CWK_STYLE_WINDOWS);
+  path = "\\\\server\\share\\folder/sub\\file.txt";
+  if (cwk_path_split(path, spans, 8) != 3 || spans[0].offset != 15 ||
+      spans[0].length != 6 || spans[1].offset != 22 || spans[1].length != 3 ||
+      spans[2].offset != 26 || spans[2].length != 8) {
+    return EXIT_FAILURE;
+  }
+
+  // In the unix style, a backslash is a regular character.
+  cwk_path_set_style(CWK_STYLE_UNIX);
+  if (cwk_path_split(path, spans, 8) != 2 || spans[0].offset != 0 ||
+      spans[0].length != 21 || spans[1].length != 12) {
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
+
+int segment_split_too_small(void)
+{
+  struct cwk_span spans[3];
+
+  // Only the spans which fit are written, but all segments are counted.
+  cwk_path_set_style(CWK_STYLE_UNIX);
+  memset(spans, 0, sizeof(spans));
+  if (cwk_path_split("a/b/c/d/e", spans, 2) != 5 || spans[1].offset != 2 ||
+      spans[2].length != 0 || cwk_path_split("a/b/c/d/e", NULL, 0) != 5) {
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
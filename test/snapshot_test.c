@@ -0,0 +1,327 @@
+#include "fixture.h"
+#include <cwalk.h>
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static char base[256];
+static uint64_t old_memory[2048];
+static uint64_t new_memory[2048];
+
+static void snapshot_age(const char *path)
+{
+  DIR *dir;
+  struct dirent *item;
+  char buffer[PATH_MAX];
+  struct timespec times[2];
+
+  // All files get the same old modification time, so any change is visible no
+  // matter how coarse the clock of the file system is.
+  times[0].tv_sec = 1000;
+  times[0].tv_nsec = 0;
+  times[1] = times[0];
+  dir = opendir(path);
+  if (dir != NULL) {
+    while ((item = readdir(dir)) != NULL) {
+      if (strcmp(item->d_name, ".") != 0 && strcmp(item->d_name, "..") != 0) {
+        snprintf(buffer, sizeof(buffer), "%s/%s", path, item->d_name);
+        snapshot_age(buffer);
+      }
+    }
+    closedir(dir);
+  }
+
+  utimensat(AT_FDCWD, path, times, AT_SYMLINK_NOFOLLOW);
+}
+
+static bool snapshot_setup(void)
+{
+  if (!cwk_fixture_setup(base, sizeof(base), "snapshot") ||
+      !cwk_fixture_create(base, "a", NULL) ||
+      !cwk_fixture_create(base, "a/b", NULL) ||
+      !cwk_fixture_create(base, "a/b/c", NULL) ||
+      !cwk_fixture_create(base, "d", NULL) ||
+      !cwk_fixture_create(base, "a/b/c/file", "c") ||
+      !cwk_fixture_create(base, "a/b/file", "b") ||
+      !cwk_fixture_create(base, "a/file1", "1") ||
+      !cwk_fixture_create(base, "a/file2", "2") ||
+      !cwk_fixture_create(base, "d/file", "d") ||
+      !cwk_fixture_create(base, "f", "f") ||
+      !cwk_fixture_link(base, "a", "link")) {
+    return false;
+  }
+
+  snapshot_age(base);
+  return true;
+}
+
+static void snapshot_collect(const void *old_snapshot,
+  const void *new_snapshot, char *changes, size_t size)
+{
+  size_t length;
+  char buffer[PATH_MAX];
+  const char *kinds;
+  struct cwk_snapshot_diff diff;
+
+  // Every change is written as a line with the kind of the change and the
+  // path, like "A a/new".
+  kinds = "ARM";
+  length = 0;
+  changes[0] = '\0';
+  if (!cwk_snapshot_diff_first(&diff, old_snapshot, new_snapshot)) {
+    return;
+  }
+
+  do {
+    if (diff.change == CWK_SNAPSHOT_ADDED) {
+      cwk_snapshot_get_path(new_snapshot, diff.new_entry, buffer,
+        sizeof(buffer));
+    } else {
+      cwk_snapshot_get_path(old_snapshot, diff.old_entry, buffer,
+        sizeof(buffer));
+    }
+    length += (size_t)snprintf(changes + length, size - length, "%c %s\n",
+      kinds[diff.change], buffer);
+  } while (cwk_snapshot_diff_next(&diff) && length < size);
+}
+
+int snapshot_simple(void)
+{
+  int result;
+  size_t size, other;
+  char changes[256];
+
+  cwk_path_set_style(CWK_STYLE_UNIX);
+  if (!snapshot_setup()) {
+    return EXIT_FAILURE;
+  }
+
+  // The same tree always results in the same snapshot, and there is nothing
+  // to report between them.
+  result = EXIT_SUCCESS;
+  size = cwk_snapshot_create(base, old_memory, sizeof(old_memory));
+  other = cwk_snapshot_create(base, new_memory, sizeof(new_memory));
+  if (size == 0 || size != other ||
+      memcmp(old_memory, new_memory, size) != 0 ||
+      !cwk_snapshot_is_valid(old_memory, size) ||
+      cwk_snapshot_get_count(old_memory) != 12) {
+    result = EXIT_FAILURE;
+  }
+
+  snapshot_collect(old_memory, new_memory, changes, sizeof(changes));
+  if (strcmp(changes, "") != 0) {
+    result = EXIT_FAILURE;
+  }
+
+  cwk_fixture_teardown(base);
+  return result;
+}
+
+int snapshot_diff(void)
+{
+  int result;
+  char changes[256];
+
+  cwk_path_set_style(CWK_STYLE_UNIX);
+  if (!snapshot_setup() ||
+      cwk_snapshot_create(base, old_memory, sizeof(old_memory)) == 0) {
+    return EXIT_FAILURE;
+  }
+
+  result = EXIT_SUCCESS;
+  if (!cwk_fixture_create(base, "a/new", "new") ||
+      !cwk_fixture_remove(base, "a/file2") ||
+      !cwk_fixture_create(base, "a/b/file", "changed") ||
+      !cwk_fixture_remove(base, "a/b/c") ||
+      !cwk_fixture_create(base, "x", NULL) ||
+      !cwk_fixture_create(base, "x/f", "x") ||
+      cwk_snapshot_create(base, new_memory, sizeof(new_memory)) == 0) {
+    result = EXIT_FAILURE;
+  }
+
+  // The directories which contain changes are modified themselves, and
+  // everything below an added or removed directory is reported as well.
+  snapshot_collect(old_memory, new_memory, changes, sizeof(changes));
+  if (strcmp(changes, "M .\nM a\nM a/b\nR a/b/c\nR a/b/c/file\nM a/b/file\n"
+                      "R a/file2\nA a/new\nA x\nA x/f\n") != 0) {
+    result = EXIT_FAILURE;
+  }
+
+  snapshot_collect(new_memory, old_memory, changes, sizeof(changes));
+  if (strcmp(changes, "M .\nM a\nM a/b\nA a/b/c\nA a/b/c/file\nM a/b/file\n"
+                      "A a/file2\nR a/new\nR x\nR x/f\n") != 0) {
+    result = EXIT_FAILURE;
+  }
+
+  cwk_fixture_teardown(base);
+  return result;
+}
+
+int snapshot_type(void)
+{
+  int result;
+  char changes[256];
+
+  cwk_path_set_style(CWK_STYLE_UNIX);
+  if (!snapshot_setup() ||
+      cwk_snapshot_create(base, old_memory, sizeof(old_memory)) == 0) {
+    return EXIT_FAILURE;
+  }
+
+  // A file which is replaced by a directory is modified, and the contents of
+  // the new directory are added.
+  result = EXIT_SUCCESS;
+  if (!cwk_fixture_remove(base, "f") || !cwk_fixture_create(base, "f", NULL) ||
+      !cwk_fixture_create(base, "f/x", "x") ||
+      cwk_snapshot_create(base, new_memory, sizeof(new_memory)) == 0) {
+    result = EXIT_FAILURE;
+  }
+
+  snapshot_collect(old_memory, new_memory, changes, sizeof(changes));
+  if (strcmp(changes, "M .\nM f\nA f/x\n") != 0) {
+    result = EXIT_FAILURE;
+  }
+
+  cwk_fixture_teardown(base);
+  return result;
+}
+
+int snapshot_info(void)
+{
+  int result;
+  char path[512], other[PATH_MAX];
+  struct stat expected;
+  struct cwk_snapshot_diff diff;
+  struct cwk_snapshot_info info;
+
+  cwk_path_set_style(CWK_STYLE_UNIX);
+  if (!snapshot_setup() || !cwk_fixture_create(base, "empty", NULL)) {
+    return EXIT_FAILURE;
+  }
+
+  // Compared to an empty directory, everything is added except for the root,
+  // and the information must match the one of lstat.
+  snprintf(path, sizeof(path), "%s/empty", base);
+  if (cwk_snapshot_create(path, old_memory, sizeof(old_memory)) == 0 ||
+      !cwk_fixture_remove(base, "empty") ||
+      cwk_snapshot_create(base, new_memory, sizeof(new_memory)) == 0 ||
+      !cwk_snapshot_diff_first(&diff, old_memory, new_memory)) {
+    return EXIT_FAILURE;
+  }
+
+  result = diff.change == CWK_SNAPSHOT_MODIFIED ? EXIT_SUCCESS : EXIT_FAILURE;
+  while (cwk_snapshot_diff_next(&diff)) {
+    cwk_snapshot_get_info(new_memory, diff.new_entry, &info);
+    cwk_snapshot_get_path(new_memory, diff.new_entry, path, sizeof(path));
+    snprintf(other, sizeof(other), "%s/%s", base, path);
+    if (diff.change != CWK_SNAPSHOT_ADDED || lstat(other, &expected) != 0 ||
+        info.mode != (uint32_t)expected.st_mode ||
+        info.size != (uint64_t)expected.st_size ||
+        info.inode != (uint64_t)expected.st_ino ||
+        info.mtime != 1000000000000) {
+      result = EXIT_FAILURE;
+    }
+  }
+
+  cwk_fixture_teardown(base);
+  return result;
+}
+
+int snapshot_valid(void)
+{
+  int result;
+  size_t size;
+  char changes[256];
+  static uint64_t copy[2048];
+
+  cwk_path_set_style(CWK_STYLE_UNIX);
+  if (!snapshot_setup()) {
+    return EXIT_FAILURE;
+  }
+
+  size = cwk_snapshot_create(base, old_memory, sizeof(old_memory));
+  if (size == 0) {
+    return EXIT_FAILURE;
+  }
+
+  // A copy of a snapshot can be used just like the original.
+  result = EXIT_SUCCESS;
+  memcpy(copy, old_memory, size);
+  snapshot_collect(old_memory, copy, changes, sizeof(changes));
+  if (!cwk_snapshot_is_valid(copy, size) || strcmp(changes, "") != 0) {
+    result = EXIT_FAILURE;
+  }
+
+  if (cwk_snapshot_is_valid(copy, size - 8) ||
+      cwk_snapshot_is_valid(copy, size + 8) ||
+      cwk_snapshot_is_valid(copy, 8)) {
+    result = EXIT_FAILURE;
+  }
+
+  // The magic, the root and the end of the second entry are broken.
+  ((unsigned char *)copy)[0] ^= 1;
+  if (cwk_snapshot_is_valid(copy, size)) {
+    result = EXIT_FAILURE;
+  }
+
+  memcpy(copy, old_memory, size);
+  ((uint32_t *)copy)[4 + 8] = 1;
+  if (cwk_snapshot_is_valid(copy, size)) {
+    result = EXIT_FAILURE;
+  }
+
+  memcpy(copy, old_memory, size);
+  ((uint32_t *)copy)[20 + 9] += 8;
+  if (cwk_snapshot_is_valid(copy, size)) {
+    result = EXIT_FAILURE;
+  }
+
+  cwk_fixture_teardown(base);
+  return result;
+}
+
+int snapshot_errors(void)
+{
+  int result;
+  char buffer[PATH_MAX];
+
+  cwk_path_set_style(CWK_STYLE_UNIX);
+  if (!snapshot_setup()) {
+    return EXIT_FAILURE;
+  }
+
+  result = EXIT_SUCCESS;
+  errno = 0;
+  if (cwk_snapshot_create(base, old_memory, 256) != 0 || errno != ENOBUFS) {
+    result = EXIT_FAILURE;
+  }
+
+  errno = 0;
+  if (cwk_snapshot_create(base, old_memory, 8) != 0 || errno != ENOBUFS) {
+    result = EXIT_FAILURE;
+  }
+
+  snprintf(buffer, sizeof(buffer), "%s/missing", base);
+  errno = 0;
+  if (cwk_snapshot_create(buffer, old_memory, sizeof(old_memory)) != 0 ||
+      errno != ENOENT) {
+    result = EXIT_FAILURE;
+  }
+
+  snprintf(buffer, sizeof(buffer), "%s/f", base);
+  errno = 0;
+  if (cwk_snapshot_create(buffer, old_memory, sizeof(old_memory)) != 0 ||
+      errno != ENOTDIR) {
+    result = EXIT_FAILURE;
+  }
+
+  cwk_fixture_teardown(base);
+  return result;
+}
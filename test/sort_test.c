@@ -0,0 +1,235 @@
+#include <cwalk.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static int sort_verify(const char **paths, const char **expected, size_t count)
+{
+  size_t i;
+
+  cwk_path_sort(paths, count);
+  for (i = 0; i < count; ++i) {
+    if (strcmp(paths[i], expected[i]) != 0) {
+      return EXIT_FAILURE;
+    }
+  }
+
+  return EXIT_SUCCESS;
+}
+
+int sort_compare_simple(void)
+{
+  cwk_path_set_style(CWK_STYLE_UNIX);
+
+  if (cwk_path_compare("/var/log", "/var/log") != 0) {
+    return EXIT_FAILURE;
+  }
+
+  if (cwk_path_compare("/var/log", "/var/lib") <= 0) {
+    return EXIT_FAILURE;
+  }
+
+  if (cwk_path_compare("/var", "/var/log") >= 0) {
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
+
+int sort_compare_separator(void)
+{
+  cwk_path_set_style(CWK_STYLE_UNIX);
+
+  if (cwk_path_compare("a/b", "a-b") >= 0) {
+    return EXIT_FAILURE;
+  }
+
+  if (cwk_path_compare("a/b", "a.b") >= 0) {
+    return EXIT_FAILURE;
+  }
+
+  if (cwk_path_compare("/a", "a") >= 0) {
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
+
+int sort_compare_windows(void)
+{
+  cwk_path_set_style(CWK_STYLE_WINDOWS);
+
+  if (cwk_path_compare("C:\\Windows\\System32", "c:/windows/system32") != 0) {
+    return EXIT_FAILURE;
+  }
+
+  if (cwk_path_compare("C:\\a\\b", "C:\\a-b") >= 0) {
+    return EXIT_FAILURE;
+  }
+
+  cwk_path_set_style(CWK_STYLE_UNIX);
+
+  if (cwk_path_compare("C:\\Windows", "c:/windows") == 0) {
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
+
+int sort_compare_unicode(void)
+{
+  cwk_path_set_style(CWK_STYLE_WINDOWS);
+
+  if (cwk_path_compare("C:\\\xc3\x84pfel", "c:/\xc3\xa4PFEL") != 0) {
+    return EXIT_FAILURE;
+  }
+
+  if (cwk_path_compare("C:\\\xc3\xb8", "C:\\\xc5\xb8") == 0) {
+    return EXIT_FAILURE;
+  }
+
+  if (cwk_path_compare("C:\\\xc3\x84\\b", "C:\\\xc3\xa4-b") >= 0) {
+    return EXIT_FAILURE;
+  }
+
+  cwk_path_set_style(CWK_STYLE_UNIX);
+
+  if (cwk_path_compare("/\xc3\x84pfel", "/\xc3\xa4pfel") == 0) {
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
+
+int sort_simple(void)
+{
+  const char *paths[] = {"/var/log/syslog", "/var/lib", "/etc/hosts", "/var",
+    "/etc"};
+  const char *expected[] = {"/etc", "/etc/hosts", "/var", "/var/lib",
+    "/var/log/syslog"};
+
+  cwk_path_set_style(CWK_STYLE_UNIX);
+
+  return sort_verify(paths, expected, sizeof(paths) / sizeof(*paths));
+}
+
+int sort_contiguous(void)
+{
+  const char *paths[] = {"a-b", "a/c", "a.b", "a/b/c", "a", "a/b", "a0"};
+  const char *expected[] = {"a", "a/b", "a/b/c", "a/c", "a-b", "a.b", "a0"};
+
+  cwk_path_set_style(CWK_STYLE_UNIX);
+
+  return sort_verify(paths, expected, sizeof(paths) / sizeof(*paths));
+}
+
+int sort_windows(void)
+{
+  const char *paths[] = {"C:\\b", "c:\\A\\x", "C:/a", "C:\\a-b", "C:\\B\\y"};
+  const char *expected[] = {"C:/a", "c:\\A\\x", "C:\\a-b", "C:\\b",
+    "C:\\B\\y"};
+
+  cwk_path_set_style(CWK_STYLE_WINDOWS);
+
+  return sort_verify(paths, expected, sizeof(paths) / sizeof(*paths));
+}
+
+int sort_large(void)
+{
+  char *storage;
+  const char **paths;
+  size_t i, count;
+  unsigned int seed;
+
+  cwk_path_set_style(CWK_STYLE_UNIX);
+
+  // We generate a lot of paths which share long prefixes, and many of them are
+  // equal. This covers the partitioning and not just the insertion sort.
+  count = 5000;
+  storage = malloc(count * 32);
+  paths = malloc(count * sizeof(*paths));
+  seed = 1;
+  for (i = 0; i < count; ++i) {
+    seed = seed * 1103515245 + 12345;
+    snprintf(&storage[i * 32], 32, "/usr/%u/%u%c%u", (seed >> 16) % 7,
+      (seed >> 8) % 13, (seed & 1) ? '/' : '-', (seed >> 4) % 5);
+    paths[i] = &storage[i * 32];
+  }
+
+  cwk_path_sort(paths, count);
+  for (i = 1; i < count; ++i) {
+    if (cwk_path_compare(paths[i - 1], paths[i]) > 0) {
+      free(paths);
+      free(storage);
+      return EXIT_FAILURE;
+    }
+  }
+
+  free(paths);
+  free(storage);
+  return EXIT_SUCCESS;
+}
+
+#ifdef CWK_THREADS
+int sort_parallel(void)
+{
+  int result;
+  char *storage;
+  const char **paths, **expected;
+  size_t i, count;
+  unsigned int seed;
+
+  cwk_path_set_style(CWK_STYLE_UNIX);
+
+  // The array has to be large enough to be split over several threads. The
+  // result must be the same as the one of the sequential sort.
+  count = 200000;
+  storage = malloc(count * 32);
+  paths = malloc(count * sizeof(*paths));
+  expected = malloc(count * sizeof(*expected));
+  seed = 1;
+  for (i = 0; i < count; ++i) {
+    seed = seed * 1103515245 + 12345;
+    snprintf(&storage[i * 32], 32, "/usr/%u/%u%c%u", (seed >> 16) % 7,
+      (seed >> 8) % 113, (seed & 1) ? '/' : '-', (seed >> 4) % 997);
+    paths[i] = &storage[i * 32];
+    expected[i] = paths[i];
+  }
+
+  result = EXIT_SUCCESS;
+  cwk_path_sort(expected, count);
+  cwk_path_sort_parallel(paths, count, 4);
+  for (i = 0; i < count; ++i) {
+    if (strcmp(paths[i], expected[i]) != 0) {
+      result = EXIT_FAILURE;
+      break;
+    }
+  }
+
+  // Small arrays and a single thread are sorted without any threads.
+  cwk_path_sort_parallel(paths, 100, 0);
+  cwk_path_sort_parallel(paths, count, 1);
+  cwk_path_sort_parallel(paths, 0, 4);
+  for (i = 1; i < count; ++i) {
+    if (cwk_path_compare(paths[i - 1], paths[i]) > 0) {
+      result = EXIT_FAILURE;
+    }
+  }
+
+  free(expected);
+  free(paths);
+  free(storage);
+  return result;
+}
+#endif
+
+int sort_empty(void)
+{
+  const char *paths[] = {"", "/", "", "a"};
+  const char *expected[] = {"", "", "/", "a"};
+
+  cwk_path_set_style(CWK_STYLE_UNIX);
+
+  cwk_path_sort(paths, 0);
+  return sort_verify(paths, expected, sizeof(paths) / sizeof(*paths));
+}
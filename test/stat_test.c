@@ -0,0 +1,207 @@
+#include "fixture.h"
+#include <cwalk.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#define STAT_FILES 300
+
+static char base[256];
+static char inputs[STAT_FILES + 4][PATH_MAX];
+static const char *paths[STAT_FILES + 4];
+static int errors[STAT_FILES + 4];
+static uint32_t modes[STAT_FILES + 4];
+static uint64_t sizes[STAT_FILES + 4];
+static uint64_t inodes[STAT_FILES + 4];
+static int64_t mtimes[STAT_FILES + 4];
+
+static bool stat_setup(void)
+{
+  size_t i;
+  char name[64];
+
+  if (!cwk_fixture_setup(base, sizeof(base), "stat")) {
+    return false;
+  }
+
+  // The files are spread over a few directories and every file has a
+  // different size, so the results can't be mixed up.
+  for (i = 0; i < 3; ++i) {
+    snprintf(name, sizeof(name), "%zu", i);
+    if (!cwk_fixture_create(base, name, NULL)) {
+      return false;
+    }
+  }
+
+  for (i = 0; i < STAT_FILES; ++i) {
+    snprintf(name, sizeof(name), "%zu/file%zu", i % 3, i);
+    if (!cwk_fixture_fill(base, name, i)) {
+      return false;
+    }
+    snprintf(inputs[i], PATH_MAX, "%s/%s", base, name);
+  }
+
+  snprintf(inputs[STAT_FILES], PATH_MAX, "%s/0/missing", base);
+  snprintf(inputs[STAT_FILES + 1], PATH_MAX, "%s/0/file0/x", base);
+  snprintf(inputs[STAT_FILES + 2], PATH_MAX, "%s/link", base);
+  snprintf(inputs[STAT_FILES + 3], PATH_MAX, "%s/1", base);
+  if (!cwk_fixture_link(base, "0/file3", "link")) {
+    return false;
+  }
+
+  // The array is in reverse order, so the sort has something to do.
+  for (i = 0; i < STAT_FILES + 4; ++i) {
+    paths[i] = inputs[STAT_FILES + 3 - i];
+  }
+
+  return true;
+}
+
+static int stat_verify(size_t count, int flags)
+{
+  size_t i;
+  struct stat expected;
+
+  // The paths must be sorted and every result must be the same as the one of
+  // fstatat.
+  if (count != STAT_FILES + 2) {
+    return EXIT_FAILURE;
+  }
+
+  for (i = 0; i < STAT_FILES + 4; ++i) {
+    if (i > 0 && cwk_path_compare(paths[i - 1], paths[i]) > 0) {
+      return EXIT_FAILURE;
+    }
+
+    if (fstatat(AT_FDCWD, paths[i], &expected, flags) != 0) {
+      if (errors[i] != errno) {
+        return EXIT_FAILURE;
+      }
+    } else if (errors[i] != 0 || modes[i] != (uint32_t)expected.st_mode ||
+               sizes[i] != (uint64_t)expected.st_size ||
+               inodes[i] != (uint64_t)expected.st_ino || mtimes[i] <= 0) {
+      return EXIT_FAILURE;
+    }
+  }
+
+  return EXIT_SUCCESS;
+}
+
+static size_t stat_run(size_t queue_depth, int flags,
+  enum cwk_stat_method method)
+{
+  struct cwk_stat_results results;
+
+  memset(errors, -1, sizeof(errors));
+  results.errors = errors;
+  results.modes = modes;
+  results.sizes = sizes;
+  results.inodes = inodes;
+  results.mtimes = mtimes;
+  return cwk_path_stat_batch(paths, STAT_FILES + 4, &results, queue_depth,
+    flags, method);
+}
+
+int stat_threads(void)
+{
+  int result;
+
+  cwk_path_set_style(CWK_STYLE_UNIX);
+  if (!stat_setup()) {
+    return EXIT_FAILURE;
+  }
+
+  result = stat_verify(stat_run(8, 0, CWK_STAT_THREADS), 0);
+  result |= stat_verify(stat_run(1, 0, CWK_STAT_THREADS), 0);
+  result |= stat_verify(stat_run(1000, AT_SYMLINK_NOFOLLOW, CWK_STAT_THREADS),
+    AT_SYMLINK_NOFOLLOW);
+
+  cwk_fixture_teardown(base);
+  return result;
+}
+
+int stat_io_uring(void)
+{
+  int result;
+  size_t i, count;
+
+  cwk_path_set_style(CWK_STYLE_UNIX);
+  if (!stat_setup()) {
+    return EXIT_FAILURE;
+  }
+
+  // If io_uring is not available, all paths must have failed with ENOSYS.
+  count = stat_run(16, 0, CWK_STAT_IO_URING);
+  if (count == 0) {
+    result = EXIT_SUCCESS;
+    for (i = 0; i < STAT_FILES + 4; ++i) {
+      if (errors[i] != ENOSYS) {
+        result = EXIT_FAILURE;
+      }
+    }
+  } else {
+    result = stat_verify(count, 0);
+    result |= stat_verify(stat_run(1, 0, CWK_STAT_IO_URING), 0);
+    result |= stat_verify(stat_run(5000, AT_SYMLINK_NOFOLLOW,
+                            CWK_STAT_IO_URING),
+      AT_SYMLINK_NOFOLLOW);
+  }
+
+  cwk_fixture_teardown(base);
+  return result;
+}
+
+int stat_auto(void)
+{
+  int result;
+
+  cwk_path_set_style(CWK_STYLE_UNIX);
+  if (!stat_setup()) {
+    return EXIT_FAILURE;
+  }
+
+  result = stat_verify(stat_run(0, 0, CWK_STAT_AUTO), 0);
+  result |= stat_verify(stat_run(64, 0, CWK_STAT_AUTO), 0);
+
+  cwk_fixture_teardown(base);
+  return result;
+}
+
+int stat_fields(void)
+{
+  int result;
+  size_t i, count;
+  struct cwk_stat_results results;
+
+  cwk_path_set_style(CWK_STYLE_UNIX);
+  if (!stat_setup()) {
+    return EXIT_FAILURE;
+  }
+
+  // Only the fields which are requested are written.
+  memset(sizes, 0, sizeof(sizes));
+  memset(&results, 0, sizeof(results));
+  results.sizes = sizes;
+  count = cwk_path_stat_batch(paths, STAT_FILES + 4, &results, 4, 0,
+    CWK_STAT_AUTO);
+  result = count == STAT_FILES + 2 ? EXIT_SUCCESS : EXIT_FAILURE;
+  for (i = 0; i < STAT_FILES + 4; ++i) {
+    if (strcmp(paths[i], inputs[299]) == 0 && sizes[i] != 299) {
+      result = EXIT_FAILURE;
+    }
+  }
+
+  // Nothing happens without any paths.
+  if (cwk_path_stat_batch(paths, 0, &results, 4, 0, CWK_STAT_AUTO) != 0) {
+    result = EXIT_FAILURE;
+  }
+
+  cwk_fixture_teardown(base);
+  return result;
+}
@@ -0,0 +1,485 @@
+#include "fixture.h"
+#include <cwalk.h>
+#include <dirent.h>
+#include <errno.h>
+#include <limits.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static char base[256];
+static uint64_t memory[8192];
+
+static bool usage_setup(void)
+{
+  size_t i;
+  char buffer[PATH_MAX];
+
+  if (!cwk_fixture_setup(base, sizeof(base), "usage")) {
+    return false;
+  }
+
+  if (!cwk_fixture_create(base, "a", NULL) ||
+      !cwk_fixture_create(base, "a/b", NULL) ||
+      !cwk_fixture_create(base, "a/b/c", NULL) ||
+      !cwk_fixture_create(base, "d", NULL) ||
+      !cwk_fixture_fill(base, "a/file1", 100) ||
+      !cwk_fixture_fill(base, "a/file2", 200) ||
+      !cwk_fixture_fill(base, "a/b/file", 300) ||
+      !cwk_fixture_fill(base, "a/b/c/file", 9000) ||
+      !cwk_fixture_fill(base, "f", 50) ||
+      !cwk_fixture_link(base, "a", "link")) {
+    return false;
+  }
+
+  // A lot of directories, so that multiple threads have something to do.
+  for (i = 0; i < 40; ++i) {
+    snprintf(buffer, sizeof(buffer), "d/%zu", i);
+    if (!cwk_fixture_create(base, buffer, NULL)) {
+      return false;
+    }
+    snprintf(buffer, sizeof(buffer), "d/%zu/file", i);
+    if (!cwk_fixture_fill(base, buffer, i + 1)) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+static void usage_count(const char *path, struct cwk_usage_totals *totals)
+{
+  DIR *dir;
+  struct dirent *item;
+  struct stat info;
+  char buffer[PATH_MAX];
+
+  // This is the reference, which simply inspects every file by its path.
+  lstat(path, &info);
+  totals->size += (uint64_t)info.st_size;
+  totals->blocks += (uint64_t)info.st_blocks;
+  dir = opendir(path);
+  while ((item = readdir(dir)) != NULL) {
+    if (strcmp(item->d_name, ".") == 0 || strcmp(item->d_name, "..") == 0) {
+      continue;
+    }
+
+    snprintf(buffer, sizeof(buffer), "%s/%s", path, item->d_name);
+    lstat(buffer, &info);
+    if (S_ISDIR(info.st_mode)) {
+      ++totals->directories;
+      usage_count(buffer, totals);
+    } else {
+      ++totals->files;
+      totals->size += (uint64_t)info.st_size;
+      totals->blocks += (uint64_t)info.st_blocks;
+    }
+  }
+  closedir(dir);
+}
+
+static bool usage_verify(const void *usage, const char *path)
+{
+  size_t entry;
+  char buffer[PATH_MAX];
+  struct cwk_usage_totals expected, totals;
+
+  memset(&expected, 0, sizeof(expected));
+  snprintf(buffer, sizeof(buffer), "%s/%s", base, path);
+  usage_count(buffer, &expected);
+
+  return cwk_usage_find(usage, path, &entry) &&
+         cwk_usage_get_totals(usage, entry, &totals) &&
+         totals.size == expected.size && totals.blocks == expected.blocks &&
+         totals.files == expected.files &&
+         totals.directories == expected.directories && totals.errors == 0;
+}
+
+int usage_simple(void)
+{
+  int result;
+  size_t count;
+
+  cwk_path_set_style(CWK_STYLE_UNIX);
+  if (!usage_setup()) {
+    return EXIT_FAILURE;
+  }
+
+  // Every directory gets an entry, and the totals must match the ones of the
+  // reference, no matter how many threads are used.
+  result = EXIT_SUCCESS;
+  count = cwk_usage_scan(base, memory, sizeof(memory), 10, 4);
+  if (count != 45 || cwk_usage_get_count(memory) != count ||
+      !usage_verify(memory, "") || !usage_verify(memory, "a") ||
+      !usage_verify(memory, "a/b") || !usage_verify(memory, "a/b/c") ||
+      !usage_verify(memory, "d") || !usage_verify(memory, "d/17")) {
+    result = EXIT_FAILURE;
+  }
+
+  count = cwk_usage_scan(base, memory, sizeof(memory), 10, 1);
+  if (count != 45 || !usage_verify(memory, "") || !usage_verify(memory, "a")) {
+    result = EXIT_FAILURE;
+  }
+
+  count = cwk_usage_scan(base, memory, sizeof(memory), 10, 0);
+  if (count != 45 || !usage_verify(memory, "")) {
+    result = EXIT_FAILURE;
+  }
+
+  cwk_fixture_teardown(base);
+  return result;
+}
+
+int usage_depth(void)
+{
+  int result;
+  size_t entry;
+
+  cwk_path_set_style(CWK_STYLE_UNIX);
+  if (!usage_setup()) {
+    return EXIT_FAILURE;
+  }
+
+  // Deeper directories don't get an entry, but they are still counted in
+  // their parents.
+  result = EXIT_SUCCESS;
+  if (cwk_usage_scan(base, memory, sizeof(memory), 1, 4) != 3 ||
+      !usage_verify(memory, "") || !usage_verify(memory, "a") ||
+      !usage_verify(memory, "d") || cwk_usage_find(memory, "a/b", &entry)) {
+    result = EXIT_FAILURE;
+  }
+
+  if (cwk_usage_scan(base, memory, sizeof(memory), 0, 4) != 1 ||
+      !usage_verify(memory, "")) {
+    result = EXIT_FAILURE;
+  }
+
+  cwk_fixture_teardown(base);
+  return result;
+}
+
+int usage_full(void)
+{
+  int result;
+  size_t count;
+
+  cwk_path_set_style(CWK_STYLE_UNIX);
+  if (!usage_setup()) {
+    return EXIT_FAILURE;
+  }
+
+  // The buffer only fits a few entries, but the totals must still be right.
+  result = EXIT_SUCCESS;
+  count = cwk_usage_scan(base, memory, 1200, 10, 4);
+  if (count == 0 || count >= 45 || !usage_verify(memory, "")) {
+    result = EXIT_FAILURE;
+  }
+
+  cwk_fixture_teardown(base);
+  return result;
+}
+
+int usage_limit(void)
+{
+  int result;
+  struct rlimit limit;
+
+  cwk_path_set_style(CWK_STYLE_UNIX);
+  if (!usage_setup()) {
+    return EXIT_FAILURE;
+  }
+
+  // There are more directories than file descriptors, so not all of them can
+  // be queued at once.
+  result = EXIT_SUCCESS;
+  if (getrlimit(RLIMIT_NOFILE, &limit) != 0) {
+    result = EXIT_FAILURE;
+  } else {
+    limit.rlim_cur = 24;
+    if (setrlimit(RLIMIT_NOFILE, &limit) != 0 ||
+        cwk_usage_scan(base, memory, sizeof(memory), 10, 4) != 45 ||
+        !usage_verify(memory, "") || !usage_verify(memory, "d")) {
+      result = EXIT_FAILURE;
+    }
+  }
+
+  cwk_fixture_teardown(base);
+  return result;
+}
+
+int usage_deep(void)
+{
+  int result;
+  size_t i, j, length;
+  struct rlimit limit, original;
+  char path[PATH_MAX];
+
+  cwk_path_set_style(CWK_STYLE_UNIX);
+  if (!usage_setup()) {
+    return EXIT_FAILURE;
+  }
+
+  // The tree is much deeper than the number of file descriptors, and most of
+  // it is deeper than the maximum depth.
+  length = (size_t)snprintf(path, sizeof(path), "a");
+  for (i = 0; i < 300; ++i) {
+    length += (size_t)snprintf(path + length, sizeof(path) - length, "/x");
+    if (!cwk_fixture_create(base, path, NULL)) {
+      return EXIT_FAILURE;
+    }
+    snprintf(path + length, sizeof(path) - length, "/file");
+    if (!cwk_fixture_fill(base, path, 10)) {
+      return EXIT_FAILURE;
+    }
+    path[length] = '\0';
+  }
+
+  // There are also more directories next to each other than fit into the
+  // queue, so a thread has to read the deep ones below them by itself.
+  if (!cwk_fixture_create(base, "w", NULL)) {
+    return EXIT_FAILURE;
+  }
+  for (i = 0; i < 10; ++i) {
+    length = (size_t)snprintf(path, sizeof(path), "w/%zu", i);
+    for (j = 0; j < 40 && cwk_fixture_create(base, path, NULL); ++j) {
+      length += (size_t)snprintf(path + length, sizeof(path) - length, "/x");
+    }
+    if (j < 40) {
+      return EXIT_FAILURE;
+    }
+  }
+
+  result = EXIT_SUCCESS;
+  if (getrlimit(RLIMIT_NOFILE, &original) != 0) {
+    result = EXIT_FAILURE;
+  } else {
+    limit = original;
+    limit.rlim_cur = 32;
+    if (setrlimit(RLIMIT_NOFILE, &limit) != 0 ||
+        cwk_usage_scan(base, memory, sizeof(memory), 2, 4) != 56) {
+      result = EXIT_FAILURE;
+    }
+
+    // The reference needs a file descriptor for every level.
+    setrlimit(RLIMIT_NOFILE, &original);
+    if (!usage_verify(memory, "") || !usage_verify(memory, "a") ||
+        !usage_verify(memory, "a/x") || !usage_verify(memory, "w/7")) {
+      result = EXIT_FAILURE;
+    }
+
+    limit.rlim_cur = 32;
+    if (setrlimit(RLIMIT_NOFILE, &limit) != 0 ||
+        cwk_usage_scan(base, memory, sizeof(memory), 0, 1) != 1) {
+      result = EXIT_FAILURE;
+    }
+
+    setrlimit(RLIMIT_NOFILE, &original);
+    if (!usage_verify(memory, "")) {
+      result = EXIT_FAILURE;
+    }
+  }
+
+  cwk_fixture_teardown(base);
+  return result;
+}
+
+int usage_reread(void)
+{
+  int result;
+  size_t i, j, k, length, threads[] = {1, 4};
+  struct rlimit limit, original;
+  char path[PATH_MAX];
+
+  cwk_path_set_style(CWK_STYLE_UNIX);
+  if (!cwk_fixture_setup(base, sizeof(base), "usage")) {
+    return EXIT_FAILURE;
+  }
+
+  // Files and directories are mixed, so some files come after a directory
+  // which is left to descend into a deep chain. Those files must still be
+  // counted once the directory is read again.
+  for (i = 0; i < 20; ++i) {
+    snprintf(path, sizeof(path), "f%zu", i);
+    if (!cwk_fixture_fill(base, path, i + 1)) {
+      return EXIT_FAILURE;
+    }
+  }
+  for (i = 0; i < 30; ++i) {
+    length = (size_t)snprintf(path, sizeof(path), "%zu", i);
+    for (j = 0; j < 20; ++j) {
+      if (!cwk_fixture_create(base, path, NULL)) {
+        return EXIT_FAILURE;
+      }
+      for (k = 0; k < 5; ++k) {
+        snprintf(path + length, sizeof(path) - length, "/f%zu", k);
+        if (!cwk_fixture_fill(base, path, k + 1)) {
+          return EXIT_FAILURE;
+        }
+      }
+      length += (size_t)snprintf(path + length, sizeof(path) - length, "/x");
+    }
+  }
+
+  result = EXIT_SUCCESS;
+  if (getrlimit(RLIMIT_NOFILE, &original) != 0) {
+    result = EXIT_FAILURE;
+  } else {
+    for (i = 0; i < sizeof(threads) / sizeof(*threads); ++i) {
+      limit = original;
+      limit.rlim_cur = 20;
+      if (setrlimit(RLIMIT_NOFILE, &limit) != 0 ||
+          cwk_usage_scan(base, memory, sizeof(memory), 1, threads[i]) != 31) {
+        result = EXIT_FAILURE;
+      }
+
+      setrlimit(RLIMIT_NOFILE, &original);
+      if (!usage_verify(memory, "") || !usage_verify(memory, "0") ||
+          !usage_verify(memory, "29")) {
+        result = EXIT_FAILURE;
+      }
+    }
+  }
+
+  cwk_fixture_teardown(base);
+  return result;
+}
+
+int usage_find(void)
+{
+  int result;
+  size_t entry, other;
+
+  cwk_path_set_style(CWK_STYLE_UNIX);
+  if (!usage_setup() ||
+      cwk_usage_scan(base, memory, sizeof(memory), 10, 4) == 0) {
+    return EXIT_FAILURE;
+  }
+
+  result = EXIT_SUCCESS;
+  if (!cwk_usage_find(memory, "a/b", &entry) ||
+      !cwk_usage_find(memory, "./a//b/", &other) || entry != other ||
+      !cwk_usage_find(memory, "a/b/c/../../b", &other) || entry != other ||
+      !cwk_usage_find(memory, "", &entry) || entry != 0 ||
+      !cwk_usage_find(memory, "a/..", &entry) || entry != 0) {
+    result = EXIT_FAILURE;
+  }
+
+  // Files, links and paths outside of the tree are never found.
+  if (cwk_usage_find(memory, "f", &entry) ||
+      cwk_usage_find(memory, "link", &entry) ||
+      cwk_usage_find(memory, "x", &entry) ||
+      cwk_usage_find(memory, "../a", &entry) ||
+      cwk_usage_find(memory, "/a", &entry)) {
+    result = EXIT_FAILURE;
+  }
+
+  cwk_fixture_teardown(base);
+  return result;
+}
+
+int usage_path(void)
+{
+  int result;
+  size_t entry;
+  char buffer[PATH_MAX];
+
+  cwk_path_set_style(CWK_STYLE_UNIX);
+  if (!usage_setup() ||
+      cwk_usage_scan(base, memory, sizeof(memory), 10, 4) == 0) {
+    return EXIT_FAILURE;
+  }
+
+  result = EXIT_SUCCESS;
+  if (!cwk_usage_find(memory, "a/b/c", &entry) ||
+      cwk_usage_get_path(memory, entry, buffer, sizeof(buffer)) != 5 ||
+      strcmp(buffer, "a/b/c") != 0 ||
+      cwk_usage_get_path(memory, entry, buffer, 4) != 5 ||
+      strcmp(buffer, "a/b") != 0 ||
+      cwk_usage_get_path(memory, 0, buffer, sizeof(buffer)) != 1 ||
+      strcmp(buffer, ".") != 0 ||
+      cwk_usage_get_path(memory, 1000, buffer, sizeof(buffer)) != 0) {
+    result = EXIT_FAILURE;
+  }
+
+  cwk_fixture_teardown(base);
+  return result;
+}
+
+int usage_largest(void)
+{
+  int result;
+  size_t i, count, entries[4], expected;
+  struct cwk_usage_totals a, b;
+
+  cwk_path_set_style(CWK_STYLE_UNIX);
+  if (!usage_setup() ||
+      cwk_usage_scan(base, memory, sizeof(memory), 10, 4) == 0) {
+    return EXIT_FAILURE;
+  }
+
+  // The largest directory is "d" with its 40 directories, followed by "a",
+  // which contains the largest file.
+  result = EXIT_SUCCESS;
+  count = cwk_usage_get_largest(memory, entries, 4);
+  if (count != 4 || !cwk_usage_find(memory, "d", &expected) ||
+      entries[0] != expected || !cwk_usage_find(memory, "a", &expected) ||
+      entries[1] != expected) {
+    result = EXIT_FAILURE;
+  }
+
+  for (i = 1; i < count; ++i) {
+    cwk_usage_get_totals(memory, entries[i - 1], &a);
+    cwk_usage_get_totals(memory, entries[i], &b);
+    if (a.blocks < b.blocks || entries[i] == 0) {
+      result = EXIT_FAILURE;
+    }
+  }
+
+  // There are only two entries below the root with a depth of one.
+  if (cwk_usage_scan(base, memory, sizeof(memory), 1, 4) == 0 ||
+      cwk_usage_get_largest(memory, entries, 4) != 2 ||
+      cwk_usage_get_largest(memory, entries, 0) != 0) {
+    result = EXIT_FAILURE;
+  }
+
+  cwk_fixture_teardown(base);
+  return result;
+}
+
+int usage_errors(void)
+{
+  int result;
+  char buffer[PATH_MAX];
+
+  cwk_path_set_style(CWK_STYLE_UNIX);
+  if (!usage_setup()) {
+    return EXIT_FAILURE;
+  }
+
+  result = EXIT_SUCCESS;
+  snprintf(buffer, sizeof(buffer), "%s/missing", base);
+  errno = 0;
+  if (cwk_usage_scan(buffer, memory, sizeof(memory), 10, 4) != 0 ||
+      errno != ENOENT) {
+    result = EXIT_FAILURE;
+  }
+
+  snprintf(buffer, sizeof(buffer), "%s/f", base);
+  errno = 0;
+  if (cwk_usage_scan(buffer, memory, sizeof(memory), 10, 4) != 0 ||
+      errno != ENOTDIR) {
+    result = EXIT_FAILURE;
+  }
+
+  errno = 0;
+  if (cwk_usage_scan(base, memory, 64, 10, 4) != 0 || errno != ENOBUFS) {
+    result = EXIT_FAILURE;
+  }
+
+  cwk_fixture_teardown(base);
+  return result;
+}
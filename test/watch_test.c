@@ -0,0 +1,534 @@
+#include "fixture.h"
+#include <cwalk.h>
+#include <errno.h>
+#include <limits.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static char base[256];
+static char outside[256];
+static uint64_t memory[8192];
+
+static bool watch_rename(const char *from, const char *to)
+{
+  char source[PATH_MAX], target[PATH_MAX];
+
+  snprintf(source, sizeof(source), "%s/%s", base, from);
+  snprintf(target, sizeof(target), "%s/%s", base, to);
+  return rename(source, target) == 0;
+}
+
+static bool watch_setup(void)
+{
+  if (!cwk_fixture_setup(base, sizeof(base), "watch")) {
+    return false;
+  } else if (!cwk_fixture_setup(outside, sizeof(outside), "watch")) {
+    cwk_fixture_teardown(base);
+    return false;
+  }
+
+  return cwk_fixture_create(base, "a", NULL) &&
+         cwk_fixture_create(base, "a/b", NULL) &&
+         cwk_fixture_create(base, "a/b/file", "b") &&
+         cwk_fixture_create(base, "a/file", "a") &&
+         cwk_fixture_create(base, "d", NULL) &&
+         cwk_fixture_create(base, "d/file", "d") &&
+         cwk_fixture_create(base, "f", "f");
+}
+
+static void watch_teardown(void)
+{
+  cwk_fixture_teardown(outside);
+  cwk_fixture_teardown(base);
+}
+
+static void watch_collect(const struct cwk_watch *watch, uint64_t generation,
+  char *changes, size_t size)
+{
+  size_t length;
+  char buffer[PATH_MAX];
+  const char *kinds;
+  struct cwk_watch_changes iterator;
+
+  // Every change is written as a line with the kind of the change and the
+  // path, like "A a/new". The newest changes come first.
+  kinds = "ARM";
+  length = 0;
+  changes[0] = '\0';
+  if (!cwk_watch_changes_first(&iterator, watch, generation)) {
+    return;
+  }
+
+  do {
+    cwk_watch_get_path(watch, iterator.entry, buffer, sizeof(buffer));
+    length += (size_t)snprintf(changes + length, size - length, "%c %s\n",
+      kinds[iterator.change], buffer);
+  } while (cwk_watch_changes_next(&iterator) && length < size);
+}
+
+int watch_simple(void)
+{
+  int result;
+  size_t entry, other;
+  char buffer[PATH_MAX], changes[256];
+  struct cwk_watch *watch;
+
+  cwk_path_set_style(CWK_STYLE_UNIX);
+  if (!watch_setup()) {
+    return EXIT_FAILURE;
+  }
+
+  result = EXIT_SUCCESS;
+  watch = cwk_watch_init(memory, sizeof(memory), base);
+  if (watch == NULL) {
+    watch_teardown();
+    return EXIT_FAILURE;
+  }
+
+  if (cwk_watch_get_count(watch) != 8 ||
+      cwk_watch_get_generation(watch) != 0 ||
+      cwk_watch_get_oldest_generation(watch) != 0 ||
+      cwk_watch_get_fd(watch) < 0) {
+    result = EXIT_FAILURE;
+  }
+
+  // Paths are normalized before they are looked up, and absolute paths have
+  // to be below the watched directory.
+  snprintf(buffer, sizeof(buffer), "%s/a/./b/../b/file", base);
+  if (!cwk_watch_find(watch, "a/b/file", &entry) ||
+      !cwk_watch_find(watch, buffer, &other) || entry != other ||
+      cwk_watch_get_path(watch, entry, buffer, sizeof(buffer)) != 8 ||
+      strcmp(buffer, "a/b/file") != 0) {
+    result = EXIT_FAILURE;
+  }
+
+  if (!cwk_watch_find(watch, ".", &entry) || entry != 0 ||
+      cwk_watch_get_path(watch, entry, buffer, sizeof(buffer)) != 1 ||
+      strcmp(buffer, ".") != 0 || !cwk_watch_find(watch, "a/../d", &entry) ||
+      cwk_watch_get_path(watch, entry, buffer, sizeof(buffer)) != 1 ||
+      strcmp(buffer, "d") != 0 || cwk_watch_find(watch, "missing", &entry) ||
+      cwk_watch_find(watch, "../d", &entry) ||
+      cwk_watch_find(watch, "/tmp", &entry)) {
+    result = EXIT_FAILURE;
+  }
+
+  // Nothing happened, so there is no new generation.
+  watch_collect(watch, 0, changes, sizeof(changes));
+  if (cwk_watch_update(watch) != 0 || cwk_watch_get_generation(watch) != 0 ||
+      strcmp(changes, "") != 0) {
+    result = EXIT_FAILURE;
+  }
+
+  cwk_watch_close(watch);
+  watch_teardown();
+  return result;
+}
+
+int watch_added(void)
+{
+  int result;
+  size_t entry;
+  char changes[256];
+  struct cwk_watch *watch;
+
+  cwk_path_set_style(CWK_STYLE_UNIX);
+  if (!watch_setup()) {
+    return EXIT_FAILURE;
+  }
+
+  result = EXIT_SUCCESS;
+  watch = cwk_watch_init(memory, sizeof(memory), base);
+  if (watch == NULL) {
+    watch_teardown();
+    return EXIT_FAILURE;
+  }
+
+  // The file of the new directory exists before the directory is watched,
+  // so it is found by walking the directory.
+  if (!cwk_fixture_create(base, "a/new", "new") ||
+      !cwk_fixture_create(base, "x", NULL) ||
+      !cwk_fixture_create(base, "x/f", "x") || cwk_watch_update(watch) != 0 ||
+      cwk_watch_get_generation(watch) != 1 ||
+      cwk_watch_get_count(watch) != 11 ||
+      !cwk_watch_find(watch, "x/f", &entry)) {
+    result = EXIT_FAILURE;
+  }
+
+  watch_collect(watch, 0, changes, sizeof(changes));
+  if (strcmp(changes, "A x/f\nA x\nA a/new\n") != 0) {
+    result = EXIT_FAILURE;
+  }
+
+  // The new directory is watched as well.
+  if (!cwk_fixture_remove(base, "x/f") || cwk_watch_update(watch) != 0 ||
+      cwk_watch_get_generation(watch) != 2 ||
+      cwk_watch_find(watch, "x/f", &entry)) {
+    result = EXIT_FAILURE;
+  }
+
+  watch_collect(watch, 1, changes, sizeof(changes));
+  if (strcmp(changes, "R x/f\n") != 0) {
+    result = EXIT_FAILURE;
+  }
+
+  // The file has been added and removed since the first generation.
+  watch_collect(watch, 0, changes, sizeof(changes));
+  if (strcmp(changes, "A x\nA a/new\n") != 0) {
+    result = EXIT_FAILURE;
+  }
+
+  cwk_watch_close(watch);
+  watch_teardown();
+  return result;
+}
+
+int watch_modify(void)
+{
+  int result;
+  char buffer[PATH_MAX], changes[256];
+  struct cwk_watch *watch;
+
+  cwk_path_set_style(CWK_STYLE_UNIX);
+  if (!watch_setup()) {
+    return EXIT_FAILURE;
+  }
+
+  result = EXIT_SUCCESS;
+  watch = cwk_watch_init(memory, sizeof(memory), base);
+  if (watch == NULL) {
+    watch_teardown();
+    return EXIT_FAILURE;
+  }
+
+  // Several events of the same file are only reported once.
+  snprintf(buffer, sizeof(buffer), "%s/a/file", base);
+  if (!cwk_fixture_create(base, "a/file", "1") ||
+      !cwk_fixture_create(base, "a/file", "2") ||
+      chmod(buffer, 0600) != 0 || cwk_watch_update(watch) != 0 ||
+      cwk_watch_get_generation(watch) != 1) {
+    result = EXIT_FAILURE;
+  }
+
+  watch_collect(watch, 0, changes, sizeof(changes));
+  if (strcmp(changes, "M a/file\n") != 0) {
+    result = EXIT_FAILURE;
+  }
+
+  if (!cwk_fixture_create(base, "f", "changed") ||
+      cwk_watch_update(watch) != 0 ||
+      cwk_watch_get_generation(watch) != 2) {
+    result = EXIT_FAILURE;
+  }
+
+  watch_collect(watch, 1, changes, sizeof(changes));
+  if (strcmp(changes, "M f\n") != 0) {
+    result = EXIT_FAILURE;
+  }
+
+  watch_collect(watch, 0, changes, sizeof(changes));
+  if (strcmp(changes, "M f\nM a/file\n") != 0) {
+    result = EXIT_FAILURE;
+  }
+
+  cwk_watch_close(watch);
+  watch_teardown();
+  return result;
+}
+
+int watch_removed(void)
+{
+  int result;
+  size_t entry;
+  char changes[256];
+  struct cwk_watch *watch;
+
+  cwk_path_set_style(CWK_STYLE_UNIX);
+  if (!watch_setup()) {
+    return EXIT_FAILURE;
+  }
+
+  result = EXIT_SUCCESS;
+  watch = cwk_watch_init(memory, sizeof(memory), base);
+  if (watch == NULL) {
+    watch_teardown();
+    return EXIT_FAILURE;
+  }
+
+  // A file which comes and goes within one update has never been visible.
+  if (!cwk_fixture_create(base, "a/new", "new") ||
+      !cwk_fixture_remove(base, "a/new") ||
+      cwk_watch_update(watch) != 0 || cwk_watch_get_generation(watch) != 0 ||
+      cwk_watch_get_count(watch) != 8) {
+    result = EXIT_FAILURE;
+  }
+
+  if (!cwk_fixture_remove(base, "a/b/file") ||
+      !cwk_fixture_remove(base, "a/b") ||
+      cwk_watch_update(watch) != 0 || cwk_watch_get_generation(watch) != 1 ||
+      cwk_watch_get_count(watch) != 6 ||
+      cwk_watch_find(watch, "a/b", &entry)) {
+    result = EXIT_FAILURE;
+  }
+
+  watch_collect(watch, 0, changes, sizeof(changes));
+  if (strcmp(changes, "R a/b\nR a/b/file\n") != 0) {
+    result = EXIT_FAILURE;
+  }
+
+  // Something which has been added and removed since then is not reported.
+  if (!cwk_fixture_create(base, "x", NULL) || cwk_watch_update(watch) != 0 ||
+      !cwk_fixture_remove(base, "x") || cwk_watch_update(watch) != 0 ||
+      cwk_watch_get_generation(watch) != 3) {
+    result = EXIT_FAILURE;
+  }
+
+  watch_collect(watch, 1, changes, sizeof(changes));
+  if (strcmp(changes, "") != 0) {
+    result = EXIT_FAILURE;
+  }
+
+  watch_collect(watch, 2, changes, sizeof(changes));
+  if (strcmp(changes, "R x\n") != 0) {
+    result = EXIT_FAILURE;
+  }
+
+  cwk_watch_close(watch);
+  watch_teardown();
+  return result;
+}
+
+int watch_move(void)
+{
+  int result;
+  size_t entry;
+  char changes[256];
+  struct cwk_watch *watch;
+
+  cwk_path_set_style(CWK_STYLE_UNIX);
+  if (!watch_setup()) {
+    return EXIT_FAILURE;
+  }
+
+  result = EXIT_SUCCESS;
+  watch = cwk_watch_init(memory, sizeof(memory), base);
+  if (watch == NULL) {
+    watch_teardown();
+    return EXIT_FAILURE;
+  }
+
+  // The directory moves with everything inside of it, so only the directory
+  // itself is reported.
+  if (!watch_rename("a", "z") || cwk_watch_update(watch) != 0 ||
+      cwk_watch_get_generation(watch) != 1 ||
+      cwk_watch_get_count(watch) != 8 ||
+      !cwk_watch_find(watch, "z/b/file", &entry) ||
+      cwk_watch_find(watch, "a/file", &entry)) {
+    result = EXIT_FAILURE;
+  }
+
+  watch_collect(watch, 0, changes, sizeof(changes));
+  if (strcmp(changes, "A z\nR a\n") != 0) {
+    result = EXIT_FAILURE;
+  }
+
+  // The directories below the moved one are still watched.
+  if (!cwk_fixture_create(base, "z/b/new", "new") ||
+      cwk_watch_update(watch) != 0 ||
+      cwk_watch_get_count(watch) != 9) {
+    result = EXIT_FAILURE;
+  }
+
+  watch_collect(watch, 1, changes, sizeof(changes));
+  if (strcmp(changes, "A z/b/new\n") != 0) {
+    result = EXIT_FAILURE;
+  }
+
+  // A file which is moved over another one replaces it.
+  if (!watch_rename("z/b/new", "z/file") || cwk_watch_update(watch) != 0 ||
+      cwk_watch_get_count(watch) != 8) {
+    result = EXIT_FAILURE;
+  }
+
+  watch_collect(watch, 2, changes, sizeof(changes));
+  if (strcmp(changes, "A z/file\nR z/b/new\nR z/file\n") != 0) {
+    result = EXIT_FAILURE;
+  }
+
+  cwk_watch_close(watch);
+  watch_teardown();
+  return result;
+}
+
+int watch_outside(void)
+{
+  int result;
+  size_t entry;
+  char source[PATH_MAX], target[PATH_MAX], changes[256];
+  struct cwk_watch *watch;
+
+  cwk_path_set_style(CWK_STYLE_UNIX);
+  if (!watch_setup()) {
+    return EXIT_FAILURE;
+  }
+
+  result = EXIT_SUCCESS;
+  watch = cwk_watch_init(memory, sizeof(memory), base);
+  if (watch == NULL) {
+    watch_teardown();
+    return EXIT_FAILURE;
+  }
+
+  // Moving a directory out of the tree removes everything inside of it.
+  snprintf(source, sizeof(source), "%s/d", base);
+  snprintf(target, sizeof(target), "%s/d", outside);
+  if (rename(source, target) != 0 || cwk_watch_update(watch) != 0 ||
+      cwk_watch_get_count(watch) != 6 ||
+      cwk_watch_find(watch, "d/file", &entry)) {
+    result = EXIT_FAILURE;
+  }
+
+  watch_collect(watch, 0, changes, sizeof(changes));
+  if (strcmp(changes, "R d\nR d/file\n") != 0) {
+    result = EXIT_FAILURE;
+  }
+
+  // Moving it back in adds it again, with everything inside of it.
+  snprintf(source, sizeof(source), "%s/e", base);
+  if (rename(target, source) != 0 || cwk_watch_update(watch) != 0 ||
+      cwk_watch_get_count(watch) != 8 ||
+      !cwk_watch_find(watch, "e/file", &entry)) {
+    result = EXIT_FAILURE;
+  }
+
+  watch_collect(watch, 1, changes, sizeof(changes));
+  if (strcmp(changes, "A e/file\nA e\n") != 0) {
+    result = EXIT_FAILURE;
+  }
+
+  cwk_watch_close(watch);
+  watch_teardown();
+  return result;
+}
+
+int watch_full(void)
+{
+  int i, result;
+  char name[16];
+  uint64_t small[750];
+  struct cwk_watch *watch;
+
+  cwk_path_set_style(CWK_STYLE_UNIX);
+  if (!watch_setup()) {
+    return EXIT_FAILURE;
+  }
+
+  result = EXIT_SUCCESS;
+  errno = 0;
+  if (cwk_watch_init(small, 100, base) != NULL || errno != ENOBUFS) {
+    result = EXIT_FAILURE;
+  }
+
+  watch = cwk_watch_init(small, sizeof(small), base);
+  if (watch == NULL) {
+    watch_teardown();
+    return EXIT_FAILURE;
+  }
+
+  for (i = 0; i < 40; ++i) {
+    snprintf(name, sizeof(name), "file%02d", i);
+    if (!cwk_fixture_create(base, name, "x")) {
+      result = EXIT_FAILURE;
+    }
+  }
+
+  if (cwk_watch_update(watch) != 0 || cwk_watch_get_count(watch) != 48) {
+    result = EXIT_FAILURE;
+  }
+
+  for (i = 0; i < 40; ++i) {
+    snprintf(name, sizeof(name), "file%02d", i);
+    if (!cwk_fixture_remove(base, name)) {
+      result = EXIT_FAILURE;
+    }
+  }
+
+  if (cwk_watch_update(watch) != 0 || cwk_watch_get_count(watch) != 8 ||
+      cwk_watch_get_oldest_generation(watch) != 0) {
+    result = EXIT_FAILURE;
+  }
+
+  // The removed files have to be forgotten to make room for the new ones, so
+  // the changes since before their removal are not known anymore.
+  for (i = 40; i < 80; ++i) {
+    snprintf(name, sizeof(name), "file%02d", i);
+    if (!cwk_fixture_create(base, name, "x")) {
+      result = EXIT_FAILURE;
+    }
+  }
+
+  if (cwk_watch_update(watch) != 0 || cwk_watch_get_count(watch) != 48 ||
+      cwk_watch_get_generation(watch) != 3 ||
+      cwk_watch_get_oldest_generation(watch) != 2) {
+    result = EXIT_FAILURE;
+  }
+
+  cwk_watch_close(watch);
+
+  // The whole tree doesn't fit at all.
+  errno = 0;
+  if (cwk_watch_init(small, sizeof(small) / 2, base) != NULL ||
+      errno != ENOBUFS) {
+    result = EXIT_FAILURE;
+  }
+
+  watch_teardown();
+  return result;
+}
+
+int watch_errors(void)
+{
+  int result;
+  char buffer[PATH_MAX];
+  struct cwk_watch *watch;
+
+  cwk_path_set_style(CWK_STYLE_UNIX);
+  if (!watch_setup()) {
+    return EXIT_FAILURE;
+  }
+
+  result = EXIT_SUCCESS;
+  snprintf(buffer, sizeof(buffer), "%s/missing", base);
+  errno = 0;
+  if (cwk_watch_init(memory, sizeof(memory), buffer) != NULL ||
+      errno != ENOENT) {
+    result = EXIT_FAILURE;
+  }
+
+  snprintf(buffer, sizeof(buffer), "%s/f", base);
+  errno = 0;
+  if (cwk_watch_init(memory, sizeof(memory), buffer) != NULL ||
+      errno != ENOTDIR) {
+    result = EXIT_FAILURE;
+  }
+
+  // The index can't continue once the watched directory is gone.
+  snprintf(buffer, sizeof(buffer), "%s/d", base);
+  watch = cwk_watch_init(memory, sizeof(memory), buffer);
+  if (watch == NULL || cwk_watch_get_count(watch) != 2) {
+    result = EXIT_FAILURE;
+  } else {
+    errno = 0;
+    if (!cwk_fixture_remove(base, "d/file") || !cwk_fixture_remove(base, "d") ||
+        cwk_watch_update(watch) != -1 || errno != ENOENT) {
+      result = EXIT_FAILURE;
+    }
+    cwk_watch_close(watch);
+  }
+
+  watch_teardown();
+  return result;
+}
@@ -41,6 +41,64 @@ int windows_intersection_case(void)
   return EXIT_SUCCESS;
 }
 
+int windows_intersection_unicode(void)
+{
+  cwk_path_set_style(CWK_STYLE_WINDOWS);
+
+  // This is "Äpfel" and "äpfel", an upper and a lower case umlaut.
+  if (cwk_path_get_intersection("C:\\\xc3\x84pfel\\x",
+        "c:\\\xc3\xa4pfel\\y") != 9) {
+    return EXIT_FAILURE;
+  }
+
+  // Greek and cyrillic letters fold as well, including the final sigma.
+  if (cwk_path_get_intersection("C:\\\xce\x9f\xce\x94\xce\x9f\xce\xa3",
+        "C:\\\xce\xbf\xce\xb4\xce\xbf\xcf\x82") != 11) {
+    return EXIT_FAILURE;
+  }
+
+  if (cwk_path_get_intersection("C:\\\xd0\x9c\xd0\xb8\xd1\x80",
+        "C:\\\xd0\xbc\xd0\x98\xd0\xa0") != 9) {
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
+
+int windows_intersection_unicode_distinct(void)
+{
+  cwk_path_set_style(CWK_STYLE_WINDOWS);
+
+  // "\xc3\xb8" (ø) and "\xc5\xb8" (Ÿ) share their last byte, but they are
+  // different letters. "\xc5\xb8" (Ÿ) and "\xc3\xbf" (ÿ) are the same.
+  if (cwk_path_get_intersection("C:\\\xc3\xb8", "C:\\\xc5\xb8") != 3) {
+    return EXIT_FAILURE;
+  }
+
+  if (cwk_path_get_intersection("C:\\\xc5\xb8", "C:\\\xc3\xbf") != 5) {
+    return EXIT_FAILURE;
+  }
+
+  // The kelvin sign folds to an ascii "k", which would change the length of
+  // the path. Such mappings are not applied.
+  if (cwk_path_get_intersection("C:\\\xe2\x84\xaa", "C:\\k") != 3) {
+    return EXIT_FAILURE;
+  }
+
+  // Invalid sequences are compared byte by byte.
+  if (cwk_path_get_intersection("C:\\\xc3", "C:\\\xe3") != 3) {
+    return EXIT_FAILURE;
+  }
+
+  cwk_path_set_style(CWK_STYLE_UNIX);
+
+  if (cwk_path_get_intersection("/\xc3\x84pfel", "/\xc3\xa4pfel") != 1) {
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
+
 int windows_get_root_relative(void)
 {
   size_t size;